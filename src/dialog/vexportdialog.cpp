@@ -51,7 +51,8 @@ VExportDialog::VExportDialog(VNotebook *p_notebook,
                                QMarginsF(10, 16, 10, 10),
                                QPageLayout::Millimeter)),
       m_inExport(false),
-      m_askedToStop(false)
+      m_askedToStop(false),
+      m_batchExport(false)
 {
     if (s_lastOutputFolder.isEmpty()) {
         s_lastOutputFolder = g_config->getExportFolderPath();
@@ -556,6 +557,7 @@ void VExportDialog::startExport()
         qDebug() << "output HTMLs to temporary dir" << tmpDir.path();
 
         s_opt.m_format = ExportFormat::HTML;
+        m_batchExport = VExporter::isBatchSupported(s_opt);
         switch (s_opt.m_source) {
         case ExportSource::CurrentNote:
             ret = doExport(m_file, s_opt, tmpDir.path(), &msg, &files);
@@ -577,6 +579,10 @@ void VExportDialog::startExport()
             break;
         }
 
+        if (m_batchExport) {
+            ret = doExportBatch(s_opt, &msg, &files);
+        }
+
         s_opt.m_format = ExportFormat::OnePDF;
 
         if (m_askedToStop) {
@@ -589,6 +595,7 @@ void VExportDialog::startExport()
             ret = doExportPDFAllInOne(files, s_opt, outputFolder, &msg);
         }
     } else {
+        m_batchExport = VExporter::isBatchSupported(s_opt);
         switch (s_opt.m_source) {
         case ExportSource::CurrentNote:
             ret = doExport(m_file, s_opt, outputFolder, &msg);
@@ -609,9 +616,15 @@ void VExportDialog::startExport()
         default:
             break;
         }
+
+        if (m_batchExport) {
+            ret = doExportBatch(s_opt, &msg);
+        }
     }
 
 exit:
+    m_batchExport = false;
+    m_batchTasks.clear();
 
     if (m_askedToStop) {
         appendLogLine(tr("User cancelled the export. Aborted!"));
@@ -959,6 +972,13 @@ int VExportDialog::doExportPDF(VFile *p_file,
                                                    QFileInfo(p_file->getName()).completeBaseName() + suffix);
     QString outputPath = QDir(p_outputFolder).filePath(name);
 
+    if (m_batchExport) {
+        // Create an empty file to reserve the name.
+        VUtils::writeFileToDisk(outputPath, QByteArray());
+        m_batchTasks.append(ExportTask(p_file, outputPath));
+        return 0;
+    }
+
     if (m_exporter->exportPDF(p_file, p_opt, outputPath, p_errMsg)) {
         if (p_outputFiles) {
             p_outputFiles->append(outputPath);
@@ -998,6 +1018,13 @@ int VExportDialog::doExportHTML(VFile *p_file,
                                                    QFileInfo(p_file->getName()).completeBaseName() + suffix);
     QString outputPath = QDir(p_outputFolder).filePath(name);
 
+    if (m_batchExport) {
+        // Create an empty file to reserve the name.
+        VUtils::writeFileToDisk(outputPath, QByteArray());
+        m_batchTasks.append(ExportTask(p_file, outputPath));
+        return 0;
+    }
+
     if (m_exporter->exportHTML(p_file, p_opt, outputPath, p_errMsg)) {
         if (p_outputFiles) {
             p_outputFiles->append(outputPath);
@@ -1103,6 +1130,65 @@ void VExportDialog::handleCurrentSrcChanged(int p_index)
     m_subfolderCB->setVisible(subfolderEnabled);
 }
 
+int VExportDialog::doExportBatch(const ExportOption &p_opt,
+                                 QString *p_errMsg,
+                                 QList<QString> *p_outputFiles)
+{
+    QVector<ExportTask> tasks;
+    tasks.swap(m_batchTasks);
+    if (tasks.isEmpty()) {
+        return 0;
+    }
+
+    m_proBar->setRange(0, tasks.size());
+    m_proBar->setValue(0);
+
+    int nrFinished = 0;
+    QMetaObject::Connection conn = connect(m_exporter, &VExporter::batchTaskFinished,
+                                           this, [this, &tasks, &nrFinished](int p_worker, int p_taskIdx, bool p_ok) {
+                                               const ExportTask &task = tasks[p_taskIdx];
+                                               // Negative worker for notes exported natively.
+                                               QString worker = p_worker < 0 ? tr("Native")
+                                                                             : tr("Worker %1").arg(p_worker);
+                                               if (p_ok) {
+                                                   appendLogLine(tr("[%1] Note %2 exported to %3.")
+                                                                   .arg(worker)
+                                                                   .arg(task.m_file->fetchPath())
+                                                                   .arg(task.m_outputFile));
+                                               } else {
+                                                   appendLogLine(tr("[%1] Fail to export note %2.")
+                                                                   .arg(worker)
+                                                                   .arg(task.m_file->fetchPath()));
+                                               }
+
+                                               m_proBar->setValue(++nrFinished);
+                                           });
+
+    QVector<bool> results;
+    int ret = m_exporter->exportBatch(tasks, p_opt, results, p_errMsg);
+
+    disconnect(conn);
+
+    for (int i = 0; i < tasks.size(); ++i) {
+        const QString &file = tasks[i].m_outputFile;
+        if (results[i]) {
+            if (p_outputFiles) {
+                p_outputFiles->append(file);
+            }
+        } else {
+            // Remove the empty file reserving the name.
+            QFileInfo fi(file);
+            if (fi.exists() && fi.size() == 0) {
+                QFile::remove(file);
+            }
+        }
+    }
+
+    m_proBar->setRange(0, 0);
+
+    return ret;
+}
+
 int VExportDialog::doExportPDFAllInOne(const QList<QString> &p_files,
                                        const ExportOption &p_opt,
                                        const QString &p_outputFolder,
@@ -4,6 +4,7 @@
 #include <QDialog>
 #include <QPageLayout>
 #include <QList>
+#include <QVector>
 #include <QComboBox>
 
 #include "vconstants.h"
@@ -169,6 +170,24 @@ struct ExportOption
 };
 
 
+// One note to export in batch.
+struct ExportTask
+{
+    ExportTask() : m_file(NULL)
+    {
+    }
+
+    ExportTask(VFile *p_file, const QString &p_outputFile)
+        : m_file(p_file), m_outputFile(p_outputFile)
+    {
+    }
+
+    VFile *m_file;
+
+    QString m_outputFile;
+};
+
+
 class VExportDialog : public QDialog
 {
     Q_OBJECT
@@ -253,6 +272,11 @@ private:
                      QString *p_errMsg = NULL,
                      QList<QString> *p_outputFiles = NULL);
 
+    // Export notes collected in m_batchTasks in parallel.
+    int doExportBatch(const ExportOption &p_opt,
+                      QString *p_errMsg = NULL,
+                      QList<QString> *p_outputFiles = NULL);
+
     int doExportPDFAllInOne(const QList<QString> &p_files,
                             const ExportOption &p_opt,
                             const QString &p_outputFolder,
@@ -350,6 +374,11 @@ private:
     // Exporter used to export PDF and HTML.
     VExporter *m_exporter;
 
+    // Whether collect notes to m_batchTasks instead of exporting them one by one.
+    bool m_batchExport;
+
+    QVector<ExportTask> m_batchTasks;
+
     // Last output folder path.
     static QString s_lastOutputFolder;
 
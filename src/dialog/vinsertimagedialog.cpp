@@ -249,6 +249,7 @@ void VInsertImageDialog::handlePathEditChanged()
         // Try to treat it as network image.
         m_imageType = ImageType::ImageData;
         VDownloader *downloader = new VDownloader(this);
+        downloader->setCacheEnabled(true);
         connect(downloader, &VDownloader::downloadFinished,
                 this, &VInsertImageDialog::imageDownloaded);
         downloader->download(url.toString());
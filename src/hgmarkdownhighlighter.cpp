@@ -2,9 +2,12 @@
 #include <QtDebug>
 #include <QTextCursor>
 #include <algorithm>
+#include <climits>
 #include "hgmarkdownhighlighter.h"
 #include "vconfigmanager.h"
+#include "vpegparser.h"
 #include "utils/vutils.h"
+#include "vlogger.h"
 
 extern VConfigManager *g_config;
 
@@ -33,8 +36,16 @@ HGMarkdownHighlighter::HGMarkdownHighlighter(const QVector<HighlightingStyle> &s
       m_codeBlockStyles(codeBlockStyles),
       m_numOfCodeBlockHighlightsToRecv(0),
       parsing(0),
+      m_parser(NULL),
+      m_timeStamp(0),
       m_blockHLResultReady(false),
       waitInterval(waitInterval),
+      m_blockCount(0),
+      m_dirtyFirstBlock(-1),
+      m_dirtyLastBlock(-1),
+      m_fullParseNeeded(true),
+      m_codeBlockRehighlightFirst(-1),
+      m_codeBlockRehighlightLast(-1),
       content(NULL),
       capacity(0),
       result(NULL)
@@ -65,16 +76,24 @@ HGMarkdownHighlighter::HGMarkdownHighlighter(const QVector<HighlightingStyle> &s
         }
     }
 
+    // Styles of the config are compiled with the merged formats.
+    const QVector<QTextCharFormat> &mergedFormats = g_config->getMdMergedFormats();
+    if (mergedFormats.size() == highlightingStyles.size() * highlightingStyles.size()) {
+        m_mergedFormats = mergedFormats;
+        updateCodeBlockMergedStyles();
+    } else {
+        updateMergedFormats();
+    }
+
     resizeBuffer(initCapacity);
     document = parent;
+    m_blockCount = document->blockCount();
 
     timer = new QTimer(this);
     timer->setSingleShot(true);
     timer->setInterval(this->waitInterval);
     connect(timer, &QTimer::timeout,
-            this, [this]() {
-                startParseAndHighlight(false);
-            });
+            this, &HGMarkdownHighlighter::startIncrementalParseAndHighlight);
 
     static const int completeWaitTime = 500;
     m_completeTimer = new QTimer(this);
@@ -83,6 +102,10 @@ HGMarkdownHighlighter::HGMarkdownHighlighter(const QVector<HighlightingStyle> &s
     connect(m_completeTimer, &QTimer::timeout,
             this, &HGMarkdownHighlighter::highlightCompleted);
 
+    m_parser = new VPegParser(this);
+    connect(m_parser, &VPegParser::parseResultReady,
+            this, &HGMarkdownHighlighter::handleParseResult);
+
     connect(document, &QTextDocument::contentsChange,
             this, &HGMarkdownHighlighter::handleContentChange);
 }
@@ -100,6 +123,38 @@ HGMarkdownHighlighter::~HGMarkdownHighlighter()
     }
 }
 
+QVector<QTextCharFormat> HGMarkdownHighlighter::mergeStylePairs(const QVector<HighlightingStyle> &p_styles)
+{
+    const int n = p_styles.size();
+    QVector<QTextCharFormat> formats;
+    formats.reserve(n * n);
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            QTextCharFormat fmt = p_styles[i].format;
+            fmt.merge(p_styles[j].format);
+            formats.append(fmt);
+        }
+    }
+
+    return formats;
+}
+
+void HGMarkdownHighlighter::updateMergedFormats()
+{
+    m_mergedFormats = mergeStylePairs(highlightingStyles);
+    updateCodeBlockMergedStyles();
+}
+
+void HGMarkdownHighlighter::updateCodeBlockMergedStyles()
+{
+    m_codeBlockMergedStyles.clear();
+    for (auto it = m_codeBlockStyles.constBegin(); it != m_codeBlockStyles.constEnd(); ++it) {
+        QTextCharFormat fmt = m_codeBlockFormat;
+        fmt.merge(it.value());
+        m_codeBlockMergedStyles.insert(it.key(), fmt);
+    }
+}
+
 void HGMarkdownHighlighter::updateBlockUserData(int p_blockNum, const QString &p_text)
 {
     Q_UNUSED(p_text);
@@ -126,30 +181,40 @@ void HGMarkdownHighlighter::highlightBlock(const QString &text)
         // units are sorted by start position and length.
         const QVector<HLUnit> &units = m_blockHighlights[blockNum];
         if (!units.isEmpty()) {
+            const int nrStyles = highlightingStyles.size();
             for (int i = 0; i < units.size(); ++i) {
                 const HLUnit &unit = units[i];
-                if (i == 0) {
+                int j = i - 1;
+                while (j >= 0 && units[j].start + units[j].length <= unit.start) {
+                    // It won't affect current unit.
+                    --j;
+                }
+
+                if (j < 0) {
                     // No need to merge format.
                     setFormat(unit.start,
                               unit.length,
                               highlightingStyles[unit.styleIndex].format);
-                } else {
-                    QTextCharFormat newFormat = highlightingStyles[unit.styleIndex].format;
-                    for (int j = i - 1; j >= 0; --j) {
-                        if (units[j].start + units[j].length <= unit.start) {
-                            // It won't affect current unit.
-                            continue;
-                        } else {
-                            // Merge the format.
-                            QTextCharFormat tmpFormat(newFormat);
-                            newFormat = highlightingStyles[units[j].styleIndex].format;
-                            // tmpFormat takes precedence.
-                            newFormat.merge(tmpFormat);
-                        }
-                    }
+                    continue;
+                }
 
-                    setFormat(unit.start, unit.length, newFormat);
+                // The most common nesting of two elements is pre-merged.
+                QTextCharFormat newFormat = m_mergedFormats[units[j].styleIndex * nrStyles
+                                                            + unit.styleIndex];
+                for (--j; j >= 0; --j) {
+                    if (units[j].start + units[j].length <= unit.start) {
+                        // It won't affect current unit.
+                        continue;
+                    } else {
+                        // Merge the format.
+                        QTextCharFormat tmpFormat(newFormat);
+                        newFormat = highlightingStyles[units[j].styleIndex].format;
+                        // tmpFormat takes precedence.
+                        newFormat.merge(tmpFormat);
+                    }
                 }
+
+                setFormat(unit.start, unit.length, newFormat);
             }
         }
     }
@@ -191,8 +256,7 @@ void HGMarkdownHighlighter::highlightBlock(const QString &text)
 
                 formats[i] = &(*it);
 
-                QTextCharFormat newFormat = m_codeBlockFormat;
-                newFormat.merge(*it);
+                QTextCharFormat newFormat = m_codeBlockMergedStyles.value(unit.style);
                 for (int j = i - 1; j >= 0; --j) {
                     if (units[j].start + units[j].length <= unit.start) {
                         // It won't affect current unit.
@@ -241,6 +305,19 @@ void HGMarkdownHighlighter::initBlockHighlightFromResult(int nrBlocks)
         return;
     }
 
+    initBlockHighlightFromResult(0, ULONG_MAX);
+
+    // Sort m_blockHighlights.
+    for (int i = 0; i < m_blockHighlights.size(); ++i) {
+        if (m_blockHighlights[i].size() > 1) {
+            std::sort(m_blockHighlights[i].begin(), m_blockHighlights[i].end(), compHLUnit);
+        }
+    }
+}
+
+void HGMarkdownHighlighter::initBlockHighlightFromResult(unsigned long p_offset,
+                                                         unsigned long p_limit)
+{
     for (int i = 0; i < highlightingStyles.size(); i++)
     {
         const HighlightingStyle &style = highlightingStyles[i];
@@ -253,29 +330,24 @@ void HGMarkdownHighlighter::initBlockHighlightFromResult(int nrBlocks)
         {
             // elem_cursor->pos and elem_cursor->end is the start
             // and end position of the element in document.
-            if (elem_cursor->end <= elem_cursor->pos) {
+            unsigned long pos = elem_cursor->pos + p_offset;
+            unsigned long end = qMin(elem_cursor->end + p_offset, p_limit);
+            if (end <= pos) {
                 elem_cursor = elem_cursor->next;
                 continue;
             }
 
             // Check header. Skip those headers with no spaces after #s.
             if (isHeader
-                && !isValidHeader(elem_cursor->pos, elem_cursor->end)) {
+                && !isValidHeader(pos, end)) {
                 elem_cursor = elem_cursor->next;
                 continue;
             }
 
-            initBlockHighlihgtOne(elem_cursor->pos, elem_cursor->end, i);
+            initBlockHighlihgtOne(pos, end, i);
             elem_cursor = elem_cursor->next;
         }
     }
-
-    // Sort m_blockHighlights.
-    for (int i = 0; i < m_blockHighlights.size(); ++i) {
-        if (m_blockHighlights[i].size() > 1) {
-            std::sort(m_blockHighlights[i].begin(), m_blockHighlights[i].end(), compHLUnit);
-        }
-    }
 }
 
 void HGMarkdownHighlighter::initHtmlCommentRegionsFromResult()
@@ -299,7 +371,7 @@ void HGMarkdownHighlighter::initHtmlCommentRegionsFromResult()
         elem = elem->next;
     }
 
-    qDebug() << "highlighter: parse" << m_commentRegions.size() << "HTML comment regions";
+    qCDebug(lcHighlighter) << "highlighter: parse" << m_commentRegions.size() << "HTML comment regions";
 }
 
 void HGMarkdownHighlighter::initImageRegionsFromResult()
@@ -323,7 +395,7 @@ void HGMarkdownHighlighter::initImageRegionsFromResult()
         elem = elem->next;
     }
 
-    qDebug() << "highlighter: parse" << m_imageRegions.size() << "image regions";
+    qCDebug(lcHighlighter) << "highlighter: parse" << m_imageRegions.size() << "image regions";
 
     emit imageLinksUpdated(m_imageRegions);
 }
@@ -363,7 +435,85 @@ void HGMarkdownHighlighter::initHeaderRegionsFromResult()
 
     std::sort(m_headerRegions.begin(), m_headerRegions.end());
 
-    qDebug() << "highlighter: parse" << m_headerRegions.size() << "header regions";
+    qCDebug(lcHighlighter) << "highlighter: parse" << m_headerRegions.size() << "header regions";
+
+    emit headersUpdated(m_headerRegions);
+}
+
+void HGMarkdownHighlighter::updateRegionsFromResult(unsigned long p_offset,
+                                                    unsigned long p_limit)
+{
+    auto overlapped = [p_offset, p_limit](const VElementRegion &p_reg) {
+        return (unsigned long)p_reg.m_endPos > p_offset
+               && (unsigned long)p_reg.m_startPos < p_limit;
+    };
+
+    // Images.
+    for (int i = m_imageRegions.size() - 1; i >= 0; --i) {
+        if (overlapped(m_imageRegions[i])) {
+            m_imageRegions.remove(i);
+        }
+    }
+
+    if (result) {
+        pmh_element *elem = result[pmh_IMAGE];
+        while (elem != NULL) {
+            if (elem->end > elem->pos) {
+                m_imageRegions.push_back(VElementRegion(elem->pos + p_offset,
+                                                        qMin(elem->end + p_offset, p_limit)));
+            }
+
+            elem = elem->next;
+        }
+    }
+
+    std::sort(m_imageRegions.begin(), m_imageRegions.end());
+
+    emit imageLinksUpdated(m_imageRegions);
+
+    // Headers.
+    for (int i = m_headerRegions.size() - 1; i >= 0; --i) {
+        if (overlapped(m_headerRegions[i])) {
+            m_headerRegions.remove(i);
+        }
+    }
+
+    int firstBlock = document->findBlock(p_offset).blockNumber();
+    int lastBlock = document->findBlock(p_limit - 1).blockNumber();
+    for (auto it = m_headerBlocks.begin(); it != m_headerBlocks.end();) {
+        if (it.key() >= firstBlock && it.key() <= lastBlock) {
+            it = m_headerBlocks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (result) {
+        pmh_element_type hx[6] = {pmh_H1, pmh_H2, pmh_H3, pmh_H4, pmh_H5, pmh_H6};
+        for (int i = 0; i < 6; ++i) {
+            pmh_element *elem = result[hx[i]];
+            while (elem != NULL) {
+                unsigned long pos = elem->pos + p_offset;
+                unsigned long end = qMin(elem->end + p_offset, p_limit);
+                if (end <= pos || !isValidHeader(pos, end)) {
+                    elem = elem->next;
+                    continue;
+                }
+
+                m_headerRegions.push_back(VElementRegion(pos, end));
+
+                QTextBlock block = document->findBlock(pos);
+                if (block.isValid()) {
+                    // Header element will contain the new line character.
+                    m_headerBlocks.insert(block.blockNumber(), HeaderBlockInfo(i, end - pos - 1));
+                }
+
+                elem = elem->next;
+            }
+        }
+    }
+
+    std::sort(m_headerRegions.begin(), m_headerRegions.end());
 
     emit headersUpdated(m_headerRegions);
 }
@@ -521,12 +671,16 @@ void HGMarkdownHighlighter::parse(bool p_fast)
     m_blockHLResultReady = false;
 
     int nrBlocks = document->blockCount();
-    parseInternal();
+    parseInternal(document->toPlainText());
 
     initBlockHighlightFromResult(nrBlocks);
 
     m_blockHLResultReady = true;
 
+    m_blockCount = nrBlocks;
+    m_dirtyFirstBlock = m_dirtyLastBlock = -1;
+    m_fullParseNeeded = p_fast;
+
     if (!p_fast) {
         initHtmlCommentRegionsFromResult();
 
@@ -545,10 +699,9 @@ exit:
     parsing.store(0);
 }
 
-void HGMarkdownHighlighter::parseInternal()
+void HGMarkdownHighlighter::parseInternal(const QString &p_text)
 {
-    QString text = document->toPlainText();
-    QByteArray ba = text.toUtf8();
+    QByteArray ba = p_text.toUtf8();
     const char *data = (const char *)ba.data();
     int len = ba.size();
 
@@ -571,30 +724,338 @@ void HGMarkdownHighlighter::parseInternal()
     pmh_markdown_to_elements(content, pmh_EXT_NONE, &result);
 }
 
-void HGMarkdownHighlighter::handleContentChange(int /* position */, int charsRemoved, int charsAdded)
+bool HGMarkdownHighlighter::isSafeBoundary(const QTextBlock &p_prev,
+                                           const QTextBlock &p_next) const
+{
+    // A blank line outside code blocks and comments followed by a block
+    // without indentation, which could not be a continuation of a list.
+    if (p_prev.userState() != HighlightBlockState::Normal
+        || !p_prev.text().trimmed().isEmpty()) {
+        return false;
+    }
+
+    QString text = p_next.text();
+    return text.isEmpty() || !text[0].isSpace();
+}
+
+bool HGMarkdownHighlighter::parseIncrementally(int &p_firstBlock, int &p_lastBlock)
+{
+    if (m_fullParseNeeded
+        || !m_blockHLResultReady
+        || m_dirtyFirstBlock == -1
+        || m_numOfCodeBlockHighlightsToRecv > 0
+        || highlightingStyles.isEmpty()) {
+        return false;
+    }
+
+    int nrBlocks = document->blockCount();
+    if (m_blockHighlights.size() != nrBlocks) {
+        return false;
+    }
+
+    QTextBlock startBlock = document->findBlockByNumber(m_dirtyFirstBlock);
+    QTextBlock endBlock = document->findBlockByNumber(qMin(m_dirtyLastBlock, nrBlocks - 1));
+    if (!startBlock.isValid() || !endBlock.isValid()) {
+        return false;
+    }
+
+    // Expand to safe boundaries.
+    while (startBlock.previous().isValid()
+           && !isSafeBoundary(startBlock.previous(), startBlock)) {
+        startBlock = startBlock.previous();
+    }
+
+    while (endBlock.next().isValid()
+           && !isSafeBoundary(endBlock, endBlock.next())) {
+        endBlock = endBlock.next();
+    }
+
+    p_firstBlock = startBlock.blockNumber();
+    p_lastBlock = endBlock.blockNumber();
+
+    // Not worth it. A full parse is needed.
+    if ((p_lastBlock - p_firstBlock + 1) * 2 > nrBlocks) {
+        return false;
+    }
+
+    QString text;
+    for (QTextBlock block = startBlock; block.isValid(); block = block.next()) {
+        text += block.text();
+        if (block == endBlock) {
+            if (block.next().isValid()) {
+                text += '\n';
+            }
+
+            break;
+        }
+
+        text += '\n';
+    }
+
+    // HTML comments and reference links depend on context outside the dirty
+    // blocks.
+    static QRegExp contextExp("<!--|-->|\\]\\s*\\[|(^|\\n)\\s{0,3}\\[[^\\]]+\\]:");
+    if (text.contains(contextExp)) {
+        return false;
+    }
+
+    unsigned long offset = startBlock.position();
+    unsigned long limit = offset + text.size();
+    for (auto const & reg : m_commentRegions) {
+        if ((unsigned long)reg.m_endPos > offset
+            && (unsigned long)reg.m_startPos < limit) {
+            return false;
+        }
+    }
+
+    qCDebug(lcHighlighter) << "highlighter: parse incrementally blocks" << p_firstBlock << p_lastBlock;
+
+    parseInternal(text);
+
+    for (int i = p_firstBlock; i <= p_lastBlock; ++i) {
+        m_blockHighlights[i].clear();
+    }
+
+    if (result) {
+        initBlockHighlightFromResult(offset, limit);
+
+        for (int i = p_firstBlock; i <= p_lastBlock; ++i) {
+            if (m_blockHighlights[i].size() > 1) {
+                std::sort(m_blockHighlights[i].begin(), m_blockHighlights[i].end(), compHLUnit);
+            }
+        }
+    }
+
+    updateRegionsFromResult(offset, limit);
+
+    if (result) {
+        pmh_free_elements(result);
+        result = NULL;
+    }
+
+    m_dirtyFirstBlock = m_dirtyLastBlock = -1;
+    return true;
+}
+
+// Shift the block-indexed entries of @p_data after a change at block
+// @p_block, which inserted (@p_delta > 0) or removed blocks.
+template <typename T>
+static void shiftBlockVector(QVector<T> &p_data, int p_block, int p_delta)
+{
+    int idx = qMin(p_block + 1, p_data.size());
+    if (p_delta > 0) {
+        p_data.insert(idx, p_delta, T());
+    } else {
+        p_data.remove(idx, qMin(-p_delta, p_data.size() - idx));
+    }
+}
+
+static int shiftBlockNumber(int p_num, int p_block, int p_delta)
+{
+    if (p_num <= p_block) {
+        return p_num;
+    }
+
+    // Removed blocks.
+    if (p_delta < 0 && p_num <= p_block - p_delta) {
+        return -1;
+    }
+
+    return p_num + p_delta;
+}
+
+static void shiftRegions(QVector<VElementRegion> &p_regions,
+                         int p_position,
+                         int p_charsRemoved,
+                         int p_delta)
+{
+    for (auto & reg : p_regions) {
+        if (reg.m_startPos >= p_position + p_charsRemoved) {
+            reg.m_startPos += p_delta;
+            reg.m_endPos += p_delta;
+        } else if (reg.m_endPos > p_position) {
+            // Overlapped with the change. It will be updated by next parse.
+            reg.m_startPos = qMin(reg.m_startPos, p_position);
+            reg.m_endPos = qMax(reg.m_startPos, reg.m_endPos + p_delta);
+        }
+    }
+}
+
+void HGMarkdownHighlighter::updateDirtyBlocks(int p_position, int p_charsRemoved, int p_charsAdded)
+{
+    int nrBlocks = document->blockCount();
+    int delta = nrBlocks - m_blockCount;
+    int oldBlockCount = m_blockCount;
+    m_blockCount = nrBlocks;
+
+    QTextBlock block = document->findBlock(p_position);
+    if (!block.isValid()) {
+        m_fullParseNeeded = true;
+        return;
+    }
+
+    int firstBlock = block.blockNumber();
+    block = document->findBlock(p_position + p_charsAdded);
+    int lastBlock = block.isValid() ? block.blockNumber() : nrBlocks - 1;
+
+    if (delta != 0) {
+        if (m_blockHighlights.size() == oldBlockCount) {
+            shiftBlockVector(m_blockHighlights, firstBlock, delta);
+        } else {
+            m_fullParseNeeded = true;
+        }
+
+        if (m_codeBlockHighlights.size() == oldBlockCount) {
+            shiftBlockVector(m_codeBlockHighlights, firstBlock, delta);
+        }
+
+        QHash<int, HeaderBlockInfo> headerBlocks;
+        for (auto it = m_headerBlocks.begin(); it != m_headerBlocks.end(); ++it) {
+            int num = shiftBlockNumber(it.key(), firstBlock, delta);
+            if (num > -1) {
+                headerBlocks.insert(num, it.value());
+            }
+        }
+
+        m_headerBlocks = headerBlocks;
+
+        QSet<int> previewBlocks;
+        for (auto num : m_possiblePreviewBlocks) {
+            num = shiftBlockNumber(num, firstBlock, delta);
+            if (num > -1) {
+                previewBlocks.insert(num);
+            }
+        }
+
+        m_possiblePreviewBlocks = previewBlocks;
+
+        if (m_dirtyFirstBlock > firstBlock) {
+            m_dirtyFirstBlock = qMax(m_dirtyFirstBlock + delta, firstBlock);
+        }
+
+        if (m_dirtyLastBlock > firstBlock) {
+            m_dirtyLastBlock = qMax(m_dirtyLastBlock + delta, firstBlock);
+        }
+    }
+
+    int charsDelta = p_charsAdded - p_charsRemoved;
+    shiftRegions(m_commentRegions, p_position, p_charsRemoved, charsDelta);
+    shiftRegions(m_imageRegions, p_position, p_charsRemoved, charsDelta);
+    shiftRegions(m_headerRegions, p_position, p_charsRemoved, charsDelta);
+
+    if (m_dirtyFirstBlock == -1) {
+        m_dirtyFirstBlock = firstBlock;
+        m_dirtyLastBlock = lastBlock;
+    } else {
+        m_dirtyFirstBlock = qMin(m_dirtyFirstBlock, firstBlock);
+        m_dirtyLastBlock = qMax(m_dirtyLastBlock, lastBlock);
+    }
+}
+
+void HGMarkdownHighlighter::handleContentChange(int position, int charsRemoved, int charsAdded)
 {
     if (charsRemoved == 0 && charsAdded == 0) {
         return;
     }
 
+    ++m_timeStamp;
+
+    updateDirtyBlocks(position, charsRemoved, charsAdded);
+
     timer->stop();
     timer->start();
 }
 
-void HGMarkdownHighlighter::startParseAndHighlight(bool p_fast)
+void HGMarkdownHighlighter::startIncrementalParseAndHighlight()
+{
+    if (!parsing.testAndSetRelaxed(0, 1)) {
+        return;
+    }
+
+    int firstBlock = -1, lastBlock = -1;
+    bool succeed = parseIncrementally(firstBlock, lastBlock);
+
+    parsing.store(0);
+
+    if (!succeed) {
+        startParseAndHighlight(false);
+        return;
+    }
+
+    if (!updateCodeBlocks(firstBlock, lastBlock)) {
+        rehighlightBlocks(firstBlock, lastBlock);
+    }
+
+    highlightChanged();
+}
+
+void HGMarkdownHighlighter::rehighlightBlocks(int p_firstBlock, int p_lastBlock)
 {
-    qDebug() << "HGMarkdownHighlighter start a new parse (fast" << p_fast << ")";
-    parse(p_fast);
+    QTextBlock block = document->findBlockByNumber(p_firstBlock);
+    while (block.isValid() && block.blockNumber() <= p_lastBlock) {
+        rehighlightBlock(block);
+        block = block.next();
+    }
+}
 
+void HGMarkdownHighlighter::startParseAndHighlight(bool p_fast)
+{
+    qCDebug(lcHighlighter) << "HGMarkdownHighlighter start a new parse (fast" << p_fast << ")";
     if (p_fast) {
+        parse(p_fast);
         rehighlight();
     } else {
-        if (!updateCodeBlocks()) {
-            rehighlight();
-        }
+        parseAsync();
+    }
+}
 
-        highlightChanged();
+void HGMarkdownHighlighter::parseAsync()
+{
+    QSharedPointer<PegParseConfig> config(new PegParseConfig());
+    config->m_timeStamp = m_timeStamp;
+    config->m_text = document->toPlainText();
+    config->m_numOfBlocks = document->blockCount();
+    config->m_styleTypes.reserve(highlightingStyles.size());
+    for (auto const & style : highlightingStyles) {
+        config->m_styleTypes.append(style.type);
     }
+
+    m_parser->parseAsync(config);
+}
+
+void HGMarkdownHighlighter::handleParseResult(const QSharedPointer<PegParseResult> &p_result)
+{
+    // Abandon obsolete result. A new parse will be requested by the change.
+    if (p_result->m_timeStamp != m_timeStamp
+        || p_result->m_numOfBlocks != document->blockCount()) {
+        qCDebug(lcHighlighter) << "highlighter: abandon obsolete parse result" << p_result->m_timeStamp << m_timeStamp;
+        return;
+    }
+
+    m_blockHighlights = p_result->m_blocksHighlights;
+    m_blockHLResultReady = true;
+
+    m_blockCount = p_result->m_numOfBlocks;
+    m_dirtyFirstBlock = m_dirtyLastBlock = -1;
+    m_fullParseNeeded = false;
+
+    m_commentRegions = p_result->m_commentRegions;
+    qCDebug(lcHighlighter) << "highlighter: parse" << m_commentRegions.size() << "HTML comment regions";
+
+    m_imageRegions = p_result->m_imageRegions;
+    qCDebug(lcHighlighter) << "highlighter: parse" << m_imageRegions.size() << "image regions";
+    emit imageLinksUpdated(m_imageRegions);
+
+    m_headerRegions = p_result->m_headerRegions;
+    m_headerBlocks = p_result->m_headerBlocks;
+    qCDebug(lcHighlighter) << "highlighter: parse" << m_headerRegions.size() << "header regions";
+    emit headersUpdated(m_headerRegions);
+
+    if (!updateCodeBlocks()) {
+        rehighlight();
+    }
+
+    highlightChanged();
 }
 
 void HGMarkdownHighlighter::updateHighlight()
@@ -609,15 +1070,25 @@ void HGMarkdownHighlighter::updateHighlightFast()
     startParseAndHighlight(true);
 }
 
-bool HGMarkdownHighlighter::updateCodeBlocks()
+bool HGMarkdownHighlighter::updateCodeBlocks(int p_firstBlock, int p_lastBlock)
 {
     if (!g_config->getEnableCodeBlockHighlight()) {
         m_codeBlockHighlights.clear();
         return false;
     }
 
-    m_codeBlockHighlights.resize(document->blockCount());
-    for (int i = 0; i < m_codeBlockHighlights.size(); ++i) {
+    int nrBlocks = document->blockCount();
+    if (p_lastBlock == -1 || m_codeBlockHighlights.size() != nrBlocks) {
+        m_codeBlockRehighlightFirst = m_codeBlockRehighlightLast = -1;
+        p_firstBlock = 0;
+        p_lastBlock = nrBlocks - 1;
+        m_codeBlockHighlights.resize(nrBlocks);
+    } else {
+        m_codeBlockRehighlightFirst = p_firstBlock;
+        m_codeBlockRehighlightLast = p_lastBlock;
+    }
+
+    for (int i = p_firstBlock; i <= p_lastBlock; ++i) {
         m_codeBlockHighlights[i].clear();
     }
 
@@ -628,8 +1099,8 @@ bool HGMarkdownHighlighter::updateCodeBlocks()
     int startLeadingSpaces = -1;
 
     // Only handle complete codeblocks.
-    QTextBlock block = document->firstBlock();
-    while (block.isValid()) {
+    QTextBlock block = document->findBlockByNumber(p_firstBlock);
+    while (block.isValid() && block.blockNumber() <= p_lastBlock) {
         QString text = block.text();
         if (inBlock) {
             item.m_text = item.m_text + "\n" + text;
@@ -641,7 +1112,7 @@ bool HGMarkdownHighlighter::updateCodeBlocks()
 
                 // See if it is a code block inside HTML comment.
                 if (!isBlockInsideCommentRegion(block)) {
-                    qDebug() << "add one code block in lang" << item.m_lang;
+                    qCDebug(lcHighlighter) << "add one code block in lang" << item.m_lang;
                     codeBlocks.append(item);
                 }
             }
@@ -742,7 +1213,11 @@ void HGMarkdownHighlighter::setCodeBlockHighlights(const QVector<HLUnitPos> &p_u
 exit:
     --m_numOfCodeBlockHighlightsToRecv;
     if (m_numOfCodeBlockHighlightsToRecv <= 0) {
-        rehighlight();
+        if (m_codeBlockRehighlightFirst > -1) {
+            rehighlightBlocks(m_codeBlockRehighlightFirst, m_codeBlockRehighlightLast);
+        } else {
+            rehighlight();
+        }
     }
 }
 
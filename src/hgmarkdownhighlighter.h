@@ -7,6 +7,7 @@
 #include <QMap>
 #include <QSet>
 #include <QString>
+#include <QSharedPointer>
 
 #include "vtextblockdata.h"
 
@@ -18,6 +19,9 @@ QT_BEGIN_NAMESPACE
 class QTextDocument;
 QT_END_NAMESPACE
 
+class VPegParser;
+struct PegParseResult;
+
 struct HighlightingStyle
 {
     pmh_element_type type;
@@ -109,6 +113,20 @@ struct VElementRegion
     }
 };
 
+struct HeaderBlockInfo
+{
+    HeaderBlockInfo(int p_level = -1, int p_length = 0)
+        : m_level(p_level), m_length(p_length)
+    {
+    }
+
+    // Header level based on 0.
+    int m_level;
+
+    // Block length;
+    int m_length;
+};
+
 class HGMarkdownHighlighter : public QSyntaxHighlighter
 {
     Q_OBJECT
@@ -138,6 +156,14 @@ public:
 
     QVector<HighlightingStyle> &getHighlightingStyles();
 
+    // Rebuild the merged formats after the styles are changed.
+    void updateMergedFormats();
+
+    // Merge the formats of @p_styles in pairs.
+    // Format at [i * n + j] is the format of @p_styles[i] merged with the one
+    // of @p_styles[j], which takes precedence.
+    static QVector<QTextCharFormat> mergeStylePairs(const QVector<HighlightingStyle> &p_styles);
+
 signals:
     void highlightCompleted();
 
@@ -163,21 +189,14 @@ private slots:
     // @p_fast: if true, just parse and update styles.
     void startParseAndHighlight(bool p_fast = false);
 
-private:
-    struct HeaderBlockInfo
-    {
-        HeaderBlockInfo(int p_level = -1, int p_length = 0)
-            : m_level(p_level), m_length(p_length)
-        {
-        }
-
-        // Header level based on 0.
-        int m_level;
+    // Try to re-parse and re-highlight only the dirty blocks. Fall back to
+    // a full parse if the dirty blocks could not be handled incrementally.
+    void startIncrementalParseAndHighlight();
 
-        // Block length;
-        int m_length;
-    };
+    // Apply the result of a background parse if it is not obsolete.
+    void handleParseResult(const QSharedPointer<PegParseResult> &p_result);
 
+private:
     QRegExp codeBlockStartExp;
     QRegExp codeBlockEndExp;
     QTextCharFormat m_codeBlockFormat;
@@ -191,6 +210,13 @@ private:
 
     QHash<QString, QTextCharFormat> m_codeBlockStyles;
 
+    // Formats of highlightingStyles merged in pairs to save merging of
+    // nested elements in highlightBlock().
+    QVector<QTextCharFormat> m_mergedFormats;
+
+    // m_codeBlockStyles merged with m_codeBlockFormat.
+    QHash<QString, QTextCharFormat> m_codeBlockMergedStyles;
+
     QVector<QVector<HLUnit> > m_blockHighlights;
 
     // Used for cache, [0, 6].
@@ -223,6 +249,13 @@ private:
 
     QAtomicInt parsing;
 
+    // Parser to parse the whole document in background.
+    VPegParser *m_parser;
+
+    // Revision of the document, increased on each content change.
+    // Used to abandon obsolete parse results.
+    int m_timeStamp;
+
     // Whether highlight results for blocks are ready.
     bool m_blockHLResultReady;
 
@@ -232,6 +265,22 @@ private:
     // Block number of those blocks which possible contains previewed image.
     QSet<int> m_possiblePreviewBlocks;
 
+    // Number of blocks of the document when last synced with content change.
+    int m_blockCount;
+
+    // [m_dirtyFirstBlock, m_dirtyLastBlock] is the range of blocks changed
+    // since last parse. -1 if nothing changed.
+    int m_dirtyFirstBlock;
+    int m_dirtyLastBlock;
+
+    // Whether the cached results are out of sync and a full parse is needed.
+    bool m_fullParseNeeded;
+
+    // Range of blocks to rehighlight after receiving all the code block highlights.
+    // -1 to rehighlight the whole document.
+    int m_codeBlockRehighlightFirst;
+    int m_codeBlockRehighlightLast;
+
     char *content;
     int capacity;
     pmh_element **result;
@@ -241,6 +290,8 @@ private:
     void resizeBuffer(int newCap);
     void highlightCodeBlock(const QString &text);
 
+    void updateCodeBlockMergedStyles();
+
     // Highlight links using regular expression.
     // PEG Markdown Highlight treat URLs with spaces illegal. This function is
     // intended to complement this.
@@ -248,11 +299,24 @@ private:
 
     void parse(bool p_fast = false);
 
-    void parseInternal();
+    void parseInternal(const QString &p_text);
+
+    // Request a background parse of the whole document.
+    void parseAsync();
+
+    // Parse only the dirty blocks expanded to safe boundaries and splice
+    // the results into the cached highlights.
+    // Return false if a full parse is needed.
+    // @p_firstBlock and @p_lastBlock will be set to the range of blocks parsed.
+    bool parseIncrementally(int &p_firstBlock, int &p_lastBlock);
 
     // Init highlight elements for all the blocks from parse results.
     void initBlockHighlightFromResult(int nrBlocks);
 
+    // Init highlight elements for blocks from parse results of text starting
+    // at @p_offset in the document. Elements will be cut at @p_limit.
+    void initBlockHighlightFromResult(unsigned long p_offset, unsigned long p_limit);
+
     // Init highlight elements for blocks from one parse result.
     void initBlockHighlihgtOne(unsigned long pos,
                                unsigned long end,
@@ -260,7 +324,20 @@ private:
 
     // Return true if there are fenced code blocks and it will call rehighlight() later.
     // Return false if there is none.
-    bool updateCodeBlocks();
+    // Only code blocks within [@p_firstBlock, @p_lastBlock] will be updated if
+    // @p_lastBlock is not -1.
+    bool updateCodeBlocks(int p_firstBlock = 0, int p_lastBlock = -1);
+
+    // Rehighlight blocks within [@p_firstBlock, @p_lastBlock].
+    void rehighlightBlocks(int p_firstBlock, int p_lastBlock);
+
+    // Keep all the cached results in sync with the content change and
+    // record the dirty blocks.
+    void updateDirtyBlocks(int p_position, int p_charsRemoved, int p_charsAdded);
+
+    // Whether it is safe to split the document between @p_prev and @p_next,
+    // which are adjacent blocks, for an incremental parse.
+    bool isSafeBoundary(const QTextBlock &p_prev, const QTextBlock &p_next) const;
 
     // Fetch all the HTML comment regions from parsing result.
     void initHtmlCommentRegionsFromResult();
@@ -271,6 +348,10 @@ private:
     // Fetch all the header regions from parsing result.
     void initHeaderRegionsFromResult();
 
+    // Fetch image and header regions from parsing result of text starting at
+    // @p_offset and replace the old regions within [@p_offset, @p_limit).
+    void updateRegionsFromResult(unsigned long p_offset, unsigned long p_limit);
+
     // Whether @p_block is totally inside a HTML comment.
     bool isBlockInsideCommentRegion(const QTextBlock &p_block) const;
 
@@ -13,11 +13,14 @@
 #include "vsingleinstanceguard.h"
 #include "vconfigmanager.h"
 #include "vpalette.h"
+#include "vlogger.h"
 
 VConfigManager *g_config;
 
 VPalette *g_palette;
 
+VLogger *g_logger = NULL;
+
 #if defined(QT_NO_DEBUG)
 // 5MB log size.
 #define MAX_LOG_SIZE 5 * 1024 * 1024
@@ -25,95 +28,18 @@ VPalette *g_palette;
 // Whether print debug log in RELEASE mode.
 bool g_debugLog = false;
 
-QFile g_logFile;
-
-static void initLogFile(const QString &p_file)
+static QFile *openLogFile(const QString &p_file)
 {
-    g_logFile.setFileName(p_file);
-    if (g_logFile.size() >= MAX_LOG_SIZE) {
-        g_logFile.open(QIODevice::WriteOnly | QIODevice::Text);
+    QFile *file = new QFile(p_file);
+    if (file->size() >= MAX_LOG_SIZE) {
+        file->open(QIODevice::WriteOnly | QIODevice::Text);
     } else {
-        g_logFile.open(QIODevice::Append | QIODevice::Text);
-    }
-}
-#endif
-
-void VLogger(QtMsgType type, const QMessageLogContext &context, const QString &msg)
-{
-#if defined(QT_NO_DEBUG)
-    if (!g_debugLog && type == QtDebugMsg) {
-        return;
+        file->open(QIODevice::Append | QIODevice::Text);
     }
-#endif
-
-    QByteArray localMsg = msg.toUtf8();
-    QString header;
-
-    switch (type) {
-    case QtDebugMsg:
-        header = "Debug:";
-        break;
-
-    case QtInfoMsg:
-        header = "Info:";
-        break;
 
-    case QtWarningMsg:
-        header = "Warning:";
-        break;
-
-    case QtCriticalMsg:
-        header = "Critical:";
-        break;
-
-    case QtFatalMsg:
-        header = "Fatal:";
-
-    default:
-        break;
-    }
-
-#if defined(QT_NO_DEBUG)
-    Q_UNUSED(context);
-
-    QTextStream stream(&g_logFile);
-
-    stream << header << localMsg << "\n";
-
-    if (type == QtFatalMsg) {
-        g_logFile.close();
-        abort();
-    }
-#else
-    std::string fileStr = QFileInfo(context.file).fileName().toStdString();
-    const char *file = fileStr.c_str();
-
-    switch (type) {
-    case QtDebugMsg:
-        fprintf(stderr, "%s(%s:%u) %s\n",
-                header.toStdString().c_str(), file, context.line, localMsg.constData());
-        break;
-    case QtInfoMsg:
-        fprintf(stderr, "%s(%s:%u) %s\n",
-                header.toStdString().c_str(), file, context.line, localMsg.constData());
-        break;
-    case QtWarningMsg:
-        fprintf(stderr, "%s(%s:%u) %s\n",
-                header.toStdString().c_str(), file, context.line, localMsg.constData());
-        break;
-    case QtCriticalMsg:
-        fprintf(stderr, "%s(%s:%u) %s\n",
-                header.toStdString().c_str(), file, context.line, localMsg.constData());
-        break;
-    case QtFatalMsg:
-        fprintf(stderr, "%s(%s:%u) %s\n",
-                header.toStdString().c_str(), file, context.line, localMsg.constData());
-        abort();
-    }
-
-    fflush(stderr);
-#endif
+    return file;
 }
+#endif
 
 int main(int argc, char *argv[])
 {
@@ -153,10 +79,23 @@ int main(int argc, char *argv[])
         }
     }
 
-    initLogFile(vconfig.getLogFilePath());
+    if (g_debugLog) {
+        // Hot path categories are capped at info by default in release builds.
+        QLoggingCategory::setFilterRules("vnote.*.debug=true");
+    } else {
+        // Drop debug messages before they are formatted.
+        QLoggingCategory::setFilterRules("*.debug=false");
+    }
+
+    VLogger logger(openLogFile(vconfig.getLogFilePath()), false);
+#else
+    QFile *errFile = new QFile();
+    errFile->open(stderr, QIODevice::WriteOnly | QIODevice::Text);
+    VLogger logger(errFile, true);
 #endif
 
-    qInstallMessageHandler(VLogger);
+    g_logger = &logger;
+    logger.install();
 
     QString locale = VUtils::getLocale();
     // Set default locale.
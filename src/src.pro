@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui webenginewidgets webchannel network svg printsupport
+QT       += core gui webenginewidgets webchannel network svg printsupport concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -113,7 +113,28 @@ SOURCES += main.cpp\
     vstyleditemdelegate.cpp \
     vtreewidget.cpp \
     dialog/vexportdialog.cpp \
-    vexporter.cpp
+    vexporter.cpp \
+    vpegparser.cpp \
+    utils/vcodeblocktokenizer.cpp \
+    vcodeblockhighlightcache.cpp \
+    vpreviewimagecache.cpp \
+    vsearchindex.cpp \
+    vfulltextsearch.cpp \
+    vsearchpanel.cpp \
+    vblockheighttree.cpp \
+    vextraselectionengine.cpp \
+    vconfigtransaction.cpp \
+    vcopyengine.cpp \
+    vnotebookmetacache.cpp \
+    vdirectoryloader.cpp \
+    vnotelistmodel.cpp \
+    vlistview.cpp \
+    vfilewatcher.cpp \
+    vbackupjournal.cpp \
+    vtextreplacer.cpp \
+    vlogger.cpp \
+    vdownloadcache.cpp \
+    veditstylecache.cpp
 
 HEADERS  += vmainwindow.h \
     vdirectorytree.h \
@@ -213,7 +234,28 @@ HEADERS  += vmainwindow.h \
     vstyleditemdelegate.h \
     vtreewidget.h \
     dialog/vexportdialog.h \
-    vexporter.h
+    vexporter.h \
+    vpegparser.h \
+    utils/vcodeblocktokenizer.h \
+    vcodeblockhighlightcache.h \
+    vpreviewimagecache.h \
+    vsearchindex.h \
+    vfulltextsearch.h \
+    vsearchpanel.h \
+    vblockheighttree.h \
+    vextraselectionengine.h \
+    vconfigtransaction.h \
+    vcopyengine.h \
+    vnotebookmetacache.h \
+    vdirectoryloader.h \
+    vnotelistmodel.h \
+    vlistview.h \
+    vfilewatcher.h \
+    vbackupjournal.h \
+    vtextreplacer.h \
+    vlogger.h \
+    vdownloadcache.h \
+    veditstylecache.h
 
 RESOURCES += \
     vnote.qrc \
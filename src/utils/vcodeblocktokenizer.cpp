@@ -0,0 +1,605 @@
+#include "vcodeblocktokenizer.h"
+
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+
+namespace
+{
+// Definition of a language for the tokenizer.
+struct LanguageDef
+{
+    LanguageDef()
+        : m_caseInsensitive(false),
+          m_tripleQuotes(false),
+          m_rawSingleQuote(false),
+          m_preprocessor(false),
+          m_decorator(false),
+          m_variable(false),
+          m_jsonKey(false),
+          m_yamlKey(false),
+          m_dollarInIdentifier(false)
+    {
+    }
+
+    QStringList m_lineComments;
+
+    // Pairs of start and end of block comments.
+    QVector<QPair<QString, QString> > m_blockComments;
+
+    // Characters to delimit a string.
+    QString m_stringDelimiters;
+
+    // Keywords are lower case if m_caseInsensitive is true.
+    bool m_caseInsensitive;
+
+    // Python's """ and '''.
+    bool m_tripleQuotes;
+
+    // String delimiters which allow the string to span multiple lines.
+    QString m_multiLineDelimiters;
+
+    // No escape within single quotes.
+    bool m_rawSingleQuote;
+
+    // Line starting with # is a preprocessor directive.
+    bool m_preprocessor;
+
+    // @xxx is a decorator.
+    bool m_decorator;
+
+    // $xxx and ${xxx} are variables.
+    bool m_variable;
+
+    // A string followed by : is a key.
+    bool m_jsonKey;
+
+    // xxx: at the start of a line is a key.
+    bool m_yamlKey;
+
+    // $ could be part of an identifier.
+    bool m_dollarInIdentifier;
+
+    QSet<QString> m_keywords;
+
+    QSet<QString> m_literals;
+
+    QSet<QString> m_builtIns;
+};
+}
+
+static QSet<QString> toSet(const char *p_words)
+{
+    QSet<QString> words;
+    for (auto const & word : QString(p_words).split(' ', QString::SkipEmptyParts)) {
+        words.insert(word);
+    }
+
+    return words;
+}
+
+static QHash<QString, LanguageDef> initLanguageDefs()
+{
+    QHash<QString, LanguageDef> defs;
+
+    // C/C++.
+    {
+    LanguageDef def;
+    def.m_lineComments << "//";
+    def.m_blockComments.append(qMakePair(QString("/*"), QString("*/")));
+    def.m_stringDelimiters = "\"'";
+    def.m_preprocessor = true;
+    def.m_keywords = toSet("alignas alignof asm auto break case catch class const constexpr "
+                           "const_cast continue decltype default delete do dynamic_cast else "
+                           "enum explicit export extern final for friend goto if inline mutable "
+                           "namespace new noexcept operator override private protected public "
+                           "register reinterpret_cast return sizeof static static_assert "
+                           "static_cast struct switch template this thread_local throw try "
+                           "typedef typeid typename union using virtual volatile while "
+                           "bool char char16_t char32_t double float int long short signed "
+                           "unsigned void wchar_t");
+    def.m_literals = toSet("true false nullptr NULL");
+    def.m_builtIns = toSet("std string vector map set list deque queue stack array pair "
+                           "unique_ptr shared_ptr weak_ptr make_shared make_unique cin cout "
+                           "cerr endl printf scanf malloc calloc realloc free memcpy memset "
+                           "strlen strcmp strcpy size_t int8_t int16_t int32_t int64_t "
+                           "uint8_t uint16_t uint32_t uint64_t assert");
+    defs.insert("cpp", def);
+    }
+
+    // Python.
+    {
+    LanguageDef def;
+    def.m_lineComments << "#";
+    def.m_stringDelimiters = "\"'";
+    def.m_tripleQuotes = true;
+    def.m_decorator = true;
+    def.m_keywords = toSet("and as assert async await break class continue def del elif else "
+                           "except exec finally for from global if import in is lambda "
+                           "nonlocal not or pass print raise return try while with yield");
+    def.m_literals = toSet("True False None Ellipsis NotImplemented");
+    def.m_builtIns = toSet("abs all any bin bool bytearray bytes callable chr classmethod dict "
+                           "dir divmod enumerate eval filter float format frozenset getattr "
+                           "globals hasattr hash help hex id input int isinstance issubclass "
+                           "iter len list locals map max min next object oct open ord pow "
+                           "property range repr reversed round set setattr slice sorted "
+                           "staticmethod str sum super tuple type vars zip __import__");
+    defs.insert("python", def);
+    }
+
+    // Bash.
+    {
+    LanguageDef def;
+    def.m_lineComments << "#";
+    def.m_stringDelimiters = "\"'";
+    def.m_multiLineDelimiters = "\"'";
+    def.m_rawSingleQuote = true;
+    def.m_variable = true;
+    def.m_keywords = toSet("if then else elif fi for while until in do done case esac "
+                           "function select return break continue");
+    def.m_literals = toSet("true false");
+    def.m_builtIns = toSet("alias bg bind builtin caller cd command compgen complete declare "
+                           "dirs disown echo enable eval exec exit export fc fg getopts hash "
+                           "help history jobs kill let local logout popd printf pushd pwd "
+                           "read readarray readonly set shift shopt source test times trap "
+                           "type typeset ulimit umask unalias unset wait");
+    defs.insert("bash", def);
+    }
+
+    // JSON.
+    {
+    LanguageDef def;
+    def.m_stringDelimiters = "\"";
+    def.m_jsonKey = true;
+    def.m_literals = toSet("true false null");
+    defs.insert("json", def);
+    }
+
+    // YAML.
+    {
+    LanguageDef def;
+    def.m_lineComments << "#";
+    def.m_stringDelimiters = "\"'";
+    def.m_rawSingleQuote = true;
+    def.m_yamlKey = true;
+    def.m_literals = toSet("true false yes no null on off True False Yes No Null "
+                           "TRUE FALSE YES NO NULL ON OFF");
+    defs.insert("yaml", def);
+    }
+
+    // SQL.
+    {
+    LanguageDef def;
+    def.m_lineComments << "--";
+    def.m_blockComments.append(qMakePair(QString("/*"), QString("*/")));
+    def.m_stringDelimiters = "'\"";
+    def.m_rawSingleQuote = true;
+    def.m_caseInsensitive = true;
+    def.m_keywords = toSet("select from where and or not insert into values update set delete "
+                           "create table drop alter add column index primary key foreign "
+                           "references join inner left right outer full cross on as group by "
+                           "order having limit offset union all distinct case when then else "
+                           "end in is like between exists view database schema grant revoke "
+                           "begin commit rollback transaction default unique check constraint "
+                           "asc desc with returning if replace truncate procedure function "
+                           "trigger declare return returns int integer bigint smallint tinyint "
+                           "varchar char text date datetime time timestamp boolean bool float "
+                           "double real decimal numeric serial blob");
+    def.m_literals = toSet("null true false");
+    def.m_builtIns = toSet("count sum avg min max coalesce ifnull nullif cast convert concat "
+                           "substring length lower upper trim round abs now current_date "
+                           "current_timestamp");
+    defs.insert("sql", def);
+    }
+
+    // Go.
+    {
+    LanguageDef def;
+    def.m_lineComments << "//";
+    def.m_blockComments.append(qMakePair(QString("/*"), QString("*/")));
+    def.m_stringDelimiters = "\"'`";
+    def.m_multiLineDelimiters = "`";
+    def.m_keywords = toSet("break case chan const continue default defer else fallthrough for "
+                           "func go goto if import interface map package range return select "
+                           "struct switch type var bool byte complex64 complex128 error float32 "
+                           "float64 int8 int16 int32 int64 string uint8 uint16 uint32 uint64 "
+                           "int uint uintptr rune");
+    def.m_literals = toSet("true false iota nil");
+    def.m_builtIns = toSet("append cap close complex copy imag len make new panic print "
+                           "println real recover delete");
+    defs.insert("go", def);
+    }
+
+    // JavaScript.
+    {
+    LanguageDef def;
+    def.m_lineComments << "//";
+    def.m_blockComments.append(qMakePair(QString("/*"), QString("*/")));
+    def.m_stringDelimiters = "\"'`";
+    def.m_multiLineDelimiters = "`";
+    def.m_dollarInIdentifier = true;
+    def.m_keywords = toSet("in of if for while finally var new function do return void else "
+                           "break catch instanceof with throw case default try this switch "
+                           "continue typeof delete let yield const export super debugger as "
+                           "async await static import from class extends get set");
+    def.m_literals = toSet("true false null undefined NaN Infinity");
+    def.m_builtIns = toSet("eval isFinite isNaN parseFloat parseInt decodeURI decodeURIComponent "
+                           "encodeURI encodeURIComponent Object Function Boolean Error Symbol "
+                           "Number Math Date String RegExp Array Map Set WeakMap WeakSet "
+                           "Promise JSON Proxy Reflect console window document require module");
+    defs.insert("javascript", def);
+    }
+
+    return defs;
+}
+
+static QString canonicalLanguage(const QString &p_lang)
+{
+    static const QHash<QString, QString> aliases = {
+        {"cpp", "cpp"}, {"c++", "cpp"}, {"cc", "cpp"}, {"cxx", "cpp"}, {"c", "cpp"},
+        {"h", "cpp"}, {"hpp", "cpp"},
+        {"python", "python"}, {"py", "python"}, {"gyp", "python"},
+        {"bash", "bash"}, {"sh", "bash"}, {"shell", "bash"}, {"zsh", "bash"},
+        {"json", "json"},
+        {"yaml", "yaml"}, {"yml", "yaml"},
+        {"sql", "sql"},
+        {"go", "go"}, {"golang", "go"},
+        {"js", "javascript"}, {"javascript", "javascript"}, {"jsx", "javascript"}
+    };
+
+    return aliases.value(p_lang.trimmed().toLower());
+}
+
+static const LanguageDef *findLanguageDef(const QString &p_lang)
+{
+    // Thread-safe initialization since C++11.
+    static const QHash<QString, LanguageDef> defs = initLanguageDefs();
+
+    QString lang = canonicalLanguage(p_lang);
+    if (lang.isEmpty()) {
+        return NULL;
+    }
+
+    auto it = defs.constFind(lang);
+    if (it == defs.constEnd()) {
+        return NULL;
+    }
+
+    return &(*it);
+}
+
+bool VCodeBlockTokenizer::isLanguageSupported(const QString &p_lang)
+{
+    return findLanguageDef(p_lang) != NULL;
+}
+
+QVector<HLUnitPos> VCodeBlockTokenizer::tokenizeCodeBlock(const QString &p_lang,
+                                                          const QString &p_text)
+{
+    QVector<HLUnitPos> units;
+
+    // Skip the opening and closing fences.
+    int start = p_text.indexOf('\n');
+    int end = p_text.lastIndexOf('\n');
+    if (start == -1 || end <= start) {
+        return units;
+    }
+
+    ++start;
+    units = tokenize(p_lang, p_text.mid(start, end - start));
+    for (auto & unit : units) {
+        unit.m_position += start;
+    }
+
+    return units;
+}
+
+static inline bool isIdentifierChar(const QChar &p_ch, bool p_dollar)
+{
+    return p_ch.isLetterOrNumber() || p_ch == '_' || (p_dollar && p_ch == '$');
+}
+
+// Whether @p_pattern appears in @p_text at @p_pos.
+static inline bool matchAt(const QString &p_text, int p_pos, const QString &p_pattern)
+{
+    return p_text.midRef(p_pos, p_pattern.size()) == p_pattern;
+}
+
+// Return the position of the end of the line containing @p_pos.
+static inline int endOfLine(const QString &p_text, int p_pos)
+{
+    int idx = p_text.indexOf('\n', p_pos);
+    return idx == -1 ? p_text.size() : idx;
+}
+
+// Return the end position (exclusive) of the string starting at @p_pos.
+static int scanString(const LanguageDef &p_def, const QString &p_text, int p_pos)
+{
+    const int size = p_text.size();
+    QChar delimiter = p_text[p_pos];
+
+    if (p_def.m_tripleQuotes
+        && matchAt(p_text, p_pos, QString(3, delimiter))) {
+        QString quotes(3, delimiter);
+        int idx = p_pos + 3;
+        while (idx < size) {
+            if (p_text[idx] == '\\') {
+                idx += 2;
+                continue;
+            }
+
+            if (matchAt(p_text, idx, quotes)) {
+                return idx + 3;
+            }
+
+            ++idx;
+        }
+
+        return size;
+    }
+
+    bool multiLine = p_def.m_multiLineDelimiters.contains(delimiter);
+    bool escape = !(delimiter == '\'' && p_def.m_rawSingleQuote);
+    int idx = p_pos + 1;
+    while (idx < size) {
+        QChar ch = p_text[idx];
+        if (ch == '\\' && escape) {
+            idx += 2;
+            continue;
+        } else if (ch == delimiter) {
+            return idx + 1;
+        } else if (ch == '\n' && !multiLine) {
+            return idx;
+        }
+
+        ++idx;
+    }
+
+    return size;
+}
+
+// Return the end position (exclusive) of the number starting at @p_pos.
+static int scanNumber(const QString &p_text, int p_pos)
+{
+    const int size = p_text.size();
+    int idx = p_pos;
+    bool hex = matchAt(p_text, idx, "0x") || matchAt(p_text, idx, "0X");
+    if (hex) {
+        idx += 2;
+    }
+
+    while (idx < size) {
+        QChar ch = p_text[idx];
+        if (ch.isLetterOrNumber() || ch == '.' || ch == '_') {
+            if (!hex
+                && (ch == 'e' || ch == 'E')
+                && idx + 1 < size
+                && (p_text[idx + 1] == '+' || p_text[idx + 1] == '-')) {
+                idx += 2;
+                continue;
+            }
+
+            ++idx;
+        } else {
+            break;
+        }
+    }
+
+    return idx;
+}
+
+// Try to match a YAML key at the start of a line.
+// Return the end position (exclusive) of the key, or -1 if not matched.
+static int scanYamlKey(const QString &p_text, int p_pos)
+{
+    const int size = p_text.size();
+    int idx = p_pos;
+    while (idx < size) {
+        QChar ch = p_text[idx];
+        if (ch == ':') {
+            if (idx > p_pos
+                && (idx + 1 == size || p_text[idx + 1].isSpace())) {
+                return idx;
+            }
+
+            return -1;
+        } else if (ch == '\n' || ch == '#' || ch == '"' || ch == '\''
+                   || ch == '{' || ch == '[' || ch == ',') {
+            return -1;
+        }
+
+        ++idx;
+    }
+
+    return -1;
+}
+
+QVector<HLUnitPos> VCodeBlockTokenizer::tokenize(const QString &p_lang, const QString &p_text)
+{
+    QVector<HLUnitPos> units;
+
+    const LanguageDef *def = findLanguageDef(p_lang);
+    if (!def) {
+        return units;
+    }
+
+    const int size = p_text.size();
+    // Whether only spaces are met since the start of current line.
+    bool lineStart = true;
+    int idx = 0;
+    while (idx < size) {
+        const QChar ch = p_text[idx];
+        if (ch == '\n') {
+            lineStart = true;
+            ++idx;
+            continue;
+        }
+
+        if (ch.isSpace()) {
+            ++idx;
+            continue;
+        }
+
+        bool atLineStart = lineStart;
+        lineStart = false;
+
+        // Preprocessor directive.
+        if (def->m_preprocessor && atLineStart && ch == '#') {
+            int end = endOfLine(p_text, idx);
+            // Line continuation.
+            while (end > 0 && end < size && p_text[end - 1] == '\\') {
+                end = endOfLine(p_text, end + 1);
+            }
+
+            units.append(HLUnitPos(idx, end - idx, "hljs-meta"));
+            idx = end;
+            continue;
+        }
+
+        // Block comment.
+        bool matched = false;
+        for (auto const & comment : def->m_blockComments) {
+            if (matchAt(p_text, idx, comment.first)) {
+                int end = p_text.indexOf(comment.second, idx + comment.first.size());
+                end = end == -1 ? size : end + comment.second.size();
+                units.append(HLUnitPos(idx, end - idx, "hljs-comment"));
+                idx = end;
+                matched = true;
+                break;
+            }
+        }
+
+        if (matched) {
+            continue;
+        }
+
+        // Line comment.
+        for (auto const & comment : def->m_lineComments) {
+            if (matchAt(p_text, idx, comment)) {
+                // # must start a word to be a comment in Bash, such as $#.
+                if (def->m_variable && idx > 0 && !p_text[idx - 1].isSpace()) {
+                    break;
+                }
+
+                int end = endOfLine(p_text, idx);
+                units.append(HLUnitPos(idx, end - idx, "hljs-comment"));
+                idx = end;
+                matched = true;
+                break;
+            }
+        }
+
+        if (matched) {
+            continue;
+        }
+
+        // YAML key.
+        if (def->m_yamlKey && atLineStart) {
+            int keyStart = idx;
+            if (ch == '-' && idx + 1 < size && p_text[idx + 1] == ' ') {
+                keyStart = idx + 2;
+                while (keyStart < size && p_text[keyStart] == ' ') {
+                    ++keyStart;
+                }
+            }
+
+            int end = scanYamlKey(p_text, keyStart);
+            if (end != -1) {
+                units.append(HLUnitPos(keyStart, end - keyStart, "hljs-attr"));
+                idx = end + 1;
+                continue;
+            }
+        }
+
+        // String.
+        if (def->m_stringDelimiters.contains(ch)) {
+            int end = scanString(*def, p_text, idx);
+            QString style("hljs-string");
+            if (def->m_jsonKey) {
+                int next = end;
+                while (next < size && p_text[next].isSpace()) {
+                    ++next;
+                }
+
+                if (next < size && p_text[next] == ':') {
+                    style = "hljs-attr";
+                }
+            }
+
+            units.append(HLUnitPos(idx, end - idx, style));
+            idx = end;
+            continue;
+        }
+
+        // Variable.
+        if (def->m_variable && ch == '$' && idx + 1 < size) {
+            int end = idx + 1;
+            QChar next = p_text[end];
+            if (next == '{') {
+                end = p_text.indexOf('}', end);
+                end = (end == -1 || end > endOfLine(p_text, idx)) ? endOfLine(p_text, idx) : end + 1;
+            } else if (next.isLetter() || next == '_') {
+                while (end < size && isIdentifierChar(p_text[end], false)) {
+                    ++end;
+                }
+            } else if (next.isDigit() || QString("@*#?$!-").contains(next)) {
+                ++end;
+            }
+
+            if (end > idx + 1) {
+                units.append(HLUnitPos(idx, end - idx, "hljs-variable"));
+                idx = end;
+                continue;
+            }
+        }
+
+        // Decorator.
+        if (def->m_decorator && ch == '@' && idx + 1 < size && p_text[idx + 1].isLetter()) {
+            int end = idx + 1;
+            while (end < size && (isIdentifierChar(p_text[end], false) || p_text[end] == '.')) {
+                ++end;
+            }
+
+            units.append(HLUnitPos(idx, end - idx, "hljs-meta"));
+            idx = end;
+            continue;
+        }
+
+        // Number.
+        if (ch.isDigit()
+            || (ch == '.' && idx + 1 < size && p_text[idx + 1].isDigit())) {
+            int end = scanNumber(p_text, idx);
+            units.append(HLUnitPos(idx, end - idx, "hljs-number"));
+            idx = end;
+            continue;
+        }
+
+        // Identifier.
+        if (isIdentifierChar(ch, def->m_dollarInIdentifier)) {
+            int end = idx + 1;
+            while (end < size && isIdentifierChar(p_text[end], def->m_dollarInIdentifier)) {
+                ++end;
+            }
+
+            QString word = p_text.mid(idx, end - idx);
+            if (def->m_caseInsensitive) {
+                word = word.toLower();
+            }
+
+            if (def->m_keywords.contains(word)) {
+                units.append(HLUnitPos(idx, end - idx, "hljs-keyword"));
+            } else if (def->m_literals.contains(word)) {
+                units.append(HLUnitPos(idx, end - idx, "hljs-literal"));
+            } else if (def->m_builtIns.contains(word)) {
+                units.append(HLUnitPos(idx, end - idx, "hljs-built_in"));
+            }
+
+            idx = end;
+            continue;
+        }
+
+        ++idx;
+    }
+
+    return units;
+}
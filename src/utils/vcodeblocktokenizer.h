@@ -0,0 +1,30 @@
+#ifndef VCODEBLOCKTOKENIZER_H
+#define VCODEBLOCKTOKENIZER_H
+
+#include <QString>
+#include <QVector>
+
+#include "hgmarkdownhighlighter.h"
+
+// A native tokenizer to highlight code blocks of common languages without
+// the help of highlight.js. Styles of the highlight units are the class
+// names used by highlight.js, such as hljs-keyword.
+class VCodeBlockTokenizer
+{
+public:
+    // Whether @p_lang could be handled natively.
+    static bool isLanguageSupported(const QString &p_lang);
+
+    // Tokenize the text of a fenced code block @p_text, including the fences.
+    // Positions of the highlight units are relative to the start of @p_text.
+    static QVector<HLUnitPos> tokenizeCodeBlock(const QString &p_lang, const QString &p_text);
+
+    // Tokenize code @p_text in language @p_lang.
+    // Positions of the highlight units are relative to the start of @p_text.
+    static QVector<HLUnitPos> tokenize(const QString &p_lang, const QString &p_text);
+
+private:
+    VCodeBlockTokenizer() {}
+};
+
+#endif // VCODEBLOCKTOKENIZER_H
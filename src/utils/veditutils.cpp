@@ -962,3 +962,17 @@ void VEditUtils::insertBlock(QTextCursor &p_cursor,
 
     p_cursor.movePosition(QTextCursor::EndOfBlock);
 }
+
+bool VEditUtils::isWholeWord(const QString &p_text, int p_start, int p_length)
+{
+    if (p_start > 0 && p_text[p_start - 1].isLetterOrNumber()) {
+        return false;
+    }
+
+    int end = p_start + p_length;
+    if (end < p_text.size() && p_text[end].isLetterOrNumber()) {
+        return false;
+    }
+
+    return true;
+}
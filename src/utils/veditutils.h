@@ -189,6 +189,9 @@ public:
     static void insertBlock(QTextCursor &p_cursor,
                             bool p_above);
 
+    // Whether [@p_start, @p_start + @p_length) is a whole word in @p_text.
+    static bool isWholeWord(const QString &p_text, int p_start, int p_length);
+
 private:
     VEditUtils() {}
 };
@@ -31,6 +31,7 @@
 #include "vnotebook.h"
 #include "hgmarkdownhighlighter.h"
 #include "vpreviewpage.h"
+#include "vlogger.h"
 
 extern VConfigManager *g_config;
 
@@ -248,7 +249,7 @@ QVector<ImageLink> VUtils::fetchImagesFromMarkdownFile(VFile *p_file,
             if (!fetchedLinks.contains(link.m_url)) {
                 fetchedLinks.insert(link.m_url);
                 images.push_back(link);
-                qDebug() << "fetch one image:" << link.m_type << link.m_path << link.m_url;
+                qCDebug(lcPreview) << "fetch one image:" << link.m_type << link.m_path << link.m_url;
             }
         }
     }
@@ -13,6 +13,7 @@
 #include "utils/veditutils.h"
 #include "vconstants.h"
 #include "vmdeditor.h"
+#include "vtextreplacer.h"
 
 extern VConfigManager *g_config;
 
@@ -5867,6 +5868,8 @@ bool VVim::executeCommand(const QString &p_cmd)
     } else if (p_cmd == "nohlsearch" || p_cmd == "noh") {
         // :nohlsearch, clear highlight search.
         clearSearchHighlight();
+    } else if (executeSubstituteCommand(p_cmd, msg)) {
+        // :s/{pattern}/{string}/, substitute.
     } else {
         validCommand = false;
     }
@@ -5908,6 +5911,208 @@ bool VVim::executeCommand(const QString &p_cmd)
     return validCommand;
 }
 
+bool VVim::executeSubstituteCommand(const QString &p_cmd, QString &p_msg)
+{
+    QRegExp cmdReg("^(%|([\\.\\$]|\\d+)(?:,([\\.\\$]|\\d+))?)?s(?:ubstitute)?([^\\w\\s\\\\\"|])(.*)$");
+    if (!cmdReg.exactMatch(p_cmd)) {
+        return false;
+    }
+
+    QTextDocument *doc = m_editor->documentW();
+    int curBlock = m_editor->textCursorW().block().blockNumber();
+    auto blockOfRange = [doc, curBlock](const QString &p_str) {
+        if (p_str == ".") {
+            return curBlock;
+        } else if (p_str == "$") {
+            return doc->blockCount() - 1;
+        } else {
+            return qMax(p_str.toInt() - 1, 0);
+        }
+    };
+
+    int firstBlock = curBlock;
+    int lastBlock = curBlock;
+    if (cmdReg.cap(1) == "%") {
+        firstBlock = 0;
+        lastBlock = doc->blockCount() - 1;
+    } else if (!cmdReg.cap(2).isEmpty()) {
+        firstBlock = lastBlock = blockOfRange(cmdReg.cap(2));
+        if (!cmdReg.cap(3).isEmpty()) {
+            lastBlock = blockOfRange(cmdReg.cap(3));
+        }
+
+        if (firstBlock > lastBlock) {
+            qSwap(firstBlock, lastBlock);
+        }
+    }
+
+    // Split the rest into pattern, string and flags by unescaped delimiters.
+    // \<delimiter> matches the delimiter literally. In the pattern, it is
+    // unescaped if \<delimiter> has a special meaning in the magic syntax,
+    // such as \+, while the bare one is literal. Otherwise the escape is kept,
+    // such as \. and \*. The string takes \<delimiter> as the delimiter itself.
+    QChar delimiter = cmdReg.cap(4).at(0);
+    QString rest = cmdReg.cap(5);
+    QStringList parts;
+    parts.append(QString());
+    for (int i = 0; i < rest.size(); ++i) {
+        if (rest[i] == '\\' && i + 1 < rest.size()) {
+            QChar next = rest[++i];
+            if (!(next == delimiter
+                  && parts.size() == 1
+                  && QString("()|{}+?=<>").contains(next))) {
+                parts.last().append('\\');
+            }
+
+            parts.last().append(next);
+        } else if (rest[i] == delimiter && parts.size() < 3) {
+            parts.append(QString());
+        } else {
+            parts.last().append(rest[i]);
+        }
+    }
+
+    QString pattern = parts[0];
+    QString replaceText = parts.size() > 1 ? parts[1] : QString();
+    QString flags = parts.size() > 2 ? parts[2] : QString();
+
+    uint options = FindOption::RegularExpression;
+    if (pattern.indexOf("\\C") > -1) {
+        options |= FindOption::CaseSensitive;
+        pattern.remove("\\C");
+    }
+
+    bool global = false;
+    for (auto const & ch : flags) {
+        if (ch == 'g') {
+            global = true;
+        } else if (ch == 'i') {
+            options &= ~FindOption::CaseSensitive;
+        } else if (ch == 'I') {
+            options |= FindOption::CaseSensitive;
+        } else if (!ch.isSpace()) {
+            p_msg = tr("Invalid flag: %1").arg(ch);
+            return true;
+        }
+    }
+
+    QString exp;
+    if (!translateMagicPattern(pattern, exp, p_msg)) {
+        return true;
+    }
+
+    VTextReplacer replacer(exp, options, replaceText);
+    replacer.setExpandCaptures(true);
+    replacer.setFirstMatchOnly(!global);
+    if (!replacer.isValid()) {
+        p_msg = replacer.errorString();
+        return true;
+    }
+
+    int nrReplaces = replacer.replace(doc, firstBlock, lastBlock);
+    if (nrReplaces == 0) {
+        p_msg = tr("Pattern not found: %1").arg(pattern);
+    } else {
+        p_msg = tr("%1 %2").arg(nrReplaces)
+                           .arg(nrReplaces > 1 ? tr("substitutions") : tr("substitution"));
+    }
+
+    return true;
+}
+
+bool VVim::translateMagicPattern(const QString &p_pattern, QString &p_exp, QString &p_msg)
+{
+    QString exp;
+    exp.reserve(p_pattern.size());
+
+    // Whether we are in a \{n,m} multi, which could be closed by } or \}.
+    bool inBraces = false;
+    const int size = p_pattern.size();
+    for (int i = 0; i < size; ++i) {
+        QChar ch = p_pattern[i];
+        if (ch == '\\' && i + 1 < size) {
+            QChar next = p_pattern[++i];
+            switch (next.unicode()) {
+            case '(':
+            case ')':
+            case '|':
+            case '+':
+            case '?':
+                exp.append(next);
+                break;
+
+            case '=':
+                exp.append('?');
+                break;
+
+            case '{':
+                if (i + 1 < size && p_pattern[i + 1] == '-') {
+                    // QRegExp has no non-greedy quantifiers.
+                    p_msg = tr("Non-greedy \\{- is not supported: %1").arg(p_pattern);
+                    return false;
+                }
+
+                exp.append(next);
+                inBraces = true;
+                break;
+
+            case '}':
+                exp.append(next);
+                inBraces = false;
+                break;
+
+            case '<':
+            case '>':
+                exp.append("\\b");
+                break;
+
+            default:
+                exp.append(ch);
+                exp.append(next);
+                break;
+            }
+        } else if (ch == '[') {
+            // Copy the collection as is.
+            int end = i + 1;
+            if (end < size && p_pattern[end] == '^') {
+                ++end;
+            }
+
+            if (end < size && p_pattern[end] == ']') {
+                ++end;
+            }
+
+            while (end < size && p_pattern[end] != ']') {
+                if (p_pattern[end] == '\\') {
+                    ++end;
+                }
+
+                ++end;
+            }
+
+            if (end >= size) {
+                // A [ without ] is literal.
+                exp.append("\\[");
+            } else {
+                exp.append(p_pattern.mid(i, end - i + 1));
+                i = end;
+            }
+        } else if (ch == '}' && inBraces) {
+            exp.append(ch);
+            inBraces = false;
+        } else if (ch == '(' || ch == ')' || ch == '|'
+                   || ch == '{' || ch == '}' || ch == '+' || ch == '?') {
+            exp.append('\\');
+            exp.append(ch);
+        } else {
+            exp.append(ch);
+        }
+    }
+
+    p_exp = exp;
+    return true;
+}
+
 bool VVim::hasNonDigitPendingKeys(const QList<Key> &p_keys)
 {
     for (auto const &key : p_keys) {
@@ -789,9 +789,21 @@ private:
     // @p_cmd does not contain the leading colon.
     // Returns true if it is a valid command.
     // Following commands are supported:
-    // w, wq, q, q!, x, <nums>
+    // w, wq, q, q!, x, <nums>, [range]s/{pattern}/{string}/[flags]
     bool executeCommand(const QString &p_cmd);
 
+    // :[range]s[ubstitute]/{pattern}/{string}/[flags]
+    // Range could be %, or one or two of ., $, <num> separated by comma.
+    // Flags could be g, i, and I.
+    // Returns false if @p_cmd is not a substitute command.
+    bool executeSubstituteCommand(const QString &p_cmd, QString &p_msg);
+
+    // Translate Vim magic pattern @p_pattern of :s to QRegExp syntax @p_exp.
+    // \( \) \| \{ \} \+ \? \= are special while ( ) | { } + ? are literal.
+    // \< and \> are word boundaries.
+    // Returns false with @p_msg set if it is not supported, such as non-greedy \{-}.
+    static bool translateMagicPattern(const QString &p_pattern, QString &p_exp, QString &p_msg);
+
     // Check if m_keys has non-digit key.
     bool hasNonDigitPendingKeys();
 
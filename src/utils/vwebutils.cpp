@@ -913,7 +913,7 @@ QString VWebUtils::copyResource(const QUrl &p_url, const QString &p_folder) cons
     bool succ = false;
     if (p_url.scheme() == "https" || p_url.scheme() == "http") {
         // Download it.
-        QByteArray data = VDownloader::downloadSync(p_url);
+        QByteArray data = VDownloader::downloadSync(p_url, true);
         if (!data.isEmpty()) {
             succ = VUtils::writeFileToDisk(targetFile, data);
         }
@@ -0,0 +1,135 @@
+#include "vbackupjournal.h"
+
+#include <QDebug>
+
+const QByteArray VBackupJournal::c_magic = "vnote_backup_journal 1\n";
+
+// Do not compact a journal smaller than this in bytes.
+static const qint64 c_minCompactSize = 64 * 1024;
+
+VBackupJournal::VBackupJournal()
+    : m_snapshotSize(-1),
+      m_journalSize(0)
+{
+}
+
+void VBackupJournal::addChange(int p_position, int p_charsRemoved, const QString &p_added)
+{
+    if (p_charsRemoved == 0 && p_added.isEmpty()) {
+        return;
+    }
+
+    // Merge with last change if typing continuously.
+    if (!m_changes.isEmpty()) {
+        Change &last = m_changes.last();
+        if (p_charsRemoved == 0
+            && p_position == last.m_position + last.m_added.size()) {
+            last.m_added += p_added;
+            return;
+        }
+    }
+
+    Change change;
+    change.m_position = p_position;
+    change.m_charsRemoved = p_charsRemoved;
+    change.m_added = p_added;
+    m_changes.append(change);
+}
+
+bool VBackupJournal::needSnapshot() const
+{
+    return m_snapshotSize < 0
+           || m_journalSize > qMax(m_snapshotSize, c_minCompactSize);
+}
+
+QByteArray VBackupJournal::takeSnapshot(const QString &p_content)
+{
+    QByteArray data(c_magic);
+    data += "S " + QByteArray::number(p_content.size()) + "\n";
+    data += p_content.toUtf8();
+    data += "\n";
+
+    m_changes.clear();
+    m_snapshotSize = data.size();
+    m_journalSize = 0;
+    return data;
+}
+
+QByteArray VBackupJournal::takeChanges()
+{
+    QByteArray data;
+    for (auto const & change : m_changes) {
+        data += "D " + QByteArray::number(change.m_position)
+                + " " + QByteArray::number(change.m_charsRemoved)
+                + " " + QByteArray::number(change.m_added.size()) + "\n";
+        data += change.m_added.toUtf8();
+        data += "\n";
+    }
+
+    m_changes.clear();
+    m_journalSize += data.size();
+    return data;
+}
+
+void VBackupJournal::reset()
+{
+    m_changes.clear();
+    m_snapshotSize = -1;
+    m_journalSize = 0;
+}
+
+QString VBackupJournal::replay(const QByteArray &p_data)
+{
+    if (!p_data.startsWith(c_magic)) {
+        // Backup file of old versions.
+        return QString::fromUtf8(p_data).replace("\r\n", "\n");
+    }
+
+    const QString text = QString::fromUtf8(p_data.mid(c_magic.size()));
+    QString content;
+    int pos = 0;
+    while (pos < text.size()) {
+        int eol = text.indexOf('\n', pos);
+        if (eol == -1) {
+            break;
+        }
+
+        QStringList fields = text.mid(pos, eol - pos).split(' ');
+        bool ok = true;
+        QVector<int> nums;
+        for (int i = 1; i < fields.size() && ok; ++i) {
+            nums.append(fields[i].toInt(&ok));
+        }
+
+        if (!ok || nums.isEmpty()) {
+            break;
+        }
+
+        int len = nums.last();
+        int start = eol + 1;
+        if (len < 0 || start + len >= text.size() || text[start + len] != '\n') {
+            // Incomplete record.
+            break;
+        }
+
+        const QString added = text.mid(start, len);
+        if (fields[0] == "S" && nums.size() == 1) {
+            content = added;
+        } else if (fields[0] == "D" && nums.size() == 3) {
+            int position = nums[0];
+            int removed = nums[1];
+            if (position < 0 || removed < 0 || position + removed > content.size()) {
+                qWarning() << "invalid change in backup journal at" << pos;
+                break;
+            }
+
+            content.replace(position, removed, added);
+        } else {
+            break;
+        }
+
+        pos = start + len + 1;
+    }
+
+    return content;
+}
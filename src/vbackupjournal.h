@@ -0,0 +1,65 @@
+#ifndef VBACKUPJOURNAL_H
+#define VBACKUPJOURNAL_H
+
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+
+// Append-only journal of the changes to a document for backup.
+// A journal is a snapshot of the whole content followed by changes. Pending
+// changes are appended on each backup, and a new snapshot is written once the
+// changes outgrow the snapshot, so the cost of a backup is proportional to
+// the text typed since last one.
+// Positions and lengths are counted in QChar of the plain text.
+class VBackupJournal
+{
+public:
+    VBackupJournal();
+
+    // Replace [@p_position, @p_position + @p_charsRemoved) with @p_added.
+    void addChange(int p_position, int p_charsRemoved, const QString &p_added);
+
+    bool hasChanges() const;
+
+    // Whether a snapshot should be written instead of appending changes.
+    bool needSnapshot() const;
+
+    // Encode a snapshot of @p_content which includes all pending changes.
+    QByteArray takeSnapshot(const QString &p_content);
+
+    // Encode pending changes to append.
+    QByteArray takeChanges();
+
+    // Drop pending changes and start over with a snapshot.
+    void reset();
+
+    // Rebuild the content from journal @p_data.
+    // Incomplete records at the end, written during a crash, are ignored.
+    // Data not in journal format is treated as the content itself.
+    static QString replay(const QByteArray &p_data);
+
+private:
+    struct Change
+    {
+        int m_position;
+        int m_charsRemoved;
+        QString m_added;
+    };
+
+    QVector<Change> m_changes;
+
+    // Bytes of last snapshot, -1 if not written yet.
+    qint64 m_snapshotSize;
+
+    // Bytes of changes appended since last snapshot.
+    qint64 m_journalSize;
+
+    static const QByteArray c_magic;
+};
+
+inline bool VBackupJournal::hasChanges() const
+{
+    return !m_changes.isEmpty();
+}
+
+#endif // VBACKUPJOURNAL_H
@@ -0,0 +1,157 @@
+#include "vblockheighttree.h"
+
+#include <algorithm>
+
+VBlockHeightTree::VBlockHeightTree()
+    : m_count(0),
+      m_size(1),
+      m_heights(2, 0),
+      m_widths(2, 0)
+{
+}
+
+void VBlockHeightTree::reset(int p_count)
+{
+    m_count = p_count;
+    m_size = 1;
+    while (m_size < p_count) {
+        m_size <<= 1;
+    }
+
+    m_heights.fill(0, 2 * m_size);
+    m_widths.fill(0, 2 * m_size);
+}
+
+bool VBlockHeightTree::reserve(int p_count)
+{
+    if (p_count <= m_size) {
+        return true;
+    }
+
+    QVector<qreal> heights = m_heights.mid(m_size, m_count);
+    QVector<qreal> widths = m_widths.mid(m_size, m_count);
+    int count = m_count;
+
+    reset(p_count);
+
+    m_count = count;
+    std::copy(heights.constBegin(), heights.constEnd(), m_heights.begin() + m_size);
+    std::copy(widths.constBegin(), widths.constEnd(), m_widths.begin() + m_size);
+    return false;
+}
+
+void VBlockHeightTree::insert(int p_idx, int p_count)
+{
+    Q_ASSERT(p_idx >= 0 && p_idx <= m_count);
+    if (p_count <= 0) {
+        return;
+    }
+
+    int start = reserve(m_count + p_count) ? p_idx : 0;
+
+    qreal *heights = m_heights.data() + m_size;
+    qreal *widths = m_widths.data() + m_size;
+    std::copy_backward(heights + p_idx, heights + m_count, heights + m_count + p_count);
+    std::copy_backward(widths + p_idx, widths + m_count, widths + m_count + p_count);
+    std::fill(heights + p_idx, heights + p_idx + p_count, 0);
+    std::fill(widths + p_idx, widths + p_idx + p_count, 0);
+
+    m_count += p_count;
+    updateFrom(start);
+}
+
+void VBlockHeightTree::remove(int p_idx, int p_count)
+{
+    Q_ASSERT(p_idx >= 0 && p_idx + p_count <= m_count);
+    if (p_count <= 0) {
+        return;
+    }
+
+    qreal *heights = m_heights.data() + m_size;
+    qreal *widths = m_widths.data() + m_size;
+    std::copy(heights + p_idx + p_count, heights + m_count, heights + p_idx);
+    std::copy(widths + p_idx + p_count, widths + m_count, widths + p_idx);
+    std::fill(heights + m_count - p_count, heights + m_count, 0);
+    std::fill(widths + m_count - p_count, widths + m_count, 0);
+
+    m_count -= p_count;
+    updateFrom(p_idx);
+}
+
+void VBlockHeightTree::updateFrom(int p_idx)
+{
+    int lo = (m_size + p_idx) >> 1;
+    int hi = m_size - 1;
+    while (lo >= 1) {
+        for (int i = lo; i <= hi; ++i) {
+            m_heights[i] = m_heights[2 * i] + m_heights[2 * i + 1];
+            m_widths[i] = qMax(m_widths[2 * i], m_widths[2 * i + 1]);
+        }
+
+        lo >>= 1;
+        hi >>= 1;
+    }
+}
+
+void VBlockHeightTree::setBlock(int p_idx, qreal p_height, qreal p_width)
+{
+    Q_ASSERT(p_idx >= 0 && p_idx < m_count);
+    int i = m_size + p_idx;
+    if (m_heights[i] == p_height && m_widths[i] == p_width) {
+        return;
+    }
+
+    m_heights[i] = p_height;
+    m_widths[i] = p_width;
+    for (i >>= 1; i >= 1; i >>= 1) {
+        m_heights[i] = m_heights[2 * i] + m_heights[2 * i + 1];
+        m_widths[i] = qMax(m_widths[2 * i], m_widths[2 * i + 1]);
+    }
+}
+
+qreal VBlockHeightTree::offset(int p_idx) const
+{
+    Q_ASSERT(p_idx >= 0 && p_idx <= m_count);
+    qreal sum = 0;
+    int l = m_size, r = m_size + p_idx;
+    while (l < r) {
+        if (l & 1) {
+            sum += m_heights[l++];
+        }
+
+        if (r & 1) {
+            sum += m_heights[--r];
+        }
+
+        l >>= 1;
+        r >>= 1;
+    }
+
+    return sum;
+}
+
+int VBlockHeightTree::findBlock(qreal p_y) const
+{
+    if (m_count == 0) {
+        return -1;
+    }
+
+    if (p_y < 0) {
+        return 0;
+    } else if (p_y >= totalHeight()) {
+        return m_count - 1;
+    }
+
+    int node = 1;
+    while (node < m_size) {
+        int left = node << 1;
+        if (p_y < m_heights[left]) {
+            node = left;
+        } else {
+            p_y -= m_heights[left];
+            node = left + 1;
+        }
+    }
+
+    return qMin(node - m_size, m_count - 1);
+}
@@ -0,0 +1,84 @@
+#ifndef VBLOCKHEIGHTTREE_H
+#define VBLOCKHEIGHTTREE_H
+
+#include <QVector>
+#include <QtGlobal>
+
+// Segment tree of the heights and widths of the blocks of a document.
+// Offset of a block, block at a given Y, total height, and maximum width
+// could be fetched in O(log n) or O(1) without storing absolute offsets,
+// so that changing one block does not invalidate the following blocks.
+class VBlockHeightTree
+{
+public:
+    VBlockHeightTree();
+
+    // Reset to @p_count blocks with zero height and width.
+    void reset(int p_count);
+
+    int count() const;
+
+    // Insert @p_count empty blocks before block @p_idx.
+    void insert(int p_idx, int p_count);
+
+    // Remove @p_count blocks from block @p_idx.
+    void remove(int p_idx, int p_count);
+
+    void setBlock(int p_idx, qreal p_height, qreal p_width);
+
+    qreal height(int p_idx) const;
+
+    // Sum of the heights of blocks [0, @p_idx).
+    qreal offset(int p_idx) const;
+
+    qreal totalHeight() const;
+
+    qreal maximumWidth() const;
+
+    // Return the block whose range [offset, offset + height) contains @p_y.
+    // Return the first or last block if @p_y is out of range.
+    // Return -1 if there is no block.
+    int findBlock(qreal p_y) const;
+
+private:
+    // Make sure there is enough leaves for @p_count blocks.
+    // Return false if the tree is rebuilt.
+    bool reserve(int p_count);
+
+    // Recompute all the internal nodes covering leaves from @p_idx.
+    void updateFrom(int p_idx);
+
+    // Number of blocks.
+    int m_count;
+
+    // Number of leaves, power of 2.
+    int m_size;
+
+    // Node i has children 2i and 2i+1. Leaves start at m_size.
+    QVector<qreal> m_heights;
+
+    QVector<qreal> m_widths;
+};
+
+inline int VBlockHeightTree::count() const
+{
+    return m_count;
+}
+
+inline qreal VBlockHeightTree::height(int p_idx) const
+{
+    Q_ASSERT(p_idx >= 0 && p_idx < m_count);
+    return m_heights[m_size + p_idx];
+}
+
+inline qreal VBlockHeightTree::totalHeight() const
+{
+    return m_heights[1];
+}
+
+inline qreal VBlockHeightTree::maximumWidth() const
+{
+    return m_widths[1];
+}
+
+#endif // VBLOCKHEIGHTTREE_H
@@ -0,0 +1,238 @@
+#include "vcodeblockhighlightcache.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+#include "vconfigmanager.h"
+
+extern VConfigManager *g_config;
+
+const quint32 VCodeBlockHighlightCache::c_magic = 0x56434248;
+
+const quint32 VCodeBlockHighlightCache::c_version = 1;
+
+const QString VCodeBlockHighlightCache::c_cacheFile = QString("codeblock_highlight.cache");
+
+VCodeBlockHighlightCache::VCodeBlockHighlightCache()
+    : m_bytes(0),
+      m_maxBytes(0),
+      m_persistent(false),
+      m_dirty(false),
+      m_hits(0),
+      m_misses(0)
+{
+}
+
+VCodeBlockHighlightCache::~VCodeBlockHighlightCache()
+{
+    save();
+}
+
+void VCodeBlockHighlightCache::init()
+{
+    m_maxBytes = (qint64)g_config->getCodeBlockHighlightCacheSize() * 1024;
+    m_persistent = g_config->getPersistCodeBlockHighlightCache();
+
+    if (m_persistent && m_maxBytes > 0) {
+        load();
+    }
+}
+
+// 64-bit FNV-1a.
+quint64 VCodeBlockHighlightCache::hash(const QString &p_lang, const QString &p_text)
+{
+    const quint64 prime = 1099511628211ULL;
+    quint64 val = 14695981039346656037ULL;
+
+    auto hashStr = [&val, prime](const QString &p_str) {
+        const ushort *data = p_str.utf16();
+        for (int i = 0; i < p_str.size(); ++i) {
+            val ^= (data[i] & 0xff);
+            val *= prime;
+            val ^= (data[i] >> 8);
+            val *= prime;
+        }
+    };
+
+    hashStr(p_lang);
+
+    // Separator between language and text.
+    val ^= 0xff;
+    val *= prime;
+
+    hashStr(p_text);
+
+    return val;
+}
+
+int VCodeBlockHighlightCache::estimateBytes(const QVector<HLUnitPos> &p_units)
+{
+    int bytes = sizeof(Entry) + 64;
+    for (auto const & unit : p_units) {
+        bytes += sizeof(HLUnitPos) + unit.m_style.size() * sizeof(QChar);
+    }
+
+    return bytes;
+}
+
+bool VCodeBlockHighlightCache::find(const QString &p_lang,
+                                    const QString &p_text,
+                                    QVector<HLUnitPos> &p_units)
+{
+    auto it = m_index.find(hash(p_lang, p_text));
+    if (it == m_index.end() || it.value()->m_textLength != p_text.size()) {
+        ++m_misses;
+        return false;
+    }
+
+    ++m_hits;
+
+    // Move to front.
+    m_entries.splice(m_entries.begin(), m_entries, it.value());
+    p_units = m_entries.front().m_units;
+    return true;
+}
+
+void VCodeBlockHighlightCache::insert(const QString &p_lang,
+                                      const QString &p_text,
+                                      const QVector<HLUnitPos> &p_units)
+{
+    // Empty result may come from a transient failure and should not outlive it.
+    if (m_maxBytes <= 0 || p_units.isEmpty()) {
+        return;
+    }
+
+    Entry entry;
+    entry.m_key = hash(p_lang, p_text);
+    entry.m_textLength = p_text.size();
+    entry.m_units = p_units;
+    entry.m_bytes = estimateBytes(p_units);
+
+    insertEntry(entry);
+    m_dirty = true;
+
+    evict();
+}
+
+void VCodeBlockHighlightCache::insertEntry(const Entry &p_entry)
+{
+    auto it = m_index.find(p_entry.m_key);
+    if (it != m_index.end()) {
+        m_bytes -= it.value()->m_bytes;
+        m_entries.erase(it.value());
+        m_index.erase(it);
+    }
+
+    m_entries.push_front(p_entry);
+    m_index.insert(p_entry.m_key, m_entries.begin());
+    m_bytes += p_entry.m_bytes;
+}
+
+void VCodeBlockHighlightCache::evict()
+{
+    while (m_bytes > m_maxBytes && !m_entries.empty()) {
+        const Entry &entry = m_entries.back();
+        m_bytes -= entry.m_bytes;
+        m_index.remove(entry.m_key);
+        m_entries.pop_back();
+    }
+}
+
+QString VCodeBlockHighlightCache::cacheFilePath() const
+{
+    return QDir(g_config->getConfigFolder()).filePath(c_cacheFile);
+}
+
+void VCodeBlockHighlightCache::load()
+{
+    QFile file(cacheFilePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_7);
+
+    quint32 magic = 0, version = 0;
+    in >> magic >> version;
+    if (magic != c_magic || version != c_version) {
+        qWarning() << "ignore code block highlight cache file of invalid version" << file.fileName();
+        return;
+    }
+
+    qint32 nrEntries = 0;
+    in >> nrEntries;
+    for (int i = 0; i < nrEntries && in.status() == QDataStream::Ok; ++i) {
+        Entry entry;
+        qint32 textLength = 0, nrUnits = 0;
+        in >> entry.m_key >> textLength >> nrUnits;
+        entry.m_textLength = textLength;
+        for (int j = 0; j < nrUnits && in.status() == QDataStream::Ok; ++j) {
+            qint32 pos = 0, len = 0;
+            QString style;
+            in >> pos >> len >> style;
+            entry.m_units.append(HLUnitPos(pos, len, style));
+        }
+
+        if (in.status() != QDataStream::Ok) {
+            break;
+        }
+
+        if (entry.m_units.isEmpty()) {
+            // Saved by an old version which cached failed results.
+            continue;
+        }
+
+        entry.m_bytes = estimateBytes(entry.m_units);
+
+        // Entries are stored from the most recently used one.
+        if (m_bytes + entry.m_bytes > m_maxBytes) {
+            break;
+        }
+
+        m_entries.push_back(entry);
+        m_index.insert(entry.m_key, --m_entries.end());
+        m_bytes += entry.m_bytes;
+    }
+
+    m_dirty = false;
+
+    qDebug() << "load" << m_entries.size() << "code block highlight cache entries" << m_bytes << "bytes";
+}
+
+void VCodeBlockHighlightCache::save()
+{
+    if (!m_persistent || !m_dirty) {
+        return;
+    }
+
+    QSaveFile file(cacheFilePath());
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "fail to open code block highlight cache file" << file.fileName();
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_7);
+
+    out << c_magic << c_version << (qint32)m_entries.size();
+    for (auto const & entry : m_entries) {
+        out << entry.m_key << (qint32)entry.m_textLength << (qint32)entry.m_units.size();
+        for (auto const & unit : entry.m_units) {
+            out << (qint32)unit.m_position << (qint32)unit.m_length << unit.m_style;
+        }
+    }
+
+    if (!file.commit()) {
+        qWarning() << "fail to write code block highlight cache file" << file.fileName();
+        return;
+    }
+
+    m_dirty = false;
+
+    qDebug() << "save" << m_entries.size() << "code block highlight cache entries"
+             << "hits" << m_hits << "misses" << m_misses;
+}
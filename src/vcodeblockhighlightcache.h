@@ -0,0 +1,92 @@
+#ifndef VCODEBLOCKHIGHLIGHTCACHE_H
+#define VCODEBLOCKHIGHLIGHTCACHE_H
+
+#include <list>
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include "hgmarkdownhighlighter.h"
+
+// LRU cache of code block highlight results shared by all the editors.
+// Keyed by a 64-bit hash of the language and text of the code block and
+// bounded by an estimated size in bytes.
+// Could be persisted to disk in the configuration folder.
+class VCodeBlockHighlightCache
+{
+public:
+    VCodeBlockHighlightCache();
+
+    ~VCodeBlockHighlightCache();
+
+    // Read configurations and load the persistent cache if enabled.
+    void init();
+
+    // Look up the highlight result of code block @p_text in language @p_lang.
+    // Positions of the units are relative to the start of the code block.
+    bool find(const QString &p_lang, const QString &p_text, QVector<HLUnitPos> &p_units);
+
+    // Empty @p_units will not be cached.
+    void insert(const QString &p_lang, const QString &p_text, const QVector<HLUnitPos> &p_units);
+
+    // Write the cache to disk if it is persistent and has been changed.
+    void save();
+
+    static quint64 hash(const QString &p_lang, const QString &p_text);
+
+private:
+    struct Entry
+    {
+        Entry() : m_key(0), m_textLength(0), m_bytes(0)
+        {
+        }
+
+        quint64 m_key;
+
+        // Length of the code block text, used to reduce false hit of hash collision.
+        int m_textLength;
+
+        // Estimated size of this entry.
+        int m_bytes;
+
+        QVector<HLUnitPos> m_units;
+    };
+
+    void insertEntry(const Entry &p_entry);
+
+    // Evict the least recently used entries until the size is within budget.
+    void evict();
+
+    void load();
+
+    QString cacheFilePath() const;
+
+    static int estimateBytes(const QVector<HLUnitPos> &p_units);
+
+    // Most recently used entries at the front.
+    std::list<Entry> m_entries;
+
+    QHash<quint64, std::list<Entry>::iterator> m_index;
+
+    qint64 m_bytes;
+
+    qint64 m_maxBytes;
+
+    bool m_persistent;
+
+    // Whether the cache has been changed since last load or save.
+    bool m_dirty;
+
+    int m_hits;
+
+    int m_misses;
+
+    // Magic number and version of the cache file.
+    static const quint32 c_magic;
+    static const quint32 c_version;
+
+    static const QString c_cacheFile;
+};
+
+#endif // VCODEBLOCKHIGHLIGHTCACHE_H
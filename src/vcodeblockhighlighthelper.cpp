@@ -2,8 +2,15 @@
 
 #include <QDebug>
 #include <QStringList>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
 #include "vdocument.h"
 #include "utils/vutils.h"
+#include "utils/vcodeblocktokenizer.h"
+#include "vcodeblockhighlightcache.h"
+#include "vlogger.h"
+
+extern VCodeBlockHighlightCache *g_codeBlockHLCache;
 
 VCodeBlockHighlightHelper::VCodeBlockHighlightHelper(HGMarkdownHighlighter *p_highlighter,
                                                      VDocument *p_vdoc,
@@ -59,31 +66,70 @@ QString VCodeBlockHighlightHelper::unindentCodeBlock(const QString &p_text)
 
 void VCodeBlockHighlightHelper::handleCodeBlocksUpdated(const QVector<VCodeBlock> &p_codeBlocks)
 {
-    if (!m_vdocument->isReadyToHighlight()) {
-        // Immediately return empty results.
-        QVector<HLUnitPos> emptyRes;
-        for (int i = 0; i < p_codeBlocks.size(); ++i) {
-            updateHighlightResults(0, emptyRes);
-        }
-
-        return;
-    }
-
     int curStamp = m_timeStamp.fetchAndAddRelaxed(1) + 1;
     m_codeBlocks = p_codeBlocks;
+
+    bool readyToHighlight = m_vdocument->isReadyToHighlight();
+    QVector<VCodeBlock> nativeBlocks;
+    QVector<HLUnitPos> cachedUnits;
     for (int i = 0; i < m_codeBlocks.size(); ++i) {
         const VCodeBlock &block = m_codeBlocks[i];
-        auto it = m_cache.find(block.m_text);
-        if (it != m_cache.end()) {
+        if (g_codeBlockHLCache->find(block.m_lang, block.m_text, cachedUnits)) {
             // Hit cache.
-            qDebug() << "code block highlight hit cache" << curStamp << i;
-            it.value().m_timeStamp = curStamp;
-            updateHighlightResults(block.m_startPos, it.value().m_units);
-        } else {
+            qCDebug(lcHighlighter) << "code block highlight hit cache" << curStamp << i;
+            updateHighlightResults(block.m_startPos, cachedUnits);
+        } else if (VCodeBlockTokenizer::isLanguageSupported(block.m_lang)) {
+            nativeBlocks.append(block);
+        } else if (readyToHighlight) {
             QString unindentedText = unindentCodeBlock(block.m_text);
             m_vdocument->highlightTextAsync(unindentedText, i, curStamp);
+        } else {
+            // Immediately return empty results.
+            updateHighlightResults(0, QVector<HLUnitPos>());
         }
     }
+
+    if (!nativeBlocks.isEmpty()) {
+        highlightNativelyAsync(nativeBlocks, curStamp);
+    }
+}
+
+void VCodeBlockHighlightHelper::highlightNativelyAsync(const QVector<VCodeBlock> &p_codeBlocks,
+                                                       int p_timeStamp)
+{
+    typedef QFutureWatcher<QVector<QVector<HLUnitPos>>> NativeWatcher;
+    NativeWatcher *watcher = new NativeWatcher(this);
+    connect(watcher, &NativeWatcher::finished,
+            this, [this, watcher, p_codeBlocks, p_timeStamp]() {
+                watcher->deleteLater();
+
+                // Abandon obsolete result.
+                if (m_timeStamp.load() != p_timeStamp) {
+                    return;
+                }
+
+                QVector<QVector<HLUnitPos>> results = watcher->result();
+                Q_ASSERT(results.size() == p_codeBlocks.size());
+                for (int i = 0; i < p_codeBlocks.size(); ++i) {
+                    const VCodeBlock &block = p_codeBlocks[i];
+                    g_codeBlockHLCache->insert(block.m_lang, block.m_text, results[i]);
+                    updateHighlightResults(block.m_startPos, results[i]);
+                }
+            });
+
+    watcher->setFuture(QtConcurrent::run(&VCodeBlockHighlightHelper::highlightNatively,
+                                         p_codeBlocks));
+}
+
+QVector<QVector<HLUnitPos>> VCodeBlockHighlightHelper::highlightNatively(const QVector<VCodeBlock> &p_codeBlocks)
+{
+    QVector<QVector<HLUnitPos>> results;
+    results.reserve(p_codeBlocks.size());
+    for (auto const & block : p_codeBlocks) {
+        results.append(VCodeBlockTokenizer::tokenizeCodeBlock(block.m_lang, block.m_text));
+    }
+
+    return results;
 }
 
 void VCodeBlockHighlightHelper::handleTextHighlightResult(const QString &p_html,
@@ -207,11 +253,11 @@ exit:
         qWarning() << "fail to parse highlighted result"
                    << "stamp:" << p_timeStamp << "index:" << p_idx << p_html;
         hlUnits.clear();
+    } else {
+        // Add it to cache only if succeeded.
+        g_codeBlockHLCache->insert(block.m_lang, text, hlUnits);
     }
 
-    // Add it to cache.
-    addToHighlightCache(text, p_timeStamp, hlUnits);
-
     updateHighlightResults(startPos, hlUnits);
 }
 
@@ -269,24 +315,3 @@ bool VCodeBlockHighlightHelper::parseSpanElement(QXmlStreamReader &p_xml,
     }
     return false;
 }
-
-void VCodeBlockHighlightHelper::addToHighlightCache(const QString &p_text,
-                                                    int p_timeStamp,
-                                                    const QVector<HLUnitPos> &p_units)
-{
-    const int c_maxEntries = 100;
-    const int c_maxTimeStampSpan = 3;
-    if (m_cache.size() >= c_maxEntries) {
-        // Remove the oldest one.
-        int ts = p_timeStamp - c_maxTimeStampSpan;
-        for (auto it = m_cache.begin(); it != m_cache.end();) {
-            if (it.value().m_timeStamp < ts) {
-                it = m_cache.erase(it);
-            } else {
-                ++it;
-            }
-        }
-    }
-
-    m_cache.insert(p_text, HLResult(p_timeStamp, p_units));
-}
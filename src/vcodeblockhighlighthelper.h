@@ -23,21 +23,6 @@ private slots:
     void handleTextHighlightResult(const QString &p_html, int p_id, int p_timeStamp);
 
 private:
-    struct HLResult
-    {
-        HLResult() : m_timeStamp(-1)
-        {
-        }
-
-        HLResult(int p_timeStamp, const QVector<HLUnitPos> &p_units)
-            : m_timeStamp(p_timeStamp), m_units(p_units)
-        {
-        }
-
-        int m_timeStamp;
-        QVector<HLUnitPos> m_units;
-    };
-
     void parseHighlightResult(int p_timeStamp, int p_idx, const QString &p_html);
 
     // @p_text: the raw text of the code block;
@@ -56,19 +41,18 @@ private:
 
     void updateHighlightResults(int p_startPos, QVector<HLUnitPos> p_units);
 
-    void addToHighlightCache(const QString &p_text,
-                             int p_timeStamp,
-                             const QVector<HLUnitPos> &p_units);
+    // Highlight @p_codeBlocks using the native tokenizer in a worker thread.
+    void highlightNativelyAsync(const QVector<VCodeBlock> &p_codeBlocks, int p_timeStamp);
+
+    // Highlight @p_codeBlocks using the native tokenizer. Thread-safe.
+    // Positions of the units are relative to the start of each code block.
+    static QVector<QVector<HLUnitPos>> highlightNatively(const QVector<VCodeBlock> &p_codeBlocks);
 
     HGMarkdownHighlighter *m_highlighter;
     VDocument *m_vdocument;
     MarkdownConverterType m_type;
     QAtomicInteger<int> m_timeStamp;
     QVector<VCodeBlock> m_codeBlocks;
-
-    // Cache for highlight result, using the code block text as key.
-    // The HLResult has relative position only.
-    QHash<QString, HLResult> m_cache;
 };
 
 #endif // VCODEBLOCKHIGHLIGHTHELPER_H
@@ -1,6 +1,7 @@
 #include "vconfigmanager.h"
 #include <QDir>
 #include <QFile>
+#include <QSaveFile>
 #include <QString>
 #include <QJsonArray>
 #include <QJsonObject>
@@ -9,6 +10,7 @@
 #include <QTextEdit>
 #include <QStandardPaths>
 #include <QCoreApplication>
+#include <QCryptographicHash>
 #include "utils/vutils.h"
 #include "vstyleparser.h"
 #include "vpalette.h"
@@ -41,6 +43,8 @@ const QString VConfigManager::c_templateConfigFolder = QString("templates");
 
 const QString VConfigManager::c_snippetConfigFolder = QString("snippets");
 
+const QString VConfigManager::c_notebookCacheFolder = QString("notebook_cache");
+
 const QString VConfigManager::c_warningTextStyle = QString("color: #C9302C; font: bold");
 
 const QString VConfigManager::c_dataTextStyle = QString("font: bold");
@@ -530,7 +534,8 @@ bool VConfigManager::writeDirectoryConfig(const QString &path, const QJsonObject
 {
     QString configFile = fetchDirConfigFilePath(path);
 
-    QFile config(configFile);
+    // Write to a temporary file and then rename it to avoid a truncated config.
+    QSaveFile config(configFile);
     // We use Unix LF for config file.
     if (!config.open(QIODevice::WriteOnly)) {
         qWarning() << "fail to open directory configuration file for write:"
@@ -539,7 +544,12 @@ bool VConfigManager::writeDirectoryConfig(const QString &path, const QJsonObject
     }
 
     QJsonDocument configDoc(configJson);
-    config.write(configDoc.toJson());
+    if (config.write(configDoc.toJson()) == -1 || !config.commit()) {
+        qWarning() << "fail to write directory configuration file:"
+                   << configFile;
+        return false;
+    }
+
     return true;
 }
 
@@ -572,22 +582,21 @@ void VConfigManager::updateMarkdownEditStyle()
 
     qDebug() << "use editor style file" << file;
 
-    QString styleStr = VUtils::readFileFromDisk(file);
-    if (styleStr.isEmpty()) {
+    QPalette palette = baseEditPalette;
+    QFont font = baseEditFont;
+    QMap<QString, QMap<QString, QString>> styles;
+    if (!m_editStyleCache.compile(file,
+                                  palette,
+                                  font,
+                                  styles,
+                                  mdHighlightingStyles,
+                                  m_mdMergedFormats,
+                                  m_codeBlockStyles)) {
         return;
     }
 
-    mdEditPalette = baseEditPalette;
-    mdEditFont = baseEditFont;
-
-    VStyleParser parser;
-    parser.parseMarkdownStyle(styleStr);
-
-    QMap<QString, QMap<QString, QString>> styles;
-    parser.fetchMarkdownEditorStyles(mdEditPalette, mdEditFont, styles);
-
-    mdHighlightingStyles = parser.fetchMarkdownStyles(mdEditFont);
-    m_codeBlockStyles = parser.fetchCodeBlockStyles(mdEditFont);
+    mdEditPalette = palette;
+    mdEditFont = font;
 
     m_editorCurrentLineBg = defaultColor;
     m_editorVimInsertBg = defaultColor;
@@ -817,6 +826,15 @@ const QString &VConfigManager::getSnippetConfigFilePath() const
     return path;
 }
 
+QString VConfigManager::getNotebookCacheFolder(const QString &p_notebookPath) const
+{
+    // Keyed by the hash of the notebook path.
+    QByteArray key = QCryptographicHash::hash(QDir::cleanPath(p_notebookPath).toUtf8(),
+                                              QCryptographicHash::Sha1).toHex();
+    QDir dir(QDir(getConfigFolder()).filePath(c_notebookCacheFolder));
+    return dir.filePath(QString::fromLatin1(key));
+}
+
 QString VConfigManager::getThemeFile() const
 {
     auto it = m_themes.find(m_theme);
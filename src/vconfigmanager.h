@@ -9,6 +9,7 @@
 #include <QHash>
 #include "vnotebook.h"
 #include "hgmarkdownhighlighter.h"
+#include "veditstylecache.h"
 #include "vmarkdownconverter.h"
 #include "vconstants.h"
 #include "vfilesessioninfo.h"
@@ -77,6 +78,9 @@ public:
 
     static bool deleteDirectoryConfig(const QString &path);
 
+    // Name of the config file in each directory.
+    static const QString &getDirConfigFileName();
+
     // Get the path of the folder used to store default notebook.
     static QString getVnoteNotebookFolderPath();
 
@@ -110,6 +114,8 @@ public:
 
     QHash<QString, QTextCharFormat> getCodeBlockStyles() const;
 
+    const QVector<QTextCharFormat> &getMdMergedFormats() const;
+
     QString getWelcomePagePath() const;
 
     QString getLogFilePath() const;
@@ -388,6 +394,10 @@ public:
 
     const QString &getSnippetConfigFilePath() const;
 
+    // Get the folder in c_notebookCacheFolder to hold the caches of notebook
+    // @p_notebookPath, so that they will not pollute the notebook.
+    QString getNotebookCacheFolder(const QString &p_notebookPath) const;
+
     // Read all available templates files in c_templateConfigFolder.
     QVector<QString> getNoteTemplates(DocType p_type = DocType::Unknown) const;
 
@@ -463,6 +473,26 @@ public:
     bool getEnableFlashAnchor() const;
     void setEnableFlashAnchor(bool p_enabled);
 
+    int getCodeBlockHighlightCacheSize() const;
+
+    bool getPersistCodeBlockHighlightCache() const;
+
+    int getPreviewImageCacheSize() const;
+
+    int getLazyLayoutBlockCount() const;
+
+    int getDownloadCacheSize() const;
+
+    QString getInsertImageFormat() const;
+
+    int getInsertImageQuality() const;
+
+    int getInsertImageMaxSize() const;
+
+    int getMaxConcurrentDownloads() const;
+
+    int getBatchExportWorkers() const;
+
 private:
     // Look up a config from user and default settings.
     QVariant getConfigFromSettings(const QString &section, const QString &key) const;
@@ -566,6 +596,12 @@ private:
     QVector<HighlightingStyle> mdHighlightingStyles;
     QHash<QString, QTextCharFormat> m_codeBlockStyles;
 
+    // Formats of mdHighlightingStyles merged in pairs.
+    QVector<QTextCharFormat> m_mdMergedFormats;
+
+    // Compiled editor style files.
+    VEditStyleCache m_editStyleCache;
+
     QString welcomePagePath;
 
     // Index of current notebook.
@@ -907,6 +943,9 @@ private:
     // The folder name of snippet files.
     static const QString c_snippetConfigFolder;
 
+    // The folder name of caches of notebooks.
+    static const QString c_notebookCacheFolder;
+
     // The folder name to store all notebooks if user does not specify one.
     static const QString c_vnoteNotebookFolderName;
 
@@ -935,6 +974,11 @@ inline QHash<QString, QTextCharFormat> VConfigManager::getCodeBlockStyles() cons
     return m_codeBlockStyles;
 }
 
+inline const QVector<QTextCharFormat> &VConfigManager::getMdMergedFormats() const
+{
+    return m_mdMergedFormats;
+}
+
 inline QString VConfigManager::getWelcomePagePath() const
 {
     return welcomePagePath;
@@ -2132,4 +2176,70 @@ inline void VConfigManager::setEnableFlashAnchor(bool p_enabled)
     m_enableFlashAnchor = p_enabled;
     setConfigToSettings("web", "enable_flash_anchor", m_enableFlashAnchor);
 }
+
+inline int VConfigManager::getCodeBlockHighlightCacheSize() const
+{
+    return getConfigFromSettings("global",
+                                 "code_block_highlight_cache_size").toInt();
+}
+
+inline bool VConfigManager::getPersistCodeBlockHighlightCache() const
+{
+    return getConfigFromSettings("global",
+                                 "persist_code_block_highlight_cache").toBool();
+}
+
+inline int VConfigManager::getPreviewImageCacheSize() const
+{
+    return getConfigFromSettings("global",
+                                 "preview_image_cache_size").toInt();
+}
+
+inline int VConfigManager::getLazyLayoutBlockCount() const
+{
+    return getConfigFromSettings("global",
+                                 "lazy_layout_block_count").toInt();
+}
+
+inline int VConfigManager::getDownloadCacheSize() const
+{
+    return getConfigFromSettings("global",
+                                 "download_cache_size").toInt();
+}
+
+inline QString VConfigManager::getInsertImageFormat() const
+{
+    return getConfigFromSettings("global",
+                                 "insert_image_format").toString();
+}
+
+inline int VConfigManager::getInsertImageQuality() const
+{
+    return getConfigFromSettings("global",
+                                 "insert_image_quality").toInt();
+}
+
+inline int VConfigManager::getInsertImageMaxSize() const
+{
+    return getConfigFromSettings("global",
+                                 "insert_image_max_size").toInt();
+}
+
+inline int VConfigManager::getMaxConcurrentDownloads() const
+{
+    return getConfigFromSettings("global",
+                                 "max_concurrent_downloads").toInt();
+}
+
+inline int VConfigManager::getBatchExportWorkers() const
+{
+    return getConfigFromSettings("export",
+                                 "batch_export_workers").toInt();
+}
+
+inline const QString &VConfigManager::getDirConfigFileName()
+{
+    return c_dirConfigFile;
+}
+
 #endif // VCONFIGMANAGER_H
@@ -0,0 +1,150 @@
+#include "vconfigtransaction.h"
+
+#include <QDebug>
+
+#include "vdirectory.h"
+#include "vnotebook.h"
+#include "utils/vutils.h"
+
+int VConfigTransaction::s_depth = 0;
+
+bool VConfigTransaction::s_flushing = false;
+
+QVector<QPointer<VDirectory> > VConfigTransaction::s_dirs;
+
+QVector<QPointer<VNotebook> > VConfigTransaction::s_notebooks;
+
+VConfigTransaction::VConfigTransaction()
+    : m_committed(false)
+{
+    ++s_depth;
+}
+
+VConfigTransaction::~VConfigTransaction()
+{
+    if (!m_committed && !commit()) {
+        qWarning() << "fail to write deferred configs at the end of transaction";
+    }
+}
+
+bool VConfigTransaction::commit(QVector<VDirectory *> *p_failedDirs, QString *p_errMsg)
+{
+    if (m_committed) {
+        return true;
+    }
+
+    m_committed = true;
+
+    Q_ASSERT(s_depth > 0);
+    if (--s_depth > 0) {
+        return true;
+    }
+
+    return flush(p_failedDirs, p_errMsg);
+}
+
+bool VConfigTransaction::deferDirectory(const VDirectory *p_dir)
+{
+    // Config of a closed directory is not in memory.
+    if (!isActive() || !p_dir->isOpened()) {
+        return false;
+    }
+
+    VDirectory *dir = const_cast<VDirectory *>(p_dir);
+    if (!s_dirs.contains(dir)) {
+        s_dirs.append(dir);
+    }
+
+    return true;
+}
+
+bool VConfigTransaction::deferNotebook(const VNotebook *p_notebook)
+{
+    if (!isActive()) {
+        return false;
+    }
+
+    VNotebook *nb = const_cast<VNotebook *>(p_notebook);
+    if (!s_notebooks.contains(nb)) {
+        s_notebooks.append(nb);
+    }
+
+    return true;
+}
+
+bool VConfigTransaction::flushDirectory(const VDirectory *p_dir)
+{
+    int idx = s_dirs.indexOf(const_cast<VDirectory *>(p_dir));
+    if (idx == -1) {
+        return true;
+    }
+
+    s_dirs.remove(idx);
+
+    s_flushing = true;
+    bool ret = p_dir->writeToConfig();
+    s_flushing = false;
+
+    if (!ret) {
+        qWarning() << "fail to write deferred config of folder" << p_dir->fetchPath();
+    }
+
+    return ret;
+}
+
+bool VConfigTransaction::flush(QVector<VDirectory *> *p_failedDirs, QString *p_errMsg)
+{
+    if (s_dirs.isEmpty() && s_notebooks.isEmpty()) {
+        return true;
+    }
+
+    s_flushing = true;
+
+    bool ret = true;
+    QVector<QPointer<VNotebook> > notebooks;
+    notebooks.swap(s_notebooks);
+    QVector<QPointer<VDirectory> > dirs;
+    dirs.swap(s_dirs);
+
+    for (auto const & nb : notebooks) {
+        if (!nb) {
+            continue;
+        }
+
+        // Config of the root directory contains the notebook config.
+        if (dirs.contains(nb->getRootDir()) && nb->getRootDir()->isOpened()) {
+            continue;
+        }
+
+        if (!nb->writeConfigNotebook()) {
+            qWarning() << "fail to write deferred config of notebook" << nb->getName();
+            VUtils::addErrMsg(p_errMsg, tr("Fail to write configuration of notebook %1.")
+                                          .arg(nb->getName()));
+            ret = false;
+        }
+    }
+
+    for (auto const & dir : dirs) {
+        // The directory may have been deleted.
+        if (!dir) {
+            continue;
+        }
+
+        if (!dir->writeToConfig()) {
+            qWarning() << "fail to write deferred config of folder" << dir->fetchPath();
+            VUtils::addErrMsg(p_errMsg, tr("Fail to write configuration of folder %1.")
+                                          .arg(dir->fetchPath()));
+            if (p_failedDirs) {
+                p_failedDirs->append(dir);
+            }
+
+            ret = false;
+        }
+    }
+
+    s_flushing = false;
+
+    qDebug() << "flushed configs of" << dirs.size() << "folders and"
+             << notebooks.size() << "notebooks";
+    return ret;
+}
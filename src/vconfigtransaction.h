@@ -0,0 +1,69 @@
+#ifndef VCONFIGTRANSACTION_H
+#define VCONFIGTRANSACTION_H
+
+#include <QVector>
+#include <QPointer>
+#include <QCoreApplication>
+
+class VDirectory;
+class VNotebook;
+
+// Defer the writes of folder and notebook configuration files within its
+// scope, so that bulk operations on notes write each config only once.
+// Transactions could be nested. Deferred configs will be written when the
+// outermost one is committed or destroyed.
+// Writes within a transaction always succeed, so callers should check the
+// result of commit() and reload the failed folders from disk.
+class VConfigTransaction
+{
+    Q_DECLARE_TR_FUNCTIONS(VConfigTransaction)
+
+public:
+    VConfigTransaction();
+
+    ~VConfigTransaction();
+
+    // End this transaction and write the deferred configs if it is the
+    // outermost one.
+    // Returns false if any config fails to write. Folders whose configs fail
+    // will be put in @p_failedDirs.
+    bool commit(QVector<VDirectory *> *p_failedDirs = NULL, QString *p_errMsg = NULL);
+
+    static bool isActive();
+
+    // Defer writing the config of @p_dir.
+    // Returns false if it should be written now.
+    static bool deferDirectory(const VDirectory *p_dir);
+
+    // Defer writing the notebook config of @p_notebook.
+    // Returns false if it should be written now.
+    static bool deferNotebook(const VNotebook *p_notebook);
+
+    // Write the config of @p_dir now if it is deferred.
+    static bool flushDirectory(const VDirectory *p_dir);
+
+    // Write all the deferred configs now.
+    static bool flush(QVector<VDirectory *> *p_failedDirs = NULL, QString *p_errMsg = NULL);
+
+private:
+    Q_DISABLE_COPY(VConfigTransaction)
+
+    bool m_committed;
+
+    // Depth of nested transactions.
+    static int s_depth;
+
+    // Whether we are writing deferred configs.
+    static bool s_flushing;
+
+    static QVector<QPointer<VDirectory> > s_dirs;
+
+    static QVector<QPointer<VNotebook> > s_notebooks;
+};
+
+inline bool VConfigTransaction::isActive()
+{
+    return s_depth > 0 && !s_flushing;
+}
+
+#endif // VCONFIGTRANSACTION_H
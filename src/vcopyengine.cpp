@@ -0,0 +1,236 @@
+#include "vcopyengine.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QDebug>
+#include <QApplication>
+#include <QProgressDialog>
+#include <QFutureWatcher>
+#include <QEventLoop>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include "utils/vutils.h"
+
+VCopyEngine::VCopyEngine(bool p_isCut)
+    : m_isCut(p_isCut),
+      m_canceled(false),
+      m_group(0)
+{
+}
+
+int VCopyEngine::beginGroup()
+{
+    return ++m_group;
+}
+
+void VCopyEngine::addFile(const QString &p_srcFilePath, const QString &p_destFilePath)
+{
+    VCopyTask task(QDir::cleanPath(p_srcFilePath),
+                   QDir::cleanPath(p_destFilePath),
+                   m_isCut,
+                   m_group);
+    m_targets.insert(task.m_destPath, task.m_srcPath);
+    m_tasks.append(task);
+}
+
+bool VCopyEngine::addDirectory(const QString &p_srcDirPath, const QString &p_destDirPath)
+{
+    QString srcPath = QDir::cleanPath(p_srcDirPath);
+    QString destPath = QDir::cleanPath(p_destDirPath);
+    if (srcPath == destPath) {
+        return true;
+    }
+
+    if (QFileInfo::exists(destPath) || m_targets.contains(destPath)) {
+        qWarning() << QString("target directory %1 already exists").arg(destPath);
+        return false;
+    }
+
+    // Nothing is done on disk until exec().
+    DirTask task;
+    task.m_srcPath = srcPath;
+    task.m_destPath = destPath;
+    task.m_group = m_group;
+    m_dirTasks.append(task);
+    m_targets.insert(destPath, srcPath);
+    return true;
+}
+
+QString VCopyEngine::plannedSource(const QString &p_destPath) const
+{
+    return m_targets.value(QDir::cleanPath(p_destPath));
+}
+
+void VCopyEngine::planDirectory(const QString &p_srcDirPath,
+                                const QString &p_destDirPath,
+                                int p_group)
+{
+    m_destDirs.append(qMakePair(p_destDirPath, p_group));
+
+    QDir srcDir(p_srcDirPath);
+    QDir destDir(p_destDirPath);
+    QFileInfoList nodes = srcDir.entryInfoList(QDir::Dirs | QDir::Files | QDir::Hidden
+                                               | QDir::NoSymLinks | QDir::NoDotAndDotDot);
+    for (int i = 0; i < nodes.size(); ++i) {
+        const QFileInfo &fileInfo = nodes.at(i);
+        QString name = fileInfo.fileName();
+        if (fileInfo.isDir()) {
+            planDirectory(srcDir.filePath(name), destDir.filePath(name), p_group);
+        } else {
+            m_tasks.append(VCopyTask(srcDir.filePath(name),
+                                     destDir.filePath(name),
+                                     m_isCut,
+                                     p_group));
+        }
+    }
+
+    m_srcDirs.append(qMakePair(p_srcDirPath, p_group));
+}
+
+void VCopyEngine::runTask(VCopyTask &p_task)
+{
+    p_task.m_succeeded = VUtils::copyFile(p_task.m_srcPath, p_task.m_destPath, p_task.m_isCut);
+    p_task.m_done = true;
+}
+
+bool VCopyEngine::exec(const QString &p_label)
+{
+    m_canceled = false;
+
+    QDir dir;
+    for (auto & task : m_dirTasks) {
+        if (m_isCut) {
+            // Try to move it at once within the same file system.
+            if (dir.mkpath(VUtils::basePathFromPath(task.m_destPath))
+                && dir.rename(task.m_srcPath, task.m_destPath)) {
+                task.m_renamed = true;
+                continue;
+            }
+        }
+
+        planDirectory(task.m_srcPath, task.m_destPath, task.m_group);
+    }
+
+    for (auto const & pa : m_destDirs) {
+        if (!dir.mkpath(pa.first)) {
+            qWarning() << QString("fail to create target directory %1").arg(pa.first);
+            rollback();
+            return false;
+        }
+    }
+
+    if (!m_tasks.isEmpty()) {
+        // Show it at once and block the whole application, since the callers
+        // hold pointers to the folders and notes being copied.
+        QProgressDialog dialog(p_label,
+                               tr("Cancel"),
+                               0,
+                               m_tasks.size(),
+                               QApplication::activeWindow());
+        dialog.setWindowModality(Qt::ApplicationModal);
+        dialog.setMinimumDuration(0);
+        dialog.setValue(0);
+        dialog.show();
+
+        QFutureWatcher<void> watcher;
+        QEventLoop loop;
+        QObject::connect(&watcher, &QFutureWatcher<void>::progressValueChanged,
+                         &dialog, &QProgressDialog::setValue);
+        QObject::connect(&dialog, &QProgressDialog::canceled,
+                         &watcher, &QFutureWatcher<void>::cancel);
+        QObject::connect(&watcher, &QFutureWatcher<void>::finished,
+                         &loop, &QEventLoop::quit);
+
+        watcher.setFuture(QtConcurrent::map(m_tasks, &VCopyEngine::runTask));
+        if (!watcher.isFinished()) {
+            loop.exec();
+        }
+
+        // Tasks being run when canceled will still finish.
+        watcher.waitForFinished();
+        m_canceled = watcher.isCanceled();
+    }
+
+    if (m_canceled) {
+        qDebug() << "copy canceled" << p_label;
+        rollback();
+        return false;
+    }
+
+    bool ret = true;
+    QSet<int> failedGroups;
+    for (auto const & task : m_tasks) {
+        if (!task.m_succeeded) {
+            failedGroups.insert(task.m_group);
+            ret = false;
+        }
+    }
+
+    if (m_isCut) {
+        for (auto const & pa : m_srcDirs) {
+            if (failedGroups.contains(pa.second)) {
+                continue;
+            }
+
+            if (!dir.rmdir(pa.first)) {
+                qWarning() << QString("fail to delete source directory %1 after cut").arg(pa.first);
+                ret = false;
+            }
+        }
+    }
+
+    return ret;
+}
+
+void VCopyEngine::rollback(int p_group)
+{
+    for (auto & task : m_tasks) {
+        if (p_group != -1 && task.m_group != p_group) {
+            continue;
+        }
+
+        if (task.m_done && task.m_succeeded) {
+            if (task.m_isCut) {
+                VUtils::copyFile(task.m_destPath, task.m_srcPath, true);
+            } else {
+                QFile::remove(task.m_destPath);
+            }
+        }
+
+        task.m_done = task.m_succeeded = false;
+    }
+
+    // Remove created directories, child goes first.
+    QDir dir;
+    for (int i = m_destDirs.size() - 1; i >= 0; --i) {
+        if (p_group == -1 || m_destDirs[i].second == p_group) {
+            dir.rmdir(m_destDirs[i].first);
+        }
+    }
+
+    for (auto & task : m_dirTasks) {
+        if (task.m_renamed && (p_group == -1 || task.m_group == p_group)) {
+            dir.rename(task.m_destPath, task.m_srcPath);
+            task.m_renamed = false;
+        }
+    }
+}
+
+bool VCopyEngine::hasFailed(const QString &p_srcPath) const
+{
+    QString path = QDir::cleanPath(p_srcPath);
+    QString dirPath = path + "/";
+    for (auto const & task : m_tasks) {
+        if (task.m_succeeded) {
+            continue;
+        }
+
+        if (task.m_srcPath == path || task.m_srcPath.startsWith(dirPath)) {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,138 @@
+#ifndef VCOPYENGINE_H
+#define VCOPYENGINE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QPair>
+#include <QHash>
+#include <QCoreApplication>
+
+// One file to copy or move.
+struct VCopyTask
+{
+    VCopyTask()
+        : m_isCut(false), m_group(0), m_done(false), m_succeeded(false)
+    {
+    }
+
+    VCopyTask(const QString &p_srcPath, const QString &p_destPath, bool p_isCut, int p_group)
+        : m_srcPath(p_srcPath),
+          m_destPath(p_destPath),
+          m_isCut(p_isCut),
+          m_group(p_group),
+          m_done(false),
+          m_succeeded(false)
+    {
+    }
+
+    QString m_srcPath;
+    QString m_destPath;
+    bool m_isCut;
+
+    // Group this task belongs to, see VCopyEngine::beginGroup().
+    int m_group;
+
+    // Whether this task has been run.
+    bool m_done;
+    bool m_succeeded;
+};
+
+// Copy or move files and directories in background.
+// Plan the whole operation via addFile() and addDirectory() first, which
+// touches nothing on disk, then exec() will run the copies in the global
+// thread pool with a modal progress dialog which could cancel the operation.
+// Moving a directory within the same file system is done by a single rename.
+// Tasks could be planned in groups, such as one group per note, so that one
+// group could be rolled back without affecting the others.
+class VCopyEngine
+{
+    Q_DECLARE_TR_FUNCTIONS(VCopyEngine)
+
+public:
+    explicit VCopyEngine(bool p_isCut);
+
+    // Tasks planned after this call belong to a new group.
+    // Returns the id of the new group.
+    int beginGroup();
+
+    void addFile(const QString &p_srcFilePath, const QString &p_destFilePath);
+
+    // Returns false if @p_destDirPath already exists or is planned.
+    bool addDirectory(const QString &p_srcDirPath, const QString &p_destDirPath);
+
+    // Returns the source path planned to copy to @p_destPath, or empty if
+    // there is none.
+    QString plannedSource(const QString &p_destPath) const;
+
+    // Run the planned tasks and wait for them with @p_label shown.
+    // Canceled tasks will be rolled back.
+    // Returns true if all the tasks succeeded.
+    bool exec(const QString &p_label);
+
+    // Undo the tasks of group @p_group, or all the groups if it is -1, that
+    // have been done.
+    void rollback(int p_group = -1);
+
+    bool isCanceled() const;
+
+    // Whether file @p_srcPath or any file within directory @p_srcPath failed.
+    bool hasFailed(const QString &p_srcPath) const;
+
+    int count() const;
+
+private:
+    // A directory to move or copy.
+    struct DirTask
+    {
+        DirTask() : m_group(0), m_renamed(false)
+        {
+        }
+
+        QString m_srcPath;
+        QString m_destPath;
+        int m_group;
+
+        // Whether it has been moved by a single rename.
+        bool m_renamed;
+    };
+
+    // Plan the files of @p_srcDirPath recursively.
+    void planDirectory(const QString &p_srcDirPath, const QString &p_destDirPath, int p_group);
+
+    // Run in worker thread.
+    static void runTask(VCopyTask &p_task);
+
+    bool m_isCut;
+
+    bool m_canceled;
+
+    // Current group.
+    int m_group;
+
+    QVector<VCopyTask> m_tasks;
+
+    // Directories added via addDirectory().
+    QVector<DirTask> m_dirTasks;
+
+    // Directories to create before copying, with their group. Parent goes first.
+    QVector<QPair<QString, int> > m_destDirs;
+
+    // Source directories to delete after cut, with their group. Child goes first.
+    QVector<QPair<QString, int> > m_srcDirs;
+
+    // Target path -> source path of all the planned files and directories.
+    QHash<QString, QString> m_targets;
+};
+
+inline bool VCopyEngine::isCanceled() const
+{
+    return m_canceled;
+}
+
+inline int VCopyEngine::count() const
+{
+    return m_tasks.size();
+}
+
+#endif // VCOPYENGINE_H
@@ -6,9 +6,15 @@
 #include "vconfigmanager.h"
 #include "vnotefile.h"
 #include "utils/vutils.h"
+#include "vfulltextsearch.h"
+#include "vconfigtransaction.h"
+#include "vcopyengine.h"
+#include "vnotebookmetacache.h"
 
 extern VConfigManager *g_config;
 
+extern VFullTextSearch *g_fullTextSearch;
+
 VDirectory::VDirectory(VNotebook *p_notebook,
                        VDirectory *p_parent,
                        const QString &p_name,
@@ -31,18 +37,29 @@ bool VDirectory::open()
     V_ASSERT(m_subDirs.isEmpty() && m_files.isEmpty());
 
     QString path = fetchPath();
-    QJsonObject configJson = VConfigManager::readDirectoryConfig(path);
+    QJsonObject configJson = m_notebook->getMetaCache()->readDirectoryConfig(path);
     if (configJson.isEmpty()) {
         qWarning() << "invalid directory configuration in path" << path;
         return false;
     }
 
+    return open(configJson);
+}
+
+bool VDirectory::open(const QJsonObject &p_configJson)
+{
+    if (m_opened) {
+        return true;
+    }
+
+    V_ASSERT(m_subDirs.isEmpty() && m_files.isEmpty());
+
     // created_time
-    m_createdTimeUtc = QDateTime::fromString(configJson[DirConfig::c_createdTime].toString(),
+    m_createdTimeUtc = QDateTime::fromString(p_configJson[DirConfig::c_createdTime].toString(),
                                              Qt::ISODate);
 
     // [sub_directories] section
-    QJsonArray dirJson = configJson[DirConfig::c_subDirectories].toArray();
+    QJsonArray dirJson = p_configJson[DirConfig::c_subDirectories].toArray();
     for (int i = 0; i < dirJson.size(); ++i) {
         QJsonObject dirItem = dirJson[i].toObject();
         VDirectory *dir = new VDirectory(m_notebook, this, dirItem[DirConfig::c_name].toString());
@@ -50,7 +67,7 @@ bool VDirectory::open()
     }
 
     // [files] section
-    QJsonArray fileJson = configJson[DirConfig::c_files].toArray();
+    QJsonArray fileJson = p_configJson[DirConfig::c_files].toArray();
     for (int i = 0; i < fileJson.size(); ++i) {
         QJsonObject fileItem = fileJson[i].toObject();
         VNoteFile *file = VNoteFile::fromJson(this,
@@ -70,6 +87,8 @@ void VDirectory::close()
         return;
     }
 
+    VConfigTransaction::flushDirectory(this);
+
     for (int i = 0; i < m_subDirs.size(); ++i) {
         VDirectory *dir = m_subDirs[i];
         dir->close();
@@ -87,6 +106,38 @@ void VDirectory::close()
     m_opened = false;
 }
 
+bool VDirectory::reloadFiles()
+{
+    Q_ASSERT(m_opened);
+
+    QString path = fetchPath();
+    QJsonObject configJson = m_notebook->getMetaCache()->readDirectoryConfig(path);
+    if (configJson.isEmpty()) {
+        qWarning() << "invalid directory configuration in path" << path;
+        return false;
+    }
+
+    for (int i = 0; i < m_files.size(); ++i) {
+        VNoteFile *file = m_files[i];
+        file->close();
+        delete file;
+    }
+    m_files.clear();
+
+    QJsonArray fileJson = configJson[DirConfig::c_files].toArray();
+    for (int i = 0; i < fileJson.size(); ++i) {
+        QJsonObject fileItem = fileJson[i].toObject();
+        VNoteFile *file = VNoteFile::fromJson(this,
+                                              fileItem,
+                                              FileType::Note,
+                                              true);
+        m_files.append(file);
+    }
+
+    qDebug() << "folder" << m_name << "reloaded" << m_files.size() << "notes";
+    return true;
+}
+
 QString VDirectory::fetchBasePath() const
 {
     return VUtils::basePathFromPath(fetchPath());
@@ -152,6 +203,11 @@ bool VDirectory::readConfig()
 
 bool VDirectory::writeToConfig() const
 {
+    // Will be written when the transaction ends.
+    if (VConfigTransaction::deferDirectory(this)) {
+        return true;
+    }
+
     QJsonObject json = toConfigJson();
 
     if (!getParentDirectory()) {
@@ -172,7 +228,7 @@ bool VDirectory::updateFileConfig(const VNoteFile *p_file)
 
 bool VDirectory::writeToConfig(const QJsonObject &p_json) const
 {
-    return VConfigManager::writeDirectoryConfig(fetchPath(), p_json);
+    return m_notebook->getMetaCache()->writeDirectoryConfig(fetchPath(), p_json);
 }
 
 void VDirectory::addNotebookConfig(QJsonObject &p_json) const
@@ -468,6 +524,8 @@ bool VDirectory::deleteDirectory(VDirectory *p_dir, bool p_skipRecycleBin, QStri
 
     delete p_dir;
 
+    g_fullTextSearch->updatePath(path);
+
     return ret;
 }
 
@@ -529,6 +587,9 @@ bool VDirectory::rename(const QString &p_name)
         return false;
     }
 
+    g_fullTextSearch->updatePaths(QStringList() << dir.filePath(oldName)
+                                                << dir.filePath(m_name));
+
     qDebug() << "folder renamed from" << oldName << "to" << m_name;
 
     return true;
@@ -544,6 +605,13 @@ bool VDirectory::copyDirectory(VDirectory *p_destDir,
     bool ret = true;
     *p_targetDir = NULL;
 
+    // Configs on disk will be copied.
+    if (!VConfigTransaction::flush(NULL, p_errMsg)) {
+        VUtils::addErrMsg(p_errMsg, tr("Fail to write configurations before %1 the folder.")
+                                      .arg(p_isCut ? tr("cutting") : tr("copying")));
+        return false;
+    }
+
     QString srcPath = QDir::cleanPath(p_dir->fetchPath());
     QString destPath = QDir::cleanPath(QDir(p_destDir->fetchPath()).filePath(p_destName));
     if (VUtils::equalPath(srcPath, destPath)) {
@@ -561,9 +629,17 @@ bool VDirectory::copyDirectory(VDirectory *p_destDir,
 
     Q_ASSERT(paDir->isOpened());
 
-    // Copy the directory.
-    if (!VUtils::copyDirectory(srcPath, destPath, p_isCut)) {
-        VUtils::addErrMsg(p_errMsg, tr("Fail to %1 the folder.").arg(opStr));
+    // Copy the directory in background.
+    VCopyEngine engine(p_isCut);
+    if (!engine.addDirectory(srcPath, destPath)
+        || !engine.exec(tr("%1 folder %2").arg(p_isCut ? tr("Moving") : tr("Copying"))
+                                          .arg(p_dir->getName()))) {
+        if (engine.isCanceled()) {
+            VUtils::addErrMsg(p_errMsg, tr("Operation is canceled."));
+        } else {
+            VUtils::addErrMsg(p_errMsg, tr("Fail to %1 the folder.").arg(opStr));
+        }
+
         qWarning() << "fail to" << opStr << "the folder directory" << srcPath << "to" << destPath;
         return false;
     }
@@ -588,6 +664,12 @@ bool VDirectory::copyDirectory(VDirectory *p_destDir,
         return false;
     }
 
+    if (p_isCut) {
+        g_fullTextSearch->updatePaths(QStringList() << srcPath << destPath);
+    } else {
+        g_fullTextSearch->updatePath(destPath);
+    }
+
     qDebug() << "copyDirectory:" << p_dir << "to" << destDir;
 
     *p_targetDir = destDir;
@@ -22,8 +22,16 @@ public:
                QDateTime p_createdTimeUtc = QDateTime());
 
     bool open();
+
+    // Open with config @p_configJson which has been read already.
+    bool open(const QJsonObject &p_configJson);
+
     void close();
 
+    // Reload the notes from the config on disk, keeping the sub-directories.
+    // Notes of this directory will be deleted.
+    bool reloadFiles();
+
     // Create a sub-directory with name @p_name.
     VDirectory *createSubDirectory(const QString &p_name,
                                    QString *p_errMsg = NULL);
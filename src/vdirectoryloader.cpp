@@ -0,0 +1,149 @@
+#include "vdirectoryloader.h"
+
+#include <QDebug>
+#include <QStringList>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include "vdirectory.h"
+#include "vnotebook.h"
+#include "vnotebookmetacache.h"
+#include "vconfigmanager.h"
+
+VDirectoryLoader::VDirectoryLoader(QObject *p_parent)
+    : QObject(p_parent)
+{
+    m_watcher = new QFutureWatcher<VDirectoryConfigData>(this);
+    connect(m_watcher, &QFutureWatcher<VDirectoryConfigData>::resultsReadyAt,
+            this, &VDirectoryLoader::handleResultsReady);
+    connect(m_watcher, &QFutureWatcher<VDirectoryConfigData>::finished,
+            this, &VDirectoryLoader::handleFinished);
+}
+
+VDirectoryLoader::~VDirectoryLoader()
+{
+    m_watcher->cancel();
+    m_watcher->waitForFinished();
+}
+
+void VDirectoryLoader::load(const QVector<VDirectory *> &p_dirs)
+{
+    for (auto dir : p_dirs) {
+        if (isLoading(dir)) {
+            continue;
+        }
+
+        if (!dir->isOpened()) {
+            // Try the cache which needs at most a stat of the config file.
+            QJsonObject json;
+            if (!dir->getNotebook()->getMetaCache()->peek(dir->fetchPath(), json)
+                || !dir->open(json)) {
+                m_pendingDirs.append(dir);
+                continue;
+            }
+        }
+
+        emit directoryLoaded(dir, true);
+    }
+
+    startNext();
+}
+
+void VDirectoryLoader::cancel()
+{
+    m_pendingDirs.clear();
+    m_watcher->cancel();
+}
+
+bool VDirectoryLoader::isLoading(const VDirectory *p_dir) const
+{
+    VDirectory *dir = const_cast<VDirectory *>(p_dir);
+    return m_pendingDirs.contains(dir)
+           || (!m_watcher->isCanceled() && m_dirs.contains(dir));
+}
+
+void VDirectoryLoader::startNext()
+{
+    // m_dirs is cleared once current job finishes.
+    if (!m_dirs.isEmpty()) {
+        return;
+    }
+
+    QStringList paths;
+    QVector<VDirectory *> openedDirs;
+    for (auto const & dir : m_pendingDirs) {
+        if (!dir) {
+            continue;
+        }
+
+        if (dir->isOpened()) {
+            // Opened by others while waiting.
+            openedDirs.append(dir);
+        } else {
+            m_dirs.append(dir);
+            paths.append(dir->fetchPath());
+        }
+    }
+
+    m_pendingDirs.clear();
+
+    if (!m_dirs.isEmpty()) {
+        m_watcher->setFuture(QtConcurrent::mapped(paths, &VDirectoryLoader::readConfig));
+    }
+
+    // Receivers may load more directories.
+    for (auto dir : openedDirs) {
+        emit directoryLoaded(dir, true);
+    }
+}
+
+void VDirectoryLoader::handleResultsReady(int p_begin, int p_end)
+{
+    if (m_watcher->isCanceled()) {
+        return;
+    }
+
+    for (int i = p_begin; i < p_end && i < m_dirs.size(); ++i) {
+        VDirectory *dir = m_dirs[i];
+        if (!dir) {
+            // Deleted during loading.
+            continue;
+        }
+
+        if (dir->isOpened()) {
+            emit directoryLoaded(dir, true);
+            continue;
+        }
+
+        const VDirectoryConfigData data = m_watcher->resultAt(i);
+        if (data.m_json.isEmpty() || !dir->open(data.m_json)) {
+            qWarning() << "fail to load directory in background" << dir->fetchPath();
+            emit directoryLoaded(dir, false);
+            continue;
+        }
+
+        if (data.m_statValid) {
+            dir->getNotebook()->getMetaCache()->insert(dir->fetchPath(),
+                                                       data.m_json,
+                                                       data.m_mtime,
+                                                       data.m_size);
+        }
+
+        emit directoryLoaded(dir, true);
+    }
+}
+
+void VDirectoryLoader::handleFinished()
+{
+    m_dirs.clear();
+    startNext();
+}
+
+VDirectoryConfigData VDirectoryLoader::readConfig(const QString &p_path)
+{
+    VDirectoryConfigData data;
+    // Get the stat before reading so a change during reading will be detected.
+    data.m_statValid = VNotebookMetaCache::statConfig(p_path, data.m_mtime, data.m_size);
+    data.m_json = VConfigManager::readDirectoryConfig(p_path);
+    return data;
+}
@@ -0,0 +1,75 @@
+#ifndef VDIRECTORYLOADER_H
+#define VDIRECTORYLOADER_H
+
+#include <QObject>
+#include <QVector>
+#include <QPointer>
+#include <QJsonObject>
+
+template <typename T> class QFutureWatcher;
+class VDirectory;
+
+// Config of a directory read in background.
+struct VDirectoryConfigData
+{
+    VDirectoryConfigData()
+        : m_mtime(0), m_size(0), m_statValid(false)
+    {
+    }
+
+    QJsonObject m_json;
+
+    // Modified time and size of the config file.
+    qint64 m_mtime;
+    qint64 m_size;
+    bool m_statValid;
+};
+
+// Open directories in background.
+// Configs are read and parsed in the global thread pool. Directories are
+// opened on the GUI thread in chunks as the results arrive.
+class VDirectoryLoader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit VDirectoryLoader(QObject *p_parent = nullptr);
+
+    ~VDirectoryLoader();
+
+    // Open @p_dirs which are not opened yet.
+    // Opened directories and directories validated in the notebook cache
+    // will be signaled at once.
+    void load(const QVector<VDirectory *> &p_dirs);
+
+    // Cancel all the loads not finished yet.
+    void cancel();
+
+    // Whether @p_dir is waiting to be opened.
+    bool isLoading(const VDirectory *p_dir) const;
+
+signals:
+    // Emit when @p_dir is opened or failed to open.
+    void directoryLoaded(VDirectory *p_dir, bool p_succeeded);
+
+private slots:
+    void handleResultsReady(int p_begin, int p_end);
+
+    void handleFinished();
+
+private:
+    // Start a job to read the configs of m_pendingDirs.
+    void startNext();
+
+    // Run in background.
+    static VDirectoryConfigData readConfig(const QString &p_path);
+
+    // Directories of current job, in the same order of the results.
+    QVector<QPointer<VDirectory> > m_dirs;
+
+    // Directories waiting for current job to finish.
+    QVector<QPointer<VDirectory> > m_pendingDirs;
+
+    QFutureWatcher<VDirectoryConfigData> *m_watcher;
+};
+
+#endif // VDIRECTORYLOADER_H
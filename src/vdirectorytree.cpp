@@ -13,6 +13,7 @@
 #include "utils/vimnavigationforwidget.h"
 #include "utils/viconutils.h"
 #include "vfilelist.h"
+#include "vdirectoryloader.h"
 
 extern VMainWindow *g_mainWin;
 
@@ -36,6 +37,10 @@ VDirectoryTree::VDirectoryTree(QWidget *parent)
     initShortcuts();
     initActions();
 
+    m_loader = new VDirectoryLoader(this);
+    connect(m_loader, &VDirectoryLoader::directoryLoaded,
+            this, &VDirectoryTree::handleDirectoryLoaded);
+
     connect(this, SIGNAL(itemExpanded(QTreeWidgetItem*)),
             this, SLOT(handleItemExpanded(QTreeWidgetItem*)));
     connect(this, SIGNAL(itemCollapsed(QTreeWidgetItem*)),
@@ -165,6 +170,7 @@ void VDirectoryTree::setNotebook(VNotebook *p_notebook)
         return;
     }
 
+    cancelLoading();
     clear();
     m_notebook = p_notebook;
     if (!m_notebook) {
@@ -201,8 +207,10 @@ void VDirectoryTree::fillTreeItem(QTreeWidgetItem *p_item, VDirectory *p_directo
 
 void VDirectoryTree::updateDirectoryTree()
 {
+    cancelLoading();
     clear();
 
+    QList<QTreeWidgetItem *> items;
     VDirectory *rootDir = m_notebook->getRootDir();
     const QVector<VDirectory *> &subDirs = rootDir->getSubDirs();
     for (int i = 0; i < subDirs.size(); ++i) {
@@ -211,9 +219,11 @@ void VDirectoryTree::updateDirectoryTree()
 
         fillTreeItem(item, dir);
 
-        buildSubTree(item, 1);
+        items.append(item);
     }
 
+    loadSubTrees(items);
+
     if (!restoreCurrentItem() && topLevelItemCount() > 0) {
         setCurrentItem(topLevelItem(0));
     }
@@ -289,6 +299,11 @@ void VDirectoryTree::handleItemCollapsed(QTreeWidgetItem *p_item)
 void VDirectoryTree::handleItemExpanded(QTreeWidgetItem *p_item)
 {
     if (p_item) {
+        if (p_item->childCount() == 0) {
+            // Expanded before being opened in background.
+            buildSubTree(p_item, 1);
+        }
+
         buildChildren(p_item);
 
         VDirectory *dir = getVDirectory(p_item);
@@ -304,14 +319,64 @@ void VDirectoryTree::buildChildren(QTreeWidgetItem *p_item)
         return;
     }
 
+    QList<QTreeWidgetItem *> items;
     for (int i = 0; i < nrChild; ++i) {
         QTreeWidgetItem *childItem = p_item->child(i);
         if (childItem->childCount() > 0) {
             continue;
         }
 
-        buildSubTree(childItem, 1);
+        items.append(childItem);
     }
+
+    loadSubTrees(items);
+}
+
+void VDirectoryTree::loadSubTrees(const QList<QTreeWidgetItem *> &p_items)
+{
+    QVector<VDirectory *> dirs;
+    for (auto const & item : p_items) {
+        VDirectory *dir = getVDirectory(item);
+        if (m_loadingItems.contains(dir)) {
+            continue;
+        }
+
+        item->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
+        m_loadingItems.insert(dir, QPersistentModelIndex(indexFromItem(item)));
+        dirs.append(dir);
+    }
+
+    // Opened directories will be signaled at once.
+    m_loader->load(dirs);
+}
+
+void VDirectoryTree::handleDirectoryLoaded(VDirectory *p_dir, bool p_succeeded)
+{
+    auto it = m_loadingItems.find(p_dir);
+    if (it == m_loadingItems.end()) {
+        return;
+    }
+
+    QPersistentModelIndex index = it.value();
+    m_loadingItems.erase(it);
+
+    // The item may be deleted or reused meanwhile.
+    QTreeWidgetItem *item = index.isValid() ? itemFromIndex(index) : NULL;
+    if (!item || getVDirectory(item) != p_dir) {
+        return;
+    }
+
+    item->setChildIndicatorPolicy(QTreeWidgetItem::DontShowIndicatorWhenChildless);
+    if (p_succeeded && item->childCount() == 0) {
+        // The directory is opened now, so this will not touch the disk.
+        buildSubTree(item, 1);
+    }
+}
+
+void VDirectoryTree::cancelLoading()
+{
+    m_loader->cancel();
+    m_loadingItems.clear();
 }
 
 void VDirectoryTree::updateItemDirectChildren(QTreeWidgetItem *p_item)
@@ -695,6 +760,7 @@ void VDirectoryTree::reloadFromDisk()
         curItem->setExpanded(false);
         curDir->setExpanded(false);
 
+        cancelLoading();
         curDir->close();
 
         // Remove all its children.
@@ -7,6 +7,7 @@
 #include <QMap>
 #include <QList>
 #include <QHash>
+#include <QPersistentModelIndex>
 
 #include "vtreewidget.h"
 #include "vdirectory.h"
@@ -15,6 +16,7 @@
 #include "vconstants.h"
 
 class VEditArea;
+class VDirectoryLoader;
 class QLabel;
 
 class VDirectoryTree : public VTreeWidget, public VNavigationMode
@@ -62,6 +64,9 @@ private slots:
     // Set the state of expansion of the directory.
     void handleItemCollapsed(QTreeWidgetItem *p_item);
 
+    // Create the children items of the item of @p_dir once it is opened.
+    void handleDirectoryLoaded(VDirectory *p_dir, bool p_succeeded);
+
     void contextMenuRequested(QPoint pos);
 
     // Directory selected folder.
@@ -128,8 +133,16 @@ private:
 
     // Build the subtree of @p_item's children if it has not been built yet.
     // We need to fill the children before showing a item to get a correct render.
+    // Children are opened in background.
     void buildChildren(QTreeWidgetItem *p_item);
 
+    // Open directories of @p_items in background and build one level of
+    // their subtrees once opened. Items will show an expand indicator meanwhile.
+    void loadSubTrees(const QList<QTreeWidgetItem *> &p_items);
+
+    // Cancel all the background loads.
+    void cancelLoading();
+
     // Expand/create the directory tree nodes to @p_directory.
     QTreeWidgetItem *expandToVDirectory(const VDirectory *p_directory);
 
@@ -157,6 +170,11 @@ private:
 
     VEditArea *m_editArea;
 
+    VDirectoryLoader *m_loader;
+
+    // Items waiting for their directories to be opened in background.
+    QHash<VDirectory *, QPersistentModelIndex> m_loadingItems;
+
     // Each notebook's current item's VDirectory.
     QHash<VNotebook *, VDirectory *> m_notebookCurrentDirMap;
 
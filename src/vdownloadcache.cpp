@@ -0,0 +1,404 @@
+#include "vdownloadcache.h"
+
+#include <algorithm>
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSaveFile>
+#include <QTimer>
+
+#include "vconfigmanager.h"
+#include "utils/vutils.h"
+
+extern VConfigManager *g_config;
+
+// Folder in the config folder to hold the cache.
+static const QString c_cacheFolder = "download_cache";
+
+static const QString c_indexFile = "index.dat";
+
+// Magic and version of the index file.
+static const quint32 c_indexMagic = 0x56444c43;
+
+static const quint32 c_indexVersion = 1;
+
+// Delay in ms to save the index after changes.
+static const int c_saveInterval = 5000;
+
+VDownloadCache::VDownloadCache(QObject *p_parent)
+    : QObject(p_parent),
+      m_maxBytes(0),
+      m_bytes(0),
+      m_maxRequests(1),
+      m_nrRunning(0),
+      m_dirty(false)
+{
+    m_nam = new QNetworkAccessManager(this);
+    connect(m_nam, &QNetworkAccessManager::finished,
+            this, &VDownloadCache::handleReplyFinished);
+
+    m_saveTimer = new QTimer(this);
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(c_saveInterval);
+    connect(m_saveTimer, &QTimer::timeout,
+            this, &VDownloadCache::saveIndex);
+}
+
+VDownloadCache::~VDownloadCache()
+{
+    if (m_dirty) {
+        saveIndex();
+    }
+}
+
+void VDownloadCache::init()
+{
+    m_maxBytes = (qint64)g_config->getDownloadCacheSize() * 1024;
+    m_maxRequests = qMax(g_config->getMaxConcurrentDownloads(), 1);
+    m_folder = QDir(g_config->getConfigFolder()).filePath(c_cacheFolder);
+
+    if (m_maxBytes <= 0) {
+        return;
+    }
+
+    if (!readIndex()) {
+        m_entries.clear();
+        m_refs.clear();
+        m_bytes = 0;
+    }
+
+    removeOrphanFiles();
+    evict();
+
+    qDebug() << "download cache" << m_entries.size() << "entries" << m_bytes << "bytes";
+}
+
+bool VDownloadCache::isCacheable(const QUrl &p_url)
+{
+    return p_url.scheme() == "http" || p_url.scheme() == "https";
+}
+
+void VDownloadCache::fetch(const QUrl &p_url)
+{
+    QString url = p_url.toString();
+    if (!p_url.isValid()) {
+        finish(url, QByteArray());
+        return;
+    }
+
+    if (m_activeUrls.contains(url)) {
+        // Merged into the one in flight.
+        return;
+    }
+
+    auto it = m_entries.find(url);
+    if (it != m_entries.end() && it.value().m_validated) {
+        QByteArray data;
+        if (readCache(url, data)) {
+            finish(url, data);
+            return;
+        }
+    }
+
+    m_activeUrls.insert(url);
+    m_pendingUrls.enqueue(url);
+    startRequests();
+}
+
+QByteArray VDownloadCache::fetchSync(const QUrl &p_url)
+{
+    QString url = p_url.toString();
+    QByteArray data;
+    QEventLoop loop;
+    connect(this, &VDownloadCache::fetched,
+            &loop, [&loop, &data, url](const QString &p_url, const QByteArray &p_data) {
+                if (p_url == url) {
+                    data = p_data;
+                    loop.quit();
+                }
+            });
+
+    fetch(p_url);
+    loop.exec();
+    return data;
+}
+
+void VDownloadCache::startRequests()
+{
+    while (m_nrRunning < m_maxRequests && !m_pendingUrls.isEmpty()) {
+        startRequest(m_pendingUrls.dequeue());
+    }
+}
+
+void VDownloadCache::startRequest(const QString &p_url)
+{
+    QUrl url(p_url);
+    QNetworkRequest request(url);
+    request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
+
+    auto it = m_entries.find(p_url);
+    if (it != m_entries.end()) {
+        if (!it.value().m_etag.isEmpty()) {
+            request.setRawHeader("If-None-Match", it.value().m_etag);
+        }
+
+        if (!it.value().m_lastModified.isEmpty()) {
+            request.setRawHeader("If-Modified-Since", it.value().m_lastModified);
+        }
+    }
+
+    ++m_nrRunning;
+    QNetworkReply *reply = m_nam->get(request);
+    // Keep the original URL since it may be redirected.
+    reply->setProperty("VUrl", p_url);
+}
+
+void VDownloadCache::handleReplyFinished(QNetworkReply *p_reply)
+{
+    p_reply->deleteLater();
+    --m_nrRunning;
+
+    QString url = p_reply->property("VUrl").toString();
+    int status = p_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    QByteArray data;
+    if (p_reply->error() == QNetworkReply::NoError && status != 304) {
+        data = p_reply->readAll();
+        if (isCacheable(QUrl(url)) && !data.isEmpty()) {
+            writeCache(url, data, p_reply);
+        }
+    } else if (status == 304 || m_entries.contains(url)) {
+        // Not modified, or unreachable and the stale one is better than none.
+        if (readCache(url, data)) {
+            m_entries[url].m_validated = true;
+        } else if (status == 304) {
+            // Data file is missing. Request again without validators.
+            removeEntry(url);
+            startRequest(url);
+            return;
+        }
+    } else {
+        qWarning() << "failed to download" << url << p_reply->errorString();
+    }
+
+    m_activeUrls.remove(url);
+    finish(url, data);
+
+    startRequests();
+}
+
+void VDownloadCache::finish(const QString &p_url, const QByteArray &p_data)
+{
+    QMetaObject::invokeMethod(this, "fetched", Qt::QueuedConnection,
+                              Q_ARG(QString, p_url),
+                              Q_ARG(QByteArray, p_data));
+}
+
+bool VDownloadCache::readCache(const QString &p_url, QByteArray &p_data)
+{
+    auto it = m_entries.find(p_url);
+    if (it == m_entries.end()) {
+        return false;
+    }
+
+    QFile file(dataFilePath(it.value().m_hash));
+    if (!file.open(QIODevice::ReadOnly)) {
+        removeEntry(p_url);
+        return false;
+    }
+
+    p_data = file.readAll();
+    it.value().m_lastAccess = QDateTime::currentMSecsSinceEpoch();
+    markDirty();
+    return true;
+}
+
+void VDownloadCache::writeCache(const QString &p_url,
+                                const QByteArray &p_data,
+                                const QNetworkReply *p_reply)
+{
+    if (m_maxBytes <= 0 || p_data.size() > m_maxBytes) {
+        return;
+    }
+
+    Entry entry;
+    entry.m_hash = QCryptographicHash::hash(p_data, QCryptographicHash::Sha1).toHex();
+    entry.m_etag = p_reply->rawHeader("ETag");
+    entry.m_lastModified = p_reply->rawHeader("Last-Modified");
+    entry.m_size = p_data.size();
+    entry.m_lastAccess = QDateTime::currentMSecsSinceEpoch();
+    entry.m_validated = true;
+
+    if (!m_refs.contains(entry.m_hash)) {
+        VUtils::makePath(m_folder);
+        if (!VUtils::writeFileToDisk(dataFilePath(entry.m_hash), p_data)) {
+            return;
+        }
+    }
+
+    removeEntry(p_url);
+    m_entries.insert(p_url, entry);
+    addRef(entry.m_hash, entry.m_size);
+    markDirty();
+
+    evict();
+}
+
+void VDownloadCache::removeEntry(const QString &p_url)
+{
+    auto it = m_entries.find(p_url);
+    if (it == m_entries.end()) {
+        return;
+    }
+
+    releaseRef(it.value().m_hash, it.value().m_size);
+    m_entries.erase(it);
+    markDirty();
+}
+
+void VDownloadCache::addRef(const QString &p_hash, qint64 p_size)
+{
+    int &ref = m_refs[p_hash];
+    if (ref == 0) {
+        m_bytes += p_size;
+    }
+
+    ++ref;
+}
+
+void VDownloadCache::releaseRef(const QString &p_hash, qint64 p_size)
+{
+    auto it = m_refs.find(p_hash);
+    if (it == m_refs.end()) {
+        return;
+    }
+
+    if (--it.value() == 0) {
+        m_refs.erase(it);
+        m_bytes -= p_size;
+        QFile::remove(dataFilePath(p_hash));
+    }
+}
+
+void VDownloadCache::evict()
+{
+    if (m_bytes <= m_maxBytes) {
+        return;
+    }
+
+    QVector<QPair<qint64, QString> > urls;
+    urls.reserve(m_entries.size());
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        urls.append(qMakePair(it.value().m_lastAccess, it.key()));
+    }
+
+    std::sort(urls.begin(), urls.end());
+    for (auto const & url : urls) {
+        if (m_bytes <= m_maxBytes) {
+            break;
+        }
+
+        removeEntry(url.second);
+    }
+}
+
+void VDownloadCache::removeOrphanFiles()
+{
+    QDir dir(m_folder);
+    if (!dir.exists()) {
+        return;
+    }
+
+    QStringList files = dir.entryList(QDir::Files);
+    for (auto const & file : files) {
+        if (file != c_indexFile && !m_refs.contains(file)) {
+            dir.remove(file);
+        }
+    }
+}
+
+QString VDownloadCache::dataFilePath(const QString &p_hash) const
+{
+    return QDir(m_folder).filePath(p_hash);
+}
+
+void VDownloadCache::markDirty()
+{
+    m_dirty = true;
+    if (!m_saveTimer->isActive()) {
+        m_saveTimer->start();
+    }
+}
+
+bool VDownloadCache::readIndex()
+{
+    QFile file(QDir(m_folder).filePath(c_indexFile));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_7);
+
+    quint32 magic = 0, version = 0;
+    qint32 nrEntries = 0;
+    in >> magic >> version >> nrEntries;
+    if (magic != c_indexMagic || version != c_indexVersion) {
+        qWarning() << "ignore download cache index of invalid version" << file.fileName();
+        return false;
+    }
+
+    for (int i = 0; i < nrEntries && in.status() == QDataStream::Ok; ++i) {
+        QString url;
+        Entry entry;
+        in >> url >> entry.m_hash >> entry.m_etag >> entry.m_lastModified
+           >> entry.m_size >> entry.m_lastAccess;
+        if (in.status() != QDataStream::Ok) {
+            break;
+        }
+
+        m_entries.insert(url, entry);
+        addRef(entry.m_hash, entry.m_size);
+    }
+
+    return in.status() == QDataStream::Ok;
+}
+
+void VDownloadCache::saveIndex()
+{
+    m_saveTimer->stop();
+    m_dirty = false;
+
+    if (m_maxBytes <= 0) {
+        return;
+    }
+
+    VUtils::makePath(m_folder);
+    QSaveFile file(QDir(m_folder).filePath(c_indexFile));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "fail to open download cache index" << file.fileName();
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_7);
+
+    out << c_indexMagic << c_indexVersion << (qint32)m_entries.size();
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        const Entry &entry = it.value();
+        out << it.key() << entry.m_hash << entry.m_etag << entry.m_lastModified
+            << entry.m_size << entry.m_lastAccess;
+    }
+
+    if (!file.commit()) {
+        qWarning() << "fail to write download cache index" << file.fileName();
+    }
+}
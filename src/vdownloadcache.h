@@ -0,0 +1,148 @@
+#ifndef VDOWNLOADCACHE_H
+#define VDOWNLOADCACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QQueue>
+#include <QString>
+#include <QByteArray>
+#include <QUrl>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTimer;
+
+// Disk cache of downloaded resources such as remote images shared by all
+// the downloaders.
+// Data files are named by the hash of the content, so the same content from
+// different URLs is stored only once. Cached entries are revalidated with
+// ETag or Last-Modified once per session and served from disk if the server
+// responds 304 or is unreachable.
+// Requests of the same URL in flight are merged and the number of concurrent
+// requests is limited. Least recently used entries are evicted when the
+// total size exceeds the limit.
+// Should be used in GUI thread only.
+class VDownloadCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit VDownloadCache(QObject *p_parent = nullptr);
+
+    ~VDownloadCache();
+
+    // Read configurations and load the index.
+    void init();
+
+    // Fetch @p_url from cache or network.
+    // fetched() will always be emitted later, even if it is cached.
+    void fetch(const QUrl &p_url);
+
+    // Fetch @p_url and wait for it with a local event loop.
+    QByteArray fetchSync(const QUrl &p_url);
+
+    // Size in bytes of all the data files.
+    qint64 bytes() const;
+
+signals:
+    // @p_data is empty if failed.
+    void fetched(const QString &p_url, const QByteArray &p_data);
+
+private slots:
+    void handleReplyFinished(QNetworkReply *p_reply);
+
+    void saveIndex();
+
+private:
+    struct Entry
+    {
+        Entry()
+            : m_size(0), m_lastAccess(0), m_validated(false)
+        {
+        }
+
+        // Hash of the content, also the name of the data file.
+        QString m_hash;
+
+        QByteArray m_etag;
+
+        QByteArray m_lastModified;
+
+        qint64 m_size;
+
+        // Msecs since epoch.
+        qint64 m_lastAccess;
+
+        // Whether it is revalidated in this session. Not saved.
+        bool m_validated;
+    };
+
+    // Start pending requests within the limit.
+    void startRequests();
+
+    // Request @p_url with validators of the cached entry if there is one.
+    void startRequest(const QString &p_url);
+
+    // Emit fetched() in next event loop.
+    void finish(const QString &p_url, const QByteArray &p_data);
+
+    // Read the data file of @p_url and update the access time.
+    // Returns false if it is not cached or the data file is missing.
+    bool readCache(const QString &p_url, QByteArray &p_data);
+
+    void writeCache(const QString &p_url, const QByteArray &p_data, const QNetworkReply *p_reply);
+
+    void removeEntry(const QString &p_url);
+
+    void addRef(const QString &p_hash, qint64 p_size);
+
+    void releaseRef(const QString &p_hash, qint64 p_size);
+
+    // Evict least recently used entries until the size is within the limit.
+    void evict();
+
+    // Delete data files not referred by any entry.
+    void removeOrphanFiles();
+
+    bool readIndex();
+
+    void markDirty();
+
+    QString dataFilePath(const QString &p_hash) const;
+
+    static bool isCacheable(const QUrl &p_url);
+
+    QString m_folder;
+
+    qint64 m_maxBytes;
+
+    qint64 m_bytes;
+
+    int m_maxRequests;
+
+    QHash<QString, Entry> m_entries;
+
+    // Number of entries referring to each data file.
+    QHash<QString, int> m_refs;
+
+    QNetworkAccessManager *m_nam;
+
+    // URLs waiting to be requested.
+    QQueue<QString> m_pendingUrls;
+
+    // URLs pending or being requested.
+    QSet<QString> m_activeUrls;
+
+    int m_nrRunning;
+
+    QTimer *m_saveTimer;
+
+    bool m_dirty;
+};
+
+inline qint64 VDownloadCache::bytes() const
+{
+    return m_bytes;
+}
+
+#endif // VDOWNLOADCACHE_H
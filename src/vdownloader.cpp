@@ -1,9 +1,15 @@
 #include "vdownloader.h"
 
-#include "utils/vutils.h"
+#include <QEventLoop>
+#include <QThread>
+
+#include "vdownloadcache.h"
+
+extern VDownloadCache *g_downloadCache;
 
 VDownloader::VDownloader(QObject *parent)
-    : QObject(parent)
+    : QObject(parent),
+      m_cacheEnabled(false)
 {
     connect(&webCtrl, &QNetworkAccessManager::finished,
             this, &VDownloader::handleDownloadFinished);
@@ -16,37 +22,58 @@ void VDownloader::handleDownloadFinished(QNetworkReply *reply)
     emit downloadFinished(data, reply->url().toString());
 }
 
+void VDownloader::handleCacheFetched(const QString &p_url, const QByteArray &p_data)
+{
+    if (m_cacheUrls.remove(p_url)) {
+        data = p_data;
+        emit downloadFinished(data, p_url);
+    }
+}
+
 void VDownloader::download(const QUrl &p_url)
 {
     if (!p_url.isValid()) {
         return;
     }
 
+    if (m_cacheEnabled && g_downloadCache) {
+        connect(g_downloadCache, &VDownloadCache::fetched,
+                this, &VDownloader::handleCacheFetched,
+                Qt::UniqueConnection);
+
+        m_cacheUrls.insert(p_url.toString());
+        g_downloadCache->fetch(p_url);
+        return;
+    }
+
     QNetworkRequest request(p_url);
     webCtrl.get(request);
 }
 
-QByteArray VDownloader::downloadSync(const QUrl &p_url)
+QByteArray VDownloader::downloadSync(const QUrl &p_url, bool p_useCache)
 {
     QByteArray data;
     if (!p_url.isValid()) {
         return data;
     }
 
-    bool finished = false;
+    if (p_useCache
+        && g_downloadCache
+        && g_downloadCache->thread() == QThread::currentThread()) {
+        return g_downloadCache->fetchSync(p_url);
+    }
+
+    QEventLoop loop;
     QNetworkAccessManager nam;
     connect(&nam, &QNetworkAccessManager::finished,
-            [&data, &finished](QNetworkReply *p_reply) {
+            [&data, &loop](QNetworkReply *p_reply) {
                 data = p_reply->readAll();
                 p_reply->deleteLater();
-                finished = true;
+                loop.quit();
             });
 
     nam.get(QNetworkRequest(p_url));
-
-    while (!finished) {
-        VUtils::sleepWait(100);
-    }
+    loop.exec();
 
     return data;
 }
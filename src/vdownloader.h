@@ -4,6 +4,7 @@
 #include <QObject>
 #include <QUrl>
 #include <QByteArray>
+#include <QSet>
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QNetworkReply>
@@ -15,7 +16,10 @@ public:
     explicit VDownloader(QObject *parent = 0);
     void download(const QUrl &p_url);
 
-    static QByteArray downloadSync(const QUrl &p_url);
+    // Fetch through the shared download cache. Used for images.
+    void setCacheEnabled(bool p_enabled);
+
+    static QByteArray downloadSync(const QUrl &p_url, bool p_useCache = false);
 
 signals:
     void downloadFinished(const QByteArray &data, const QString &url);
@@ -23,9 +27,21 @@ signals:
 private slots:
     void handleDownloadFinished(QNetworkReply *reply);
 
+    void handleCacheFetched(const QString &p_url, const QByteArray &p_data);
+
 private:
     QNetworkAccessManager webCtrl;
     QByteArray data;
+
+    bool m_cacheEnabled;
+
+    // URLs requested from the cache.
+    QSet<QString> m_cacheUrls;
 };
 
+inline void VDownloader::setCacheEnabled(bool p_enabled)
+{
+    m_cacheEnabled = p_enabled;
+}
+
 #endif // VDOWNLOADER_H
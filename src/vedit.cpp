@@ -12,6 +12,7 @@
 #include "vedittab.h"
 #include "dialog/vinsertlinkdialog.h"
 #include "utils/viconutils.h"
+#include "vtextreplacer.h"
 
 extern VConfigManager *g_config;
 
@@ -423,34 +424,10 @@ void VEdit::replaceText(const QString &p_text, uint p_options,
 void VEdit::replaceTextAll(const QString &p_text, uint p_options,
                            const QString &p_replaceText)
 {
-    // Replace from the start to the end and restore the cursor.
+    // Replace all in one edit block and restore the cursor.
     QTextCursor cursor = textCursor();
-    int nrReplaces = 0;
-    QTextCursor tmpCursor = cursor;
-    tmpCursor.setPosition(0);
-    setTextCursor(tmpCursor);
-    int start = tmpCursor.position();
-    while (true) {
-        bool wrapped = false;
-        QTextCursor retCursor;
-        bool found = findTextHelper(p_text, p_options, true,
-                                    start, wrapped, retCursor);
-        if (!found) {
-            break;
-        } else {
-            if (wrapped) {
-                // Wrap back.
-                break;
-            }
-
-            nrReplaces++;
-            retCursor.beginEditBlock();
-            retCursor.insertText(p_replaceText);
-            retCursor.endEditBlock();
-            setTextCursor(retCursor);
-            start = retCursor.position();
-        }
-    }
+    VTextReplacer replacer(p_text, p_options, p_replaceText);
+    int nrReplaces = replacer.replace(document());
 
     // Restore cursor position.
     cursor.clearSelection();
@@ -11,6 +11,7 @@
 #include "vmainwindow.h"
 #include "vcaptain.h"
 #include "vfilelist.h"
+#include "vfilewatcher.h"
 
 extern VConfigManager *g_config;
 
@@ -18,6 +19,8 @@ extern VNote *g_vnote;
 
 extern VMainWindow *g_mainWin;
 
+extern VFileWatcher *g_fileWatcher;
+
 VEditArea::VEditArea(QWidget *parent)
     : QWidget(parent),
       VNavigationMode(),
@@ -64,6 +67,9 @@ VEditArea::VEditArea(QWidget *parent)
     timer->start();
 
     m_autoSave = g_config->getEnableAutoSave();
+
+    connect(g_fileWatcher, &VFileWatcher::filesChanged,
+            this, &VEditArea::handleWatchedFilesChanged);
 }
 
 void VEditArea::setupUI()
@@ -1080,14 +1086,21 @@ void VEditArea::recordClosedFile(const VFileSessionInfo &p_file)
 
 void VEditArea::handleFileTimerTimeout()
 {
+    // Changes outside are reported by the file watcher.
+    if (!m_autoSave) {
+        return;
+    }
+
     int nrWin = splitter->count();
     for (int i = 0; i < nrWin; ++i) {
-        // Check whether opened files have been changed outside.
-        VEditWindow *win = getWindow(i);
-        win->checkFileChangeOutside();
+        getWindow(i)->saveAll();
+    }
+}
 
-        if (m_autoSave) {
-            win->saveAll();
-        }
+void VEditArea::handleWatchedFilesChanged(const QStringList &p_paths)
+{
+    int nrWin = splitter->count();
+    for (int i = 0; i < nrWin; ++i) {
+        getWindow(i)->checkFileChangeOutside(p_paths);
     }
 }
@@ -154,6 +154,9 @@ private slots:
     // Handle the timeout signal of file timer.
     void handleFileTimerTimeout();
 
+    // Check opened files in @p_paths which may be changed outside.
+    void handleWatchedFilesChanged(const QStringList &p_paths);
+
 private:
     void setupUI();
     QVector<QPair<int, int> > findTabsByFile(const VFile *p_file);
@@ -10,6 +10,8 @@
 #include "dialog/vinsertlinkdialog.h"
 #include "utils/vmetawordmanager.h"
 #include "utils/vvim.h"
+#include "vextraselectionengine.h"
+#include "vtextreplacer.h"
 
 extern VConfigManager *g_config;
 
@@ -21,6 +23,8 @@ VEditor::VEditor(VFile *p_file, QWidget *p_editor)
       m_file(p_file),
       m_editOps(nullptr),
       m_document(nullptr),
+      m_trailingSpaceEngine(nullptr),
+      m_selectedWordEngine(nullptr),
       m_enableInputMethod(true)
 {
 }
@@ -69,6 +73,25 @@ void VEditor::init()
 
     m_extraSelections.resize((int)SelectionId::MaxSelection);
 
+    QTextCharFormat trailingSpaceFormat;
+    trailingSpaceFormat.setBackground(m_trailingSpaceColor);
+    m_trailingSpaceEngine = new VExtraSelectionEngine(m_document, m_editor);
+    m_trailingSpaceEngine->setFormat(trailingSpaceFormat);
+    QObject::connect(m_trailingSpaceEngine, &VExtraSelectionEngine::selectionsUpdated,
+                     m_object, &VEditorObject::updateTrailingSpaceSelections);
+
+    QTextCharFormat selectedWordFormat;
+    selectedWordFormat.setForeground(m_selectedWordFg);
+    selectedWordFormat.setBackground(m_selectedWordBg);
+    m_selectedWordEngine = new VExtraSelectionEngine(m_document, m_editor);
+    m_selectedWordEngine->setFormat(selectedWordFormat);
+    QObject::connect(m_selectedWordEngine, &VExtraSelectionEngine::selectionsUpdated,
+                     m_object, &VEditorObject::updateSelectedWordSelections);
+
+    // Selections of visible blocks take priority.
+    QObject::connect(verticalScrollBarW(), &QScrollBar::valueChanged,
+                     m_object, &VEditorObject::updateVisibleExtraSelections);
+
     updateFontAndPalette();
 
     m_config.init(QFontMetrics(m_editor->font()), false);
@@ -195,6 +218,7 @@ void VEditor::highlightTrailingSpace()
 {
     if (!g_config->getEnableTrailingSpaceHighlight()) {
         QList<QTextEdit::ExtraSelection> &selects = m_extraSelections[(int)SelectionId::TrailingSapce];
+        m_trailingSpaceEngine->clear();
         if (!selects.isEmpty()) {
             selects.clear();
             highlightExtraSelections(true);
@@ -202,14 +226,44 @@ void VEditor::highlightTrailingSpace()
         return;
     }
 
-    QTextCharFormat format;
-    format.setBackground(m_trailingSpaceColor);
-    QString text("\\s+$");
-    highlightTextAll(text,
-                     FindOption::RegularExpression,
-                     SelectionId::TrailingSapce,
-                     format,
-                     trailingSpaceFilter);
+    // Only the changed and visible blocks will be matched here.
+    m_trailingSpaceEngine->setPattern("\\s+$", FindOption::RegularExpression);
+    m_trailingSpaceEngine->update(firstVisibleBlockW().blockNumber(),
+                                  lastVisibleBlockW().blockNumber());
+
+    // Filter depends on the cursor, so always update.
+    updateTrailingSpaceSelections();
+}
+
+void VEditor::updateTrailingSpaceSelections()
+{
+    QList<QTextEdit::ExtraSelection> &selects = m_extraSelections[(int)SelectionId::TrailingSapce];
+    selects = m_trailingSpaceEngine->selections();
+    trailingSpaceFilter(this, selects);
+    highlightExtraSelections();
+}
+
+void VEditor::updateSelectedWordSelections()
+{
+    m_extraSelections[(int)SelectionId::SelectedWord] = m_selectedWordEngine->selections();
+    highlightExtraSelections();
+}
+
+void VEditor::updateVisibleExtraSelections()
+{
+    if (!m_trailingSpaceEngine->hasPattern() && !m_selectedWordEngine->hasPattern()) {
+        return;
+    }
+
+    int first = firstVisibleBlockW().blockNumber();
+    int last = lastVisibleBlockW().blockNumber();
+    if (m_trailingSpaceEngine->update(first, last)) {
+        updateTrailingSpaceSelections();
+    }
+
+    if (m_selectedWordEngine->update(first, last)) {
+        updateSelectedWordSelections();
+    }
 }
 
 void VEditor::highlightExtraSelections(bool p_now)
@@ -306,6 +360,7 @@ void VEditor::highlightSelectedWord()
 {
     QList<QTextEdit::ExtraSelection> &selects = m_extraSelections[(int)SelectionId::SelectedWord];
     if (!g_config->getHighlightSelectedWord()) {
+        m_selectedWordEngine->clear();
         if (!selects.isEmpty()) {
             selects.clear();
             highlightExtraSelections(true);
@@ -316,18 +371,18 @@ void VEditor::highlightSelectedWord()
 
     QString text = textCursorW().selectedText().trimmed();
     if (text.isEmpty() || wordInSearchedSelection(text)) {
+        m_selectedWordEngine->clear();
         selects.clear();
         highlightExtraSelections(true);
         return;
     }
 
-    QTextCharFormat format;
-    format.setForeground(m_selectedWordFg);
-    format.setBackground(m_selectedWordBg);
-    highlightTextAll(text,
-                     FindOption::CaseSensitive,
-                     SelectionId::SelectedWord,
-                     format);
+    // Visible blocks are matched now and the rest in background.
+    m_selectedWordEngine->setPattern(text, FindOption::CaseSensitive);
+    if (m_selectedWordEngine->update(firstVisibleBlockW().blockNumber(),
+                                     lastVisibleBlockW().blockNumber())) {
+        updateSelectedWordSelections();
+    }
 }
 
 bool VEditor::wordInSearchedSelection(const QString &p_text)
@@ -726,38 +781,10 @@ void VEditor::replaceTextAll(const QString &p_text,
                              uint p_options,
                              const QString &p_replaceText)
 {
-    // Replace from the start to the end and restore the cursor.
+    // Replace all in one edit block and restore the cursor.
     QTextCursor cursor = textCursorW();
-    int nrReplaces = 0;
-    QTextCursor tmpCursor = cursor;
-    tmpCursor.setPosition(0);
-    setTextCursorW(tmpCursor);
-    int start = tmpCursor.position();
-    while (true) {
-        bool wrapped = false;
-        QTextCursor retCursor;
-        bool found = findTextHelper(p_text,
-                                    p_options,
-                                    true,
-                                    start,
-                                    wrapped,
-                                    retCursor);
-        if (!found) {
-            break;
-        } else {
-            if (wrapped) {
-                // Wrap back.
-                break;
-            }
-
-            nrReplaces++;
-            retCursor.beginEditBlock();
-            retCursor.insertText(p_replaceText);
-            retCursor.endEditBlock();
-            setTextCursorW(retCursor);
-            start = retCursor.position();
-        }
-    }
+    VTextReplacer replacer(p_text, p_options, p_replaceText);
+    int nrReplaces = replacer.replace(m_document);
 
     // Restore cursor position.
     cursor.clearSelection();
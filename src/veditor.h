@@ -17,6 +17,7 @@ class VEditOperations;
 class QTimer;
 class QLabel;
 class VVim;
+class VExtraSelectionEngine;
 enum class VimMode;
 class QMouseEvent;
 
@@ -192,6 +193,10 @@ public:
 
     virtual void zoomOutW(int p_range = 1) = 0;
 
+    virtual QTextBlock firstVisibleBlockW() const = 0;
+
+    virtual QTextBlock lastVisibleBlockW() const = 0;
+
 protected:
     void init();
 
@@ -239,6 +244,15 @@ private:
 
     void highlightTrailingSpace();
 
+    // Update trailing space selections from m_trailingSpaceEngine.
+    void updateTrailingSpaceSelections();
+
+    // Update selected word selections from m_selectedWordEngine.
+    void updateSelectedWordSelections();
+
+    // Match the visible blocks for the incremental extra selections.
+    void updateVisibleExtraSelections();
+
     // Trigger the timer to request highlight.
     // If @p_now is true, stop the timer and highlight immediately.
     void highlightExtraSelections(bool p_now = false);
@@ -298,6 +312,10 @@ private:
 
     QColor m_trailingSpaceColor;
 
+    // Incremental matching of trailing spaces and selected word.
+    VExtraSelectionEngine *m_trailingSpaceEngine;
+    VExtraSelectionEngine *m_selectedWordEngine;
+
     // Timer for extra selections highlight.
     QTimer *m_highlightTimer;
 
@@ -376,6 +394,21 @@ private slots:
         m_editor->doHighlightExtraSelections();
     }
 
+    void updateTrailingSpaceSelections()
+    {
+        m_editor->updateTrailingSpaceSelections();
+    }
+
+    void updateSelectedWordSelections()
+    {
+        m_editor->updateSelectedWordSelections();
+    }
+
+    void updateVisibleExtraSelections()
+    {
+        m_editor->updateVisibleExtraSelections();
+    }
+
 private:
     friend class VEditor;
 
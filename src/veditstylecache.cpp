@@ -0,0 +1,52 @@
+#include "veditstylecache.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QFileInfo>
+
+#include "vstyleparser.h"
+#include "utils/vutils.h"
+
+bool VEditStyleCache::compile(const QString &p_file,
+                              QPalette &p_palette,
+                              QFont &p_font,
+                              QMap<QString, QMap<QString, QString>> &p_editorStyles,
+                              QVector<HighlightingStyle> &p_styles,
+                              QVector<QTextCharFormat> &p_mergedFormats,
+                              QHash<QString, QTextCharFormat> &p_codeBlockStyles)
+{
+    QFileInfo info(p_file);
+    qint64 lastModified = info.lastModified().toMSecsSinceEpoch();
+
+    Entry &entry = m_entries[p_file];
+    if (!entry.m_parser || entry.m_lastModified != lastModified) {
+        QString styleStr = VUtils::readFileFromDisk(p_file);
+        if (styleStr.isEmpty()) {
+            m_entries.remove(p_file);
+            return false;
+        }
+
+        entry = Entry();
+        entry.m_lastModified = lastModified;
+        entry.m_parser.reset(new VStyleParser());
+        entry.m_parser->parseMarkdownStyle(styleStr);
+
+        qDebug() << "parsed editor style file" << p_file;
+    }
+
+    p_editorStyles.clear();
+    entry.m_parser->fetchMarkdownEditorStyles(p_palette, p_font, p_editorStyles);
+
+    QString fontKey = p_font.toString();
+    if (entry.m_fontKey != fontKey || entry.m_styles.isEmpty()) {
+        entry.m_fontKey = fontKey;
+        entry.m_styles = entry.m_parser->fetchMarkdownStyles(p_font);
+        entry.m_mergedFormats = HGMarkdownHighlighter::mergeStylePairs(entry.m_styles);
+        entry.m_codeBlockStyles = entry.m_parser->fetchCodeBlockStyles(p_font);
+    }
+
+    p_styles = entry.m_styles;
+    p_mergedFormats = entry.m_mergedFormats;
+    p_codeBlockStyles = entry.m_codeBlockStyles;
+    return true;
+}
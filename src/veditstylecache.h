@@ -0,0 +1,64 @@
+#ifndef VEDITSTYLECACHE_H
+#define VEDITSTYLECACHE_H
+
+#include <QString>
+#include <QHash>
+#include <QMap>
+#include <QVector>
+#include <QPalette>
+#include <QFont>
+#include <QSharedPointer>
+#include <QTextCharFormat>
+
+#include "hgmarkdownhighlighter.h"
+
+class VStyleParser;
+
+// Cache of compiled editor style files (.mdhl).
+// A style file is parsed once until it is modified, and the formats compiled
+// on a base font are kept, so switching between styles needs no reading,
+// parsing, or format building.
+// Compiled formats are implicitly shared with the callers.
+class VEditStyleCache
+{
+public:
+    // Compile style file @p_file.
+    // @p_palette and @p_font: the base palette and font, which will be updated
+    // by the editor sections of the style.
+    // @p_editorStyles: [rule] -> ([attr] -> value) of the editor sections.
+    // @p_mergedFormats: see HGMarkdownHighlighter::mergeStylePairs().
+    // Returns false if @p_file could not be read.
+    bool compile(const QString &p_file,
+                 QPalette &p_palette,
+                 QFont &p_font,
+                 QMap<QString, QMap<QString, QString>> &p_editorStyles,
+                 QVector<HighlightingStyle> &p_styles,
+                 QVector<QTextCharFormat> &p_mergedFormats,
+                 QHash<QString, QTextCharFormat> &p_codeBlockStyles);
+
+private:
+    struct Entry
+    {
+        Entry() : m_lastModified(0)
+        {
+        }
+
+        qint64 m_lastModified;
+
+        QSharedPointer<VStyleParser> m_parser;
+
+        // Base font the formats are compiled on.
+        QString m_fontKey;
+
+        QVector<HighlightingStyle> m_styles;
+
+        QVector<QTextCharFormat> m_mergedFormats;
+
+        QHash<QString, QTextCharFormat> m_codeBlockStyles;
+    };
+
+    // Keyed by the file path.
+    QHash<QString, Entry> m_entries;
+};
+
+#endif // VEDITSTYLECACHE_H
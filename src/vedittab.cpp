@@ -1,12 +1,16 @@
 #include "vedittab.h"
 #include <QApplication>
 #include <QWheelEvent>
+#include <QDir>
 
 #include "utils/vutils.h"
 #include "vconfigmanager.h"
+#include "vfilewatcher.h"
 
 extern VConfigManager *g_config;
 
+extern VFileWatcher *g_fileWatcher;
+
 VEditTab::VEditTab(VFile *p_file, VEditArea *p_editArea, QWidget *p_parent)
     : QWidget(p_parent),
       m_file(p_file),
@@ -21,10 +25,14 @@ VEditTab::VEditTab(VFile *p_file, VEditArea *p_editArea, QWidget *p_parent)
 {
     connect(qApp, &QApplication::focusChanged,
             this, &VEditTab::handleFocusChanged);
+
+    updateFileWatch();
 }
 
 VEditTab::~VEditTab()
 {
+    clearFileWatch();
+
     if (m_file) {
         m_file->close();
     }
@@ -190,6 +198,43 @@ void VEditTab::writeBackupFile()
 {
 }
 
+void VEditTab::updateFileWatch()
+{
+    QStringList paths;
+    if (m_file) {
+        paths << m_file->fetchPath();
+        if (m_file->getType() == FileType::Note) {
+            paths << QDir(m_file->fetchBasePath()).filePath(VConfigManager::getDirConfigFileName());
+        }
+    }
+
+    if (paths == m_watchedPaths) {
+        return;
+    }
+
+    clearFileWatch();
+
+    for (auto const & path : paths) {
+        g_fileWatcher->addFile(path);
+    }
+
+    m_watchedPaths = paths;
+}
+
+void VEditTab::clearFileWatch()
+{
+    if (!g_fileWatcher) {
+        m_watchedPaths.clear();
+        return;
+    }
+
+    for (auto const & path : m_watchedPaths) {
+        g_fileWatcher->removeFile(path);
+    }
+
+    m_watchedPaths.clear();
+}
+
 void VEditTab::handleFileOrDirectoryChange(bool p_isFile, UpdateAction p_act)
 {
     Q_UNUSED(p_isFile);
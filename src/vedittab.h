@@ -114,6 +114,10 @@ public:
     // Handle the change of file or directory, such as the file has been moved.
     virtual void handleFileOrDirectoryChange(bool p_isFile, UpdateAction p_act);
 
+    // Watch the file and its folder config for changes outside.
+    // Should be called once the path of the file changes.
+    void updateFileWatch();
+
 public slots:
     // Enter edit mode
     virtual void editFile() = 0;
@@ -174,6 +178,13 @@ protected:
     // Whether backup file is enabled.
     bool m_enableBackupFile;
 
+private:
+    // Stop watching paths in m_watchedPaths.
+    void clearFileWatch();
+
+    // Paths watched for this tab.
+    QStringList m_watchedPaths;
+
 signals:
     void getFocused();
 
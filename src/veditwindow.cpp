@@ -854,6 +854,7 @@ void VEditWindow::updateFileInfo(const VFile *p_file, UpdateAction p_act)
     if (idx > -1) {
         updateTabStatus(idx);
         getTab(idx)->handleFileOrDirectoryChange(true, p_act);
+        getTab(idx)->updateFileWatch();
     }
 }
 
@@ -870,6 +871,7 @@ void VEditWindow::updateDirectoryInfo(const VDirectory *p_dir, UpdateAction p_ac
         if (p_dir->containsFile(file)) {
             updateTabStatus(i);
             editor->handleFileOrDirectoryChange(false, p_act);
+            editor->updateFileWatch();
         }
     }
 }
@@ -1163,11 +1165,15 @@ QVector<VEditTab *> VEditWindow::getAllTabs() const
     return tabs;
 }
 
-void VEditWindow::checkFileChangeOutside()
+void VEditWindow::checkFileChangeOutside(const QStringList &p_paths)
 {
     int nrTab = count();
     for (int i = 0; i < nrTab; ++i) {
-        getTab(i)->checkFileChangeOutside();
+        VEditTab *tab = getTab(i);
+        VFile *file = tab->getFile();
+        if (file && p_paths.contains(file->fetchPath())) {
+            tab->checkFileChangeOutside();
+        }
     }
 }
 
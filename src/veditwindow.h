@@ -77,8 +77,8 @@ public:
     // If @p_index is -1, it is current tab.
     void updateTabStatus(int p_index = -1);
 
-    // Check whether opened files have been changed outside.
-    void checkFileChangeOutside();
+    // Check whether opened files in @p_paths have been changed outside.
+    void checkFileChangeOutside(const QStringList &p_paths);
 
     // Auto save file.
     void saveAll();
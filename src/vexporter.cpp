@@ -9,6 +9,12 @@
 #include <QTemporaryDir>
 #include <QScopedPointer>
 #include <QCoreApplication>
+#include <QEventLoop>
+#include <QThread>
+#include <QRegularExpression>
+#include <QFutureWatcher>
+#include <QElapsedTimer>
+#include <QtConcurrent/QtConcurrentMap>
 
 #include "vconfigmanager.h"
 #include "vfile.h"
@@ -19,16 +25,27 @@
 #include "vmarkdownconverter.h"
 #include "vdocument.h"
 #include "utils/vwebutils.h"
+#include "utils/vcodeblocktokenizer.h"
 
 extern VConfigManager *g_config;
 
 extern VWebUtils *g_webUtils;
 
+const int VExporter::c_maxBatchWorkers = 8;
+
 VExporter::VExporter(QWidget *p_parent)
     : QObject(p_parent),
       m_webViewer(NULL),
       m_state(ExportState::Idle),
-      m_askedToStop(false)
+      m_askedToStop(false),
+      m_batchTasks(NULL),
+      m_batchOpt(NULL),
+      m_batchResults(NULL),
+      m_nrPendingBatchTasks(0),
+      m_maxWKProcesses(1),
+      m_batchTmpDir(NULL),
+      m_batchLoop(NULL),
+      m_processLoop(NULL)
 {
 }
 
@@ -182,22 +199,33 @@ void VExporter::initWebViewer(VFile *p_file, const ExportOption &p_opt)
 {
     Q_ASSERT(!m_webViewer);
 
-    m_webViewer = new VWebView(p_file, static_cast<QWidget *>(parent()));
-    m_webViewer->hide();
+    m_webViewer = createWebViewer(p_file, p_opt, &m_webDocument);
 
-    VPreviewPage *page = new VPreviewPage(m_webViewer);
-    m_webViewer->setPage(page);
-    connect(page, &VPreviewPage::loadFinished,
+    connect(m_webViewer->page(), &QWebEnginePage::loadFinished,
             this, &VExporter::handleLoadFinished);
-    connect(page->profile(), &QWebEngineProfile::downloadRequested,
+    connect(m_webViewer->page()->profile(), &QWebEngineProfile::downloadRequested,
             this, &VExporter::handleDownloadRequested);
-
-    m_webDocument = new VDocument(p_file, m_webViewer);
     connect(m_webDocument, &VDocument::logicsFinished,
             this, &VExporter::handleLogicsFinished);
 
-    QWebChannel *channel = new QWebChannel(m_webViewer);
-    channel->registerObject(QStringLiteral("content"), m_webDocument);
+    m_baseUrl = p_file->getBaseUrl();
+    m_webViewer->setHtml(m_htmlTemplate, m_baseUrl);
+}
+
+VWebView *VExporter::createWebViewer(VFile *p_file,
+                                     const ExportOption &p_opt,
+                                     VDocument **p_webDocument)
+{
+    VWebView *webViewer = new VWebView(p_file, static_cast<QWidget *>(parent()));
+    webViewer->hide();
+
+    VPreviewPage *page = new VPreviewPage(webViewer);
+    webViewer->setPage(page);
+
+    VDocument *webDocument = new VDocument(p_file, webViewer);
+
+    QWebChannel *channel = new QWebChannel(webViewer);
+    channel->registerObject(QStringLiteral("content"), webDocument);
     page->setWebChannel(channel);
 
     // Need to generate HTML using Hoedown.
@@ -218,11 +246,11 @@ void VExporter::initWebViewer(VFile *p_file, const ExportOption &p_opt)
             html = div + html;
         }
 
-        m_webDocument->setHtml(html);
+        webDocument->setHtml(html);
     }
 
-    m_baseUrl = p_file->getBaseUrl();
-    m_webViewer->setHtml(m_htmlTemplate, m_baseUrl);
+    *p_webDocument = webDocument;
+    return webViewer;
 }
 
 void VExporter::handleLogicsFinished()
@@ -480,54 +508,22 @@ bool VExporter::exportToHTML(VDocument *p_webDocument,
             this, [&, this](const QString &p_headContent,
                             const QString &p_styleContent,
                             const QString &p_bodyContent) {
-                if (p_bodyContent.isEmpty() || this->m_state == ExportState::Cancelled) {
-                    htmlExported = -1;
-                    return;
-                }
-
-                Q_ASSERT(!p_filePath.isEmpty());
-
-                QFile file(p_filePath);
-                if (!file.open(QFile::WriteOnly)) {
+                if (this->m_state == ExportState::Cancelled) {
                     htmlExported = -1;
                     return;
                 }
 
-                QString resFolder = QFileInfo(p_filePath).completeBaseName() + "_files";
-                QString resFolderPath = QDir(VUtils::basePathFromPath(p_filePath)).filePath(resFolder);
-
-                qDebug() << "HTML files folder" << resFolderPath;
-
-                QString html(m_exportHtmlTemplate);
-                if (!p_styleContent.isEmpty() && p_opt.m_embedCssStyle) {
-                    QString content(p_styleContent);
-                    fixStyleResources(resFolderPath, content);
-                    html.replace(HtmlHolder::c_styleHolder, content);
-                }
-
-                if (!p_headContent.isEmpty()) {
-                    html.replace(HtmlHolder::c_headHolder, p_headContent);
-                }
-
-                if (p_opt.m_completeHTML) {
-                    QString content(p_bodyContent);
-                    fixBodyResources(m_baseUrl, resFolderPath, content);
-                    html.replace(HtmlHolder::c_bodyHolder, content);
+                if (writeHtmlFile(m_exportHtmlTemplate,
+                                  m_baseUrl,
+                                  p_opt,
+                                  p_filePath,
+                                  p_headContent,
+                                  p_styleContent,
+                                  p_bodyContent)) {
+                    htmlExported = 1;
                 } else {
-                    html.replace(HtmlHolder::c_bodyHolder, p_bodyContent);
-                }
-
-                file.write(html.toUtf8());
-                file.close();
-
-                // Delete empty resource folder.
-                QDir dir(resFolderPath);
-                if (dir.isEmpty()) {
-                    dir.cdUp();
-                    dir.rmdir(resFolder);
+                    htmlExported = -1;
                 }
-
-                htmlExported = 1;
             });
 
     p_webDocument->getHtmlContentAsync();
@@ -543,6 +539,62 @@ bool VExporter::exportToHTML(VDocument *p_webDocument,
     return htmlExported == 1;
 }
 
+bool VExporter::writeHtmlFile(const QString &p_template,
+                              const QUrl &p_baseUrl,
+                              const ExportHTMLOption &p_opt,
+                              const QString &p_filePath,
+                              const QString &p_headContent,
+                              const QString &p_styleContent,
+                              const QString &p_bodyContent)
+{
+    if (p_bodyContent.isEmpty()) {
+        return false;
+    }
+
+    Q_ASSERT(!p_filePath.isEmpty());
+
+    QFile file(p_filePath);
+    if (!file.open(QFile::WriteOnly)) {
+        return false;
+    }
+
+    QString resFolder = QFileInfo(p_filePath).completeBaseName() + "_files";
+    QString resFolderPath = QDir(VUtils::basePathFromPath(p_filePath)).filePath(resFolder);
+
+    qDebug() << "HTML files folder" << resFolderPath;
+
+    QString html(p_template);
+    if (!p_styleContent.isEmpty() && p_opt.m_embedCssStyle) {
+        QString content(p_styleContent);
+        fixStyleResources(resFolderPath, content);
+        html.replace(HtmlHolder::c_styleHolder, content);
+    }
+
+    if (!p_headContent.isEmpty()) {
+        html.replace(HtmlHolder::c_headHolder, p_headContent);
+    }
+
+    if (p_opt.m_completeHTML) {
+        QString content(p_bodyContent);
+        fixBodyResources(p_baseUrl, resFolderPath, content);
+        html.replace(HtmlHolder::c_bodyHolder, content);
+    } else {
+        html.replace(HtmlHolder::c_bodyHolder, p_bodyContent);
+    }
+
+    file.write(html.toUtf8());
+    file.close();
+
+    // Delete empty resource folder.
+    QDir dir(resFolderPath);
+    if (dir.isEmpty()) {
+        dir.cdUp();
+        dir.rmdir(resFolder);
+    }
+
+    return true;
+}
+
 bool VExporter::fixStyleResources(const QString &p_folder,
                                   QString &p_html)
 {
@@ -726,73 +778,731 @@ int VExporter::exportPDFInOne(const QList<QString> &p_htmlFiles,
 int VExporter::startProcess(const QString &p_program, const QStringList &p_args)
 {
     int ret = 0;
+    bool finished = false;
+
+    QElapsedTimer timer;
+    timer.start();
+
     QScopedPointer<QProcess> process(new QProcess(this));
+    QEventLoop loop;
+
+    connect(process.data(), &QProcess::readyReadStandardOutput,
+            &loop, [this, &process]() {
+                emit outputLog(QString::fromLocal8Bit(process->readAllStandardOutput()));
+            });
+    connect(process.data(), &QProcess::readyReadStandardError,
+            &loop, [this, &process]() {
+                emit outputLog(QString::fromLocal8Bit(process->readAllStandardError()));
+            });
+    connect(process.data(), static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            &loop, [&ret, &finished, &loop](int p_exitCode, QProcess::ExitStatus p_status) {
+                ret = p_status == QProcess::CrashExit ? -1 : p_exitCode;
+                finished = true;
+                loop.quit();
+            });
+    connect(process.data(), &QProcess::errorOccurred,
+            &loop, [this, &ret, &finished, &loop](QProcess::ProcessError p_err) {
+                if (p_err == QProcess::FailedToStart) {
+                    emit outputLog(tr("QProcess error %1.").arg(p_err));
+                    ret = -2;
+                    finished = true;
+                    loop.quit();
+                }
+            });
+
     process->start(p_program, p_args);
-    bool finished = false;
-    bool started = false;
-    while (true) {
-        QProcess::ProcessError err = process->error();
-        if (err == QProcess::FailedToStart
-            || err == QProcess::Crashed) {
-            emit outputLog(tr("QProcess error %1.").arg(err));
-            if (err == QProcess::FailedToStart) {
-                ret = -2;
+
+    if (!finished && !m_askedToStop) {
+        m_processLoop = &loop;
+        loop.exec();
+        m_processLoop = NULL;
+    }
+
+    process->disconnect(&loop);
+
+    if (!finished) {
+        // Asked to stop.
+        process->kill();
+        process->waitForFinished();
+        ret = -1;
+    }
+
+    emit outputLog(tr("Process finished in %1 ms.").arg(timer.elapsed()));
+
+    return ret;
+}
+
+void VExporter::setAskedToStop(bool p_askedToStop)
+{
+    m_askedToStop = p_askedToStop;
+
+    if (m_askedToStop) {
+        if (m_batchLoop) {
+            m_batchLoop->quit();
+        }
+
+        if (m_processLoop) {
+            m_processLoop->quit();
+        }
+    }
+}
+
+bool VExporter::isBatchSupported(const ExportOption &p_opt)
+{
+    // OnePDF is exported as HTML first.
+    switch (p_opt.m_format) {
+    case ExportFormat::PDF:
+        V_FALLTHROUGH;
+    case ExportFormat::HTML:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+int VExporter::exportBatch(const QVector<ExportTask> &p_tasks,
+                           const ExportOption &p_opt,
+                           QVector<bool> &p_results,
+                           QString *p_errMsg)
+{
+    Q_UNUSED(p_errMsg);
+
+    p_results.fill(false, p_tasks.size());
+    if (p_tasks.isEmpty()) {
+        return 0;
+    }
+
+    Q_ASSERT(m_state == ExportState::Idle);
+    m_state = ExportState::Busy;
+
+    int nrWorkers = g_config->getBatchExportWorkers();
+    if (nrWorkers <= 0) {
+        nrWorkers = QThread::idealThreadCount();
+    }
+
+    nrWorkers = qBound(1, nrWorkers, qMin(c_maxBatchWorkers, p_tasks.size()));
+
+    m_batchTasks = &p_tasks;
+    m_batchOpt = &p_opt;
+    m_batchResults = &p_results;
+    m_batchQueue.clear();
+    m_nrPendingBatchTasks = p_tasks.size();
+
+    // Web view rendering and wkhtmltopdf conversions run in pipeline.
+    m_wkQueue.clear();
+    m_maxWKProcesses = nrWorkers;
+    if (p_opt.m_format == ExportFormat::PDF && p_opt.m_pdfOpt.m_wkhtmltopdf) {
+        m_batchTmpDir = new QTemporaryDir();
+    }
+
+    m_workers.resize(nrWorkers);
+    for (int i = 0; i < nrWorkers; ++i) {
+        m_workers[i] = ExportWorker();
+        m_workers[i].m_id = i;
+    }
+
+    // Notes are rendered natively on the thread pool if possible. Those need
+    // web view to render will be queued to the render workers.
+    bool native = isNativeExportSupported(p_opt);
+    QVector<NativeExportJob> nativeJobs;
+    if (native) {
+        QString styleContent = readStyleContent(g_config->getCssStyleUrl(p_opt.m_renderStyle))
+                               + readStyleContent(g_config->getCodeBlockCssStyleUrl(p_opt.m_renderCodeBlockStyle));
+
+        nativeJobs.reserve(p_tasks.size());
+        for (int i = 0; i < p_tasks.size(); ++i) {
+            const ExportTask &task = p_tasks[i];
+            NativeExportJob job;
+            job.m_taskIdx = i;
+            if (task.m_file->isOpened()) {
+                job.m_content = task.m_file->getContent();
             } else {
-                ret = -1;
+                job.m_filePath = task.m_file->fetchPath();
             }
 
+            job.m_outputFile = task.m_outputFile;
+            job.m_baseUrl = task.m_file->getBaseUrl();
+            job.m_template = m_exportHtmlTemplate;
+            job.m_styleContent = styleContent;
+            job.m_htmlOpt = p_opt.m_htmlOpt;
+            job.m_extensions = g_config->getMarkdownExtensions();
+            job.m_enableMermaid = g_config->getEnableMermaid();
+            job.m_enableFlowchart = g_config->getEnableFlowchart();
+            job.m_enableMathjax = g_config->getEnableMathjax();
+            nativeJobs.append(job);
+        }
+
+        emit outputLog(tr("Export %1 notes natively.").arg(p_tasks.size()));
+    } else {
+        for (int i = 0; i < p_tasks.size(); ++i) {
+            m_batchQueue.enqueue(i);
+        }
+
+        emit outputLog(tr("Export %1 notes with %2 workers.").arg(p_tasks.size()).arg(nrWorkers));
+    }
+
+    // All the web pages share the default profile. Dispatch MIME HTML downloads
+    // to the worker by the output file path.
+    QMetaObject::Connection downloadConn;
+    if (p_opt.m_format == ExportFormat::HTML && p_opt.m_htmlOpt.m_mimeHTML) {
+        downloadConn = connect(QWebEngineProfile::defaultProfile(), &QWebEngineProfile::downloadRequested,
+                               this, [this](QWebEngineDownloadItem *p_item) {
+                                   if (p_item->savePageFormat() != QWebEngineDownloadItem::MimeHtmlSaveFormat) {
+                                       return;
+                                   }
+
+                                   QString path = QDir::cleanPath(p_item->path());
+                                   for (auto const & worker : m_workers) {
+                                       if (worker.m_taskIdx == -1
+                                           || QDir::cleanPath((*m_batchTasks)[worker.m_taskIdx].m_outputFile) != path) {
+                                           continue;
+                                       }
+
+                                       int workerId = worker.m_id;
+                                       int taskIdx = worker.m_taskIdx;
+                                       connect(p_item, &QWebEngineDownloadItem::stateChanged,
+                                               this, [this, workerId, taskIdx](QWebEngineDownloadItem::DownloadState p_state) {
+                                                   if (!batchWorker(workerId, taskIdx)) {
+                                                       return;
+                                                   }
+
+                                                   if (p_state == QWebEngineDownloadItem::DownloadCompleted) {
+                                                       finishBatchTask(workerId, true);
+                                                   } else if (p_state == QWebEngineDownloadItem::DownloadCancelled
+                                                              || p_state == QWebEngineDownloadItem::DownloadInterrupted) {
+                                                       finishBatchTask(workerId, false);
+                                                   }
+                                               });
+                                       break;
+                                   }
+                               });
+    }
+
+    QFutureWatcher<int> nativeWatcher;
+    connect(&nativeWatcher, &QFutureWatcher<int>::resultReadyAt,
+            this, [this, &nativeWatcher, &nativeJobs](int p_idx) {
+                if (!m_batchLoop) {
+                    return;
+                }
+
+                int ret = nativeWatcher.resultAt(p_idx);
+                int taskIdx = nativeJobs[p_idx].m_taskIdx;
+                if (ret == -1) {
+                    // Render it via web view.
+                    m_batchQueue.enqueue(taskIdx);
+                    startIdleBatchWorkers();
+                    return;
+                }
+
+                completeBatchTask(-1, taskIdx, ret == 1);
+            });
+
+    QEventLoop loop;
+    m_batchLoop = &loop;
+
+    if (native) {
+        nativeWatcher.setFuture(QtConcurrent::mapped(nativeJobs, &VExporter::exportHtmlNatively));
+    }
+
+    for (int i = 0; i < nrWorkers; ++i) {
+        startBatchTask(i);
+    }
+
+    if (m_nrPendingBatchTasks > 0 && !m_askedToStop) {
+        loop.exec();
+    }
+
+    m_batchLoop = NULL;
+
+    nativeWatcher.cancel();
+    nativeWatcher.waitForFinished();
+
+    // Kill conversions in progress if cancelled.
+    for (auto process : m_wkProcesses) {
+        process->disconnect(this);
+        process->kill();
+        process->waitForFinished();
+        delete process;
+    }
+
+    m_wkProcesses.clear();
+    m_wkQueue.clear();
+
+    delete m_batchTmpDir;
+    m_batchTmpDir = NULL;
+
+    if (downloadConn) {
+        disconnect(downloadConn);
+    }
+
+    // Clean up tasks in progress if cancelled.
+    for (auto & worker : m_workers) {
+        if (worker.m_taskIdx == -1) {
+            continue;
+        }
+
+        if (worker.m_webViewer) {
+            worker.m_webViewer->deleteLater();
+        }
+
+        if (!worker.m_isOpened) {
+            (*m_batchTasks)[worker.m_taskIdx].m_file->close();
+        }
+    }
+
+    m_workers.clear();
+    m_batchTasks = NULL;
+    m_batchOpt = NULL;
+    m_batchResults = NULL;
+
+    m_state = ExportState::Idle;
+
+    return p_results.count(true);
+}
+
+VExporter::ExportWorker *VExporter::batchWorker(int p_worker, int p_taskIdx)
+{
+    if (!m_batchLoop || p_worker >= m_workers.size()) {
+        return NULL;
+    }
+
+    ExportWorker &worker = m_workers[p_worker];
+    if (worker.m_taskIdx != p_taskIdx) {
+        return NULL;
+    }
+
+    return &worker;
+}
+
+void VExporter::startBatchTask(int p_worker)
+{
+    ExportWorker &worker = m_workers[p_worker];
+    Q_ASSERT(worker.m_taskIdx == -1);
+
+    while (!m_batchQueue.isEmpty()
+           && m_wkQueue.size() < m_maxWKProcesses
+           && !m_askedToStop) {
+        int idx = m_batchQueue.dequeue();
+        VFile *file = (*m_batchTasks)[idx].m_file;
+
+        worker.m_isOpened = file->isOpened();
+        if (!worker.m_isOpened && !file->open()) {
+            --m_nrPendingBatchTasks;
+            emit batchTaskFinished(p_worker, idx, false);
+            continue;
+        }
+
+        worker.m_taskIdx = idx;
+        worker.m_noteState = NoteState::NotReady;
+        worker.m_webViewer = createWebViewer(file, *m_batchOpt, &worker.m_webDocument);
+
+        connect(worker.m_webViewer->page(), &QWebEnginePage::loadFinished,
+                this, [this, p_worker, idx](bool p_ok) {
+                    ExportWorker *worker = batchWorker(p_worker, idx);
+                    if (!worker || (worker->m_noteState & NoteState::WebLoadFinished)) {
+                        return;
+                    }
+
+                    if (!p_ok) {
+                        finishBatchTask(p_worker, false);
+                        return;
+                    }
+
+                    worker->m_noteState = NoteState(worker->m_noteState | NoteState::WebLoadFinished);
+                    if (worker->m_noteState == NoteState::Ready) {
+                        exportBatchTask(p_worker);
+                    }
+                });
+        connect(worker.m_webDocument, &VDocument::logicsFinished,
+                this, [this, p_worker, idx]() {
+                    ExportWorker *worker = batchWorker(p_worker, idx);
+                    if (!worker || (worker->m_noteState & NoteState::WebLogicsReady)) {
+                        return;
+                    }
+
+                    worker->m_noteState = NoteState(worker->m_noteState | NoteState::WebLogicsReady);
+                    if (worker->m_noteState == NoteState::Ready) {
+                        exportBatchTask(p_worker);
+                    }
+                });
+
+        worker.m_baseUrl = file->getBaseUrl();
+        worker.m_webViewer->setHtml(m_htmlTemplate, worker.m_baseUrl);
+        return;
+    }
+
+    if (m_nrPendingBatchTasks == 0 && m_batchLoop) {
+        m_batchLoop->quit();
+    }
+}
+
+void VExporter::exportBatchTask(int p_worker)
+{
+    ExportWorker &worker = m_workers[p_worker];
+    int idx = worker.m_taskIdx;
+    const ExportTask &task = (*m_batchTasks)[idx];
+
+    switch (m_batchOpt->m_format) {
+    case ExportFormat::PDF:
+        V_FALLTHROUGH;
+    case ExportFormat::OnePDF:
+    {
+        if (m_batchOpt->m_pdfOpt.m_wkhtmltopdf) {
+            connect(worker.m_webDocument, &VDocument::htmlContentFinished,
+                    this, [this, p_worker, idx](const QString &p_headContent,
+                                                const QString &p_styleContent,
+                                                const QString &p_bodyContent) {
+                        ExportWorker *worker = batchWorker(p_worker, idx);
+                        if (!worker) {
+                            return;
+                        }
+
+                        QString htmlPath = QDir(m_batchTmpDir->path()).filePath(QString("vnote_tmp_%1.html").arg(idx));
+                        bool ret = m_batchTmpDir->isValid()
+                                   && writeHtmlFile(m_exportHtmlTemplate,
+                                                    worker->m_baseUrl,
+                                                    ExportHTMLOption(),
+                                                    htmlPath,
+                                                    p_headContent,
+                                                    p_styleContent,
+                                                    p_bodyContent);
+
+                        // Render next note while converting this one.
+                        releaseBatchWorker(p_worker);
+                        if (ret) {
+                            queueWKConversion(p_worker, idx, htmlPath);
+                        } else {
+                            completeBatchTask(p_worker, idx, false);
+                        }
+
+                        startBatchTask(p_worker);
+                    });
+
+            worker.m_webDocument->getHtmlContentAsync();
             break;
         }
 
-        if (started) {
-            if (process->state() == QProcess::NotRunning) {
-                finished = true;
+        QString filePath = task.m_outputFile;
+        worker.m_webViewer->page()->printToPdf([this, p_worker, idx, filePath](const QByteArray &p_result) {
+            if (!batchWorker(p_worker, idx)) {
+                return;
             }
+
+            bool ret = !p_result.isEmpty() && VUtils::writeFileToDisk(filePath, p_result);
+            finishBatchTask(p_worker, ret);
+        }, m_pageLayout);
+
+        break;
+    }
+
+    case ExportFormat::HTML:
+        if (m_batchOpt->m_htmlOpt.m_mimeHTML) {
+            // Remove the file reserving the name. Finished in the handler of
+            // downloadRequested.
+            QFile::remove(task.m_outputFile);
+            worker.m_webViewer->page()->save(task.m_outputFile,
+                                             QWebEngineDownloadItem::MimeHtmlSaveFormat);
         } else {
-            if (process->state() != QProcess::NotRunning) {
-                started = true;
-            }
+            connect(worker.m_webDocument, &VDocument::htmlContentFinished,
+                    this, [this, p_worker, idx](const QString &p_headContent,
+                                                const QString &p_styleContent,
+                                                const QString &p_bodyContent) {
+                        ExportWorker *worker = batchWorker(p_worker, idx);
+                        if (!worker) {
+                            return;
+                        }
+
+                        bool ret = writeHtmlFile(m_exportHtmlTemplate,
+                                                 worker->m_baseUrl,
+                                                 m_batchOpt->m_htmlOpt,
+                                                 (*m_batchTasks)[idx].m_outputFile,
+                                                 p_headContent,
+                                                 p_styleContent,
+                                                 p_bodyContent);
+                        finishBatchTask(p_worker, ret);
+                    });
+
+            worker.m_webDocument->getHtmlContentAsync();
         }
 
-        if (process->waitForFinished(500)) {
-            // Finished.
-            finished = true;
-        }
+        break;
 
-        QByteArray outBa = process->readAllStandardOutput();
-        QByteArray errBa = process->readAllStandardError();
-        QString msg;
-        if (!outBa.isEmpty()) {
-            msg += QString::fromLocal8Bit(outBa);
-        }
+    default:
+        finishBatchTask(p_worker, false);
+        break;
+    }
+}
+
+void VExporter::finishBatchTask(int p_worker, bool p_ok)
+{
+    int idx = releaseBatchWorker(p_worker);
+
+    completeBatchTask(p_worker, idx, p_ok);
+
+    startBatchTask(p_worker);
+}
+
+int VExporter::releaseBatchWorker(int p_worker)
+{
+    ExportWorker &worker = m_workers[p_worker];
+    int idx = worker.m_taskIdx;
+    Q_ASSERT(idx > -1);
+    worker.m_taskIdx = -1;
+
+    // Called from the signals of the web view.
+    Q_ASSERT(worker.m_webViewer);
+    worker.m_webViewer->deleteLater();
+    worker.m_webViewer = NULL;
+    worker.m_webDocument = NULL;
+    worker.m_baseUrl.clear();
+
+    if (!worker.m_isOpened) {
+        (*m_batchTasks)[idx].m_file->close();
+    }
 
-        if (!errBa.isEmpty()) {
-            msg += QString::fromLocal8Bit(errBa);
+    return idx;
+}
+
+void VExporter::completeBatchTask(int p_worker, int p_taskIdx, bool p_ok)
+{
+    (*m_batchResults)[p_taskIdx] = p_ok;
+    --m_nrPendingBatchTasks;
+
+    emit batchTaskFinished(p_worker, p_taskIdx, p_ok);
+
+    if (m_nrPendingBatchTasks == 0 && m_batchLoop) {
+        m_batchLoop->quit();
+    }
+}
+
+void VExporter::startIdleBatchWorkers()
+{
+    for (int i = 0; i < m_workers.size(); ++i) {
+        if (m_workers[i].m_taskIdx == -1) {
+            startBatchTask(i);
         }
+    }
+}
+
+void VExporter::queueWKConversion(int p_worker, int p_taskIdx, const QString &p_htmlFile)
+{
+    WKConversion conv;
+    conv.m_worker = p_worker;
+    conv.m_taskIdx = p_taskIdx;
+    conv.m_htmlFile = p_htmlFile;
+    m_wkQueue.enqueue(conv);
+
+    startWKConversions();
+}
+
+void VExporter::startWKConversions()
+{
+    while (!m_wkQueue.isEmpty()
+           && m_wkProcesses.size() < m_maxWKProcesses
+           && !m_askedToStop) {
+        WKConversion conv = m_wkQueue.dequeue();
+
+        QStringList args(m_wkArgs);
+        args << QDir::toNativeSeparators(conv.m_htmlFile);
+        args << QDir::toNativeSeparators((*m_batchTasks)[conv.m_taskIdx].m_outputFile);
+
+        QProcess *process = new QProcess(this);
+        m_wkProcesses.append(process);
+
+        QElapsedTimer timer;
+        timer.start();
+
+        int worker = conv.m_worker;
+        int taskIdx = conv.m_taskIdx;
+        connect(process, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+                this, [this, process, worker, taskIdx, timer](int p_exitCode, QProcess::ExitStatus p_status) {
+                    finishWKConversion(process,
+                                       worker,
+                                       taskIdx,
+                                       timer.elapsed(),
+                                       p_status == QProcess::NormalExit && p_exitCode == 0);
+                });
+        connect(process, &QProcess::errorOccurred,
+                this, [this, process, worker, taskIdx, timer](QProcess::ProcessError p_err) {
+                    if (p_err == QProcess::FailedToStart) {
+                        emit outputLog(tr("Fail to start wkhtmltopdf (%1).").arg(m_batchOpt->m_pdfOpt.m_wkPath));
+                        finishWKConversion(process, worker, taskIdx, timer.elapsed(), false);
+                    }
+                });
 
+        process->start(m_batchOpt->m_pdfOpt.m_wkPath, args);
+    }
+}
+
+void VExporter::finishWKConversion(QProcess *p_process,
+                                   int p_worker,
+                                   int p_taskIdx,
+                                   qint64 p_elapsed,
+                                   bool p_ok)
+{
+    // Both errorOccurred() and finished() may be emitted.
+    if (!m_wkProcesses.removeOne(p_process)) {
+        return;
+    }
+
+    if (!p_ok) {
+        QByteArray msg = p_process->readAllStandardOutput() + p_process->readAllStandardError();
         if (!msg.isEmpty()) {
-            emit outputLog(msg);
+            emit outputLog(QString::fromLocal8Bit(msg));
         }
+    }
+
+    p_process->deleteLater();
+
+    emit outputLog(tr("wkhtmltopdf %1 note %2 in %3 ms (%4 running, %5 queued).")
+                     .arg(p_ok ? tr("converted") : tr("failed to convert"))
+                     .arg((*m_batchTasks)[p_taskIdx].m_file->getName())
+                     .arg(p_elapsed)
+                     .arg(m_wkProcesses.size())
+                     .arg(m_wkQueue.size()));
+
+    completeBatchTask(p_worker, p_taskIdx, p_ok);
+
+    startWKConversions();
+
+    // The queue may be not full now.
+    startIdleBatchWorkers();
+}
+
+bool VExporter::isNativeExportSupported(const ExportOption &p_opt)
+{
+    // Hoedown is the only renderer available natively.
+    return p_opt.m_format == ExportFormat::HTML
+           && !p_opt.m_htmlOpt.m_mimeHTML
+           && p_opt.m_renderer == MarkdownConverterType::Hoedown;
+}
 
-        if (finished) {
-            QProcess::ExitStatus sta = process->exitStatus();
-            if (sta == QProcess::CrashExit) {
-                ret = -1;
-                break;
+int VExporter::exportHtmlNatively(const NativeExportJob &p_job)
+{
+    QString content = p_job.m_content.isNull() ? VUtils::readFileFromDisk(p_job.m_filePath)
+                                               : p_job.m_content;
+
+    // Diagrams and math are rendered by JavaScript.
+    if ((p_job.m_enableMermaid && content.contains("```mermaid"))
+        || (p_job.m_enableFlowchart && content.contains("```flow"))
+        || (p_job.m_enableMathjax && (content.contains('$')
+                                      || content.contains("\\(")
+                                      || content.contains("\\[")
+                                      || content.contains("```mathjax")))) {
+        return -1;
+    }
+
+    VMarkdownConverter mdConverter;
+    QString toc;
+    QString html = mdConverter.generateHtml(content,
+                                            (hoedown_extensions)p_job.m_extensions,
+                                            toc);
+
+    highlightCodeBlocks(html);
+
+    bool ret = writeHtmlFile(p_job.m_template,
+                             p_job.m_baseUrl,
+                             p_job.m_htmlOpt,
+                             p_job.m_outputFile,
+                             QString(),
+                             p_job.m_styleContent,
+                             html);
+    return ret ? 1 : 0;
+}
+
+static QString unescapeHtml(const QString &p_text)
+{
+    QString text(p_text);
+    text.replace("&lt;", "<");
+    text.replace("&gt;", ">");
+    text.replace("&quot;", "\"");
+    text.replace("&#39;", "'");
+    text.replace("&#47;", "/");
+    text.replace("&amp;", "&");
+    return text;
+}
+
+void VExporter::highlightCodeBlocks(QString &p_html)
+{
+    // Contents of code blocks are escaped by Hoedown.
+    QRegularExpression regExp("<pre><code class=\"language-([^\"]+)\">([^<]*)</code></pre>");
+
+    QString result;
+    int lastPos = 0;
+    QRegularExpressionMatchIterator it = regExp.globalMatch(p_html);
+    while (it.hasNext()) {
+        QRegularExpressionMatch match = it.next();
+        QString lang = match.captured(1);
+        if (!VCodeBlockTokenizer::isLanguageSupported(lang)) {
+            continue;
+        }
+
+        QString code = unescapeHtml(match.captured(2));
+        QVector<HLUnitPos> units = VCodeBlockTokenizer::tokenize(lang, code);
+
+        result += p_html.midRef(lastPos, match.capturedStart() - lastPos);
+        result += QString("<pre><code class=\"language-%1 hljs\">").arg(lang);
+
+        int pos = 0;
+        for (auto const & unit : units) {
+            if (unit.m_position < pos) {
+                continue;
             }
 
-            ret = process->exitCode();
-            break;
+            result += code.mid(pos, unit.m_position - pos).toHtmlEscaped();
+            result += QString("<span class=\"%1\">%2</span>")
+                        .arg(unit.m_style)
+                        .arg(code.mid(unit.m_position, unit.m_length).toHtmlEscaped());
+            pos = unit.m_position + unit.m_length;
         }
 
-        QCoreApplication::processEvents();
+        result += code.mid(pos).toHtmlEscaped();
+        result += "</code></pre>";
 
-        if (m_askedToStop) {
-            process->kill();
-            ret = -1;
+        lastPos = match.capturedEnd();
+    }
+
+    if (lastPos == 0) {
+        return;
+    }
+
+    result += p_html.midRef(lastPos);
+    p_html = result;
+}
+
+QString VExporter::readStyleContent(const QString &p_url)
+{
+    if (p_url.isEmpty()) {
+        return QString();
+    }
+
+    QUrl url(p_url);
+    QString filePath = url.scheme() == "qrc" ? ":" + url.path() : url.toLocalFile();
+    QString css = VUtils::readFileFromDisk(filePath);
+    if (css.isEmpty()) {
+        return css;
+    }
+
+    // Translate relative url() to absolute as what the web side does.
+    QString baseUrl = p_url.left(p_url.lastIndexOf('/'));
+    QRegExp reg("\\burl\\(\"([^\"\\)]+)\"\\);");
+    int pos = 0;
+    while (pos < css.size()) {
+        int idx = css.indexOf(reg, pos);
+        if (idx == -1) {
             break;
         }
+
+        if (!QUrl(reg.cap(1)).isRelative()) {
+            pos = idx + reg.matchedLength();
+            continue;
+        }
+
+        QString newUrl = QString("url(\"%1/%2\");").arg(baseUrl).arg(reg.cap(1));
+        css.replace(idx, reg.matchedLength(), newUrl);
+        pos = idx + newUrl.size();
     }
 
-    return ret;
+    return css + "\n";
 }
@@ -6,10 +6,15 @@
 #include <QUrl>
 #include <QWebEngineDownloadItem>
 #include <QStringList>
+#include <QVector>
+#include <QQueue>
 
 #include "dialog/vexportdialog.h"
 
 class QWidget;
+class QEventLoop;
+class QProcess;
+class QTemporaryDir;
 class VWebView;
 class VDocument;
 
@@ -36,12 +41,27 @@ public:
                        const QString &p_outputFile,
                        QString *p_errMsg = NULL);
 
+    // Whether notes could be exported via exportBatch() with @p_opt.
+    static bool isBatchSupported(const ExportOption &p_opt);
+
+    // Export @p_tasks via a pool of web views in parallel.
+    // Returns the number of notes exported successfully.
+    // @p_results: output, whether each task succeeds.
+    int exportBatch(const QVector<ExportTask> &p_tasks,
+                    const ExportOption &p_opt,
+                    QVector<bool> &p_results,
+                    QString *p_errMsg = NULL);
+
     void setAskedToStop(bool p_askedToStop);
 
 signals:
     // Request to output log.
     void outputLog(const QString &p_log);
 
+    // Emitted when task @p_taskIdx in batch export is finished by worker @p_worker.
+    // @p_worker is -1 if the note is exported natively.
+    void batchTaskFinished(int p_worker, int p_taskIdx, bool p_ok);
+
 private slots:
     void handleLogicsFinished();
 
@@ -70,8 +90,139 @@ private:
     };
 
 
+    // A render worker of batch export with its own web view and document.
+    struct ExportWorker
+    {
+        ExportWorker()
+            : m_id(-1),
+              m_webViewer(NULL),
+              m_webDocument(NULL),
+              m_taskIdx(-1),
+              m_noteState(NoteState::NotReady),
+              m_isOpened(false)
+        {
+        }
+
+        int m_id;
+
+        VWebView *m_webViewer;
+
+        VDocument *m_webDocument;
+
+        QUrl m_baseUrl;
+
+        // Index of the task in progress. -1 if idle.
+        int m_taskIdx;
+
+        NoteState m_noteState;
+
+        // Whether the file of current task is opened before export.
+        bool m_isOpened;
+    };
+
     void initWebViewer(VFile *p_file, const ExportOption &p_opt);
 
+    // Create a hidden web view to render @p_file.
+    VWebView *createWebViewer(VFile *p_file,
+                              const ExportOption &p_opt,
+                              VDocument **p_webDocument);
+
+    // Fetch next task from the queue and start it on @p_worker.
+    void startBatchTask(int p_worker);
+
+    // Web side of @p_worker is ready. Export the note.
+    void exportBatchTask(int p_worker);
+
+    // Release @p_worker and start next task on it.
+    void finishBatchTask(int p_worker, bool p_ok);
+
+    // Release the web view of @p_worker and return the index of its task.
+    int releaseBatchWorker(int p_worker);
+
+    // Record the result of task @p_taskIdx.
+    void completeBatchTask(int p_worker, int p_taskIdx, bool p_ok);
+
+    // Start next task on all idle workers.
+    void startIdleBatchWorkers();
+
+    // Queue HTML file @p_htmlFile of task @p_taskIdx to convert via wkhtmltopdf.
+    void queueWKConversion(int p_worker, int p_taskIdx, const QString &p_htmlFile);
+
+    // Start wkhtmltopdf processes for queued conversions.
+    void startWKConversions();
+
+    void finishWKConversion(QProcess *p_process,
+                            int p_worker,
+                            int p_taskIdx,
+                            qint64 p_elapsed,
+                            bool p_ok);
+
+    // Return the worker with task @p_taskIdx in progress, or NULL if the task
+    // has been obsolete.
+    ExportWorker *batchWorker(int p_worker, int p_taskIdx);
+
+    // A note to export to HTML natively via Hoedown without web view.
+    struct NativeExportJob
+    {
+        NativeExportJob()
+            : m_taskIdx(-1),
+              m_extensions(0),
+              m_enableMermaid(false),
+              m_enableFlowchart(false),
+              m_enableMathjax(false)
+        {
+        }
+
+        int m_taskIdx;
+
+        // Read content from @m_filePath if @m_content is null.
+        QString m_filePath;
+
+        QString m_content;
+
+        QString m_outputFile;
+
+        QUrl m_baseUrl;
+
+        QString m_template;
+
+        QString m_styleContent;
+
+        ExportHTMLOption m_htmlOpt;
+
+        // hoedown_extensions.
+        int m_extensions;
+
+        bool m_enableMermaid;
+
+        bool m_enableFlowchart;
+
+        bool m_enableMathjax;
+    };
+
+    // Whether @p_opt could be exported natively without web view.
+    static bool isNativeExportSupported(const ExportOption &p_opt);
+
+    // Thread-safe.
+    // Returns 1 if succeeded, 0 if failed, and -1 if the note needs web view
+    // to render, such as Mermaid and MathJax.
+    static int exportHtmlNatively(const NativeExportJob &p_job);
+
+    // Highlight code blocks in @p_html generated by Hoedown natively.
+    static void highlightCodeBlocks(QString &p_html);
+
+    // Read the CSS style @p_url and translate relative url() to absolute.
+    static QString readStyleContent(const QString &p_url);
+
+    // Write the HTML contents to @p_filePath.
+    static bool writeHtmlFile(const QString &p_template,
+                              const QUrl &p_baseUrl,
+                              const ExportHTMLOption &p_opt,
+                              const QString &p_filePath,
+                              const QString &p_headContent,
+                              const QString &p_styleContent,
+                              const QString &p_bodyContent);
+
     void clearWebViewer();
 
     void clearNoteState();
@@ -150,6 +301,50 @@ private:
     QStringList m_wkArgs;
 
     bool m_askedToStop;
+
+    // Render workers of batch export.
+    QVector<ExportWorker> m_workers;
+
+    const QVector<ExportTask> *m_batchTasks;
+
+    const ExportOption *m_batchOpt;
+
+    QVector<bool> *m_batchResults;
+
+    // Index of the tasks in m_batchTasks to export via web view.
+    QQueue<int> m_batchQueue;
+
+    // HTML file rendered by web view to convert via wkhtmltopdf.
+    struct WKConversion
+    {
+        int m_worker;
+
+        int m_taskIdx;
+
+        QString m_htmlFile;
+    };
+
+    // Bounded by m_maxWKProcesses. Workers will wait when it is full.
+    QQueue<WKConversion> m_wkQueue;
+
+    // Running wkhtmltopdf processes of batch export.
+    QList<QProcess *> m_wkProcesses;
+
+    int m_maxWKProcesses;
+
+    // Folder to hold the HTML files to convert via wkhtmltopdf.
+    QTemporaryDir *m_batchTmpDir;
+
+    int m_nrPendingBatchTasks;
+
+    // Event loop to wait for batch export.
+    QEventLoop *m_batchLoop;
+
+    // Event loop to wait for the process started by startProcess().
+    QEventLoop *m_processLoop;
+
+    // Max number of render workers.
+    static const int c_maxBatchWorkers;
 };
 
 inline void VExporter::clearNoteState()
@@ -167,8 +362,4 @@ inline bool VExporter::isNoteStateFailed() const
     return m_noteState & NoteState::Failed;
 }
 
-inline void VExporter::setAskedToStop(bool p_askedToStop)
-{
-    m_askedToStop = p_askedToStop;
-}
 #endif // VEXPORTER_H
@@ -0,0 +1,305 @@
+#include "vextraselectionengine.h"
+
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include "vconstants.h"
+#include "utils/veditutils.h"
+
+// Max number of selections to provide.
+static const int c_maxSelections = 1000;
+
+// Max time in ms to match blocks in one slice.
+static const int c_sliceTime = 5;
+
+// Interval in ms between two slices.
+static const int c_sliceInterval = 20;
+
+VExtraSelectionEngine::VExtraSelectionEngine(QTextDocument *p_document, QObject *p_parent)
+    : QObject(p_parent),
+      m_document(p_document),
+      m_options(0),
+      m_nextBlockNumber(0),
+      m_changed(false),
+      m_truncated(false),
+      m_firstVisible(-1),
+      m_lastVisible(-1)
+{
+    m_matchTimer = new QTimer(this);
+    m_matchTimer->setSingleShot(true);
+    m_matchTimer->setInterval(c_sliceInterval);
+    connect(m_matchTimer, &QTimer::timeout,
+            this, &VExtraSelectionEngine::matchInBackground);
+
+    connect(m_document, &QTextDocument::contentsChange,
+            this, &VExtraSelectionEngine::handleContentsChange);
+}
+
+void VExtraSelectionEngine::setPattern(const QString &p_text, uint p_options)
+{
+    if (p_text.isEmpty()) {
+        clear();
+        return;
+    }
+
+    if (hasPattern() && p_text == m_text && p_options == m_options) {
+        return;
+    }
+
+    m_text = p_text;
+    m_options = p_options;
+    if (m_options & FindOption::RegularExpression) {
+        m_exp = QRegExp(m_text,
+                        (m_options & FindOption::CaseSensitive) ? Qt::CaseSensitive
+                                                               : Qt::CaseInsensitive);
+    } else {
+        m_exp = QRegExp();
+    }
+
+    m_blocks.clear();
+    m_blocks.resize(m_document->blockCount());
+    m_selections.clear();
+    m_truncated = false;
+    m_changed = true;
+
+    scheduleMatch(0);
+}
+
+void VExtraSelectionEngine::setFormat(const QTextCharFormat &p_format)
+{
+    m_format = p_format;
+    for (auto it = m_selections.begin(); it != m_selections.end(); ++it) {
+        it->format = m_format;
+    }
+}
+
+void VExtraSelectionEngine::clear()
+{
+    m_matchTimer->stop();
+    m_text.clear();
+    m_options = 0;
+    m_blocks.clear();
+    m_selections.clear();
+    m_truncated = false;
+    m_changed = false;
+}
+
+bool VExtraSelectionEngine::update(int p_first, int p_last)
+{
+    if (!hasPattern()) {
+        return false;
+    }
+
+    int maxBlockNumber = m_blocks.size() - 1;
+    p_first = qBound(0, p_first, maxBlockNumber);
+    p_last = qBound(p_first, p_last, maxBlockNumber);
+
+    QTextBlock block = m_document->findBlockByNumber(p_first);
+    for (int i = p_first; i <= p_last && block.isValid(); ++i) {
+        if (!m_blocks[i].m_valid) {
+            matchBlock(block);
+        }
+
+        block = block.next();
+    }
+
+    bool rangeChanged = p_first != m_firstVisible || p_last != m_lastVisible;
+    m_firstVisible = p_first;
+    m_lastVisible = p_last;
+
+    // Visible selections may be dropped due to the limit.
+    if (m_changed || (m_truncated && rangeChanged)) {
+        updateSelections();
+        return true;
+    }
+
+    return false;
+}
+
+void VExtraSelectionEngine::handleContentsChange(int p_position, int p_charsRemoved, int p_charsAdded)
+{
+    Q_UNUSED(p_charsRemoved);
+    if (!hasPattern()) {
+        return;
+    }
+
+    int firstBlockNumber = 0;
+    QTextBlock block = m_document->findBlock(p_position);
+    if (block.isValid()) {
+        firstBlockNumber = block.blockNumber();
+    }
+
+    int lastBlockNumber = m_document->blockCount() - 1;
+    block = m_document->findBlock(p_position + p_charsAdded);
+    if (block.isValid()) {
+        lastBlockNumber = block.blockNumber();
+    }
+
+    // Blocks are inserted or removed right after the first changed block.
+    int delta = m_document->blockCount() - m_blocks.size();
+    if (delta > 0) {
+        m_blocks.insert(firstBlockNumber + 1, delta, BlockMatches());
+    } else if (delta < 0) {
+        m_blocks.remove(firstBlockNumber + 1, -delta);
+        m_changed = true;
+    }
+
+    for (int i = firstBlockNumber; i <= lastBlockNumber; ++i) {
+        m_blocks[i].m_valid = false;
+    }
+
+    scheduleMatch(firstBlockNumber);
+}
+
+void VExtraSelectionEngine::scheduleMatch(int p_blockNumber)
+{
+    if (m_matchTimer->isActive()) {
+        m_nextBlockNumber = qMin(m_nextBlockNumber, p_blockNumber);
+    } else {
+        m_nextBlockNumber = p_blockNumber;
+        m_matchTimer->start();
+    }
+}
+
+void VExtraSelectionEngine::matchInBackground()
+{
+    if (!hasPattern()) {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    int nrBlocks = m_blocks.size();
+    QTextBlock block = m_document->findBlockByNumber(m_nextBlockNumber);
+    for (int i = m_nextBlockNumber; i < nrBlocks && block.isValid(); ++i) {
+        if (!m_blocks[i].m_valid) {
+            matchBlock(block);
+
+            if (timer.elapsed() >= c_sliceTime) {
+                m_nextBlockNumber = i + 1;
+                m_matchTimer->start();
+                return;
+            }
+        }
+
+        block = block.next();
+    }
+
+    m_nextBlockNumber = 0;
+
+    if (m_changed) {
+        updateSelections();
+        emit selectionsUpdated();
+    }
+}
+
+void VExtraSelectionEngine::matchBlock(const QTextBlock &p_block)
+{
+    BlockMatches &info = m_blocks[p_block.blockNumber()];
+    QVector<QPair<int, int> > matches = matchText(p_block.text());
+    if (matches != info.m_matches) {
+        info.m_matches = matches;
+        m_changed = true;
+    }
+
+    info.m_valid = true;
+}
+
+QVector<QPair<int, int> > VExtraSelectionEngine::matchText(const QString &p_text) const
+{
+    QVector<QPair<int, int> > matches;
+    bool wholeWord = m_options & FindOption::WholeWordOnly;
+    if (m_options & FindOption::RegularExpression) {
+        int pos = 0;
+        while (pos < p_text.size()) {
+            int idx = m_exp.indexIn(p_text, pos);
+            if (idx == -1) {
+                break;
+            }
+
+            int len = m_exp.matchedLength();
+            if (len <= 0) {
+                // Skip empty match.
+                pos = idx + 1;
+                continue;
+            }
+
+            if (!wholeWord || VEditUtils::isWholeWord(p_text, idx, len)) {
+                matches.append(qMakePair(idx, len));
+                pos = idx + len;
+            } else {
+                pos = idx + 1;
+            }
+        }
+    } else {
+        Qt::CaseSensitivity cs = (m_options & FindOption::CaseSensitive) ? Qt::CaseSensitive
+                                                                         : Qt::CaseInsensitive;
+        int len = m_text.size();
+        int idx = p_text.indexOf(m_text, 0, cs);
+        while (idx != -1) {
+            if (!wholeWord || VEditUtils::isWholeWord(p_text, idx, len)) {
+                matches.append(qMakePair(idx, len));
+                idx = p_text.indexOf(m_text, idx + len, cs);
+            } else {
+                idx = p_text.indexOf(m_text, idx + 1, cs);
+            }
+        }
+    }
+
+    return matches;
+}
+
+void VExtraSelectionEngine::updateSelections()
+{
+    m_selections.clear();
+    m_changed = false;
+    m_truncated = false;
+
+    int nrBlocks = m_blocks.size();
+    if (nrBlocks == 0) {
+        return;
+    }
+
+    int first = qBound(0, m_firstVisible, nrBlocks - 1);
+    int last = qBound(first, m_lastVisible, nrBlocks - 1);
+
+    // Visible blocks first, then blocks below and above.
+    QVector<QPair<int, int> > ranges;
+    ranges.append(qMakePair(first, last + 1));
+    ranges.append(qMakePair(last + 1, nrBlocks));
+    ranges.append(qMakePair(0, first));
+
+    for (auto const &range : ranges) {
+        for (int i = range.first; i < range.second; ++i) {
+            const QVector<QPair<int, int> > &matches = m_blocks[i].m_matches;
+            if (matches.isEmpty()) {
+                continue;
+            }
+
+            if (m_selections.size() + matches.size() > c_maxSelections) {
+                m_truncated = true;
+                return;
+            }
+
+            QTextBlock block = m_document->findBlockByNumber(i);
+            if (!block.isValid()) {
+                continue;
+            }
+
+            int pos = block.position();
+            for (auto const &match : matches) {
+                QTextEdit::ExtraSelection select;
+                select.format = m_format;
+                select.cursor = QTextCursor(block);
+                select.cursor.setPosition(pos + match.first);
+                select.cursor.setPosition(pos + match.first + match.second,
+                                          QTextCursor::KeepAnchor);
+                m_selections.append(select);
+            }
+        }
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef VEXTRASELECTIONENGINE_H
+#define VEXTRASELECTIONENGINE_H
+
+#include <QObject>
+#include <QVector>
+#include <QList>
+#include <QPair>
+#include <QRegExp>
+#include <QTextEdit>
+#include <QTextCharFormat>
+
+class QTextDocument;
+class QTextBlock;
+class QTimer;
+
+// Find all the matches of a pattern in a document as extra selections
+// incrementally.
+// Matches are cached per block and only the changed blocks will be matched
+// again. Visible blocks are matched at once while the rest are matched in
+// slices in background. The number of selections is limited and the visible
+// ones take priority.
+class VExtraSelectionEngine : public QObject
+{
+    Q_OBJECT
+public:
+    explicit VExtraSelectionEngine(QTextDocument *p_document, QObject *p_parent = nullptr);
+
+    // Set the pattern to match with FindOption @p_options.
+    // Caches will be kept if the pattern does not change.
+    void setPattern(const QString &p_text, uint p_options);
+
+    void setFormat(const QTextCharFormat &p_format);
+
+    // Clear the pattern and all the selections.
+    void clear();
+
+    bool hasPattern() const;
+
+    // Match the blocks in [@p_first, @p_last] which are visible now.
+    // Returns true if selections are updated.
+    bool update(int p_first, int p_last);
+
+    const QList<QTextEdit::ExtraSelection> &selections() const;
+
+signals:
+    // Emit when selections are updated by the background matching.
+    void selectionsUpdated();
+
+private slots:
+    void handleContentsChange(int p_position, int p_charsRemoved, int p_charsAdded);
+
+    // Match one slice of the blocks not matched yet.
+    void matchInBackground();
+
+private:
+    struct BlockMatches
+    {
+        BlockMatches()
+            : m_valid(false)
+        {
+        }
+
+        bool m_valid;
+
+        // [start, length] of each match within the block.
+        QVector<QPair<int, int> > m_matches;
+    };
+
+    // Match @p_block and update the cache.
+    void matchBlock(const QTextBlock &p_block);
+
+    QVector<QPair<int, int> > matchText(const QString &p_text) const;
+
+    // Rebuild m_selections from the caches.
+    void updateSelections();
+
+    // Start background matching from block @p_blockNumber.
+    void scheduleMatch(int p_blockNumber);
+
+    QTextDocument *m_document;
+
+    QString m_text;
+
+    uint m_options;
+
+    QRegExp m_exp;
+
+    QTextCharFormat m_format;
+
+    // Indexed by block number. Empty if there is no pattern.
+    QVector<BlockMatches> m_blocks;
+
+    // Block to continue background matching from.
+    int m_nextBlockNumber;
+
+    // Whether caches are changed since last updateSelections().
+    bool m_changed;
+
+    // Whether some matches are dropped due to the limit.
+    bool m_truncated;
+
+    // Visible range used to build m_selections.
+    int m_firstVisible;
+    int m_lastVisible;
+
+    QList<QTextEdit::ExtraSelection> m_selections;
+
+    QTimer *m_matchTimer;
+};
+
+inline bool VExtraSelectionEngine::hasPattern() const
+{
+    return !m_blocks.isEmpty();
+}
+
+inline const QList<QTextEdit::ExtraSelection> &VExtraSelectionEngine::selections() const
+{
+    return m_selections;
+}
+
+#endif // VEXTRASELECTIONENGINE_H
@@ -8,9 +8,13 @@
 #include <QTextStream>
 #include "utils/vutils.h"
 #include "vconfigmanager.h"
+#include "vbackupjournal.h"
+#include "vfilewatcher.h"
 
 extern VConfigManager *g_config;
 
+extern VFileWatcher *g_fileWatcher;
+
 const QString VFile::c_backupFileHeadMagic = "vnote_backup_file_826537664";
 
 VFile::VFile(QObject *p_parent,
@@ -75,6 +79,10 @@ bool VFile::save()
     if (ret) {
         m_lastModified = QFileInfo(fetchPath()).lastModified();
         m_modifiedTimeUtc = QDateTime::currentDateTimeUtc();
+
+        if (g_fileWatcher) {
+            g_fileWatcher->ignoreOwnWrite(fetchPath());
+        }
     }
 
     return ret;
@@ -196,15 +204,37 @@ QString VFile::fetchBackupFileHead() const
     return c_backupFileHeadMagic + " " + fetchPath();
 }
 
-bool VFile::writeBackupFile(const QString &p_content)
+bool VFile::writeBackupFile(const QByteArray &p_data, bool p_append)
 {
-    return VUtils::writeFileToDisk(fetchBackupFilePath(),
-                                   fetchBackupFileHead() + "\n" + p_content);
+    QString lastPath = m_lastBackupFilePath;
+    QString filePath = fetchBackupFilePath();
+    if (!p_append) {
+        return VUtils::writeFileToDisk(filePath,
+                                       (fetchBackupFileHead() + "\n").toUtf8() + p_data);
+    }
+
+    if (filePath != lastPath || !QFileInfo::exists(filePath)) {
+        return false;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "fail to open backup file" << filePath << "to append";
+        return false;
+    }
+
+    return file.write(p_data) == p_data.size();
 }
 
 QString VFile::readBackupFile(const QString &p_file)
 {
-    const QString content = VUtils::readFileFromDisk(p_file);
-    int idx = content.indexOf("\n");
-    return content.mid(idx + 1);
+    QFile file(p_file);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "fail to open backup file" << p_file << "to read";
+        return QString();
+    }
+
+    QByteArray data = file.readAll();
+    int idx = data.indexOf('\n');
+    return VBackupJournal::replay(data.mid(idx + 1));
 }
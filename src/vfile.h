@@ -82,8 +82,10 @@ public:
     // Return backup file of previous session if there exists one.
     QString backupFileOfPreviousSession() const;
 
-    // Write @p_content to backup file.
-    bool writeBackupFile(const QString &p_content);
+    // Write journal @p_data to backup file.
+    // @p_append: append to the backup file written before. Fail if the backup
+    // file does not exist or has been moved.
+    bool writeBackupFile(const QByteArray &p_data, bool p_append = false);
 
     QString readBackupFile(const QString &p_file);
 
@@ -2,6 +2,7 @@
 #include <QtWidgets>
 #include <QUrl>
 #include <QTimer>
+#include <algorithm>
 
 #include "vfilelist.h"
 #include "vconfigmanager.h"
@@ -20,6 +21,9 @@
 #include "utils/viconutils.h"
 #include "dialog/vtipsdialog.h"
 #include "vcart.h"
+#include "vconfigtransaction.h"
+#include "vdirectoryloader.h"
+#include "vcopyengine.h"
 
 extern VConfigManager *g_config;
 extern VNote *g_vnote;
@@ -30,16 +34,40 @@ const QString VFileList::c_copyShortcutSequence = "Ctrl+C";
 const QString VFileList::c_cutShortcutSequence = "Ctrl+X";
 const QString VFileList::c_pasteShortcutSequence = "Ctrl+V";
 
+// Generate a name for a note pasted into @p_dirPath which neither exists nor
+// is planned in @p_engine.
+static QString pastedFileName(const QString &p_dirPath,
+                              const QString &p_fileName,
+                              const VCopyEngine &p_engine)
+{
+    QDir dir(p_dirPath);
+    QString name = VUtils::generateCopiedFileName(p_dirPath, p_fileName, true);
+    while (!p_engine.plannedSource(dir.filePath(name)).isEmpty()) {
+        QFileInfo fi(name);
+        QString copiedName = fi.completeBaseName() + "_copy";
+        if (!fi.suffix().isEmpty()) {
+            copiedName = copiedName + "." + fi.suffix();
+        }
+
+        name = VUtils::generateCopiedFileName(p_dirPath, copiedName, true);
+    }
+
+    return name;
+}
+
 VFileList::VFileList(QWidget *parent)
     : QWidget(parent),
       VNavigationMode(),
-      m_itemClicked(NULL),
       m_fileToCloseInSingleClick(NULL)
 {
     setupUI();
     initShortcuts();
     initActions();
 
+    m_loader = new VDirectoryLoader(this);
+    connect(m_loader, &VDirectoryLoader::directoryLoaded,
+            this, &VFileList::handleDirectoryLoaded);
+
     m_clickTimer = new QTimer(this);
     m_clickTimer->setSingleShot(true);
     m_clickTimer->setInterval(QApplication::doubleClickInterval());
@@ -47,7 +75,7 @@ VFileList::VFileList(QWidget *parent)
     // effect as opening file in current tab.
     connect(m_clickTimer, &QTimer::timeout,
             this, [this]() {
-                m_itemClicked = NULL;
+                m_itemClicked = QPersistentModelIndex();
                 VFile *file = m_fileToCloseInSingleClick;
                 m_fileToCloseInSingleClick = NULL;
 
@@ -60,7 +88,10 @@ VFileList::VFileList(QWidget *parent)
 
 void VFileList::setupUI()
 {
-    fileList = new VListWidget(this);
+    m_model = new VNoteListModel(this);
+
+    fileList = new VListView(this);
+    fileList->setModel(m_model);
     fileList->setContextMenuPolicy(Qt::CustomContextMenu);
     fileList->setSelectionMode(QAbstractItemView::ExtendedSelection);
     fileList->setObjectName("FileList");
@@ -70,9 +101,9 @@ void VFileList::setupUI()
     mainLayout->addWidget(fileList);
     mainLayout->setContentsMargins(0, 0, 0, 0);
 
-    connect(fileList, &QListWidget::customContextMenuRequested,
+    connect(fileList, &QListView::customContextMenuRequested,
             this, &VFileList::contextMenuRequested);
-    connect(fileList, &QListWidget::itemClicked,
+    connect(fileList, &QListView::clicked,
             this, &VFileList::handleItemClicked);
 
     setLayout(mainLayout);
@@ -123,9 +154,9 @@ void VFileList::initActions()
     m_openInReadAct->setToolTip(tr("Open current note in read mode"));
     connect(m_openInReadAct, &QAction::triggered,
             this, [this]() {
-                QListWidgetItem *item = fileList->currentItem();
-                if (item) {
-                    emit fileClicked(getVFile(item), OpenFileMode::Read, true);
+                VNoteFile *file = getVFile(fileList->currentIndex());
+                if (file) {
+                    emit fileClicked(file, OpenFileMode::Read, true);
                 }
             });
 
@@ -134,9 +165,9 @@ void VFileList::initActions()
     m_openInEditAct->setToolTip(tr("Open current note in edit mode"));
     connect(m_openInEditAct, &QAction::triggered,
             this, [this]() {
-                QListWidgetItem *item = fileList->currentItem();
-                if (item) {
-                    emit fileClicked(getVFile(item), OpenFileMode::Edit, true);
+                VNoteFile *file = getVFile(fileList->currentIndex());
+                if (file) {
+                    emit fileClicked(file, OpenFileMode::Edit, true);
                 }
             });
 
@@ -197,7 +228,8 @@ void VFileList::setDirectory(VDirectory *p_directory)
     // be NULL.
     if (m_directory == p_directory) {
         if (!m_directory) {
-            fileList->clearAll();
+            fileList->clearSearch();
+            m_model->setDirectory(NULL);
         }
 
         return;
@@ -205,7 +237,9 @@ void VFileList::setDirectory(VDirectory *p_directory)
 
     m_directory = p_directory;
     if (!m_directory) {
-        fileList->clearAll();
+        stopLoading();
+        fileList->clearSearch();
+        m_model->setDirectory(NULL);
         return;
     }
 
@@ -214,47 +248,82 @@ void VFileList::setDirectory(VDirectory *p_directory)
 
 void VFileList::updateFileList()
 {
-    fileList->clearAll();
-    if (!m_directory->open()) {
+    stopLoading();
+    fileList->clearSearch();
+    if (!m_directory->isOpened()) {
+        // Open it in background and show a placeholder meanwhile.
+        m_model->setDirectory(m_directory);
+        m_model->setLoading(true);
+
+        m_loader->load(QVector<VDirectory *>() << m_directory);
         return;
     }
 
-    const QVector<VNoteFile *> &files = m_directory->getFiles();
-    for (int i = 0; i < files.size(); ++i) {
-        VNoteFile *file = files[i];
-        insertFileListItem(file);
+    m_model->setDirectory(m_directory);
+}
+
+void VFileList::handleDirectoryLoaded(VDirectory *p_dir, bool p_succeeded)
+{
+    if (p_dir != m_directory) {
+        return;
     }
+
+    // Remove the placeholder.
+    m_model->setDirectory(p_succeeded ? m_directory : NULL);
+}
+
+void VFileList::stopLoading()
+{
+    m_loader->cancel();
+}
+
+void VFileList::finishLoading()
+{
+    if (!m_directory || m_directory->isOpened()) {
+        return;
+    }
+
+    m_loader->cancel();
+    m_directory->open();
+    m_model->setDirectory(m_directory);
+}
+
+QModelIndexList VFileList::selectedIndexes() const
+{
+    QModelIndexList indexes = fileList->selectionModel()->selectedRows();
+    std::sort(indexes.begin(), indexes.end());
+    return indexes;
 }
 
 void VFileList::fileInfo()
 {
-    QList<QListWidgetItem *> items = fileList->selectedItems();
-    if (items.size() == 1) {
-        fileInfo(getVFile(items[0]));
+    QModelIndexList indexes = selectedIndexes();
+    if (indexes.size() == 1) {
+        fileInfo(getVFile(indexes[0]));
     }
 }
 
 void VFileList::openFileLocation() const
 {
-    QList<QListWidgetItem *> items = fileList->selectedItems();
-    if (items.size() == 1) {
-        QUrl url = QUrl::fromLocalFile(getVFile(items[0])->fetchBasePath());
+    QModelIndexList indexes = selectedIndexes();
+    if (indexes.size() == 1) {
+        QUrl url = QUrl::fromLocalFile(getVFile(indexes[0])->fetchBasePath());
         QDesktopServices::openUrl(url);
     }
 }
 
 void VFileList::addFileToCart() const
 {
-    QList<QListWidgetItem *> items = fileList->selectedItems();
+    QModelIndexList indexes = selectedIndexes();
     VCart *cart = g_mainWin->getCart();
 
-    for (int i = 0; i < items.size(); ++i) {
-        cart->addFile(getVFile(items[i])->fetchPath());
+    for (int i = 0; i < indexes.size(); ++i) {
+        cart->addFile(getVFile(indexes[i])->fetchPath());
     }
 
     g_mainWin->showStatusMessage(tr("%1 %2 added to Cart")
-                                   .arg(items.size())
-                                   .arg(items.size() > 1 ? tr("notes") : tr("note")));
+                                   .arg(indexes.size())
+                                   .arg(indexes.size() > 1 ? tr("notes") : tr("note")));
 }
 
 void VFileList::fileInfo(VNoteFile *p_file)
@@ -280,61 +349,19 @@ void VFileList::fileInfo(VNoteFile *p_file)
             return;
         }
 
-        QListWidgetItem *item = findItem(p_file);
-        if (item) {
-            fillItem(item, p_file);
-        }
+        m_model->updateFile(p_file);
 
         emit fileUpdated(p_file, UpdateAction::InfoChanged);
     }
 }
 
-void VFileList::fillItem(QListWidgetItem *p_item, const VNoteFile *p_file)
-{
-    qulonglong ptr = (qulonglong)p_file;
-    p_item->setData(Qt::UserRole, ptr);
-    p_item->setToolTip(p_file->getName());
-    p_item->setText(p_file->getName());
-
-    V_ASSERT(sizeof(p_file) <= sizeof(ptr));
-}
-
-QListWidgetItem* VFileList::insertFileListItem(VNoteFile *file, bool atFront)
-{
-    V_ASSERT(file);
-    QListWidgetItem *item = new QListWidgetItem();
-    fillItem(item, file);
-
-    if (atFront) {
-        fileList->insertItem(0, item);
-    } else {
-        fileList->addItem(item);
-    }
-
-    // Qt seems not to update the QListWidget correctly. Manually force it to repaint.
-    fileList->update();
-    return item;
-}
-
 void VFileList::removeFileListItem(VNoteFile *p_file)
 {
     if (!p_file) {
         return;
     }
 
-    QListWidgetItem *item = findItem(p_file);
-    if (!item) {
-        return;
-    }
-
-    int row = fileList->row(item);
-    Q_ASSERT(row >= 0);
-
-    fileList->takeItem(row);
-    delete item;
-
-    // Qt seems not to update the QListWidget correctly. Manually force it to repaint.
-    fileList->update();
+    m_model->removeFile(p_file);
 }
 
 void VFileList::newFile()
@@ -404,11 +431,11 @@ void VFileList::newFile()
             }
         }
 
-        QVector<QListWidgetItem *> items = updateFileListAdded();
-        Q_ASSERT(items.size() == 1);
-        fileList->setCurrentItem(items[0], QItemSelectionModel::ClearAndSelect);
-        // Qt seems not to update the QListWidget correctly. Manually force it to repaint.
-        fileList->update();
+        finishLoading();
+        m_model->refresh();
+        QModelIndex index = m_model->indexOf(file);
+        Q_ASSERT(index.isValid());
+        fileList->selectionModel()->setCurrentIndex(index, QItemSelectionModel::ClearAndSelect);
 
         // Open it in edit mode
         emit fileCreated(file, OpenFileMode::Edit, true);
@@ -428,35 +455,14 @@ void VFileList::newFile()
     }
 }
 
-QVector<QListWidgetItem *> VFileList::updateFileListAdded()
-{
-    QVector<QListWidgetItem *> ret;
-    const QVector<VNoteFile *> &files = m_directory->getFiles();
-    for (int i = 0; i < files.size(); ++i) {
-        VNoteFile *file = files[i];
-        if (i >= fileList->count()) {
-            QListWidgetItem *item = insertFileListItem(file, false);
-            ret.append(item);
-        } else {
-            VNoteFile *itemFile = getVFile(fileList->item(i));
-            if (itemFile != file) {
-                QListWidgetItem *item = insertFileListItem(file, false);
-                ret.append(item);
-            }
-        }
-    }
-
-    return ret;
-}
-
 void VFileList::deleteSelectedFiles()
 {
-    QList<QListWidgetItem *> items = fileList->selectedItems();
-    Q_ASSERT(!items.isEmpty());
+    QModelIndexList indexes = selectedIndexes();
+    Q_ASSERT(!indexes.isEmpty());
 
     QVector<VNoteFile *> files;
-    for (auto const & item : items) {
-        files.push_back(getVFile(item));
+    for (auto const & index : indexes) {
+        files.push_back(getVFile(index));
     }
 
     deleteFiles(files);
@@ -513,6 +519,8 @@ void VFileList::deleteFiles(const QVector<VNoteFile *> &p_files)
             files.push_back((VNoteFile *)item.m_data);
         }
 
+        VConfigTransaction trans;
+
         int nrDeleted = 0;
         for (auto file : files) {
             editArea->closeFile(file, true);
@@ -541,6 +549,11 @@ void VFileList::deleteFiles(const QVector<VNoteFile *> &p_files)
             }
         }
 
+        QString errMsg;
+        if (!commitConfigs(trans, &errMsg)) {
+            showCommitError(errMsg);
+        }
+
         if (nrDeleted > 0) {
             g_mainWin->showStatusMessage(tr("%1 %2 deleted")
                                            .arg(nrDeleted)
@@ -551,7 +564,7 @@ void VFileList::deleteFiles(const QVector<VNoteFile *> &p_files)
 
 void VFileList::contextMenuRequested(QPoint pos)
 {
-    QListWidgetItem *item = fileList->itemAt(pos);
+    VNoteFile *file = getVFile(fileList->indexAt(pos));
     QMenu menu(this);
     menu.setToolTipsVisible(true);
 
@@ -559,28 +572,25 @@ void VFileList::contextMenuRequested(QPoint pos)
         return;
     }
 
-    int selectedSize = fileList->selectedItems().size();
-
-    if (item && selectedSize == 1) {
-        VNoteFile *file = getVFile(item);
-        if (file) {
-            if (file->getDocType() == DocType::Markdown) {
-                menu.addAction(m_openInReadAct);
-                menu.addAction(m_openInEditAct);
-            }
+    int selectedSize = fileList->selectionModel()->selectedRows().size();
 
-            menu.addMenu(m_openWithMenu);
-            menu.addSeparator();
+    if (file && selectedSize == 1) {
+        if (file->getDocType() == DocType::Markdown) {
+            menu.addAction(m_openInReadAct);
+            menu.addAction(m_openInEditAct);
         }
+
+        menu.addMenu(m_openWithMenu);
+        menu.addSeparator();
     }
 
     menu.addAction(newFileAct);
 
-    if (fileList->count() > 1) {
+    if (m_model->rowCount() > 1) {
         menu.addAction(m_sortAct);
     }
 
-    if (item) {
+    if (file) {
         menu.addSeparator();
         menu.addAction(deleteFileAct);
         menu.addAction(copyAct);
@@ -588,14 +598,14 @@ void VFileList::contextMenuRequested(QPoint pos)
     }
 
     if (pasteAvailable()) {
-        if (!item) {
+        if (!file) {
             menu.addSeparator();
         }
 
         menu.addAction(pasteAct);
     }
 
-    if (item) {
+    if (file) {
         menu.addSeparator();
         if (selectedSize == 1) {
             menu.addAction(m_openLocationAct);
@@ -611,26 +621,22 @@ void VFileList::contextMenuRequested(QPoint pos)
     menu.exec(fileList->mapToGlobal(pos));
 }
 
-QListWidgetItem* VFileList::findItem(const VNoteFile *p_file)
+QModelIndex VFileList::findItem(const VNoteFile *p_file)
 {
     if (!p_file || p_file->getDirectory() != m_directory) {
-        return NULL;
+        return QModelIndex();
     }
 
-    int nrChild = fileList->count();
-    for (int i = 0; i < nrChild; ++i) {
-        QListWidgetItem *item = fileList->item(i);
-        if (p_file == getVFile(item)) {
-            return item;
-        }
-    }
+    finishLoading();
 
-    return NULL;
+    return m_model->indexOf(p_file);
 }
 
-void VFileList::handleItemClicked(QListWidgetItem *p_item)
+void VFileList::handleItemClicked(const QModelIndex &p_index)
 {
-    Q_ASSERT(p_item);
+    if (!getVFile(p_index)) {
+        return;
+    }
 
     Qt::KeyboardModifiers modifiers = QGuiApplication::keyboardModifiers();
     if (modifiers != Qt::NoModifier) {
@@ -638,16 +644,16 @@ void VFileList::handleItemClicked(QListWidgetItem *p_item)
     }
 
     m_clickTimer->stop();
-    if (m_itemClicked) {
+    if (m_itemClicked.isValid()) {
         // Timer will not trigger.
-        if (m_itemClicked == p_item) {
+        if (m_itemClicked == p_index) {
             // Double clicked.
-            m_itemClicked = NULL;
+            m_itemClicked = QPersistentModelIndex();
             m_fileToCloseInSingleClick = NULL;
             return;
         } else {
             // Handle previous clicked item as single click.
-            m_itemClicked = NULL;
+            m_itemClicked = QPersistentModelIndex();
             if (m_fileToCloseInSingleClick) {
                 editArea->closeFile(m_fileToCloseInSingleClick, false);
                 m_fileToCloseInSingleClick = NULL;
@@ -655,14 +661,14 @@ void VFileList::handleItemClicked(QListWidgetItem *p_item)
         }
     }
 
-    // Pending @p_item.
+    // Pending @p_index.
     bool singleClickClose = g_config->getSingleClickClosePreviousTab();
     if (singleClickClose) {
-        VFile *file = getVFile(p_item);
+        VFile *file = getVFile(p_index);
         Q_ASSERT(file);
         if (editArea->isFileOpened(file)) {
             // File already opened.
-            activateItem(p_item, true);
+            activateItem(p_index, true);
             return;
         }
 
@@ -676,24 +682,23 @@ void VFileList::handleItemClicked(QListWidgetItem *p_item)
     }
 
     // Activate it.
-    activateItem(p_item, true);
+    activateItem(p_index, true);
 
     if (singleClickClose) {
-        m_itemClicked = p_item;
+        m_itemClicked = p_index;
         m_clickTimer->start();
     }
 }
 
-void VFileList::activateItem(QListWidgetItem *p_item, bool p_restoreFocus)
+void VFileList::activateItem(const QModelIndex &p_index, bool p_restoreFocus)
 {
-    if (!p_item) {
+    VNoteFile *file = getVFile(p_index);
+    if (!file) {
         emit fileClicked(NULL);
         return;
     }
 
-    // Qt seems not to update the QListWidget correctly. Manually force it to repaint.
-    fileList->update();
-    emit fileClicked(getVFile(p_item), g_config->getNoteOpenMode());
+    emit fileClicked(file, g_config->getNoteOpenMode());
 
     if (p_restoreFocus) {
         fileList->setFocus();
@@ -711,6 +716,9 @@ bool VFileList::importFiles(const QStringList &p_files, QString *p_errMsg)
     QString dirPath = m_directory->fetchPath();
     QDir dir(dirPath);
 
+    // Write the folder config only once.
+    VConfigTransaction trans;
+
     int nrImported = 0;
     for (int i = 0; i < p_files.size(); ++i) {
         const QString &file = p_files[i];
@@ -750,6 +758,10 @@ bool VFileList::importFiles(const QStringList &p_files, QString *p_errMsg)
 
     qDebug() << "imported" << nrImported << "files";
 
+    if (!commitConfigs(trans, p_errMsg)) {
+        ret = false;
+    }
+
     updateFileList();
 
     return ret;
@@ -757,14 +769,14 @@ bool VFileList::importFiles(const QStringList &p_files, QString *p_errMsg)
 
 void VFileList::copySelectedFiles(bool p_isCut)
 {
-    QList<QListWidgetItem *> items = fileList->selectedItems();
-    if (items.isEmpty()) {
+    QModelIndexList indexes = selectedIndexes();
+    if (indexes.isEmpty()) {
         return;
     }
 
     QJsonArray files;
-    for (int i = 0; i < items.size(); ++i) {
-        VNoteFile *file = getVFile(items[i]);
+    for (int i = 0; i < indexes.size(); ++i) {
+        VNoteFile *file = getVFile(indexes[i]);
         files.append(file->fetchPath());
     }
 
@@ -819,7 +831,10 @@ void VFileList::pasteFiles(VDirectory *p_destDir,
         return;
     }
 
-    int nrPasted = 0;
+    // Plan all the notes in one engine and copy them at once.
+    VCopyEngine engine(p_isCut);
+    QVector<VNoteCopyPlan> plans;
+    QVector<QString> planFiles;
     for (int i = 0; i < p_files.size(); ++i) {
         VNoteFile *file = g_vnote->getInternalFile(p_files[i]);
         if (!file) {
@@ -865,32 +880,63 @@ void VFileList::pasteFiles(VDirectory *p_destDir,
                     continue;
                 }
             }
+        }
 
-            // Rename it to xxx_copy.md.
-            fileName = VUtils::generateCopiedFileName(file->fetchBasePath(),
-                                                      fileName,
-                                                      true);
-        } else {
-            // Rename it to xxx_copy.md if needed.
-            fileName = VUtils::generateCopiedFileName(p_destDir->fetchPath(),
-                                                      fileName,
-                                                      true);
+        // Rename it to xxx_copy.md if needed.
+        fileName = pastedFileName(p_destDir->fetchPath(), fileName, engine);
+
+        QString msg;
+        VNoteCopyPlan plan;
+        if (!VNoteFile::planCopyFile(p_destDir,
+                                     fileName,
+                                     file,
+                                     p_isCut,
+                                     &engine,
+                                     plan,
+                                     &msg)) {
+            VUtils::showMessage(QMessageBox::Warning,
+                                tr("Warning"),
+                                tr("Fail to copy note <span style=\"%1\">%2</span>.")
+                                  .arg(g_config->c_dataTextStyle)
+                                  .arg(p_files[i]),
+                                msg,
+                                QMessageBox::Ok,
+                                QMessageBox::Ok,
+                                this);
+            continue;
         }
 
+        plans.append(plan);
+        planFiles.append(p_files[i]);
+    }
+
+    if (plans.isEmpty()) {
+        return;
+    }
+
+    engine.exec(tr("%1 %2 %3").arg(p_isCut ? tr("Moving") : tr("Copying"))
+                              .arg(plans.size())
+                              .arg(plans.size() > 1 ? tr("notes") : tr("note")));
+    if (engine.isCanceled()) {
+        // The whole batch has been rolled back.
+        g_mainWin->showStatusMessage(tr("Operation is canceled."));
+        return;
+    }
+
+    // Write each folder config only once.
+    VConfigTransaction trans;
+
+    int nrPasted = 0;
+    for (int i = 0; i < plans.size(); ++i) {
         QString msg;
         VNoteFile *destFile = NULL;
-        bool ret = VNoteFile::copyFile(p_destDir,
-                                       fileName,
-                                       file,
-                                       p_isCut,
-                                       &destFile,
-                                       &msg);
+        bool ret = VNoteFile::finishCopyFile(plans[i], &engine, &destFile, &msg);
         if (!ret) {
             VUtils::showMessage(QMessageBox::Warning,
                                 tr("Warning"),
                                 tr("Fail to copy note <span style=\"%1\">%2</span>.")
                                   .arg(g_config->c_dataTextStyle)
-                                  .arg(p_files[i]),
+                                  .arg(planFiles[i]),
                                 msg,
                                 QMessageBox::Ok,
                                 QMessageBox::Ok,
@@ -903,6 +949,11 @@ void VFileList::pasteFiles(VDirectory *p_destDir,
         }
     }
 
+    QString errMsg;
+    if (!commitConfigs(trans, &errMsg)) {
+        showCommitError(errMsg);
+    }
+
     qDebug() << "pasted" << nrPasted << "files";
     if (nrPasted > 0) {
         g_mainWin->showStatusMessage(tr("%1 %2 pasted")
@@ -914,15 +965,69 @@ void VFileList::pasteFiles(VDirectory *p_destDir,
     getNewMagic();
 }
 
+bool VFileList::commitConfigs(VConfigTransaction &p_trans, QString *p_errMsg)
+{
+    QVector<VDirectory *> failedDirs;
+    if (p_trans.commit(&failedDirs, p_errMsg)) {
+        return true;
+    }
+
+    // Notes in memory do not match the configs on disk any more.
+    bool needUpdate = false;
+    for (auto dir : failedDirs) {
+        bool closed = true;
+        const QVector<VNoteFile *> &files = dir->getFiles();
+        for (auto file : files) {
+            if (!editArea->closeFile(file, false)) {
+                closed = false;
+                break;
+            }
+        }
+
+        if (!closed) {
+            VUtils::addErrMsg(p_errMsg, tr("Folder %1 is not reloaded since its notes are still opened.")
+                                          .arg(dir->fetchPath()));
+            continue;
+        }
+
+        if (dir == m_directory) {
+            stopLoading();
+            needUpdate = true;
+        }
+
+        if (!dir->reloadFiles()) {
+            VUtils::addErrMsg(p_errMsg, tr("Fail to reload folder %1 from disk.")
+                                          .arg(dir->fetchPath()));
+        }
+    }
+
+    if (needUpdate) {
+        updateFileList();
+    }
+
+    return false;
+}
+
+void VFileList::showCommitError(const QString &p_errMsg)
+{
+    VUtils::showMessage(QMessageBox::Warning,
+                        tr("Warning"),
+                        tr("Fail to write the configuration of folders. "
+                           "Affected folders are reloaded from disk."),
+                        p_errMsg,
+                        QMessageBox::Ok,
+                        QMessageBox::Ok,
+                        this);
+}
+
 void VFileList::keyPressEvent(QKeyEvent *p_event)
 {
     if (p_event->key() == Qt::Key_Return) {
-        QListWidgetItem *item = fileList->currentItem();
-        if (item) {
+        QModelIndex index = fileList->currentIndex();
+        VFile *file = getVFile(index);
+        if (file) {
             VFile *fileToClose = NULL;
             if (!(p_event->modifiers() & Qt::ControlModifier)) {
-                VFile *file = getVFile(item);
-                Q_ASSERT(file);
                 if (!editArea->isFileOpened(file)) {
                     VEditTab *tab = editArea->getCurrentTab();
                     if (tab) {
@@ -932,7 +1037,7 @@ void VFileList::keyPressEvent(QKeyEvent *p_event)
 
             }
 
-            activateItem(item, false);
+            activateItem(index, false);
             if (fileToClose) {
                 editArea->closeFile(fileToClose, false);
             }
@@ -954,9 +1059,9 @@ bool VFileList::locateFile(const VNoteFile *p_file)
             return false;
         }
 
-        QListWidgetItem *item = findItem(p_file);
-        if (item) {
-            fileList->setCurrentItem(item, QItemSelectionModel::ClearAndSelect);
+        QModelIndex index = findItem(p_file);
+        if (index.isValid()) {
+            fileList->selectionModel()->setCurrentIndex(index, QItemSelectionModel::ClearAndSelect);
             return true;
         }
     }
@@ -1021,6 +1126,8 @@ bool VFileList::pasteAvailable() const
 
 void VFileList::sortItems()
 {
+    finishLoading();
+
     const QVector<VNoteFile *> &files = m_directory->getFiles();
     if (files.size() < 2) {
         return;
@@ -1131,14 +1238,11 @@ void VFileList::initOpenWithMenu()
 
     connect(defaultAct, &QAction::triggered,
             this, [this]() {
-                QListWidgetItem *item = fileList->currentItem();
-                if (item) {
-                    VNoteFile *file = getVFile(item);
-                    if (file
-                        && (!editArea->isFileOpened(file) || editArea->closeFile(file, false))) {
-                        QUrl url = QUrl::fromLocalFile(file->fetchPath());
-                        QDesktopServices::openUrl(url);
-                    }
+                VNoteFile *file = getVFile(fileList->currentIndex());
+                if (file
+                    && (!editArea->isFileOpened(file) || editArea->closeFile(file, false))) {
+                    QUrl url = QUrl::fromLocalFile(file->fetchPath());
+                    QDesktopServices::openUrl(url);
                 }
             });
 
@@ -1173,18 +1277,15 @@ void VFileList::handleOpenWithActionTriggered()
     QAction *act = static_cast<QAction *>(sender());
     QString cmd = act->data().toString();
 
-    QListWidgetItem *item = fileList->currentItem();
-    if (item) {
-        VNoteFile *file = getVFile(item);
-        if (file
-            && (!g_config->getCloseBeforeExternalEditor()
-                || !editArea->isFileOpened(file)
-                || editArea->closeFile(file, false))) {
-            cmd.replace("%0", file->fetchPath());
-            QProcess *process = new QProcess(this);
-            connect(process, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
-                    process, &QProcess::deleteLater);
-            process->start(cmd);
-        }
+    VNoteFile *file = getVFile(fileList->currentIndex());
+    if (file
+        && (!g_config->getCloseBeforeExternalEditor()
+            || !editArea->isFileOpened(file)
+            || editArea->closeFile(file, false))) {
+        cmd.replace("%0", file->fetchPath());
+        QProcess *process = new QProcess(this);
+        connect(process, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+                process, &QProcess::deleteLater);
+        process->start(cmd);
     }
 }
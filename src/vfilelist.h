@@ -6,20 +6,23 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QPointer>
-#include <QListWidgetItem>
+#include <QModelIndex>
+#include <QPersistentModelIndex>
 #include <QMap>
 #include "vnotebook.h"
 #include "vconstants.h"
 #include "vdirectory.h"
 #include "vnotefile.h"
 #include "vnavigationmode.h"
-#include "vlistwidget.h"
+#include "vlistview.h"
+#include "vnotelistmodel.h"
 
 class QAction;
 class VNote;
-class QListWidget;
 class QPushButton;
 class VEditArea;
+class VDirectoryLoader;
+class VConfigTransaction;
 class QFocusEvent;
 class QLabel;
 class QMenu;
@@ -76,7 +79,7 @@ signals:
 private slots:
     void contextMenuRequested(QPoint pos);
 
-    void handleItemClicked(QListWidgetItem *p_item);
+    void handleItemClicked(const QModelIndex &p_index);
 
     // View and edit information of selected file.
     // Valid only when there is only one selected file.
@@ -111,6 +114,8 @@ private slots:
     // Hanlde Open With action's triggered signal.
     void handleOpenWithActionTriggered();
 
+    void handleDirectoryLoaded(VDirectory *p_dir, bool p_succeeded);
+
 protected:
     void keyPressEvent(QKeyEvent *p_event) Q_DECL_OVERRIDE;
 
@@ -122,35 +127,43 @@ private:
     // Init shortcuts.
     void initShortcuts();
 
-    // Clear and re-fill the list widget according to m_directory.
+    // Reset the model according to m_directory.
+    // The directory will be opened in background if it is not opened yet.
     void updateFileList();
 
-    // Insert a new item into the list widget.
-    // @file: the file represented by the new item.
-    // @atFront: insert at the front or back of the list widget.
-    QListWidgetItem *insertFileListItem(VNoteFile *file, bool atFront = false);
+    // Stop opening the directory in background.
+    void stopLoading();
+
+    // Open the directory at once if it is still loading.
+    // Should be called before accessing rows of the model.
+    void finishLoading();
 
-    // Remove and delete item related to @p_file from list widget.
+    // Remove the row of @p_file from the model.
     void removeFileListItem(VNoteFile *p_file);
 
     // Init actions.
     void initActions();
 
-    // Return the corresponding QListWidgetItem of @p_file.
-    QListWidgetItem *findItem(const VNoteFile *p_file);
+    // Return the corresponding index of @p_file.
+    QModelIndex findItem(const VNoteFile *p_file);
 
     // Paste files given path by @p_files to destination directory @p_destDir.
     void pasteFiles(VDirectory *p_destDir,
                     const QVector<QString> &p_files,
                     bool p_isCut);
 
-    // New items have been added to direcotry. Update file list accordingly.
-    QVector<QListWidgetItem *> updateFileListAdded();
+    // Commit @p_trans. Folders whose configs fail to write will be reloaded
+    // from disk to keep their notes consistent with the configs.
+    // Returns false if any config fails to write.
+    bool commitConfigs(VConfigTransaction &p_trans, QString *p_errMsg = NULL);
 
-    inline QPointer<VNoteFile> getVFile(QListWidgetItem *p_item) const;
+    // Show @p_errMsg of a failed commitConfigs().
+    void showCommitError(const QString &p_errMsg);
 
-    // Fill the info of @p_item according to @p_file.
-    void fillItem(QListWidgetItem *p_item, const VNoteFile *p_file);
+    inline VNoteFile *getVFile(const QModelIndex &p_index) const;
+
+    // Selected indexes in the order of rows.
+    QModelIndexList selectedIndexes() const;
 
     // Generate new magic to m_magicForClipboard.
     int getNewMagic();
@@ -164,10 +177,11 @@ private:
     // Init Open With menu.
     void initOpenWithMenu();
 
-    void activateItem(QListWidgetItem *p_item, bool p_restoreFocus = false);
+    void activateItem(const QModelIndex &p_index, bool p_restoreFocus = false);
 
     VEditArea *editArea;
-    VListWidget *fileList;
+    VListView *fileList;
+    VNoteListModel *m_model;
     QPointer<VDirectory> m_directory;
 
     // Magic number for clipboard operations.
@@ -194,10 +208,12 @@ private:
 
     QTimer *m_clickTimer;
 
-    QListWidgetItem *m_itemClicked;
+    QPersistentModelIndex m_itemClicked;
 
     VFile *m_fileToCloseInSingleClick;
 
+    VDirectoryLoader *m_loader;
+
     static const QString c_infoShortcutSequence;
     static const QString c_copyShortcutSequence;
     static const QString c_cutShortcutSequence;
@@ -209,10 +225,9 @@ inline void VFileList::setEditArea(VEditArea *editArea)
     this->editArea = editArea;
 }
 
-inline QPointer<VNoteFile> VFileList::getVFile(QListWidgetItem *p_item) const
+inline VNoteFile *VFileList::getVFile(const QModelIndex &p_index) const
 {
-    Q_ASSERT(p_item);
-    return (VNoteFile *)p_item->data(Qt::UserRole).toULongLong();
+    return m_model->getFile(p_index);
 }
 
 inline const VDirectory *VFileList::currentDirectory() const
@@ -0,0 +1,264 @@
+#include "vfilewatcher.h"
+
+#include <QFileSystemWatcher>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDir>
+#include <QStorageInfo>
+#include <QTimer>
+#include <QDebug>
+
+#include "vconfigmanager.h"
+
+extern VConfigManager *g_config;
+
+// Delay in ms to coalesce changes.
+static const int c_flushDelay = 200;
+
+// File systems which do not notify changes made by other hosts.
+static const char *c_pollFileSystems[] = {
+    "nfs", "nfs4", "cifs", "smbfs", "smb2", "smb3", "afs", "9p",
+    "fuse.sshfs", "fuse.davfs2", "davfs", "fuse.rclone"
+};
+
+VFileWatcher::VFileWatcher(QObject *p_parent)
+    : QObject(p_parent)
+{
+    m_watcher = new QFileSystemWatcher(this);
+    connect(m_watcher, &QFileSystemWatcher::fileChanged,
+            this, &VFileWatcher::handlePathChanged);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged,
+            this, &VFileWatcher::handlePathChanged);
+
+    m_flushTimer = new QTimer(this);
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(c_flushDelay);
+    connect(m_flushTimer, &QTimer::timeout,
+            this, &VFileWatcher::flushChanges);
+
+    m_pollTimer = new QTimer(this);
+    m_pollTimer->setSingleShot(false);
+    connect(m_pollTimer, &QTimer::timeout,
+            this, &VFileWatcher::poll);
+}
+
+void VFileWatcher::addFile(const QString &p_path)
+{
+    addPath(p_path, false);
+}
+
+void VFileWatcher::removeFile(const QString &p_path)
+{
+    removePath(p_path);
+}
+
+void VFileWatcher::addDirectory(const QString &p_path)
+{
+    addPath(p_path, true);
+}
+
+void VFileWatcher::removeDirectory(const QString &p_path)
+{
+    removePath(p_path);
+}
+
+void VFileWatcher::ignoreOwnWrite(const QString &p_path)
+{
+    auto it = m_paths.find(QDir::cleanPath(p_path));
+    if (it == m_paths.end()) {
+        return;
+    }
+
+    statPath(it.key(), it->m_ownMtime, it->m_ownSize);
+    it->m_ownWritten = true;
+
+    // Polling should not pick it up either.
+    if (it->m_polled) {
+        it->m_mtime = it->m_ownMtime;
+        it->m_size = it->m_ownSize;
+    }
+}
+
+void VFileWatcher::addPath(const QString &p_path, bool p_isDir)
+{
+    if (p_path.isEmpty()) {
+        return;
+    }
+
+    QString path = QDir::cleanPath(p_path);
+    WatchInfo &info = m_paths[path];
+    if (info.m_refs++ > 0) {
+        return;
+    }
+
+    info.m_isDir = p_isDir;
+    watchPath(path, info);
+    updatePollTimer();
+}
+
+void VFileWatcher::removePath(const QString &p_path)
+{
+    QString path = QDir::cleanPath(p_path);
+    auto it = m_paths.find(path);
+    if (it == m_paths.end()) {
+        return;
+    }
+
+    if (--it->m_refs > 0) {
+        return;
+    }
+
+    if (!it->m_polled) {
+        m_watcher->removePath(path);
+    }
+
+    m_paths.erase(it);
+    m_pendingPaths.remove(path);
+    updatePollTimer();
+}
+
+void VFileWatcher::watchPath(const QString &p_path, WatchInfo &p_info)
+{
+    statPath(p_path, p_info.m_mtime, p_info.m_size);
+
+    // A missing path is polled until it comes back.
+    p_info.m_polled = p_info.m_size < 0
+                      || !supportsNotification(p_path)
+                      || !m_watcher->addPath(p_path);
+    if (p_info.m_polled) {
+        qDebug() << "poll path for changes" << p_path;
+    }
+}
+
+void VFileWatcher::handlePathChanged(const QString &p_path)
+{
+    if (!m_paths.contains(p_path)) {
+        return;
+    }
+
+    m_pendingPaths.insert(p_path);
+
+    // Do not restart the timer to avoid starving on continuous changes.
+    if (!m_flushTimer->isActive()) {
+        m_flushTimer->start();
+    }
+}
+
+void VFileWatcher::flushChanges()
+{
+    if (m_pendingPaths.isEmpty()) {
+        return;
+    }
+
+    QStringList watched = m_watcher->files();
+    watched.append(m_watcher->directories());
+
+    QStringList files, dirs;
+    for (auto const & path : m_pendingPaths) {
+        auto it = m_paths.find(path);
+        if (it == m_paths.end()) {
+            continue;
+        }
+
+        // Files replaced or removed are dropped by the system watcher.
+        if (it->m_polled || !watched.contains(path)) {
+            watchPath(path, *it);
+        }
+
+        if (isOwnWrite(path, *it)) {
+            continue;
+        }
+
+        if (it->m_isDir) {
+            dirs.append(path);
+        } else {
+            files.append(path);
+        }
+    }
+
+    m_pendingPaths.clear();
+    updatePollTimer();
+
+    if (!files.isEmpty()) {
+        emit filesChanged(files);
+    }
+
+    if (!dirs.isEmpty()) {
+        emit directoriesChanged(dirs);
+    }
+}
+
+void VFileWatcher::poll()
+{
+    for (auto it = m_paths.begin(); it != m_paths.end(); ++it) {
+        if (!it->m_polled) {
+            continue;
+        }
+
+        qint64 mtime, size;
+        statPath(it.key(), mtime, size);
+        if (mtime != it->m_mtime || size != it->m_size) {
+            it->m_mtime = mtime;
+            it->m_size = size;
+            handlePathChanged(it.key());
+        }
+    }
+}
+
+void VFileWatcher::updatePollTimer()
+{
+    bool needPoll = false;
+    for (auto it = m_paths.constBegin(); it != m_paths.constEnd(); ++it) {
+        if (it->m_polled) {
+            needPoll = true;
+            break;
+        }
+    }
+
+    if (!needPoll) {
+        m_pollTimer->stop();
+    } else if (!m_pollTimer->isActive()) {
+        m_pollTimer->start(g_config->getFileTimerInterval());
+    }
+}
+
+bool VFileWatcher::isOwnWrite(const QString &p_path, const WatchInfo &p_info)
+{
+    if (!p_info.m_ownWritten) {
+        return false;
+    }
+
+    qint64 mtime, size;
+    statPath(p_path, mtime, size);
+    return mtime == p_info.m_ownMtime && size == p_info.m_ownSize;
+}
+
+void VFileWatcher::statPath(const QString &p_path, qint64 &p_mtime, qint64 &p_size)
+{
+    QFileInfo fi(p_path);
+    if (!fi.exists()) {
+        p_mtime = 0;
+        p_size = -1;
+        return;
+    }
+
+    p_mtime = fi.lastModified().toMSecsSinceEpoch();
+    p_size = fi.isDir() ? 0 : fi.size();
+}
+
+bool VFileWatcher::supportsNotification(const QString &p_path)
+{
+    QStorageInfo storage(p_path);
+    if (!storage.isValid()) {
+        return false;
+    }
+
+    QByteArray type = storage.fileSystemType().toLower();
+    for (auto fs : c_pollFileSystems) {
+        if (type == fs) {
+            return false;
+        }
+    }
+
+    return true;
+}
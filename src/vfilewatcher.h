@@ -0,0 +1,113 @@
+#ifndef VFILEWATCHER_H
+#define VFILEWATCHER_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+class QFileSystemWatcher;
+class QTimer;
+
+// Watch files and directories for changes made outside.
+// Paths are reference counted. Changes are coalesced and reported in batch.
+// Paths on file systems without change notification, such as network file
+// systems, or failed to be watched are polled instead.
+// Writes of VNote itself should be marked via ignoreOwnWrite() so that they
+// will not be reported as changes made outside.
+class VFileWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit VFileWatcher(QObject *p_parent = nullptr);
+
+    void addFile(const QString &p_path);
+
+    void removeFile(const QString &p_path);
+
+    void addDirectory(const QString &p_path);
+
+    void removeDirectory(const QString &p_path);
+
+    // Mark @p_path as just written by VNote. Changes of it will not be reported
+    // until its stat differs from the one after this write.
+    void ignoreOwnWrite(const QString &p_path);
+
+signals:
+    // Emit when watched files are modified, replaced, or removed.
+    void filesChanged(const QStringList &p_paths);
+
+    // Emit when entries of watched directories change.
+    void directoriesChanged(const QStringList &p_paths);
+
+private slots:
+    void handlePathChanged(const QString &p_path);
+
+    // Report pending changes.
+    void flushChanges();
+
+    // Check polled paths.
+    void poll();
+
+private:
+    struct WatchInfo
+    {
+        WatchInfo()
+            : m_refs(0),
+              m_isDir(false),
+              m_polled(false),
+              m_mtime(0),
+              m_size(-1),
+              m_ownWritten(false),
+              m_ownMtime(0),
+              m_ownSize(-1)
+        {
+        }
+
+        int m_refs;
+
+        bool m_isDir;
+
+        bool m_polled;
+
+        // Stat of last poll. Size is -1 if it does not exist.
+        qint64 m_mtime;
+        qint64 m_size;
+
+        // Stat after the last write of VNote itself.
+        bool m_ownWritten;
+        qint64 m_ownMtime;
+        qint64 m_ownSize;
+    };
+
+    void addPath(const QString &p_path, bool p_isDir);
+
+    void removePath(const QString &p_path);
+
+    // Watch @p_path via the system or fall back to polling.
+    void watchPath(const QString &p_path, WatchInfo &p_info);
+
+    void updatePollTimer();
+
+    // Whether the change of @p_path is made by VNote itself.
+    static bool isOwnWrite(const QString &p_path, const WatchInfo &p_info);
+
+    static void statPath(const QString &p_path, qint64 &p_mtime, qint64 &p_size);
+
+    // Whether the file system of @p_path supports change notification.
+    static bool supportsNotification(const QString &p_path);
+
+    QHash<QString, WatchInfo> m_paths;
+
+    QFileSystemWatcher *m_watcher;
+
+    // Changed paths waiting to be reported.
+    QSet<QString> m_pendingPaths;
+
+    QTimer *m_flushTimer;
+
+    QTimer *m_pollTimer;
+};
+
+#endif // VFILEWATCHER_H
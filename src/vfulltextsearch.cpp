@@ -0,0 +1,137 @@
+#include "vfulltextsearch.h"
+
+#include <algorithm>
+
+#include <QDebug>
+#include <QDir>
+
+#include "vnote.h"
+#include "vnotebook.h"
+
+extern VNote *g_vnote;
+
+// Whether @p_path is @p_dir or within it.
+static bool isPathInDir(const QString &p_path, const QString &p_dir)
+{
+#if defined(Q_OS_WIN)
+    Qt::CaseSensitivity cs = Qt::CaseInsensitive;
+#else
+    Qt::CaseSensitivity cs = Qt::CaseSensitive;
+#endif
+
+    if (!p_path.startsWith(p_dir, cs)) {
+        return false;
+    }
+
+    return p_path.size() == p_dir.size() || p_path[p_dir.size()] == '/';
+}
+
+VFullTextSearch::VFullTextSearch(QObject *p_parent)
+    : QObject(p_parent)
+{
+}
+
+VSearchIndex *VFullTextSearch::getIndex(const QString &p_notebookPath, bool p_create)
+{
+    QString path = QDir::cleanPath(p_notebookPath);
+    VSearchIndex *index = m_indexes.value(path, NULL);
+    if (!index && p_create) {
+        index = new VSearchIndex(path, this);
+        connect(index, &VSearchIndex::indexUpdated,
+                this, &VFullTextSearch::indexUpdated);
+        m_indexes.insert(path, index);
+        index->init();
+    }
+
+    return index;
+}
+
+void VFullTextSearch::prepare(const VNotebook *p_notebook)
+{
+    if (p_notebook) {
+        getIndex(p_notebook->getPath(), true);
+        return;
+    }
+
+    const QVector<VNotebook *> &notebooks = g_vnote->getNotebooks();
+    for (auto nb : notebooks) {
+        getIndex(nb->getPath(), true);
+    }
+}
+
+bool VFullTextSearch::isReady() const
+{
+    for (auto index : m_indexes) {
+        if (!index->isReady() || index->isBusy()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void VFullTextSearch::removeNotebook(const QString &p_notebookPath)
+{
+    VSearchIndex *index = m_indexes.take(QDir::cleanPath(p_notebookPath));
+    // It will wait for the background tasks.
+    delete index;
+}
+
+void VFullTextSearch::updatePaths(const QStringList &p_paths)
+{
+    // Indexes not created yet will be refreshed as a whole when created.
+    for (auto index : m_indexes) {
+        QStringList paths;
+        for (auto const & path : p_paths) {
+            QString cleanPath = QDir::cleanPath(path);
+            if (isPathInDir(cleanPath, index->getNotebookPath())) {
+                paths.append(cleanPath);
+            }
+        }
+
+        if (!paths.isEmpty()) {
+            index->updatePaths(paths);
+        }
+    }
+}
+
+QVector<VSearchHit> VFullTextSearch::search(const QString &p_query,
+                                            const VNotebook *p_notebook,
+                                            int p_limit)
+{
+    QVector<VSearchHit> hits;
+    QVector<VSearchClause> clauses = VSearchIndex::parseQuery(p_query);
+    if (clauses.isEmpty()) {
+        return hits;
+    }
+
+    prepare(p_notebook);
+
+    QVector<VSearchIndex *> indexes;
+    if (p_notebook) {
+        indexes.append(getIndex(p_notebook->getPath(), false));
+    } else {
+        const QVector<VNotebook *> &notebooks = g_vnote->getNotebooks();
+        for (auto nb : notebooks) {
+            indexes.append(getIndex(nb->getPath(), false));
+        }
+    }
+
+    for (auto index : indexes) {
+        if (index && index->isReady()) {
+            hits += index->search(clauses, p_limit);
+        }
+    }
+
+    // Scores of different notebooks are not comparable strictly, but good
+    // enough to merge.
+    std::stable_sort(hits.begin(), hits.end(), [](const VSearchHit &p_a, const VSearchHit &p_b) {
+        return p_a.m_score > p_b.m_score;
+    });
+
+    if (hits.size() > p_limit) {
+        hits.resize(p_limit);
+    }
+
+    return hits;
+}
@@ -0,0 +1,61 @@
+#ifndef VFULLTEXTSEARCH_H
+#define VFULLTEXTSEARCH_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "vsearchindex.h"
+
+class VNotebook;
+
+// Manage the full-text search indexes of all the notebooks.
+// Indexes are created lazily on first search and kept in sync with the
+// changes of notes and folders done within VNote.
+// Should be used in GUI thread only.
+class VFullTextSearch : public QObject
+{
+    Q_OBJECT
+public:
+    explicit VFullTextSearch(QObject *p_parent = nullptr);
+
+    // Notes or folders @p_paths (absolute) have been added, modified, or removed.
+    void updatePaths(const QStringList &p_paths);
+
+    void updatePath(const QString &p_path);
+
+    // Search @p_query in @p_notebook or all the notebooks if it is NULL.
+    // Return at most @p_limit hits sorted by score.
+    // Hits are not located, see VSearchIndex::locateHits().
+    QVector<VSearchHit> search(const QString &p_query,
+                               const VNotebook *p_notebook,
+                               int p_limit);
+
+    // Make sure indexes of @p_notebook or all the notebooks are created.
+    void prepare(const VNotebook *p_notebook = NULL);
+
+    // Whether all the indexes are loaded and idle.
+    bool isReady() const;
+
+    // Drop the index of notebook @p_notebookPath, which is removed.
+    void removeNotebook(const QString &p_notebookPath);
+
+signals:
+    // Emitted when any index has been updated.
+    void indexUpdated();
+
+private:
+    VSearchIndex *getIndex(const QString &p_notebookPath, bool p_create);
+
+    // Notebook path -> index.
+    QHash<QString, VSearchIndex *> m_indexes;
+};
+
+inline void VFullTextSearch::updatePath(const QString &p_path)
+{
+    updatePaths(QStringList(p_path));
+}
+
+#endif // VFULLTEXTSEARCH_H
@@ -1,14 +1,39 @@
 #include "vimageresourcemanager2.h"
 
+#include "vpreviewimagecache.h"
+
+extern VPreviewImageCache *g_previewImageCache;
 
 VImageResourceManager2::VImageResourceManager2()
 {
 }
 
+VImageResourceManager2::~VImageResourceManager2()
+{
+    clear();
+}
+
 void VImageResourceManager2::addImage(const QString &p_name,
                                       const QPixmap &p_image)
 {
-    m_images.insert(p_name, p_image);
+    Image image;
+    image.m_size = p_image.size();
+    image.m_image = p_image;
+    removeImage(p_name);
+    m_images.insert(p_name, image);
+}
+
+void VImageResourceManager2::addImage(const QString &p_name,
+                                      const QString &p_key,
+                                      const QSize &p_size)
+{
+    Image image;
+    image.m_key = p_key;
+    image.m_size = p_size;
+    // Pin the new one before unpinning the old one which may be the same.
+    g_previewImageCache->pin(p_key);
+    removeImage(p_name);
+    m_images.insert(p_name, image);
 }
 
 bool VImageResourceManager2::contains(const QString &p_name) const
@@ -17,21 +42,51 @@ bool VImageResourceManager2::contains(const QString &p_name) const
 }
 
 const QPixmap *VImageResourceManager2::findImage(const QString &p_name) const
+{
+    auto it = m_images.find(p_name);
+    if (it == m_images.end()) {
+        return NULL;
+    }
+
+    if (it.value().m_key.isEmpty()) {
+        return &it.value().m_image;
+    }
+
+    return g_previewImageCache->find(it.value().m_key);
+}
+
+QSize VImageResourceManager2::imageSize(const QString &p_name) const
 {
     auto it = m_images.find(p_name);
     if (it != m_images.end()) {
-        return &it.value();
+        return it.value().m_size;
     }
 
-    return NULL;
+    return QSize();
 }
 
 void VImageResourceManager2::clear()
 {
+    for (auto it = m_images.constBegin(); it != m_images.constEnd(); ++it) {
+        unpinImage(it.value());
+    }
+
     m_images.clear();
 }
 
 void VImageResourceManager2::removeImage(const QString &p_name)
 {
-    m_images.remove(p_name);
+    auto it = m_images.find(p_name);
+    if (it != m_images.end()) {
+        unpinImage(it.value());
+        m_images.erase(it);
+    }
+}
+
+void VImageResourceManager2::unpinImage(const Image &p_image)
+{
+    // The cache is gone when quitting.
+    if (!p_image.m_key.isEmpty() && g_previewImageCache) {
+        g_previewImageCache->unpin(p_image.m_key);
+    }
 }
@@ -11,23 +11,45 @@ class VImageResourceManager2
 public:
     VImageResourceManager2();
 
+    ~VImageResourceManager2();
+
     // Add an image to the resource with @p_name as the key.
     // If @p_name already exists in the resources, it will update it.
     void addImage(const QString &p_name, const QPixmap &p_image);
 
+    // Add an image held by the shared preview image cache with key @p_key.
+    // Only the key is kept here, which is pinned in the cache until removed.
+    void addImage(const QString &p_name, const QString &p_key, const QSize &p_size);
+
     // Remove image @p_name.
     void removeImage(const QString &p_name);
 
     // Whether the resources contains image with name @p_name.
     bool contains(const QString &p_name) const;
 
+    // Returns NULL if @p_name does not exist or has been evicted from the
+    // shared cache.
     const QPixmap *findImage(const QString &p_name) const;
 
+    QSize imageSize(const QString &p_name) const;
+
     void clear();
 
 private:
+    struct Image
+    {
+        // Key in the shared preview image cache. Empty if @m_image is held.
+        QString m_key;
+
+        QSize m_size;
+
+        QPixmap m_image;
+    };
+
+    void unpinImage(const Image &p_image);
+
     // All the images resources.
-    QHash<QString, QPixmap> m_images;
+    QHash<QString, Image> m_images;
 };
 
 #endif // VIMAGERESOURCEMANAGER2_H
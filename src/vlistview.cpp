@@ -0,0 +1,164 @@
+#include "vlistview.h"
+
+#include <QKeyEvent>
+#include <QSet>
+#include <QScrollBar>
+
+#include "utils/vimnavigationforwidget.h"
+#include "vstyleditemdelegate.h"
+
+VListView::VListView(QWidget *p_parent)
+    : QListView(p_parent),
+      ISimpleSearch()
+{
+    m_searchInput = new VSimpleSearchInput(this, this);
+    connect(m_searchInput, &VSimpleSearchInput::triggered,
+            this, &VListView::handleSearchModeTriggered);
+
+    m_searchInput->hide();
+
+    m_delegate = new VStyledItemDelegate(this);
+    setItemDelegate(m_delegate);
+
+    // Do not measure each item.
+    setUniformItemSizes(true);
+}
+
+void VListView::keyPressEvent(QKeyEvent *p_event)
+{
+    if (m_searchInput->tryHandleKeyPressEvent(p_event)) {
+        return;
+    }
+
+    if (VimNavigationForWidget::injectKeyPressEventForVim(this, p_event)) {
+        return;
+    }
+
+    QListView::keyPressEvent(p_event);
+}
+
+void VListView::clearSearch()
+{
+    m_searchInput->clear();
+    setSearchInputVisible(false);
+
+    m_hitIndexes.clear();
+    m_delegate->clearHitItems();
+}
+
+void VListView::setSearchInputVisible(bool p_visible)
+{
+    m_searchInput->setVisible(p_visible);
+
+    int bottomMargin = 0;
+    if (p_visible) {
+        bottomMargin = m_searchInput->height();
+    }
+
+    setViewportMargins(0, 0, 0, bottomMargin);
+}
+
+void VListView::resizeEvent(QResizeEvent *p_event)
+{
+    QListView::resizeEvent(p_event);
+
+    QRect rect = contentsRect();
+    int width = rect.width();
+    QScrollBar *vbar = verticalScrollBar();
+    if (vbar && (vbar->minimum() != vbar->maximum())) {
+        width -= vbar->width();
+    }
+
+    int y = rect.bottom() - m_searchInput->height();
+    QScrollBar *hbar = horizontalScrollBar();
+    if (hbar && (hbar->minimum() != hbar->maximum())) {
+        y -= hbar->height();
+    }
+
+    m_searchInput->setGeometry(QRect(rect.left(),
+                                     y,
+                                     width,
+                                     m_searchInput->height()));
+}
+
+void VListView::handleSearchModeTriggered(bool p_inSearchMode)
+{
+    setSearchInputVisible(p_inSearchMode);
+    if (!p_inSearchMode) {
+        clearItemsHighlight();
+        setFocus();
+    }
+}
+
+QList<void *> VListView::searchItems(const QString &p_text,
+                                     Qt::MatchFlags p_flags) const
+{
+    m_hitIndexes.clear();
+
+    QList<void *> res;
+    QAbstractItemModel *mo = model();
+    if (!mo || mo->rowCount() == 0) {
+        return res;
+    }
+
+    QModelIndexList indexes = mo->match(mo->index(0, 0),
+                                        Qt::DisplayRole,
+                                        p_text,
+                                        -1,
+                                        p_flags);
+    res.reserve(indexes.size());
+    for (auto const & index : indexes) {
+        void *item = index.internalPointer();
+        if (item) {
+            m_hitIndexes.insert(item, QPersistentModelIndex(index));
+            res.append(item);
+        }
+    }
+
+    return res;
+}
+
+void VListView::highlightHitItems(const QList<void *> &p_items)
+{
+    clearItemsHighlight();
+
+    QSet<QModelIndex> hitIndexes;
+    for (auto it : p_items) {
+        QModelIndex index = m_hitIndexes.value(it);
+        if (index.isValid()) {
+            hitIndexes.insert(index);
+        }
+    }
+
+    if (!hitIndexes.isEmpty()) {
+        m_delegate->setHitItems(hitIndexes);
+        viewport()->update();
+    }
+}
+
+void VListView::clearItemsHighlight()
+{
+    m_delegate->clearHitItems();
+    viewport()->update();
+}
+
+void VListView::selectHitItem(void *p_item)
+{
+    QModelIndex index = m_hitIndexes.value(p_item);
+    if (!selectionModel()) {
+        return;
+    }
+
+    selectionModel()->setCurrentIndex(index, QItemSelectionModel::ClearAndSelect);
+}
+
+int VListView::totalNumberOfItems()
+{
+    return model() ? model()->rowCount() : 0;
+}
+
+void VListView::selectNextItem(bool p_forward)
+{
+    Q_UNUSED(p_forward);
+    Q_ASSERT(false);
+}
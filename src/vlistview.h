@@ -0,0 +1,57 @@
+#ifndef VLISTVIEW_H
+#define VLISTVIEW_H
+
+#include <QListView>
+#include <QHash>
+#include <QPersistentModelIndex>
+
+#include "vsimplesearchinput.h"
+
+class VStyledItemDelegate;
+
+// List view with simple search, the model/view counterpart of VListWidget.
+// Indexes of the model should carry unique internal pointers which are used
+// as the hit items.
+class VListView : public QListView, public ISimpleSearch
+{
+public:
+    explicit VListView(QWidget *p_parent = Q_NULLPTR);
+
+    // Clear the search input and the highlight.
+    void clearSearch();
+
+    // Implement ISimpleSearch.
+    virtual QList<void *> searchItems(const QString &p_text,
+                                      Qt::MatchFlags p_flags) const Q_DECL_OVERRIDE;
+
+    virtual void highlightHitItems(const QList<void *> &p_items) Q_DECL_OVERRIDE;
+
+    virtual void clearItemsHighlight() Q_DECL_OVERRIDE;
+
+    virtual void selectHitItem(void *p_item) Q_DECL_OVERRIDE;
+
+    virtual int totalNumberOfItems() Q_DECL_OVERRIDE;
+
+    virtual void selectNextItem(bool p_forward) Q_DECL_OVERRIDE;
+
+private slots:
+    void handleSearchModeTriggered(bool p_inSearchMode);
+
+protected:
+    void keyPressEvent(QKeyEvent *p_event) Q_DECL_OVERRIDE;
+
+    void resizeEvent(QResizeEvent *p_event) Q_DECL_OVERRIDE;
+
+private:
+    // Show or hide search input.
+    void setSearchInputVisible(bool p_visible);
+
+    VSimpleSearchInput *m_searchInput;
+
+    VStyledItemDelegate *m_delegate;
+
+    // Indexes of the items returned by last searchItems().
+    mutable QHash<void *, QPersistentModelIndex> m_hitIndexes;
+};
+
+#endif // VLISTVIEW_H
@@ -0,0 +1,229 @@
+#include "vlogger.h"
+
+#include <QIODevice>
+#include <QFileInfo>
+#include <QFileDevice>
+#include <QMutexLocker>
+#include <cstdio>
+
+extern VLogger *g_logger;
+
+// Number of slots of the ring buffer, power of 2.
+static const quint32 c_capacity = 4096;
+
+// Max interval in ms between two writes.
+static const unsigned long c_writeInterval = 100;
+
+// Default level of the hot path categories, which is lowered by -d in main().
+#if defined(QT_NO_DEBUG)
+static const QtMsgType c_hotPathLevel = QtInfoMsg;
+#else
+static const QtMsgType c_hotPathLevel = QtDebugMsg;
+#endif
+
+Q_LOGGING_CATEGORY(lcHighlighter, "vnote.highlighter", c_hotPathLevel)
+
+Q_LOGGING_CATEGORY(lcPreview, "vnote.preview", c_hotPathLevel)
+
+VLogger::VLogger(QIODevice *p_device, bool p_withContext)
+    : m_device(p_device),
+      m_withContext(p_withContext),
+      m_slots(new Slot[c_capacity]),
+      m_mask(c_capacity - 1),
+      m_head(0),
+      m_tail(0),
+      m_dropped(0),
+      m_flushRequested(false),
+      m_stopRequested(false)
+{
+    for (quint32 i = 0; i < c_capacity; ++i) {
+        m_slots[i].m_seq.store(i);
+    }
+}
+
+VLogger::~VLogger()
+{
+    stop();
+
+    delete[] m_slots;
+    delete m_device;
+}
+
+void VLogger::install()
+{
+    start(QThread::LowPriority);
+    qInstallMessageHandler(VLogger::messageHandler);
+}
+
+void VLogger::flush()
+{
+    QMutexLocker locker(&m_mutex);
+    m_flushRequested = true;
+    m_cond.wakeOne();
+}
+
+void VLogger::stop()
+{
+    if (g_logger == this) {
+        qInstallMessageHandler(0);
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopRequested = true;
+        m_cond.wakeOne();
+    }
+
+    if (isRunning() && QThread::currentThread() != this) {
+        wait();
+    } else {
+        writeOut();
+    }
+}
+
+void VLogger::run()
+{
+    while (true) {
+        bool stopped = false;
+        {
+            QMutexLocker locker(&m_mutex);
+            if (!m_stopRequested && !m_flushRequested) {
+                m_cond.wait(&m_mutex, c_writeInterval);
+            }
+
+            stopped = m_stopRequested;
+            m_flushRequested = false;
+        }
+
+        writeOut();
+
+        if (stopped) {
+            break;
+        }
+    }
+}
+
+bool VLogger::push(const QByteArray &p_msg)
+{
+    quint32 pos = m_head.load();
+    Slot *slot = NULL;
+    while (true) {
+        slot = &m_slots[pos & m_mask];
+        qint32 diff = (qint32)(slot->m_seq.loadAcquire() - pos);
+        if (diff == 0) {
+            // The slot is free. Try to claim it.
+            if (m_head.testAndSetRelaxed(pos, pos + 1)) {
+                break;
+            }
+
+            pos = m_head.load();
+        } else if (diff < 0) {
+            // The slot is not popped yet. The buffer is full.
+            m_dropped.fetchAndAddRelaxed(1);
+            return false;
+        } else {
+            // Claimed by another producer.
+            pos = m_head.load();
+        }
+    }
+
+    slot->m_data = p_msg;
+    slot->m_seq.storeRelease(pos + 1);
+    return true;
+}
+
+void VLogger::popAll(QByteArray &p_data)
+{
+    while (true) {
+        Slot &slot = m_slots[m_tail & m_mask];
+        if (slot.m_seq.loadAcquire() != m_tail + 1) {
+            // Empty or not finished pushing yet.
+            break;
+        }
+
+        p_data.append(slot.m_data);
+        slot.m_data.clear();
+        slot.m_seq.storeRelease(m_tail + c_capacity);
+        ++m_tail;
+    }
+}
+
+void VLogger::writeOut()
+{
+    QByteArray data;
+    popAll(data);
+
+    int dropped = m_dropped.fetchAndStoreRelaxed(0);
+    if (dropped > 0) {
+        data.append(QString("Warning: %1 log messages dropped\n").arg(dropped).toUtf8());
+    }
+
+    if (data.isEmpty()) {
+        return;
+    }
+
+    m_device->write(data);
+
+    // Flush QFile's buffer.
+    if (QFileDevice *file = qobject_cast<QFileDevice *>(m_device)) {
+        file->flush();
+    }
+}
+
+void VLogger::messageHandler(QtMsgType p_type,
+                             const QMessageLogContext &p_context,
+                             const QString &p_msg)
+{
+    QByteArray header;
+
+    switch (p_type) {
+    case QtDebugMsg:
+        header = "Debug:";
+        break;
+
+    case QtInfoMsg:
+        header = "Info:";
+        break;
+
+    case QtWarningMsg:
+        header = "Warning:";
+        break;
+
+    case QtCriticalMsg:
+        header = "Critical:";
+        break;
+
+    case QtFatalMsg:
+        header = "Fatal:";
+        break;
+
+    default:
+        break;
+    }
+
+    QByteArray line;
+    line.reserve(header.size() + p_msg.size() + 32);
+    line.append(header);
+    if (g_logger && g_logger->m_withContext) {
+        line.append(QString("(%1:%2) ").arg(QFileInfo(p_context.file).fileName())
+                                       .arg(p_context.line).toUtf8());
+    }
+
+    line.append(p_msg.toUtf8());
+    line.append('\n');
+
+    if (g_logger) {
+        g_logger->push(line);
+    } else {
+        fprintf(stderr, "%s", line.constData());
+        fflush(stderr);
+    }
+
+    if (p_type == QtFatalMsg) {
+        if (g_logger) {
+            g_logger->stop();
+        }
+
+        abort();
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef VLOGGER_H
+#define VLOGGER_H
+
+#include <QThread>
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QLoggingCategory>
+
+class QIODevice;
+
+// Categories of the hot paths which log per block or per parse.
+// Use qCDebug() with them so that the message will not even be formatted
+// if the category is disabled.
+// They are disabled in release mode by default and could be enabled via
+// QT_LOGGING_RULES, such as "vnote.highlighter.debug=true".
+Q_DECLARE_LOGGING_CATEGORY(lcHighlighter)
+Q_DECLARE_LOGGING_CATEGORY(lcPreview)
+
+// Asynchronous logger.
+// Producers format the message and push it into a bounded lock-free ring
+// buffer. A background thread writes the pending messages to the device in
+// batches. Messages will be dropped if the buffer is full.
+class VLogger : public QThread
+{
+public:
+    // @p_device: opened device to write to. VLogger takes the ownership.
+    // @p_withContext: whether prepend the file and line of the message.
+    VLogger(QIODevice *p_device, bool p_withContext);
+
+    ~VLogger();
+
+    // Install as the Qt message handler and start the writer.
+    void install();
+
+    // Ask the writer to write out the pending messages now.
+    void flush();
+
+    // Write out all the pending messages and stop the writer.
+    // Will restore the default message handler.
+    void stop();
+
+    static void messageHandler(QtMsgType p_type,
+                               const QMessageLogContext &p_context,
+                               const QString &p_msg);
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    struct Slot
+    {
+        // Sequence number to tell whether the slot is ready to push or pop.
+        QAtomicInteger<quint32> m_seq;
+
+        QByteArray m_data;
+    };
+
+    // Could be called by any thread.
+    // Returns false if the buffer is full.
+    bool push(const QByteArray &p_msg);
+
+    // Pop all the pending messages and append them to @p_data.
+    // Only called by the writer.
+    void popAll(QByteArray &p_data);
+
+    // Pop and write all the pending messages.
+    void writeOut();
+
+    QIODevice *m_device;
+
+    bool m_withContext;
+
+    Slot *m_slots;
+
+    quint32 m_mask;
+
+    // Next position to push.
+    QAtomicInteger<quint32> m_head;
+
+    // Next position to pop. Only accessed by the writer.
+    quint32 m_tail;
+
+    // Number of messages dropped since last write.
+    QAtomicInt m_dropped;
+
+    // Used only to wake up the writer.
+    QMutex m_mutex;
+
+    QWaitCondition m_cond;
+
+    bool m_flushRequested;
+
+    bool m_stopRequested;
+};
+
+#endif // VLOGGER_H
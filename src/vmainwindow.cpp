@@ -37,7 +37,9 @@
 #include "utils/viconutils.h"
 #include "dialog/vtipsdialog.h"
 #include "vcart.h"
+#include "vsearchpanel.h"
 #include "dialog/vexportdialog.h"
+#include "vlogger.h"
 
 extern VConfigManager *g_config;
 
@@ -51,9 +53,7 @@ VWebUtils *g_webUtils;
 
 const int VMainWindow::c_sharedMemTimerInterval = 1000;
 
-#if defined(QT_NO_DEBUG)
-extern QFile g_logFile;
-#endif
+extern VLogger *g_logger;
 
 #define COLOR_PIXMAP_ICON_SIZE 64
 
@@ -1287,6 +1287,9 @@ void VMainWindow::initDockWindows()
     // Cart.
     m_cart = new VCart(this);
 
+    // Full-text search.
+    m_searchPanel = new VSearchPanel(this);
+
     m_toolBox = new VToolBox(this);
     m_toolBox->addItem(outline,
                        ":/resources/icons/outline.svg",
@@ -1297,6 +1300,9 @@ void VMainWindow::initDockWindows()
     m_toolBox->addItem(m_cart,
                        ":/resources/icons/cart.svg",
                        tr("Cart"));
+    m_toolBox->addItem(m_searchPanel,
+                       ":/resources/icons/find_replace.svg",
+                       tr("Search"));
 
     toolDock->setWidget(m_toolBox);
     addDockWidget(Qt::RightDockWidgetArea, toolDock);
@@ -2691,10 +2697,7 @@ bool VMainWindow::flushLogFileByCaptain(void *p_target, void *p_data)
     Q_UNUSED(p_target);
     Q_UNUSED(p_data);
 
-#if defined(QT_NO_DEBUG)
-    // Flush g_logFile.
-    g_logFile.flush();
-#endif
+    g_logger->flush();
 
     return true;
 }
@@ -39,6 +39,7 @@ class VButtonWithWidget;
 class VAttachmentList;
 class VSnippetList;
 class VCart;
+class VSearchPanel;
 class QPrinter;
 
 enum class PanelViewState
@@ -68,6 +69,8 @@ public:
 
     VCart *getCart() const;
 
+    VNotebookSelector *getNotebookSelector() const;
+
     // View and edit the information of @p_file, which is an orphan file.
     void editOrphanFileInfo(VFile *p_file);
 
@@ -324,6 +327,8 @@ private:
     // View and manage cart.
     VCart *m_cart;
 
+    VSearchPanel *m_searchPanel;
+
     VFindReplaceDialog *m_findReplaceDialog;
 
     VVimCmdLineEdit *m_vimCmd;
@@ -453,4 +458,9 @@ inline VCart *VMainWindow::getCart() const
     return m_cart;
 }
 
+inline VNotebookSelector *VMainWindow::getNotebookSelector() const
+{
+    return notebookSelector;
+}
+
 #endif // VMAINWINDOW_H
@@ -4,6 +4,9 @@
 #include <QMimeData>
 #include <QWidget>
 #include <QImageReader>
+#include <QImageWriter>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
 #include <QDir>
 #include <QMessageBox>
 #include <QKeyEvent>
@@ -59,42 +62,40 @@ bool VMdEditOperations::insertImageFromMimeData(const QMimeData *source)
 void VMdEditOperations::insertImageFromQImage(const QString &title, const QString &path,
                                               const QString &folderInLink, const QImage &image)
 {
-    QString fileName = VUtils::generateImageFileName(path, title);
+    QString format = insertImageFormat();
+    QString fileName = VUtils::generateImageFileName(path, title, format);
     QString filePath = QDir(path).filePath(fileName);
     V_ASSERT(!QFile(filePath).exists());
 
-    QString errStr;
-    bool ret = VUtils::makePath(path);
-    if (!ret) {
-        errStr = tr("Fail to create image folder <span style=\"%1\">%2</span>.")
-                   .arg(g_config->c_dataTextStyle).arg(path);
-    } else {
-        ret = image.save(filePath);
-        if (!ret) {
-            errStr = tr("Fail to save image <span style=\"%1\">%2</span>.")
-                       .arg(g_config->c_dataTextStyle).arg(filePath);
-        }
-    }
-
-    if (!ret) {
-        VUtils::showMessage(QMessageBox::Warning, tr("Warning"),
-                            tr("Fail to insert image <span style=\"%1\">%2</span>.").arg(g_config->c_dataTextStyle).arg(title),
-                            errStr,
-                            QMessageBox::Ok,
-                            QMessageBox::Ok,
-                            m_editor->getEditor());
+    if (!VUtils::makePath(path)) {
+        showInsertImageError(title,
+                             tr("Fail to create image folder <span style=\"%1\">%2</span>.")
+                               .arg(g_config->c_dataTextStyle).arg(path));
         return;
     }
 
-    QString url = QString("%1/%2").arg(folderInLink).arg(fileName);
-    QString md = QString("![%1](%2)").arg(title).arg(url);
-    insertTextAtCurPos(md);
+    QSize size = image.size();
+    int maxSize = g_config->getInsertImageMaxSize();
+    if (maxSize > 0 && (size.width() > maxSize || size.height() > maxSize)) {
+        size.scale(maxSize, maxSize, Qt::KeepAspectRatio);
+    }
 
-    qDebug() << "insert image" << title << filePath;
+    int quality = g_config->getInsertImageQuality();
+    if (quality < 0 && format == "webp") {
+        // Lossless.
+        quality = 100;
+    }
 
-    VMdEditor *mdEditor = dynamic_cast<VMdEditor *>(m_editor);
-    Q_ASSERT(mdEditor);
-    mdEditor->imageInserted(filePath, url);
+    // Encoding a large image takes long. Do it in background.
+    QFuture<bool> future = QtConcurrent::run(&VMdEditOperations::saveImage,
+                                             image,
+                                             size,
+                                             filePath,
+                                             format,
+                                             quality);
+    insertImageLink(title, filePath, folderInLink, size, future,
+                    tr("Fail to save image <span style=\"%1\">%2</span>.")
+                      .arg(g_config->c_dataTextStyle).arg(filePath));
 }
 
 void VMdEditOperations::insertImageFromPath(const QString &title, const QString &path,
@@ -104,38 +105,114 @@ void VMdEditOperations::insertImageFromPath(const QString &title, const QString
     QString filePath = QDir(path).filePath(fileName);
     V_ASSERT(!QFile(filePath).exists());
 
-    QString errStr;
-    bool ret = VUtils::makePath(path);
-    if (!ret) {
-        errStr = tr("Fail to create image folder <span style=\"%1\">%2</span>.")
-                   .arg(g_config->c_dataTextStyle).arg(path);
-    } else {
-        ret = QFile::copy(oriImagePath, filePath);
-        if (!ret) {
-            errStr = tr("Fail to copy image <span style=\"%1\">%2</span>.")
-                       .arg(g_config->c_dataTextStyle).arg(filePath);
-        }
-    }
-
-    if (!ret) {
-        VUtils::showMessage(QMessageBox::Warning, tr("Warning"),
-                            tr("Fail to insert image <span style=\"%1\">%2</span>.").arg(g_config->c_dataTextStyle).arg(title),
-                            errStr,
-                            QMessageBox::Ok,
-                            QMessageBox::Ok,
-                            m_editor->getEditor());
+    if (!VUtils::makePath(path)) {
+        showInsertImageError(title,
+                             tr("Fail to create image folder <span style=\"%1\">%2</span>.")
+                               .arg(g_config->c_dataTextStyle).arg(path));
         return;
     }
 
-    QString url = QString("%1/%2").arg(folderInLink).arg(fileName);
-    QString md = QString("![%1](%2)").arg(title).arg(url);
-    insertTextAtCurPos(md);
+    // Only read the header to get the size.
+    QSize size = QImageReader(oriImagePath).size();
 
-    qDebug() << "insert image" << title << filePath;
+    QFuture<bool> future = QtConcurrent::run([oriImagePath, filePath]() {
+                                                 return QFile::copy(oriImagePath, filePath);
+                                             });
+    insertImageLink(title, filePath, folderInLink, size, future,
+                    tr("Fail to copy image <span style=\"%1\">%2</span>.")
+                      .arg(g_config->c_dataTextStyle).arg(filePath));
+}
 
+void VMdEditOperations::insertImageLink(const QString &p_title,
+                                        const QString &p_filePath,
+                                        const QString &p_folderInLink,
+                                        const QSize &p_size,
+                                        const QFuture<bool> &p_future,
+                                        const QString &p_errStr)
+{
     VMdEditor *mdEditor = dynamic_cast<VMdEditor *>(m_editor);
     Q_ASSERT(mdEditor);
-    mdEditor->imageInserted(filePath, url);
+
+    QString url = QString("%1/%2").arg(p_folderInLink).arg(QFileInfo(p_filePath).fileName());
+    QString md = QString("![%1](%2)").arg(p_title).arg(url);
+
+    // Preview a placeholder until the file lands.
+    if (p_size.isValid()) {
+        mdEditor->imageSaving(p_filePath, p_size);
+    }
+    insertTextAtCurPos(md);
+
+    // Track the link to remove it if it fails to save the image.
+    QTextCursor linkCursor = m_editor->textCursorW();
+    linkCursor.setPosition(linkCursor.position() - md.size(), QTextCursor::KeepAnchor);
+
+    qDebug() << "insert image" << p_title << p_filePath;
+
+    mdEditor->imageInserted(p_filePath, url);
+
+    QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished,
+            this, [this, watcher, mdEditor, linkCursor, md, p_title, p_filePath, p_errStr]() {
+                watcher->deleteLater();
+
+                mdEditor->imageSaved(p_filePath);
+                if (!watcher->result()) {
+                    // Leave it alone if it has been edited.
+                    QTextCursor cursor(linkCursor);
+                    if (cursor.selectedText() == md) {
+                        cursor.removeSelectedText();
+                    }
+
+                    showInsertImageError(p_title, p_errStr);
+                }
+            });
+    watcher->setFuture(p_future);
+}
+
+bool VMdEditOperations::saveImage(const QImage &p_image,
+                                  const QSize &p_size,
+                                  const QString &p_filePath,
+                                  const QString &p_format,
+                                  int p_quality)
+{
+    QImage image = p_image;
+    if (image.size() != p_size) {
+        image = image.scaled(p_size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
+    QImageWriter writer(p_filePath, p_format.toLatin1());
+    writer.setQuality(p_quality);
+    if (!writer.write(image)) {
+        qWarning() << "fail to save image" << p_filePath << writer.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+QString VMdEditOperations::insertImageFormat()
+{
+    QString format = g_config->getInsertImageFormat().toLower();
+    if (format == "jpeg") {
+        format = "jpg";
+    }
+
+    if (format.isEmpty()
+        || !QImageWriter::supportedImageFormats().contains(format.toLatin1())) {
+        return "png";
+    }
+
+    return format;
+}
+
+void VMdEditOperations::showInsertImageError(const QString &p_title, const QString &p_errStr)
+{
+    VUtils::showMessage(QMessageBox::Warning, tr("Warning"),
+                        tr("Fail to insert image <span style=\"%1\">%2</span>.").arg(g_config->c_dataTextStyle).arg(p_title),
+                        p_errStr,
+                        QMessageBox::Ok,
+                        QMessageBox::Ok,
+                        m_editor->getEditor());
 }
 
 bool VMdEditOperations::insertImageFromURL(const QUrl &imageUrl)
@@ -171,6 +248,7 @@ bool VMdEditOperations::insertImageFromURL(const QUrl &imageUrl)
     } else {
         // Download it to a QImage
         VDownloader *downloader = new VDownloader(&dialog);
+        downloader->setCacheEnabled(true);
         connect(downloader, &VDownloader::downloadFinished,
                 &dialog, &VInsertImageDialog::imageDownloaded);
         downloader->download(imageUrl.toString());
@@ -6,6 +6,7 @@
 #include <QUrl>
 #include <QImage>
 #include <QTextBlock>
+#include <QFuture>
 #include "veditoperations.h"
 
 class QTimer;
@@ -45,6 +46,33 @@ private:
     void insertImageFromQImage(const QString &title, const QString &path,
                                const QString &folderInLink, const QImage &image);
 
+    // Insert the link of image @p_filePath at once and notify the editor
+    // when @p_future saving it finishes. The link will be removed if
+    // @p_future fails.
+    // @p_size: size of the image once saved.
+    // @p_errStr: message to show if @p_future fails.
+    void insertImageLink(const QString &p_title,
+                         const QString &p_filePath,
+                         const QString &p_folderInLink,
+                         const QSize &p_size,
+                         const QFuture<bool> &p_future,
+                         const QString &p_errStr);
+
+    void showInsertImageError(const QString &p_title, const QString &p_errStr);
+
+    // Scale @p_image to @p_size and save it as @p_filePath.
+    // @p_quality: -1 for the default quality of @p_format.
+    // Thread-safe.
+    static bool saveImage(const QImage &p_image,
+                          const QSize &p_size,
+                          const QString &p_filePath,
+                          const QString &p_format,
+                          int p_quality);
+
+    // Format to save inserted images in. Fall back to PNG if the configured
+    // one is not supported.
+    static QString insertImageFormat();
+
     // Key press handlers.
     bool handleKeyTab(QKeyEvent *p_event);
     bool handleKeyBackTab(QKeyEvent *p_event);
@@ -84,6 +84,8 @@ VMdEditor::VMdEditor(VFile *p_file,
             m_previewMgr, &VPreviewManager::imageLinksUpdated);
     connect(m_previewMgr, &VPreviewManager::requestUpdateImageLinks,
             m_mdHighlighter, &HGMarkdownHighlighter::updateHighlight);
+    connect(this, &VTextEdit::imageMissing,
+            m_previewMgr, &VPreviewManager::handleImageMissing);
 
     m_editOps = new VMdEditOperations(this, m_file);
     connect(m_editOps, &VEditOperations::statusMessage,
@@ -819,6 +821,16 @@ void VMdEditor::imageInserted(const QString &p_path, const QString &p_url)
     m_insertedImages.append(link);
 }
 
+void VMdEditor::imageSaving(const QString &p_path, const QSize &p_size)
+{
+    m_previewMgr->addSavingImage(p_path, p_size);
+}
+
+void VMdEditor::imageSaved(const QString &p_path)
+{
+    m_previewMgr->savingImageFinished(p_path);
+}
+
 bool VMdEditor::scrollToHeader(int p_blockNumber)
 {
     if (p_blockNumber < 0) {
@@ -946,6 +958,8 @@ void VMdEditor::updateTextEditConfig()
 
     setLineLeading(m_config.m_lineDistanceHeight);
 
+    setLazyLayoutThreshold(g_config->getLazyLayoutBlockCount());
+
     setImageLineColor(g_config->getEditorPreviewImageLineFg());
 
     int lineNumber = g_config->getEditorLineNumber();
@@ -1145,6 +1159,8 @@ void VMdEditor::zoomPage(bool p_zoomIn, int p_range)
         it.value().setFontPointSize(size);
     }
 
+    m_mdHighlighter->updateMergedFormats();
+
     m_mdHighlighter->rehighlight();
 }
 
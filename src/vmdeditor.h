@@ -50,6 +50,12 @@ public:
     // @p_url is the URL text within ().
     void imageInserted(const QString &p_path, const QString &p_url);
 
+    // Image @p_path of size @p_size is being saved in background.
+    void imageSaving(const QString &p_path, const QSize &p_size);
+
+    // Image @p_path has been saved or failed to save.
+    void imageSaved(const QString &p_path);
+
     // Scroll to header @p_blockNumber.
     // Return true if @p_blockNumber is valid to scroll to.
     bool scrollToHeader(int p_blockNumber);
@@ -168,6 +174,16 @@ public:
         zoomPage(false, p_range);
     }
 
+    QTextBlock firstVisibleBlockW() const Q_DECL_OVERRIDE
+    {
+        return firstVisibleBlock();
+    }
+
+    QTextBlock lastVisibleBlockW() const Q_DECL_OVERRIDE
+    {
+        return lastVisibleBlock();
+    }
+
 signals:
     // Signal when headers change.
     void headersChanged(const QVector<VTableOfContentItem> &p_headers);
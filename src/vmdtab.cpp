@@ -35,7 +35,8 @@ VMdTab::VMdTab(VFile *p_file, VEditArea *p_editArea,
       m_document(NULL),
       m_mdConType(g_config->getMdConverterType()),
       m_enableHeadingSequence(false),
-      m_backupFileChecked(false)
+      m_backupFileChecked(false),
+      m_backupTextLength(0)
 {
     V_ASSERT(m_file->getDocType() == DocType::Markdown);
 
@@ -973,9 +974,14 @@ void VMdTab::tabIsReady(TabReady p_mode)
     if (m_enableBackupFile
         && m_file->isModifiable()
         && p_mode == TabReady::EditMode) {
+        m_backupJournal.reset();
+        m_backupTextLength = m_editor->document()->characterCount() - 1;
+
         // contentsChanged will be emitted even the content is not changed.
         connect(m_editor->document(), &QTextDocument::contentsChange,
-                this, [this]() {
+                this, [this](int p_position, int p_charsRemoved, int p_charsAdded) {
+                    recordBackupChange(p_position, p_charsRemoved, p_charsAdded);
+
                     if (m_isEditMode) {
                         m_backupTimer->stop();
                         m_backupTimer->start();
@@ -984,10 +990,49 @@ void VMdTab::tabIsReady(TabReady p_mode)
     }
 }
 
+void VMdTab::recordBackupChange(int p_position, int p_charsRemoved, int p_charsAdded)
+{
+    Q_UNUSED(p_charsAdded);
+    QTextDocument *doc = m_editor->document();
+    int length = doc->characterCount() - 1;
+
+    // Counts may cover the last block separator which is not in the plain text,
+    // so derive the added count from the change of length.
+    int removed = qMin(p_charsRemoved, m_backupTextLength - p_position);
+    int added = length - (m_backupTextLength - removed);
+    m_backupTextLength = length;
+    if (p_position < 0 || removed < 0 || added < 0 || p_position + added > length) {
+        m_backupJournal.reset();
+        return;
+    }
+
+    QTextCursor cursor(doc);
+    cursor.setPosition(p_position);
+    cursor.setPosition(p_position + added, QTextCursor::KeepAnchor);
+
+    // Keep the same as toPlainText().
+    QString text = cursor.selectedText();
+    text.replace(QChar::ParagraphSeparator, '\n');
+    text.replace(QChar::LineSeparator, '\n');
+    text.replace(QChar::Nbsp, ' ');
+
+    m_backupJournal.addChange(p_position, removed, text);
+}
+
 void VMdTab::writeBackupFile()
 {
     Q_ASSERT(m_enableBackupFile && m_file->isModifiable());
-    m_file->writeBackupFile(m_editor->getContent());
+    if (!m_backupJournal.needSnapshot()) {
+        if (!m_backupJournal.hasChanges()
+            || m_file->writeBackupFile(m_backupJournal.takeChanges(), true)) {
+            return;
+        }
+
+        // Backup file is gone or moved. Start over.
+        m_backupJournal.reset();
+    }
+
+    m_file->writeBackupFile(m_backupJournal.takeSnapshot(m_editor->getContent()));
 }
 
 bool VMdTab::checkPreviousBackupFile()
@@ -7,6 +7,7 @@
 #include "vconstants.h"
 #include "vmarkdownconverter.h"
 #include "vconfigmanager.h"
+#include "vbackupjournal.h"
 
 class VWebView;
 class QStackedLayout;
@@ -203,6 +204,9 @@ private:
     // updateStatus() with only cursor position information.
     void updateCursorStatus();
 
+    // Record the change of the document to the backup journal.
+    void recordBackupChange(int p_position, int p_charsRemoved, int p_charsAdded);
+
     void textToHtmlViaWebView(const QString &p_text);
 
     bool executeVimCommandInWebView(const QString &p_cmd);
@@ -222,6 +226,12 @@ private:
 
     bool m_backupFileChecked;
 
+    // Changes to write to backup file.
+    VBackupJournal m_backupJournal;
+
+    // Length of the plain text of the document known by m_backupJournal.
+    int m_backupTextLength;
+
     // Used to scroll to the header of edit mode in read mode.
     VHeaderPointer m_headerFromEditMode;
 
@@ -4,6 +4,7 @@
 #include <QLabel>
 #include <QListWidget>
 #include <QTreeWidget>
+#include <QListView>
 #include <QScrollBar>
 
 #include "vnote.h"
@@ -171,6 +172,7 @@ void VNavigationMode::showNavigation(QTreeWidget *p_widget)
 void VNavigationMode::clearNavigation()
 {
     m_keyMap.clear();
+    m_indexKeyMap.clear();
     for (auto label : m_naviLabels) {
         delete label;
     }
@@ -209,3 +211,90 @@ bool VNavigationMode::handleKeyNavigation(QTreeWidget *p_widget,
 
     return ret;
 }
+
+void VNavigationMode::showNavigation(QListView *p_widget)
+{
+    clearNavigation();
+
+    if (!p_widget->isVisible()) {
+        return;
+    }
+
+    // Generate labels for visible items.
+    auto items = getVisibleItems(p_widget);
+    for (int i = 0; i < 26 && i < items.size(); ++i) {
+        QChar key('a' + i);
+        m_indexKeyMap[key] = items[i];
+
+        QString str = QString(m_majorKey) + key;
+        QLabel *label = new QLabel(str, p_widget);
+        label->setStyleSheet(g_vnote->getNavigationLabelStyle(str));
+        label->show();
+        QRect rect = p_widget->visualRect(items[i]);
+        // Display the label at the end to show the file name.
+        int extraWidth = label->width() + 2;
+        QScrollBar *vbar = p_widget->verticalScrollBar();
+        if (vbar && vbar->minimum() != vbar->maximum()) {
+            extraWidth += vbar->width();
+        }
+
+        label->move(rect.x() + p_widget->rect().width() - extraWidth,
+                    rect.y());
+
+        m_naviLabels.append(label);
+    }
+}
+
+QList<QModelIndex> VNavigationMode::getVisibleItems(const QListView *p_widget) const
+{
+    QList<QModelIndex> items;
+    QRect viewRect = p_widget->viewport()->rect();
+    QModelIndex index = p_widget->indexAt(viewRect.topLeft());
+    while (index.isValid()) {
+        QRect rect = p_widget->visualRect(index);
+        if (!rect.intersects(viewRect)) {
+            break;
+        }
+
+        if (!p_widget->isRowHidden(index.row())) {
+            items.append(index);
+        }
+
+        index = index.sibling(index.row() + 1, 0);
+    }
+
+    return items;
+}
+
+bool VNavigationMode::handleKeyNavigation(QListView *p_widget,
+                                          bool &p_secondKey,
+                                          int p_key,
+                                          bool &p_succeed)
+{
+    bool ret = false;
+    p_succeed = false;
+    QChar keyChar = VUtils::keyToChar(p_key);
+    if (p_secondKey && !keyChar.isNull()) {
+        p_secondKey = false;
+        p_succeed = true;
+        ret = true;
+        auto it = m_indexKeyMap.find(keyChar);
+        if (it != m_indexKeyMap.end() && it.value().isValid()) {
+            p_widget->selectionModel()->setCurrentIndex(it.value(),
+                                                        QItemSelectionModel::ClearAndSelect);
+            p_widget->setFocus();
+        }
+    } else if (keyChar == m_majorKey) {
+        // Major key pressed.
+        // Need second key if m_indexKeyMap is not empty.
+        if (m_indexKeyMap.isEmpty()) {
+            p_succeed = true;
+        } else {
+            p_secondKey = true;
+        }
+
+        ret = true;
+    }
+
+    return ret;
+}
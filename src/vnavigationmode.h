@@ -5,10 +5,12 @@
 #include <QVector>
 #include <QMap>
 #include <QList>
+#include <QPersistentModelIndex>
 
 class QLabel;
 class QListWidget;
 class QListWidgetItem;
+class QListView;
 class QTreeWidget;
 class QTreeWidgetItem;
 
@@ -38,6 +40,8 @@ protected:
 
     void showNavigation(QTreeWidget *p_widget);
 
+    void showNavigation(QListView *p_widget);
+
     bool handleKeyNavigation(QListWidget *p_widget,
                              bool &p_secondKey,
                              int p_key,
@@ -48,17 +52,28 @@ protected:
                              int p_key,
                              bool &p_succeed);
 
+    bool handleKeyNavigation(QListView *p_widget,
+                             bool &p_secondKey,
+                             int p_key,
+                             bool &p_succeed);
+
     QChar m_majorKey;
 
     // Map second key to item.
     QMap<QChar, void *> m_keyMap;
 
+    // Map second key to index for views.
+    QMap<QChar, QPersistentModelIndex> m_indexKeyMap;
+
     QVector<QLabel *> m_naviLabels;
 
 private:
     QList<QListWidgetItem *> getVisibleItems(const QListWidget *p_widget) const;
 
     QList<QTreeWidgetItem *> getVisibleItems(const QTreeWidget *p_widget) const;
+
+    // Only items within the viewport.
+    QList<QModelIndex> getVisibleItems(const QListView *p_widget) const;
 };
 
 #endif // VNAVIGATIONMODE_H
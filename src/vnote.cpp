@@ -13,6 +13,7 @@
 #include "vorphanfile.h"
 #include "vnotefile.h"
 #include "vpalette.h"
+#include "vnotebookmetacache.h"
 
 extern VConfigManager *g_config;
 
@@ -21,6 +22,21 @@ extern VPalette *g_palette;
 // Meta word manager.
 VMetaWordManager *g_mwMgr;
 
+// Code block highlight cache.
+VCodeBlockHighlightCache *g_codeBlockHLCache;
+
+// Preview image cache.
+VPreviewImageCache *g_previewImageCache;
+
+// Full-text search.
+VFullTextSearch *g_fullTextSearch;
+
+// File watcher.
+VFileWatcher *g_fileWatcher;
+
+// Download cache.
+VDownloadCache *g_downloadCache;
+
 QString VNote::s_simpleHtmlTemplate;
 
 QString VNote::s_markdownTemplate;
@@ -61,6 +77,10 @@ const QString VNote::c_markdownGuideDocFile = "markdown_guide.md";
 VNote::VNote(QObject *parent)
     : QObject(parent)
 {
+    g_fileWatcher = &m_fileWatcher;
+    connect(&m_fileWatcher, &VFileWatcher::filesChanged,
+            this, &VNote::handleWatchedFilesChanged);
+
     initTemplate();
 
     g_config->getNotebooks(m_notebooks, this);
@@ -68,6 +88,28 @@ VNote::VNote(QObject *parent)
     m_metaWordMgr.init();
 
     g_mwMgr = &m_metaWordMgr;
+
+    m_codeBlockHLCache.init();
+
+    g_codeBlockHLCache = &m_codeBlockHLCache;
+
+    m_previewImageCache.init();
+
+    g_previewImageCache = &m_previewImageCache;
+
+    g_fullTextSearch = &m_fullTextSearch;
+
+    m_downloadCache.init();
+
+    g_downloadCache = &m_downloadCache;
+}
+
+VNote::~VNote()
+{
+    // Tabs and downloaders may be destroyed later.
+    g_fileWatcher = NULL;
+    g_downloadCache = NULL;
+    g_previewImageCache = NULL;
 }
 
 void VNote::initTemplate()
@@ -327,3 +369,19 @@ void VNote::freeOrphanFiles()
         }
     }
 }
+
+void VNote::handleWatchedFilesChanged(const QStringList &p_paths)
+{
+    for (auto const & path : p_paths) {
+        QFileInfo fi(path);
+        if (fi.fileName() != VConfigManager::getDirConfigFileName()) {
+            continue;
+        }
+
+        VDirectory *dir = getInternalDirectory(fi.absolutePath());
+        if (dir) {
+            qDebug() << "folder config changed outside" << path;
+            dir->getNotebook()->getMetaCache()->invalidate(dir->fetchPath());
+        }
+    }
+}
@@ -13,6 +13,11 @@
 #include "vnotebook.h"
 #include "vconstants.h"
 #include "utils/vmetawordmanager.h"
+#include "vcodeblockhighlightcache.h"
+#include "vpreviewimagecache.h"
+#include "vfulltextsearch.h"
+#include "vfilewatcher.h"
+#include "vdownloadcache.h"
 
 class VOrphanFile;
 class VNoteFile;
@@ -24,6 +29,8 @@ class VNote : public QObject
 public:
     VNote(QObject *parent = 0);
 
+    ~VNote();
+
     const QVector<VNotebook *> &getNotebooks() const;
     QVector<VNotebook *> &getNotebooks();
 
@@ -111,6 +118,10 @@ public slots:
 
     void updateSimpletHtmlTemplate();
 
+private slots:
+    // Drop cached configs of folders changed outside.
+    void handleWatchedFilesChanged(const QStringList &p_paths);
+
 private:
     const QString &getMonospacedFont() const;
 
@@ -119,6 +130,21 @@ private:
 
     VMetaWordManager m_metaWordMgr;
 
+    // Cache of code block highlight results shared by all editors.
+    VCodeBlockHighlightCache m_codeBlockHLCache;
+
+    // Cache of decoded preview images shared by all editors.
+    VPreviewImageCache m_previewImageCache;
+
+    // Full-text search indexes of all notebooks.
+    VFullTextSearch m_fullTextSearch;
+
+    // Watcher of opened notes, their folder configs, and notebook roots.
+    VFileWatcher m_fileWatcher;
+
+    // Disk cache of downloaded images shared by all downloaders.
+    VDownloadCache m_downloadCache;
+
     // Hold all external file: Orphan File.
     // Need to clean up periodly.
     QList<VOrphanFile *> m_externalFiles;
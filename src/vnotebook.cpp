@@ -5,14 +5,20 @@
 #include "utils/vutils.h"
 #include "vconfigmanager.h"
 #include "vnotefile.h"
+#include "vconfigtransaction.h"
+#include "vnotebookmetacache.h"
+#include "vfulltextsearch.h"
 
 extern VConfigManager *g_config;
 
+extern VFullTextSearch *g_fullTextSearch;
+
 VNotebook::VNotebook(const QString &name, const QString &path, QObject *parent)
     : QObject(parent), m_name(name), m_valid(false)
 {
     m_path = QDir::cleanPath(path);
     m_recycleBinFolder = g_config->getRecycleBinFolder();
+    m_metaCache = new VNotebookMetaCache(m_path, this);
     m_rootDir = new VDirectory(this,
                                NULL,
                                VUtils::directoryNameFromPath(path),
@@ -26,7 +32,7 @@ VNotebook::~VNotebook()
 
 bool VNotebook::readConfigNotebook()
 {
-    QJsonObject configJson = VConfigManager::readDirectoryConfig(m_path);
+    QJsonObject configJson = m_metaCache->readDirectoryConfig(m_path);
     if (configJson.isEmpty()) {
         qWarning() << "fail to read notebook configuration" << m_path;
         m_valid = false;
@@ -95,14 +101,18 @@ QJsonObject VNotebook::toConfigJson() const
 
 bool VNotebook::writeToConfig() const
 {
-    return VConfigManager::writeDirectoryConfig(m_path, toConfigJson());
+    return m_metaCache->writeDirectoryConfig(m_path, toConfigJson());
 }
 
 bool VNotebook::writeConfigNotebook() const
 {
+    if (VConfigTransaction::deferNotebook(this)) {
+        return true;
+    }
+
     QJsonObject nbJson = toConfigJsonNotebook();
 
-    QJsonObject configJson = VConfigManager::readDirectoryConfig(m_path);
+    QJsonObject configJson = m_metaCache->readDirectoryConfig(m_path);
     if (configJson.isEmpty()) {
         qWarning() << "fail to read notebook configuration" << m_path;
         return false;
@@ -112,7 +122,7 @@ bool VNotebook::writeConfigNotebook() const
         configJson[it.key()] = it.value();
     }
 
-    return VConfigManager::writeDirectoryConfig(m_path, configJson);
+    return m_metaCache->writeDirectoryConfig(m_path, configJson);
 }
 
 const QString &VNotebook::getName() const
@@ -142,7 +152,11 @@ bool VNotebook::open()
         }
     }
 
-    return m_rootDir->open();
+    if (!m_rootDir->open()) {
+        return false;
+    }
+
+    return true;
 }
 
 VNotebook *VNotebook::createNotebook(const QString &p_name,
@@ -215,6 +229,8 @@ bool VNotebook::deleteNotebook(VNotebook *p_notebook, bool p_deleteFiles)
             ret = false;
         }
 
+        p_notebook->getMetaCache()->clear();
+
         // Delete the config file.
         if (!VConfigManager::deleteDirectoryConfig(p_notebook->getPath())) {
             ret = false;
@@ -231,9 +247,15 @@ bool VNotebook::deleteNotebook(VNotebook *p_notebook, bool p_deleteFiles)
     }
 
 exit:
+    QString path = p_notebook->getPath();
+
     p_notebook->close();
     delete p_notebook;
 
+    // Drop the caches of the notebook in the config folder.
+    g_fullTextSearch->removeNotebook(path);
+    QDir(g_config->getNotebookCacheFolder(path)).removeRecursively();
+
     return ret;
 }
 
@@ -8,6 +8,7 @@
 class VDirectory;
 class VFile;
 class VNoteFile;
+class VNotebookMetaCache;
 
 class VNotebook : public QObject
 {
@@ -48,6 +49,9 @@ public:
 
     VDirectory *getRootDir() const;
 
+    // Cache of the configs of all the directories.
+    VNotebookMetaCache *getMetaCache() const;
+
     void rename(const QString &p_name);
 
     static VNotebook *createNotebook(const QString &p_name,
@@ -121,6 +125,8 @@ private:
     // Parent is NULL for root directory
     VDirectory *m_rootDir;
 
+    VNotebookMetaCache *m_metaCache;
+
     // Whether this notebook is valid.
     // Will set to true after readConfigNotebook().
     bool m_valid;
@@ -131,6 +137,11 @@ inline VDirectory *VNotebook::getRootDir() const
     return m_rootDir;
 }
 
+inline VNotebookMetaCache *VNotebook::getMetaCache() const
+{
+    return m_metaCache;
+}
+
 inline const QString &VNotebook::getRecycleBinFolder() const
 {
     return m_recycleBinFolder;
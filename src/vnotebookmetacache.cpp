@@ -0,0 +1,404 @@
+#include "vnotebookmetacache.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QTimer>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "vconfigmanager.h"
+#include "utils/vutils.h"
+#include "vfilewatcher.h"
+
+extern VConfigManager *g_config;
+
+extern VFileWatcher *g_fileWatcher;
+
+// Name of the snapshot file in the cache folder of the notebook.
+static const QString c_snapshotFile = "meta.dat";
+
+// Magic and version of the snapshot file.
+static const quint32 c_snapshotMagic = 0x564d4554;
+
+static const quint32 c_snapshotVersion = 1;
+
+// Delay in ms to save the snapshot after changes.
+static const int c_saveInterval = 5000;
+
+// Time in ms since the validation starts to trust the validated entries.
+// The config files may be changed outside later.
+static const qint64 c_validationLifetime = 30000;
+
+VNotebookMetaCache::VNotebookMetaCache(const QString &p_notebookPath, QObject *p_parent)
+    : QObject(p_parent),
+      m_notebookPath(QDir::cleanPath(p_notebookPath)),
+      m_loaded(false),
+      m_dirty(false)
+{
+    m_snapshotFile = QDir(g_config->getNotebookCacheFolder(m_notebookPath)).filePath(c_snapshotFile);
+
+    m_validateWatcher = new QFutureWatcher<QSet<QString> >(this);
+    connect(m_validateWatcher, &QFutureWatcher<QSet<QString> >::finished,
+            this, &VNotebookMetaCache::handleValidationFinished);
+
+    m_saveTimer = new QTimer(this);
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(c_saveInterval);
+    connect(m_saveTimer, &QTimer::timeout,
+            this, &VNotebookMetaCache::save);
+}
+
+VNotebookMetaCache::~VNotebookMetaCache()
+{
+    m_validateWatcher->waitForFinished();
+    m_saveFuture.waitForFinished();
+
+    if (m_dirty) {
+        writeSnapshot(m_snapshotFile, m_entries);
+    }
+}
+
+void VNotebookMetaCache::load()
+{
+    if (m_loaded) {
+        return;
+    }
+
+    m_loaded = true;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!readSnapshot(m_snapshotFile, m_entries)) {
+        m_entries.clear();
+        return;
+    }
+
+    qDebug() << "notebook meta snapshot of" << m_notebookPath << "loaded in"
+             << timer.elapsed() << "ms" << m_entries.size() << "folders";
+
+    // Validate all the entries in background.
+    m_validatingEntries = m_entries;
+    m_validationTimer.start();
+    m_validateWatcher->setFuture(QtConcurrent::run(&VNotebookMetaCache::validate,
+                                                   m_notebookPath,
+                                                   m_validatingEntries));
+}
+
+bool VNotebookMetaCache::relativePath(const QString &p_path, QString &p_relativePath) const
+{
+    QString path = QDir::cleanPath(QDir(m_notebookPath).relativeFilePath(p_path));
+    if (path == ".") {
+        path.clear();
+    } else if (path.startsWith("../") || path == ".." || QDir::isAbsolutePath(path)) {
+        return false;
+    }
+
+    p_relativePath = path;
+    return true;
+}
+
+QJsonObject VNotebookMetaCache::readDirectoryConfig(const QString &p_path)
+{
+    QString relPath;
+    if (!relativePath(p_path, relPath)) {
+        return VConfigManager::readDirectoryConfig(p_path);
+    }
+
+    load();
+
+    auto it = m_entries.find(relPath);
+    if (it != m_entries.end()) {
+        if (isUpToDate(*it, p_path)) {
+            // Check it again next time since it may be changed outside.
+            it->m_validated = false;
+            QJsonObject json = QJsonDocument::fromJson(it->m_config).object();
+            if (!json.isEmpty()) {
+                return json;
+            }
+        }
+
+        m_entries.erase(it);
+        scheduleSave();
+    }
+
+    QJsonObject json = VConfigManager::readDirectoryConfig(p_path);
+    if (!json.isEmpty()) {
+        updateEntry(relPath, p_path, json);
+    }
+
+    return json;
+}
+
+bool VNotebookMetaCache::writeDirectoryConfig(const QString &p_path, const QJsonObject &p_json)
+{
+    if (!VConfigManager::writeDirectoryConfig(p_path, p_json)) {
+        invalidate(p_path);
+        return false;
+    }
+
+    if (g_fileWatcher) {
+        g_fileWatcher->ignoreOwnWrite(VConfigManager::fetchDirConfigFilePath(p_path));
+    }
+
+    QString relPath;
+    if (relativePath(p_path, relPath)) {
+        load();
+        updateEntry(relPath, p_path, p_json);
+    }
+
+    return true;
+}
+
+void VNotebookMetaCache::invalidate(const QString &p_path)
+{
+    QString relPath;
+    if (relativePath(p_path, relPath) && m_entries.remove(relPath) > 0) {
+        scheduleSave();
+    }
+}
+
+bool VNotebookMetaCache::peek(const QString &p_path, QJsonObject &p_json)
+{
+    QString relPath;
+    if (!relativePath(p_path, relPath)) {
+        return false;
+    }
+
+    load();
+
+    auto it = m_entries.find(relPath);
+    if (it == m_entries.end() || !isUpToDate(*it, p_path)) {
+        return false;
+    }
+
+    p_json = QJsonDocument::fromJson(it->m_config).object();
+    if (p_json.isEmpty()) {
+        return false;
+    }
+
+    it->m_validated = false;
+    return true;
+}
+
+void VNotebookMetaCache::insert(const QString &p_path,
+                                const QJsonObject &p_json,
+                                qint64 p_mtime,
+                                qint64 p_size)
+{
+    QString relPath;
+    if (!relativePath(p_path, relPath)) {
+        return;
+    }
+
+    load();
+
+    VDirMetaEntry entry;
+    entry.m_mtime = p_mtime;
+    entry.m_size = p_size;
+    entry.m_config = QJsonDocument(p_json).toJson(QJsonDocument::Compact);
+    m_entries.insert(relPath, entry);
+    scheduleSave();
+}
+
+void VNotebookMetaCache::clear()
+{
+    m_saveTimer->stop();
+    m_validateWatcher->waitForFinished();
+    m_saveFuture.waitForFinished();
+
+    m_entries.clear();
+    m_validatingEntries.clear();
+    m_dirty = false;
+    m_loaded = true;
+
+    QFile::remove(m_snapshotFile);
+}
+
+bool VNotebookMetaCache::isUpToDate(const VDirMetaEntry &p_entry, const QString &p_path) const
+{
+    if (p_entry.m_validated
+        && m_validationTimer.isValid()
+        && m_validationTimer.elapsed() < c_validationLifetime) {
+        return true;
+    }
+
+    qint64 mtime = 0, size = 0;
+    return statConfig(p_path, mtime, size)
+           && mtime == p_entry.m_mtime
+           && size == p_entry.m_size;
+}
+
+void VNotebookMetaCache::updateEntry(const QString &p_relativePath,
+                                     const QString &p_path,
+                                     const QJsonObject &p_json)
+{
+    VDirMetaEntry entry;
+    if (!statConfig(p_path, entry.m_mtime, entry.m_size)) {
+        // Maybe using the obsolete config file.
+        if (m_entries.remove(p_relativePath) > 0) {
+            scheduleSave();
+        }
+
+        return;
+    }
+
+    entry.m_config = QJsonDocument(p_json).toJson(QJsonDocument::Compact);
+    m_entries.insert(p_relativePath, entry);
+    scheduleSave();
+}
+
+void VNotebookMetaCache::scheduleSave()
+{
+    m_dirty = true;
+    m_saveTimer->start();
+}
+
+void VNotebookMetaCache::save()
+{
+    if (!m_dirty) {
+        return;
+    }
+
+    if (m_saveFuture.isRunning()) {
+        m_saveTimer->start();
+        return;
+    }
+
+    m_dirty = false;
+    m_saveFuture = QtConcurrent::run(&VNotebookMetaCache::writeSnapshot,
+                                     m_snapshotFile,
+                                     m_entries);
+}
+
+void VNotebookMetaCache::handleValidationFinished()
+{
+    QSet<QString> validPaths = m_validateWatcher->result();
+    for (auto it = m_validatingEntries.constBegin(); it != m_validatingEntries.constEnd(); ++it) {
+        auto entryIt = m_entries.find(it.key());
+        if (entryIt == m_entries.end()
+            || entryIt->m_mtime != it->m_mtime
+            || entryIt->m_size != it->m_size) {
+            // Changed since validation started.
+            continue;
+        }
+
+        if (validPaths.contains(it.key())) {
+            entryIt->m_validated = true;
+        } else {
+            m_entries.erase(entryIt);
+            m_dirty = true;
+        }
+    }
+
+    qDebug() << "notebook meta snapshot of" << m_notebookPath << "validated"
+             << validPaths.size() << "/" << m_validatingEntries.size();
+
+    m_validatingEntries.clear();
+
+    if (m_dirty) {
+        scheduleSave();
+    }
+}
+
+bool VNotebookMetaCache::statConfig(const QString &p_dirPath, qint64 &p_mtime, qint64 &p_size)
+{
+    QFileInfo info(QDir(p_dirPath).filePath(VConfigManager::getDirConfigFileName()));
+    if (!info.isFile()) {
+        return false;
+    }
+
+    p_mtime = info.lastModified().toMSecsSinceEpoch();
+    p_size = info.size();
+    return true;
+}
+
+QSet<QString> VNotebookMetaCache::validate(const QString &p_notebookPath,
+                                           const VDirMetaHash &p_entries)
+{
+    QSet<QString> validPaths;
+    QDir rootDir(p_notebookPath);
+    for (auto it = p_entries.constBegin(); it != p_entries.constEnd(); ++it) {
+        qint64 mtime = 0, size = 0;
+        QString dirPath = it.key().isEmpty() ? p_notebookPath : rootDir.filePath(it.key());
+        if (statConfig(dirPath, mtime, size)
+            && mtime == it->m_mtime
+            && size == it->m_size) {
+            validPaths.insert(it.key());
+        }
+    }
+
+    return validPaths;
+}
+
+bool VNotebookMetaCache::readSnapshot(const QString &p_file, VDirMetaHash &p_entries)
+{
+    QFile file(p_file);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // Read it at once.
+    QByteArray data = file.readAll();
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0, version = 0;
+    in >> magic >> version;
+    if (magic != c_snapshotMagic || version != c_snapshotVersion) {
+        qWarning() << "invalid notebook meta snapshot" << p_file;
+        return false;
+    }
+
+    int nrEntries = 0;
+    in >> nrEntries;
+    if (nrEntries < 0) {
+        return false;
+    }
+
+    // Do not trust the count to reserve since the file may be corrupted.
+    for (int i = 0; i < nrEntries; ++i) {
+        QString path;
+        VDirMetaEntry entry;
+        in >> path >> entry.m_mtime >> entry.m_size >> entry.m_config;
+        if (in.status() != QDataStream::Ok) {
+            break;
+        }
+
+        p_entries.insert(path, entry);
+    }
+
+    return in.status() == QDataStream::Ok;
+}
+
+bool VNotebookMetaCache::writeSnapshot(const QString &p_file, const VDirMetaHash &p_entries)
+{
+    VUtils::makePath(VUtils::basePathFromPath(p_file));
+    QSaveFile file(p_file);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "fail to write notebook meta snapshot" << p_file;
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+
+    out << c_snapshotMagic << c_snapshotVersion;
+
+    out << p_entries.size();
+    for (auto it = p_entries.constBegin(); it != p_entries.constEnd(); ++it) {
+        out << it.key() << it->m_mtime << it->m_size << it->m_config;
+    }
+
+    if (out.status() != QDataStream::Ok) {
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
+}
@@ -0,0 +1,137 @@
+#ifndef VNOTEBOOKMETACACHE_H
+#define VNOTEBOOKMETACACHE_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QSet>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QFuture>
+#include <QElapsedTimer>
+
+template <typename T> class QFutureWatcher;
+class QTimer;
+
+// Cached config of one directory.
+struct VDirMetaEntry
+{
+    VDirMetaEntry()
+        : m_mtime(0), m_size(0), m_validated(false)
+    {
+    }
+
+    // Modified time and size of the config file.
+    qint64 m_mtime;
+    qint64 m_size;
+
+    // Compact JSON of the config.
+    QByteArray m_config;
+
+    // Whether it is known to match the config file without checking it again.
+    // Only trusted for a while after the validation starts and will be reset
+    // once used.
+    bool m_validated;
+};
+
+// Keyed by the directory path relative to the notebook.
+typedef QHash<QString, VDirMetaEntry> VDirMetaHash;
+
+// Snapshot of the configs of all the directories of a notebook.
+// It is stored in the config folder instead of the notebook, which may be
+// synced elsewhere.
+// The snapshot is loaded in one read. A cached config is used only if the
+// modified time and size of its config file do not change. All the entries
+// are validated in background once the snapshot is loaded, so that opening
+// directories shortly after needs no access to the disk at all. Afterwards
+// the config file is checked each time an entry is used.
+class VNotebookMetaCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit VNotebookMetaCache(const QString &p_notebookPath, QObject *p_parent = nullptr);
+
+    ~VNotebookMetaCache();
+
+    // Read the config of directory @p_path via the cache.
+    QJsonObject readDirectoryConfig(const QString &p_path);
+
+    // Write the config of directory @p_path and update the cache.
+    bool writeDirectoryConfig(const QString &p_path, const QJsonObject &p_json);
+
+    // Drop the cached config of directory @p_path.
+    void invalidate(const QString &p_path);
+
+    // Drop all the cached configs and delete the snapshot file.
+    void clear();
+
+    // Get the config of directory @p_path only if it is cached and still
+    // matches the config file, which needs at most a stat of the file.
+    bool peek(const QString &p_path, QJsonObject &p_json);
+
+    // Add the config of directory @p_path read elsewhere with the modified
+    // time and size of its config file.
+    void insert(const QString &p_path, const QJsonObject &p_json, qint64 p_mtime, qint64 p_size);
+
+    // Get the modified time and size of the config file in @p_dirPath.
+    // Thread-safe.
+    static bool statConfig(const QString &p_dirPath, qint64 &p_mtime, qint64 &p_size);
+
+private slots:
+    void handleValidationFinished();
+
+    // Write the snapshot to disk in background.
+    void save();
+
+private:
+    // Load the snapshot if not loaded yet.
+    void load();
+
+    // Returns false if @p_path is not within the notebook.
+    bool relativePath(const QString &p_path, QString &p_relativePath) const;
+
+    // Whether entry @p_entry of directory @p_path still matches its config file.
+    bool isUpToDate(const VDirMetaEntry &p_entry, const QString &p_path) const;
+
+    // Update entry @p_relativePath with the config file in @p_path.
+    void updateEntry(const QString &p_relativePath,
+                     const QString &p_path,
+                     const QJsonObject &p_json);
+
+    void scheduleSave();
+
+    static bool readSnapshot(const QString &p_file, VDirMetaHash &p_entries);
+
+    static bool writeSnapshot(const QString &p_file, const VDirMetaHash &p_entries);
+
+    // Run in background.
+    // Returns the relative paths of the entries matching the config files.
+    static QSet<QString> validate(const QString &p_notebookPath, const VDirMetaHash &p_entries);
+
+    QString m_notebookPath;
+
+    // Path of the snapshot file in the cache folder of the notebook.
+    QString m_snapshotFile;
+
+    bool m_loaded;
+
+    // Whether there are changes not saved.
+    bool m_dirty;
+
+    VDirMetaHash m_entries;
+
+    QFutureWatcher<QSet<QString> > *m_validateWatcher;
+
+    // Entries validated in background are only reliable if they do not
+    // change since the validation starts.
+    VDirMetaHash m_validatingEntries;
+
+    // Started when the validation starts.
+    QElapsedTimer m_validationTimer;
+
+    QTimer *m_saveTimer;
+
+    QFuture<bool> m_saveFuture;
+};
+
+#endif // VNOTEBOOKMETACACHE_H
@@ -9,6 +9,10 @@
 #include <QDebug>
 
 #include "vdirectory.h"
+#include "vfulltextsearch.h"
+#include "vcopyengine.h"
+
+extern VFullTextSearch *g_fullTextSearch;
 
 VNoteFile::VNoteFile(VDirectory *p_directory,
                      const QString &p_name,
@@ -29,6 +33,16 @@ QString VNoteFile::fetchPath() const
     return QDir(getDirectory()->fetchPath()).filePath(m_name);
 }
 
+bool VNoteFile::save()
+{
+    bool ret = VFile::save();
+    if (ret) {
+        g_fullTextSearch->updatePath(fetchPath());
+    }
+
+    return ret;
+}
+
 QString VNoteFile::fetchBasePath() const
 {
     return getDirectory()->fetchPath();
@@ -88,6 +102,9 @@ bool VNoteFile::rename(const QString &p_name)
 
     m_docType = VUtils::docTypeFromName(m_name);
 
+    g_fullTextSearch->updatePaths(QStringList() << diskDir.filePath(oldName)
+                                                << diskDir.filePath(m_name));
+
     qDebug() << "file renamed from" << oldName << "to" << m_name;
     return true;
 }
@@ -434,6 +451,8 @@ bool VNoteFile::deleteFile(VNoteFile *p_file, QString *p_errMsg)
 
     delete p_file;
 
+    g_fullTextSearch->updatePath(path);
+
     return ret;
 }
 
@@ -444,15 +463,44 @@ bool VNoteFile::copyFile(VDirectory *p_destDir,
                          VNoteFile **p_targetFile,
                          QString *p_errMsg)
 {
-    bool ret = true;
     *p_targetFile = NULL;
-    int nrImageCopied = 0;
-    bool attachmentFolderCopied = false;
 
-    QString srcPath = QDir::cleanPath(p_file->fetchPath());
-    QString destPath = QDir::cleanPath(QDir(p_destDir->fetchPath()).filePath(p_destName));
-    if (VUtils::equalPath(srcPath, destPath)) {
-        *p_targetFile = p_file;
+    VCopyEngine engine(p_isCut);
+    VNoteCopyPlan plan;
+    if (!planCopyFile(p_destDir, p_destName, p_file, p_isCut, &engine, plan, p_errMsg)) {
+        if (VUtils::equalPath(plan.m_srcPath, plan.m_destPath)) {
+            *p_targetFile = p_file;
+        }
+
+        return false;
+    }
+
+    engine.exec(tr("%1 note %2").arg(p_isCut ? tr("Moving") : tr("Copying"))
+                                .arg(p_file->getName()));
+    if (engine.isCanceled()) {
+        VUtils::addErrMsg(p_errMsg, tr("Operation is canceled."));
+        return false;
+    }
+
+    return finishCopyFile(plan, &engine, p_targetFile, p_errMsg);
+}
+
+bool VNoteFile::planCopyFile(VDirectory *p_destDir,
+                             const QString &p_destName,
+                             VNoteFile *p_file,
+                             bool p_isCut,
+                             VCopyEngine *p_engine,
+                             VNoteCopyPlan &p_plan,
+                             QString *p_errMsg)
+{
+    p_plan = VNoteCopyPlan();
+    p_plan.m_file = p_file;
+    p_plan.m_destDir = p_destDir;
+    p_plan.m_destName = p_destName;
+    p_plan.m_isCut = p_isCut;
+    p_plan.m_srcPath = QDir::cleanPath(p_file->fetchPath());
+    p_plan.m_destPath = QDir::cleanPath(QDir(p_destDir->fetchPath()).filePath(p_destName));
+    if (VUtils::equalPath(p_plan.m_srcPath, p_plan.m_destPath)) {
         return false;
     }
 
@@ -461,11 +509,15 @@ bool VNoteFile::copyFile(VDirectory *p_destDir,
         return false;
     }
 
+    if (!p_engine->plannedSource(p_plan.m_destPath).isEmpty()) {
+        VUtils::addErrMsg(p_errMsg, tr("Another note is pasted as %1.").arg(p_plan.m_destPath));
+        return false;
+    }
+
     QString opStr = p_isCut ? tr("cut") : tr("copy");
-    VDirectory *srcDir = p_file->getDirectory();
     DocType docType = p_file->getDocType();
 
-    Q_ASSERT(srcDir->isOpened());
+    Q_ASSERT(p_file->getDirectory()->isOpened());
     Q_ASSERT(docType == VUtils::docTypeFromName(p_destName));
 
     // Images to be copied.
@@ -477,30 +529,84 @@ bool VNoteFile::copyFile(VDirectory *p_destDir,
 
     // Attachments to be copied.
     QString attaFolder = p_file->getAttachmentFolder();
-    QString attaFolderPath;
     if (!attaFolder.isEmpty()) {
-        attaFolderPath = p_file->fetchAttachmentFolderPath();
+        p_plan.m_attaFolderPath = p_file->fetchAttachmentFolderPath();
+    }
+
+    // Plan the note file, its images, and its attachments in one group.
+    p_plan.m_group = p_engine->beginGroup();
+    p_engine->addFile(p_plan.m_srcPath, p_plan.m_destPath);
+
+    if (!planInternalImages(images,
+                            p_destDir->fetchPath(),
+                            p_engine,
+                            &p_plan.m_imagePaths,
+                            &p_plan.m_errMsg)) {
+        p_plan.m_succeeded = false;
+    }
+
+    if (!p_plan.m_attaFolderPath.isEmpty()) {
+        QDir folderDir(QDir(p_destDir->fetchPath()).filePath(p_destDir->getNotebook()->getAttachmentFolder()));
+        QString destAttaFolder = VUtils::getDirNameWithSequence(folderDir.path(), attaFolder);
+        // Skip the ones planned by other notes but not created yet.
+        int seq = 1;
+        while (!p_engine->plannedSource(folderDir.filePath(destAttaFolder)).isEmpty()) {
+            destAttaFolder = VUtils::getDirNameWithSequence(folderDir.path(),
+                                                            QString("%1_%2").arg(attaFolder).arg(seq++));
+        }
+
+        QString folderPath = folderDir.filePath(destAttaFolder);
+        if (p_engine->addDirectory(p_plan.m_attaFolderPath, folderPath)) {
+            p_plan.m_destAttaFolder = destAttaFolder;
+        } else {
+            VUtils::addErrMsg(&p_plan.m_errMsg, tr("Fail to %1 attachments folder %2 to %3. "
+                                                   "Please manually maintain it.")
+                                                  .arg(opStr).arg(p_plan.m_attaFolderPath).arg(folderPath));
+            p_plan.m_succeeded = false;
+        }
+    }
+
+    return true;
+}
+
+bool VNoteFile::finishCopyFile(const VNoteCopyPlan &p_plan,
+                               VCopyEngine *p_engine,
+                               VNoteFile **p_targetFile,
+                               QString *p_errMsg)
+{
+    bool ret = p_plan.m_succeeded;
+    *p_targetFile = NULL;
+    int nrImageCopied = 0;
+    bool attachmentFolderCopied = false;
+    VNoteFile *file = p_plan.m_file;
+    VDirectory *destDir = p_plan.m_destDir;
+    QString opStr = p_plan.m_isCut ? tr("cut") : tr("copy");
+
+    if (!p_plan.m_errMsg.isEmpty()) {
+        VUtils::addErrMsg(p_errMsg, p_plan.m_errMsg);
     }
 
-    // Copy the note file.
-    if (!VUtils::copyFile(srcPath, destPath, p_isCut)) {
+    if (p_engine->hasFailed(p_plan.m_srcPath)) {
+        // Keep images and attachments along with the note.
+        p_engine->rollback(p_plan.m_group);
         VUtils::addErrMsg(p_errMsg, tr("Fail to %1 the note file.").arg(opStr));
-        qWarning() << "fail to" << opStr << "the note file" << srcPath << "to" << destPath;
+        qWarning() << "fail to" << opStr << "the note file" << p_plan.m_srcPath
+                   << "to" << p_plan.m_destPath;
         return false;
     }
 
-    // Add file to VDirectory.
+    // Update the configs on the GUI thread after all the files are copied.
     VNoteFile *destFile = NULL;
-    if (p_isCut) {
-        srcDir->removeFile(p_file);
-        p_file->setName(p_destName);
-        if (p_destDir->addFile(p_file, -1)) {
-            destFile = p_file;
+    if (p_plan.m_isCut) {
+        file->getDirectory()->removeFile(file);
+        file->setName(p_plan.m_destName);
+        if (destDir->addFile(file, -1)) {
+            destFile = file;
         } else {
             destFile = NULL;
         }
     } else {
-        destFile = p_destDir->addFile(p_destName, -1);
+        destFile = destDir->addFile(p_plan.m_destName, -1);
     }
 
     if (!destFile) {
@@ -508,47 +614,51 @@ bool VNoteFile::copyFile(VDirectory *p_destDir,
         return false;
     }
 
-    // Copy images.
-    if (!copyInternalImages(images,
-                            destFile->fetchBasePath(),
-                            p_isCut,
-                            &nrImageCopied,
-                            p_errMsg)) {
-        ret = false;
+    for (int i = 0; i < p_plan.m_imagePaths.size(); ++i) {
+        if (p_engine->hasFailed(p_plan.m_imagePaths[i])) {
+            VUtils::addErrMsg(p_errMsg, tr("Fail to %1 image %2. "
+                                           "Please manually %1 it and modify the note.")
+                                          .arg(opStr).arg(p_plan.m_imagePaths[i]));
+            ret = false;
+        } else {
+            ++nrImageCopied;
+        }
     }
 
-    // Copy attachment folder.
-    if (!attaFolderPath.isEmpty()) {
-        QDir dir(destFile->fetchBasePath());
-        QString folderPath = dir.filePath(destFile->getNotebook()->getAttachmentFolder());
-        attaFolder = VUtils::getDirNameWithSequence(folderPath, attaFolder);
-        folderPath = QDir(folderPath).filePath(attaFolder);
+    if (!p_plan.m_attaFolderPath.isEmpty()) {
+        if (p_plan.m_destAttaFolder.isEmpty() || p_engine->hasFailed(p_plan.m_attaFolderPath)) {
+            if (!p_plan.m_destAttaFolder.isEmpty()) {
+                VUtils::addErrMsg(p_errMsg, tr("Fail to %1 attachments folder %2. "
+                                               "Please manually maintain it.")
+                                              .arg(opStr).arg(p_plan.m_attaFolderPath));
+            }
 
-        // Copy attaFolderPath to folderPath.
-        if (!VUtils::copyDirectory(attaFolderPath, folderPath, p_isCut)) {
-            VUtils::addErrMsg(p_errMsg, tr("Fail to %1 attachments folder %2 to %3. "
-                                           "Please manually maintain it.")
-                                          .arg(opStr).arg(attaFolderPath).arg(folderPath));
             QVector<VAttachment> emptyAttas;
             destFile->setAttachments(emptyAttas);
             ret = false;
         } else {
             attachmentFolderCopied = true;
 
-            destFile->setAttachmentFolder(attaFolder);
-            if (!p_isCut) {
-                destFile->setAttachments(p_file->getAttachments());
+            destFile->setAttachmentFolder(p_plan.m_destAttaFolder);
+            if (!p_plan.m_isCut) {
+                destFile->setAttachments(file->getAttachments());
             }
         }
 
-        if (!p_destDir->updateFileConfig(destFile)) {
+        if (!destDir->updateFileConfig(destFile)) {
             VUtils::addErrMsg(p_errMsg, tr("Fail to update configuration of note %1.")
                                           .arg(destFile->fetchPath()));
             ret = false;
         }
     }
 
-    qDebug() << "copyFile:" << p_file << "to" << destFile
+    if (p_plan.m_isCut) {
+        g_fullTextSearch->updatePaths(QStringList() << p_plan.m_srcPath << p_plan.m_destPath);
+    } else {
+        g_fullTextSearch->updatePath(p_plan.m_destPath);
+    }
+
+    qDebug() << "copyFile:" << file << "to" << destFile
              << "copied_images:" << nrImageCopied
              << "copied_attachments:" << attachmentFolderCopied;
 
@@ -561,12 +671,45 @@ bool VNoteFile::copyInternalImages(const QVector<ImageLink> &p_images,
                                    bool p_isCut,
                                    int *p_nrImageCopied,
                                    QString *p_errMsg)
+{
+    VCopyEngine engine(p_isCut);
+    QVector<QString> imagePaths;
+    bool ret = planInternalImages(p_images, p_destDirPath, &engine, &imagePaths, p_errMsg);
+
+    QString opStr = p_isCut ? tr("cut") : tr("copy");
+    engine.exec(tr("%1 images").arg(p_isCut ? tr("Moving") : tr("Copying")));
+    if (engine.isCanceled()) {
+        VUtils::addErrMsg(p_errMsg, tr("Operation is canceled."));
+        *p_nrImageCopied = 0;
+        return false;
+    }
+
+    int nrImageCopied = 0;
+    for (int i = 0; i < imagePaths.size(); ++i) {
+        if (engine.hasFailed(imagePaths[i])) {
+            VUtils::addErrMsg(p_errMsg, tr("Fail to %1 image %2. "
+                                           "Please manually %1 it and modify the note.")
+                                          .arg(opStr).arg(imagePaths[i]));
+            ret = false;
+        } else {
+            ++nrImageCopied;
+            qDebug() << opStr << "image" << imagePaths[i];
+        }
+    }
+
+    *p_nrImageCopied = nrImageCopied;
+    return ret;
+}
+
+bool VNoteFile::planInternalImages(const QVector<ImageLink> &p_images,
+                                   const QString &p_destDirPath,
+                                   VCopyEngine *p_engine,
+                                   QVector<QString> *p_imagePaths,
+                                   QString *p_errMsg)
 {
     bool ret = true;
     QDir parentDir(p_destDirPath);
     QSet<QString> processedImages;
-    QString opStr = p_isCut ? tr("cut") : tr("copy");
-    int nrImageCopied = 0;
     for (int i = 0; i < p_images.size(); ++i) {
         const ImageLink &link = p_images[i];
         if (processedImages.contains(link.m_path)) {
@@ -592,17 +735,21 @@ bool VNoteFile::copyInternalImages(const QVector<ImageLink> &p_images,
             continue;
         }
 
-        if (!VUtils::copyFile(link.m_path, destImagePath, p_isCut)) {
-            VUtils::addErrMsg(p_errMsg, tr("Fail to %1 image %2 to %3. "
-                                           "Please manually %1 it and modify the note.")
-                                          .arg(opStr).arg(link.m_path).arg(destImagePath));
-            ret = false;
-        } else {
-            ++nrImageCopied;
-            qDebug() << opStr << "image" << link.m_path << "to" << destImagePath;
+        // Images shared with other notes in the same engine are copied once.
+        QString plannedPath = p_engine->plannedSource(destImagePath);
+        if (!plannedPath.isEmpty()) {
+            if (!VUtils::equalPath(plannedPath, link.m_path)) {
+                VUtils::addErrMsg(p_errMsg, tr("Skip image %1 since another image is copied to %2.")
+                                              .arg(link.m_path).arg(destImagePath));
+                ret = false;
+            }
+
+            continue;
         }
+
+        p_engine->addFile(link.m_path, destImagePath);
+        p_imagePaths->append(link.m_path);
     }
 
-    *p_nrImageCopied = nrImageCopied;
     return ret;
 }
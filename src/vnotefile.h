@@ -9,6 +9,7 @@
 
 class VDirectory;
 class VNotebook;
+class VCopyEngine;
 
 // Structure for a note attachment.
 struct VAttachment
@@ -26,6 +27,39 @@ struct VAttachment
     QString m_name;
 };
 
+// Plan of copying one note via VCopyEngine.
+struct VNoteCopyPlan
+{
+    VNoteCopyPlan()
+        : m_file(NULL), m_destDir(NULL), m_isCut(false), m_group(0), m_succeeded(true)
+    {
+    }
+
+    VNoteFile *m_file;
+    VDirectory *m_destDir;
+    QString m_destName;
+    bool m_isCut;
+
+    QString m_srcPath;
+    QString m_destPath;
+
+    // Group of the tasks of this note in the engine.
+    int m_group;
+
+    // Source paths of the planned images.
+    QVector<QString> m_imagePaths;
+
+    QString m_attaFolderPath;
+
+    // Name of the target attachment folder. Empty if not planned.
+    QString m_destAttaFolder;
+
+    // False if part of the note could not be planned.
+    bool m_succeeded;
+
+    QString m_errMsg;
+};
+
 class VNoteFile : public VFile
 {
     Q_OBJECT
@@ -49,6 +83,8 @@ public:
 
     QString getImageFolderInLink() const Q_DECL_OVERRIDE;
 
+    bool save() Q_DECL_OVERRIDE;
+
     // Set the name of this file.
     void setName(const QString &p_name);
 
@@ -130,6 +166,24 @@ public:
                          VNoteFile **p_targetFile,
                          QString *p_errMsg = NULL);
 
+    // Plan copying file @p_file, its images, and its attachments to @p_destDir
+    // with new name @p_destName in @p_engine as one group.
+    // Returns false if the note could not be copied at all.
+    static bool planCopyFile(VDirectory *p_destDir,
+                             const QString &p_destName,
+                             VNoteFile *p_file,
+                             bool p_isCut,
+                             VCopyEngine *p_engine,
+                             VNoteCopyPlan &p_plan,
+                             QString *p_errMsg = NULL);
+
+    // Update the configs of @p_plan after @p_engine is executed and not canceled.
+    // Returns a file representing the destination file after copy/cut.
+    static bool finishCopyFile(const VNoteCopyPlan &p_plan,
+                               VCopyEngine *p_engine,
+                               VNoteFile **p_targetFile,
+                               QString *p_errMsg = NULL);
+
     // Copy images @p_images of a file to @p_destDirPath.
     static bool copyInternalImages(const QVector<ImageLink> &p_images,
                                    const QString &p_destDirPath,
@@ -137,6 +191,14 @@ public:
                                    int *p_nrImageCopied,
                                    QString *p_errMsg = NULL);
 
+    // Plan copies of images @p_images of a file to @p_destDirPath in @p_engine.
+    // Source paths of planned images will be appended to @p_imagePaths.
+    static bool planInternalImages(const QVector<ImageLink> &p_images,
+                                   const QString &p_destDirPath,
+                                   VCopyEngine *p_engine,
+                                   QVector<QString> *p_imagePaths,
+                                   QString *p_errMsg = NULL);
+
 private:
     // Delete internal images of this file.
     // Return true only when all internal images were deleted successfully.
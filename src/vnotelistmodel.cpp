@@ -0,0 +1,232 @@
+#include "vnotelistmodel.h"
+
+#include "vdirectory.h"
+#include "vnotefile.h"
+
+VNoteListModel::VNoteListModel(QObject *p_parent)
+    : QAbstractListModel(p_parent),
+      m_rowsValid(false),
+      m_loading(false)
+{
+}
+
+void VNoteListModel::setDirectory(VDirectory *p_dir)
+{
+    beginResetModel();
+    m_dir = p_dir;
+    m_loading = false;
+    if (m_dir && m_dir->isOpened()) {
+        setFiles(m_dir->getFiles());
+    } else {
+        m_files.clear();
+    }
+
+    m_rows.clear();
+    m_rowsValid = false;
+    endResetModel();
+}
+
+void VNoteListModel::setLoading(bool p_loading)
+{
+    if (m_loading == p_loading) {
+        return;
+    }
+
+    beginResetModel();
+    m_loading = p_loading;
+    endResetModel();
+}
+
+void VNoteListModel::refresh()
+{
+    if (!m_dir || !m_dir->isOpened()) {
+        setDirectory(m_dir);
+        return;
+    }
+
+    const QVector<VNoteFile *> &files = m_dir->getFiles();
+    if (!m_loading && isSameFiles(files)) {
+        return;
+    }
+
+    int cnt = m_files.size();
+    bool appended = !m_loading && files.size() > cnt;
+    for (int i = 0; appended && i < cnt; ++i) {
+        if (files[i] != m_files[i]) {
+            appended = false;
+        }
+    }
+
+    if (!appended) {
+        setDirectory(m_dir);
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), cnt, files.size() - 1);
+    m_files.reserve(files.size());
+    for (int i = cnt; i < files.size(); ++i) {
+        m_files.append(files[i]);
+        if (m_rowsValid) {
+            m_rows.insert(files[i], i);
+        }
+    }
+
+    endInsertRows();
+}
+
+bool VNoteListModel::isSameFiles(const QVector<VNoteFile *> &p_files) const
+{
+    if (p_files.size() != m_files.size()) {
+        return false;
+    }
+
+    for (int i = 0; i < p_files.size(); ++i) {
+        if (p_files[i] != m_files[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void VNoteListModel::setFiles(const QVector<VNoteFile *> &p_files)
+{
+    m_files.clear();
+    m_files.reserve(p_files.size());
+    for (auto file : p_files) {
+        m_files.append(file);
+    }
+}
+
+void VNoteListModel::removeFile(const VNoteFile *p_file)
+{
+    QModelIndex idx = indexOf(p_file);
+    if (!idx.isValid()) {
+        return;
+    }
+
+    int row = idx.row();
+    beginRemoveRows(QModelIndex(), row, row);
+    m_files.remove(row);
+
+    // Shift the rows after it instead of rebuilding the whole hash.
+    // Deleted notes are not indexed.
+    m_rows.remove(p_file);
+    for (int i = row; i < m_files.size(); ++i) {
+        const VNoteFile *file = m_files[i].data();
+        if (file) {
+            m_rows[file] = i;
+        }
+    }
+
+    endRemoveRows();
+}
+
+void VNoteListModel::updateFile(const VNoteFile *p_file)
+{
+    QModelIndex idx = indexOf(p_file);
+    if (idx.isValid()) {
+        emit dataChanged(idx, idx);
+    }
+}
+
+VNoteFile *VNoteListModel::getFile(const QModelIndex &p_index) const
+{
+    if (m_loading || !p_index.isValid() || p_index.row() >= m_files.size()) {
+        return NULL;
+    }
+
+    // NULL if the note has been deleted.
+    return m_files[p_index.row()].data();
+}
+
+QModelIndex VNoteListModel::indexOf(const VNoteFile *p_file) const
+{
+    if (!p_file || m_loading) {
+        return QModelIndex();
+    }
+
+    buildRows();
+    auto it = m_rows.find(p_file);
+    if (it == m_rows.end()) {
+        return QModelIndex();
+    }
+
+    return index(it.value());
+}
+
+void VNoteListModel::buildRows() const
+{
+    if (m_rowsValid) {
+        return;
+    }
+
+    m_rows.clear();
+    m_rows.reserve(m_files.size());
+    for (int i = 0; i < m_files.size(); ++i) {
+        const VNoteFile *file = m_files[i].data();
+        if (file) {
+            m_rows.insert(file, i);
+        }
+    }
+
+    m_rowsValid = true;
+}
+
+int VNoteListModel::rowCount(const QModelIndex &p_parent) const
+{
+    if (p_parent.isValid()) {
+        return 0;
+    }
+
+    return m_loading ? 1 : m_files.size();
+}
+
+QVariant VNoteListModel::data(const QModelIndex &p_index, int p_role) const
+{
+    if (!p_index.isValid()) {
+        return QVariant();
+    }
+
+    if (m_loading) {
+        if (p_role == Qt::DisplayRole) {
+            return tr("Loading...");
+        }
+
+        return QVariant();
+    }
+
+    const VNoteFile *file = getFile(p_index);
+    if (!file) {
+        return QVariant();
+    }
+
+    switch (p_role) {
+    case Qt::DisplayRole:
+    case Qt::ToolTipRole:
+        return file->getName();
+
+    default:
+        break;
+    }
+
+    return QVariant();
+}
+
+Qt::ItemFlags VNoteListModel::flags(const QModelIndex &p_index) const
+{
+    if (!p_index.isValid() || m_loading) {
+        return Qt::NoItemFlags;
+    }
+
+    return Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+}
+
+QModelIndex VNoteListModel::index(int p_row, int p_column, const QModelIndex &p_parent) const
+{
+    if (p_parent.isValid() || p_column != 0 || p_row < 0 || p_row >= rowCount()) {
+        return QModelIndex();
+    }
+
+    return createIndex(p_row, p_column);
+}
@@ -0,0 +1,78 @@
+#ifndef VNOTELISTMODEL_H
+#define VNOTELISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+#include <QHash>
+#include <QPointer>
+
+class VDirectory;
+class VNoteFile;
+
+// List model of the notes of a directory.
+// It keeps guarded pointers to the files of the directory without creating
+// any item, and looks up the row of a note via a hash built on demand.
+// A note deleted without notifying the model shows as an empty row until
+// next refresh().
+class VNoteListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    explicit VNoteListModel(QObject *p_parent = nullptr);
+
+    // Show notes of @p_dir which should be opened already.
+    void setDirectory(VDirectory *p_dir);
+
+    // Show a placeholder row instead of the notes.
+    void setLoading(bool p_loading);
+
+    // Sync with the files of current directory after notes are added or sorted.
+    // Notes appended at the end will be inserted without resetting the model.
+    void refresh();
+
+    // Remove the row of @p_file before it is deleted.
+    void removeFile(const VNoteFile *p_file);
+
+    // Notify views that the info of @p_file changed.
+    void updateFile(const VNoteFile *p_file);
+
+    // Return NULL for invalid index or the placeholder.
+    VNoteFile *getFile(const QModelIndex &p_index) const;
+
+    // O(1) except for the first lookup after rows change.
+    QModelIndex indexOf(const VNoteFile *p_file) const;
+
+    // Implementations for QAbstractListModel.
+    int rowCount(const QModelIndex &p_parent = QModelIndex()) const Q_DECL_OVERRIDE;
+
+    QVariant data(const QModelIndex &p_index, int p_role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+
+    Qt::ItemFlags flags(const QModelIndex &p_index) const Q_DECL_OVERRIDE;
+
+    QModelIndex index(int p_row,
+                      int p_column = 0,
+                      const QModelIndex &p_parent = QModelIndex()) const Q_DECL_OVERRIDE;
+
+private:
+    // Build m_rows from m_files if it is outdated.
+    void buildRows() const;
+
+    // Whether m_files is the same as @p_files.
+    bool isSameFiles(const QVector<VNoteFile *> &p_files) const;
+
+    void setFiles(const QVector<VNoteFile *> &p_files);
+
+    QPointer<VDirectory> m_dir;
+
+    // Files of m_dir when last synced.
+    QVector<QPointer<VNoteFile>> m_files;
+
+    // Row of each note in m_files.
+    mutable QHash<const VNoteFile *, int> m_rows;
+
+    mutable bool m_rowsValid;
+
+    bool m_loading;
+};
+
+#endif // VNOTELISTMODEL_H
@@ -0,0 +1,255 @@
+#include "vpegparser.h"
+
+#include <QtConcurrent/QtConcurrentRun>
+#include <QDebug>
+#include <algorithm>
+
+VPegParser::VPegParser(QObject *p_parent)
+    : QObject(p_parent)
+{
+    m_watcher = new QFutureWatcher<QSharedPointer<PegParseResult> >(this);
+    connect(m_watcher, &QFutureWatcher<QSharedPointer<PegParseResult> >::finished,
+            this, &VPegParser::handleParseFinished);
+}
+
+VPegParser::~VPegParser()
+{
+    m_pendingConfig.clear();
+    m_watcher->waitForFinished();
+}
+
+void VPegParser::parseAsync(const QSharedPointer<PegParseConfig> &p_config)
+{
+    if (m_watcher->isRunning()) {
+        m_pendingConfig = p_config;
+        return;
+    }
+
+    startParse(p_config);
+}
+
+void VPegParser::startParse(const QSharedPointer<PegParseConfig> &p_config)
+{
+    m_watcher->setFuture(QtConcurrent::run(&VPegParser::parse, p_config));
+}
+
+void VPegParser::handleParseFinished()
+{
+    QSharedPointer<PegParseResult> result = m_watcher->result();
+
+    if (!m_pendingConfig.isNull()) {
+        QSharedPointer<PegParseConfig> config = m_pendingConfig;
+        m_pendingConfig.clear();
+        startParse(config);
+    }
+
+    emit parseResultReady(result);
+}
+
+// Start position of each block in @p_text.
+static QVector<int> blocksPosition(const QString &p_text)
+{
+    QVector<int> pos;
+    pos.append(0);
+    int idx = p_text.indexOf('\n');
+    while (idx != -1) {
+        pos.append(idx + 1);
+        idx = p_text.indexOf('\n', idx + 1);
+    }
+
+    return pos;
+}
+
+// Find the number of the block containing @p_pos.
+static int findBlock(const QVector<int> &p_blocksPos, unsigned long p_pos)
+{
+    auto it = std::upper_bound(p_blocksPos.begin(), p_blocksPos.end(), (int)p_pos);
+    return it - p_blocksPos.begin() - 1;
+}
+
+static int blockLength(const QVector<int> &p_blocksPos, int p_textSize, int p_blockNum)
+{
+    if (p_blockNum + 1 < p_blocksPos.size()) {
+        return p_blocksPos[p_blockNum + 1] - p_blocksPos[p_blockNum];
+    }
+
+    // Count the paragraph separator.
+    return p_textSize - p_blocksPos[p_blockNum] + 1;
+}
+
+// Check if [p_pos, p_end) is a valid header.
+static bool isValidHeader(const QString &p_text, unsigned long p_pos, unsigned long p_end)
+{
+    // There must exist spaces after #s.
+    // No more than 6 #s.
+    int nrNumberSign = 0;
+    for (unsigned long i = p_pos; i < p_end; ++i) {
+        QChar ch = i < (unsigned long)p_text.size() ? p_text[(int)i] : QChar('\n');
+        if (ch.isSpace()) {
+            return nrNumberSign > 0;
+        } else if (ch == QChar('#')) {
+            if (++nrNumberSign > 6) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+static void initBlockHighlightOne(QVector<QVector<HLUnit> > &p_highlights,
+                                  const QVector<int> &p_blocksPos,
+                                  int p_textSize,
+                                  unsigned long p_pos,
+                                  unsigned long p_end,
+                                  int p_styleIndex)
+{
+    // When the the highlight element is at the end of document, @p_end will equals
+    // to the characterCount.
+    unsigned long nrChar = p_textSize + 1;
+    if (p_end >= nrChar) {
+        p_end = nrChar - 1;
+    }
+
+    int startBlockNum = findBlock(p_blocksPos, p_pos);
+    int endBlockNum = findBlock(p_blocksPos, p_end);
+    if (endBlockNum >= p_highlights.size()) {
+        endBlockNum = p_highlights.size() - 1;
+    }
+
+    for (int i = startBlockNum; i <= endBlockNum; ++i) {
+        int blockStartPos = p_blocksPos[i];
+        HLUnit unit;
+        if (i == startBlockNum) {
+            unit.start = p_pos - blockStartPos;
+            unit.length = (startBlockNum == endBlockNum) ?
+                          (p_end - p_pos) : (blockLength(p_blocksPos, p_textSize, i) - unit.start);
+        } else if (i == endBlockNum) {
+            unit.start = 0;
+            unit.length = p_end - blockStartPos;
+        } else {
+            unit.start = 0;
+            unit.length = blockLength(p_blocksPos, p_textSize, i);
+        }
+
+        unit.styleIndex = p_styleIndex;
+
+        p_highlights[i].append(unit);
+    }
+}
+
+static bool compHLUnit(const HLUnit &p_a, const HLUnit &p_b)
+{
+    if (p_a.start < p_b.start) {
+        return true;
+    } else if (p_a.start == p_b.start) {
+        return p_a.length > p_b.length;
+    } else {
+        return false;
+    }
+}
+
+QSharedPointer<PegParseResult> VPegParser::parse(const QSharedPointer<PegParseConfig> &p_config)
+{
+    QSharedPointer<PegParseResult> result(new PegParseResult(p_config->m_timeStamp,
+                                                             p_config->m_numOfBlocks));
+    result->m_blocksHighlights.resize(p_config->m_numOfBlocks);
+
+    const QString &text = p_config->m_text;
+    QByteArray ba = text.toUtf8();
+    if (ba.isEmpty()) {
+        return result;
+    }
+
+    pmh_element **elements = NULL;
+    pmh_markdown_to_elements(ba.data(), p_config->m_extensions, &elements);
+    if (!elements) {
+        return result;
+    }
+
+    QVector<int> blocksPos = blocksPosition(text);
+    int textSize = text.size();
+
+    // Block highlights.
+    for (int i = 0; i < p_config->m_styleTypes.size(); ++i) {
+        pmh_element_type type = p_config->m_styleTypes[i];
+
+        // pmh_H1 to pmh_H6 is continuous.
+        bool isHeader = type >= pmh_H1 && type <= pmh_H6;
+
+        pmh_element *elem = elements[type];
+        while (elem != NULL) {
+            if (elem->end <= elem->pos
+                || (isHeader && !isValidHeader(text, elem->pos, elem->end))) {
+                elem = elem->next;
+                continue;
+            }
+
+            initBlockHighlightOne(result->m_blocksHighlights,
+                                  blocksPos,
+                                  textSize,
+                                  elem->pos,
+                                  elem->end,
+                                  i);
+            elem = elem->next;
+        }
+    }
+
+    for (auto & units : result->m_blocksHighlights) {
+        if (units.size() > 1) {
+            std::sort(units.begin(), units.end(), compHLUnit);
+        }
+    }
+
+    // HTML comment regions.
+    pmh_element *elem = elements[pmh_COMMENT];
+    while (elem != NULL) {
+        if (elem->end > elem->pos) {
+            result->m_commentRegions.push_back(VElementRegion(elem->pos, elem->end));
+        }
+
+        elem = elem->next;
+    }
+
+    // Image regions.
+    elem = elements[pmh_IMAGE];
+    while (elem != NULL) {
+        if (elem->end > elem->pos) {
+            result->m_imageRegions.push_back(VElementRegion(elem->pos, elem->end));
+        }
+
+        elem = elem->next;
+    }
+
+    // Header regions.
+    pmh_element_type hx[6] = {pmh_H1, pmh_H2, pmh_H3, pmh_H4, pmh_H5, pmh_H6};
+    for (int i = 0; i < 6; ++i) {
+        elem = elements[hx[i]];
+        while (elem != NULL) {
+            if (elem->end <= elem->pos
+                || !isValidHeader(text, elem->pos, elem->end)) {
+                elem = elem->next;
+                continue;
+            }
+
+            result->m_headerRegions.push_back(VElementRegion(elem->pos, elem->end));
+
+            int blockNum = findBlock(blocksPos, elem->pos);
+            if (blockNum >= 0) {
+                // Header element will contain the new line character.
+                result->m_headerBlocks.insert(blockNum,
+                                              HeaderBlockInfo(i, elem->end - elem->pos - 1));
+            }
+
+            elem = elem->next;
+        }
+    }
+
+    std::sort(result->m_headerRegions.begin(), result->m_headerRegions.end());
+
+    pmh_free_elements(elements);
+
+    return result;
+}
@@ -0,0 +1,96 @@
+#ifndef VPEGPARSER_H
+#define VPEGPARSER_H
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QVector>
+#include <QHash>
+#include <QString>
+#include <QFutureWatcher>
+
+#include "hgmarkdownhighlighter.h"
+
+// Immutable snapshot of the document to parse.
+struct PegParseConfig
+{
+    PegParseConfig()
+        : m_timeStamp(0),
+          m_numOfBlocks(0),
+          m_extensions(pmh_EXT_NONE)
+    {
+    }
+
+    // Revision of the document when the snapshot is taken.
+    int m_timeStamp;
+
+    QString m_text;
+
+    int m_numOfBlocks;
+
+    int m_extensions;
+
+    // Element type of each highlighting style, indexed by the style index.
+    QVector<pmh_element_type> m_styleTypes;
+};
+
+// Parse result processed into blocks and regions.
+struct PegParseResult
+{
+    PegParseResult(int p_timeStamp = 0, int p_numOfBlocks = 0)
+        : m_timeStamp(p_timeStamp),
+          m_numOfBlocks(p_numOfBlocks)
+    {
+    }
+
+    int m_timeStamp;
+
+    int m_numOfBlocks;
+
+    // Highlight units of each block, sorted by start position and length.
+    QVector<QVector<HLUnit> > m_blocksHighlights;
+
+    // All HTML comment regions.
+    QVector<VElementRegion> m_commentRegions;
+
+    // All image link regions.
+    QVector<VElementRegion> m_imageRegions;
+
+    // All valid header regions, sorted by start position.
+    QVector<VElementRegion> m_headerRegions;
+
+    // Indexed by block number.
+    QHash<int, HeaderBlockInfo> m_headerBlocks;
+};
+
+// Run PEG Markdown Highlight parser in a worker thread.
+// Only one parse will be running at a time. A new request will overwrite the
+// pending one which has not been started yet.
+class VPegParser : public QObject
+{
+    Q_OBJECT
+public:
+    explicit VPegParser(QObject *p_parent = nullptr);
+
+    ~VPegParser();
+
+    void parseAsync(const QSharedPointer<PegParseConfig> &p_config);
+
+    // Parse synchronously. Thread-safe.
+    static QSharedPointer<PegParseResult> parse(const QSharedPointer<PegParseConfig> &p_config);
+
+signals:
+    void parseResultReady(const QSharedPointer<PegParseResult> &p_result);
+
+private slots:
+    void handleParseFinished();
+
+private:
+    void startParse(const QSharedPointer<PegParseConfig> &p_config);
+
+    QFutureWatcher<QSharedPointer<PegParseResult> > *m_watcher;
+
+    // Config to parse after current parse finishes.
+    QSharedPointer<PegParseConfig> m_pendingConfig;
+};
+
+#endif // VPEGPARSER_H
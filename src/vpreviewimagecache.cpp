@@ -0,0 +1,176 @@
+#include "vpreviewimagecache.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "vconfigmanager.h"
+
+extern VConfigManager *g_config;
+
+VPreviewImageCache::VPreviewImageCache(QObject *p_parent)
+    : QObject(p_parent),
+      m_bytes(0),
+      m_maxBytes(0),
+      m_hits(0),
+      m_misses(0)
+{
+}
+
+VPreviewImageCache::~VPreviewImageCache()
+{
+    qDebug() << "preview image cache" << count() << "entries" << m_bytes << "bytes"
+             << "hits" << m_hits << "misses" << m_misses;
+}
+
+void VPreviewImageCache::init()
+{
+    m_maxBytes = (qint64)g_config->getPreviewImageCacheSize() * 1024;
+}
+
+QString VPreviewImageCache::key(const QString &p_path, int p_width)
+{
+    QFileInfo info(p_path);
+    QString path = info.canonicalFilePath();
+    if (path.isEmpty()) {
+        return path;
+    }
+
+    return QString("%1|%2|%3").arg(path)
+                              .arg(info.lastModified().toMSecsSinceEpoch())
+                              .arg(p_width);
+}
+
+qint64 VPreviewImageCache::imageBytes(const QPixmap &p_image)
+{
+    return (qint64)p_image.width() * p_image.height() * p_image.depth() / 8;
+}
+
+const QPixmap *VPreviewImageCache::find(const QString &p_key)
+{
+    if (m_maxBytes <= 0 || p_key.isEmpty()) {
+        return NULL;
+    }
+
+    auto it = m_index.find(p_key);
+    if (it == m_index.end()) {
+        ++m_misses;
+        return NULL;
+    }
+
+    ++m_hits;
+
+    // Move to front.
+    m_entries.splice(m_entries.begin(), m_entries, it.value());
+    return &m_entries.front().m_image;
+}
+
+bool VPreviewImageCache::insert(const QString &p_key, const QPixmap &p_image)
+{
+    if (m_maxBytes <= 0 || p_key.isEmpty() || p_image.isNull()) {
+        return false;
+    }
+
+    Entry entry;
+    entry.m_key = p_key;
+    entry.m_image = p_image;
+    entry.m_bytes = imageBytes(p_image);
+
+    auto it = m_index.find(entry.m_key);
+    if (it != m_index.end()) {
+        m_bytes -= it.value()->m_bytes;
+        m_entries.erase(it.value());
+        m_index.erase(it);
+    }
+
+    m_entries.push_front(entry);
+    m_index.insert(entry.m_key, m_entries.begin());
+    m_bytes += entry.m_bytes;
+
+    evict();
+    return contains(p_key);
+}
+
+void VPreviewImageCache::decodeAsync(const QString &p_key, const QString &p_path, const QSize &p_size)
+{
+    if (m_decodingKeys.contains(p_key)) {
+        return;
+    }
+
+    m_decodingKeys.insert(p_key);
+
+    QFutureWatcher<QImage> *watcher = new QFutureWatcher<QImage>(this);
+    connect(watcher, &QFutureWatcher<QImage>::finished,
+            this, [this, watcher, p_key]() {
+                watcher->deleteLater();
+                m_decodingKeys.remove(p_key);
+
+                QPixmap image = QPixmap::fromImage(watcher->result());
+                insert(p_key, image);
+                emit imageDecoded(p_key, image);
+            });
+    watcher->setFuture(QtConcurrent::run(&VPreviewImageCache::decodeImage, p_path, p_size));
+}
+
+QImage VPreviewImageCache::decodeImage(const QString &p_path, const QSize &p_size)
+{
+    QImageReader reader(p_path);
+    if (reader.size() != p_size) {
+        reader.setScaledSize(p_size);
+    }
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+        qWarning() << "fail to decode image" << p_path << reader.errorString();
+    }
+
+    return image;
+}
+
+void VPreviewImageCache::evict()
+{
+    // Editors will decode the evicted images again if they are still displayed.
+    auto it = m_entries.end();
+    while (m_bytes > m_maxBytes && it != m_entries.begin()) {
+        --it;
+        if (m_pins.contains(it->m_key)) {
+            continue;
+        }
+
+        m_bytes -= it->m_bytes;
+        m_index.remove(it->m_key);
+        it = m_entries.erase(it);
+    }
+}
+
+void VPreviewImageCache::pin(const QString &p_key)
+{
+    if (!p_key.isEmpty()) {
+        ++m_pins[p_key];
+    }
+}
+
+void VPreviewImageCache::unpin(const QString &p_key)
+{
+    auto it = m_pins.find(p_key);
+    if (it == m_pins.end()) {
+        return;
+    }
+
+    if (--it.value() <= 0) {
+        m_pins.erase(it);
+
+        // It may be kept over the budget.
+        evict();
+    }
+}
+
+void VPreviewImageCache::clear()
+{
+    m_entries.clear();
+    m_index.clear();
+    m_bytes = 0;
+}
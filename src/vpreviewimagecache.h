@@ -0,0 +1,149 @@
+#ifndef VPREVIEWIMAGECACHE_H
+#define VPREVIEWIMAGECACHE_H
+
+#include <list>
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QPixmap>
+#include <QImage>
+#include <QString>
+
+// LRU cache of decoded local images for in-place preview shared by all the
+// editors.
+// Keyed by the canonical path, the last modified time and the target width
+// of the image, and bounded by the size in bytes of the pixmaps.
+// Resource managers of the editors hold only the keys and look up the images
+// here when painting, so an image previewed in multiple editors is decoded
+// and stored only once. Keys referenced by editors are pinned and will not be
+// evicted, so the cache may exceed its budget while they are in use.
+// Should be used in GUI thread only.
+class VPreviewImageCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit VPreviewImageCache(QObject *p_parent = nullptr);
+
+    ~VPreviewImageCache();
+
+    // Read configurations.
+    void init();
+
+    // Returns the key of image @p_path decoded with target width @p_width.
+    // @p_width: -1 for the original size.
+    // Returns empty if @p_path does not exist.
+    static QString key(const QString &p_path, int p_width);
+
+    // Look up image of @p_key.
+    // The returned image is valid until next insert().
+    const QPixmap *find(const QString &p_key);
+
+    bool contains(const QString &p_key) const;
+
+    // Returns false if @p_image is not cached, such as the cache is disabled.
+    bool insert(const QString &p_key, const QPixmap &p_image);
+
+    // Decode image @p_path downscaled to @p_size in background and insert it
+    // as @p_key. Decodes of the same key in flight are merged.
+    // imageDecoded() will be emitted once it is done.
+    void decodeAsync(const QString &p_key, const QString &p_path, const QSize &p_size);
+
+    // Editors reference image of @p_key. Pinned images will not be evicted.
+    void pin(const QString &p_key);
+
+    void unpin(const QString &p_key);
+
+    void clear();
+
+    int hits() const;
+
+    int misses() const;
+
+    // Size in bytes of all the cached images.
+    qint64 bytes() const;
+
+    qint64 maximumBytes() const;
+
+    int count() const;
+
+signals:
+    // Emit when image of @p_key is decoded by decodeAsync().
+    // @p_image will be null if it fails to decode.
+    void imageDecoded(const QString &p_key, const QPixmap &p_image);
+
+private:
+    struct Entry
+    {
+        Entry() : m_bytes(0)
+        {
+        }
+
+        QString m_key;
+
+        qint64 m_bytes;
+
+        QPixmap m_image;
+    };
+
+    // Evict the least recently used entries which are not pinned until the
+    // size is within budget.
+    void evict();
+
+    // Decode image @p_path downscaled to @p_size.
+    // Thread-safe.
+    static QImage decodeImage(const QString &p_path, const QSize &p_size);
+
+    static qint64 imageBytes(const QPixmap &p_image);
+
+    // Most recently used entries at the front.
+    std::list<Entry> m_entries;
+
+    QHash<QString, std::list<Entry>::iterator> m_index;
+
+    // Keys being decoded in background.
+    QSet<QString> m_decodingKeys;
+
+    // Key -> number of references from the editors.
+    QHash<QString, int> m_pins;
+
+    qint64 m_bytes;
+
+    qint64 m_maxBytes;
+
+    int m_hits;
+
+    int m_misses;
+};
+
+inline bool VPreviewImageCache::contains(const QString &p_key) const
+{
+    return m_index.contains(p_key);
+}
+
+inline int VPreviewImageCache::hits() const
+{
+    return m_hits;
+}
+
+inline int VPreviewImageCache::misses() const
+{
+    return m_misses;
+}
+
+inline qint64 VPreviewImageCache::bytes() const
+{
+    return m_bytes;
+}
+
+inline qint64 VPreviewImageCache::maximumBytes() const
+{
+    return m_maxBytes;
+}
+
+inline int VPreviewImageCache::count() const
+{
+    return m_index.size();
+}
+
+#endif // VPREVIEWIMAGECACHE_H
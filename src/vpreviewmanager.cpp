@@ -5,13 +5,20 @@
 #include <QDir>
 #include <QUrl>
 #include <QVector>
+#include <QImageReader>
+#include <QApplication>
+#include <QDesktopWidget>
 #include "vconfigmanager.h"
 #include "utils/vutils.h"
 #include "vdownloader.h"
 #include "hgmarkdownhighlighter.h"
+#include "vpreviewimagecache.h"
+#include "vlogger.h"
 
 extern VConfigManager *g_config;
 
+extern VPreviewImageCache *g_previewImageCache;
+
 VPreviewManager::VPreviewManager(VMdEditor *p_editor, HGMarkdownHighlighter *p_highlighter)
     : QObject(p_editor),
       m_editor(p_editor),
@@ -21,8 +28,12 @@ VPreviewManager::VPreviewManager(VMdEditor *p_editor, HGMarkdownHighlighter *p_h
       m_timeStamp(0)
 {
     m_downloader = new VDownloader(this);
+    m_downloader->setCacheEnabled(true);
     connect(m_downloader, &VDownloader::downloadFinished,
             this, &VPreviewManager::imageDownloaded);
+
+    connect(g_previewImageCache, &VPreviewImageCache::imageDecoded,
+            this, &VPreviewManager::handleImageDecoded);
 }
 
 void VPreviewManager::imageLinksUpdated(const QVector<VElementRegion> &p_imageRegions)
@@ -165,9 +176,9 @@ void VPreviewManager::fetchImageLinksFromRegions(QVector<ImageLinkInfo> &p_image
 
         p_imageLinks.append(info);
 
-        qDebug() << "image region" << i
-                 << info.m_startPos << info.m_endPos << info.m_blockNumber
-                 << info.m_linkShortUrl << info.m_linkUrl << info.m_isBlock;
+        qCDebug(lcPreview) << "image region" << i
+                           << info.m_startPos << info.m_endPos << info.m_blockNumber
+                           << info.m_linkShortUrl << info.m_linkUrl << info.m_isBlock;
     }
 }
 
@@ -237,23 +248,244 @@ QString VPreviewManager::imageResourceName(const ImageLinkInfo &p_link)
 
     // Add it to the resource.
     QString imgPath = p_link.m_linkUrl;
+    auto savingIt = m_savingImages.find(QDir::cleanPath(imgPath));
+    if (savingIt != m_savingImages.end()) {
+        // Not landed yet. Use a placeholder of the same size.
+        QSize size = savingIt.value().m_size;
+        int maxWidth = maximumImageWidth();
+        if (maxWidth > 0 && size.width() > maxWidth) {
+            size.scale(maxWidth, size.height(), Qt::KeepAspectRatio);
+        }
+
+        savingIt.value().m_name = name;
+        m_pendingImages.insert(name, size);
+        return name;
+    }
+
     QFileInfo info(imgPath);
-    QPixmap image;
     if (info.exists()) {
-        // Local file.
-        image = QPixmap(imgPath);
+        // Local file. Decode it in background and use a placeholder of the
+        // same size before it is ready.
+        if (m_pendingImages.contains(name)
+            || decodeImageAsync(name, imgPath).isValid()) {
+            return name;
+        }
     } else {
         // URL. Try to download it.
         m_downloader->download(imgPath);
         m_urlToName.insert(imgPath, name);
     }
 
-    if (image.isNull()) {
-        return QString();
+    return QString();
+}
+
+int VPreviewManager::maximumImageWidth() const
+{
+    if (!g_config->getEnablePreviewImageConstraint()) {
+        return -1;
+    }
+
+    // The image will be scaled down to the width of the editor when painted.
+    // Use the width of the screen to avoid decoding again on resize.
+    int width = QApplication::desktop()->availableGeometry(m_editor).width();
+    return width * m_editor->devicePixelRatio();
+}
+
+QSize VPreviewManager::decodeImageAsync(const QString &p_name, const QString &p_path)
+{
+    // Only read the header to get the size.
+    QImageReader reader(p_path);
+    QSize size = reader.size();
+    if (!size.isValid()) {
+        // Some formats could not tell the size without decoding.
+        QString key = VPreviewImageCache::key(p_path, -1);
+        addSharedImage(p_name, key, p_path, QSize());
+        const QPixmap *cachedImage = g_previewImageCache->find(key);
+        if (cachedImage) {
+            m_editor->addImage(p_name, key, cachedImage->size());
+            return cachedImage->size();
+        }
+
+        QPixmap image = QPixmap::fromImage(reader.read());
+        if (image.isNull()) {
+            return QSize();
+        }
+
+        addDecodedImage(p_name, key, image);
+        return image.size();
+    }
+
+    int maxWidth = maximumImageWidth();
+    if (maxWidth > 0 && size.width() > maxWidth) {
+        size.scale(maxWidth, size.height(), Qt::KeepAspectRatio);
+    }
+
+    QString key = VPreviewImageCache::key(p_path, size.width());
+    if (key.isEmpty()) {
+        return QSize();
+    }
+
+    addSharedImage(p_name, key, p_path, size);
+
+    // The image may have been decoded by other editors.
+    const QPixmap *cachedImage = g_previewImageCache->find(key);
+    if (cachedImage) {
+        m_editor->addImage(p_name, key, cachedImage->size());
+        return cachedImage->size();
+    }
+
+    m_pendingImages.insert(p_name, size);
+
+    // Other editors may be decoding the same image.
+    m_decodingImages.insert(key, p_name);
+    g_previewImageCache->decodeAsync(key, p_path, size);
+
+    return size;
+}
+
+void VPreviewManager::addSharedImage(const QString &p_name,
+                                     const QString &p_key,
+                                     const QString &p_path,
+                                     const QSize &p_size)
+{
+    SharedImage image;
+    image.m_key = p_key;
+    image.m_path = p_path;
+    image.m_size = p_size;
+    m_sharedImages.insert(p_name, image);
+}
+
+void VPreviewManager::addDecodedImage(const QString &p_name,
+                                      const QString &p_key,
+                                      const QPixmap &p_image)
+{
+    if (g_previewImageCache->contains(p_key)) {
+        m_editor->addImage(p_name, p_key, p_image.size());
+    } else {
+        // Not cached, such as the cache is disabled.
+        m_editor->addImage(p_name, p_image);
+    }
+}
+
+void VPreviewManager::handleImageDecoded(const QString &p_key, const QPixmap &p_image)
+{
+    QList<QString> names = m_decodingImages.values(p_key);
+    if (names.isEmpty()) {
+        return;
+    }
+
+    m_decodingImages.remove(p_key);
+
+    for (auto const & name : names) {
+        imageDecoded(name, p_key, p_image);
+    }
+}
+
+void VPreviewManager::handleImageMissing(const QString &p_name)
+{
+    if (!m_previewEnabled || m_pendingImages.contains(p_name)) {
+        return;
+    }
+
+    auto it = m_sharedImages.find(p_name);
+    if (it == m_sharedImages.end() || !m_editor->containsImage(p_name)) {
+        return;
+    }
+
+    // Decode only this image again. It keeps its place in the layout and the
+    // blocks showing it will be relaid out once it is decoded.
+    qDebug() << "preview image evicted from cache" << p_name;
+    m_pendingImages.insert(p_name, m_editor->imageSize(p_name));
+    m_decodingImages.insert(it.value().m_key, p_name);
+    g_previewImageCache->decodeAsync(it.value().m_key, it.value().m_path, it.value().m_size);
+}
+
+void VPreviewManager::imageDecoded(const QString &p_name,
+                                   const QString &p_key,
+                                   const QPixmap &p_image)
+{
+    auto it = m_pendingImages.find(p_name);
+    if (it == m_pendingImages.end()) {
+        // Abandon obsolete image.
+        return;
+    }
+
+    QSize placeholderSize = it.value();
+    m_pendingImages.erase(it);
+
+    if (p_image.isNull()) {
+        // Do not try it again on every paint if it is decoded before.
+        m_editor->removeImage(p_name);
+        m_sharedImages.remove(p_name);
+        return;
+    }
+
+    if (!m_previewEnabled) {
+        return;
+    }
+
+    addDecodedImage(p_name, p_key, p_image);
+
+    // Relayout only the blocks previewing this image.
+    QSet<int> affectedBlocks;
+    const QSet<int> &blocks = m_highlighter->getPossiblePreviewBlocks();
+    for (auto i : blocks) {
+        QTextBlock block = m_document->findBlockByNumber(i);
+        if (!block.isValid()) {
+            continue;
+        }
+
+        VTextBlockData *blockData = dynamic_cast<VTextBlockData *>(block.userData());
+        if (!blockData) {
+            continue;
+        }
+
+        for (auto info : blockData->getPreviews()) {
+            if (info->m_imageInfo.m_imageName == p_name) {
+                info->m_imageInfo.m_imageSize = p_image.size();
+                affectedBlocks.insert(i);
+            }
+        }
+    }
+
+    qDebug() << "decoded image inserted in resource manager" << p_name
+             << placeholderSize << p_image.size() << affectedBlocks;
+
+    m_editor->relayout(affectedBlocks);
+}
+
+void VPreviewManager::addSavingImage(const QString &p_path, const QSize &p_size)
+{
+    SavingImage image;
+    image.m_size = p_size;
+    m_savingImages.insert(QDir::cleanPath(p_path), image);
+}
+
+void VPreviewManager::savingImageFinished(const QString &p_path)
+{
+    auto it = m_savingImages.find(QDir::cleanPath(p_path));
+    if (it == m_savingImages.end()) {
+        return;
+    }
+
+    QString name = it.value().m_name;
+    m_savingImages.erase(it);
+
+    // Drop the placeholder and preview it from the file.
+    if (!name.isEmpty()) {
+        m_pendingImages.remove(name);
+        emit requestUpdateImageLinks();
+    }
+}
+
+QSize VPreviewManager::previewImageSize(const QString &p_name) const
+{
+    auto it = m_pendingImages.find(p_name);
+    if (it != m_pendingImages.end()) {
+        return it.value();
     }
 
-    m_editor->addImage(name, image);
-    return name;
+    return m_editor->imageSize(p_name);
 }
 
 int VPreviewManager::calculateBlockMargin(const QTextBlock &p_block)
@@ -318,14 +550,14 @@ void VPreviewManager::updateBlockPreviewInfo(TS p_timeStamp,
                                               link.m_padding,
                                               !link.m_isBlock,
                                               name,
-                                              m_editor->imageSize(name));
+                                              previewImageSize(name));
         blockData->insertPreviewInfo(info);
 
         imageCache(PreviewSource::ImageLink).insert(name, p_timeStamp);
 
-        qDebug() << "block" << link.m_blockNumber
-                 << imageCache(PreviewSource::ImageLink).size()
-                 << blockData->toString();
+        qCDebug(lcPreview) << "block" << link.m_blockNumber
+                           << imageCache(PreviewSource::ImageLink).size()
+                           << blockData->toString();
     }
 }
 
@@ -336,6 +568,8 @@ void VPreviewManager::clearObsoleteImages(long long p_timeStamp, PreviewSource p
     for (auto it = cache.begin(); it != cache.end();) {
         if (it.value() < p_timeStamp) {
             m_editor->removeImage(it.key());
+            m_pendingImages.remove(it.key());
+            m_sharedImages.remove(it.key());
             it = cache.erase(it);
         } else {
             ++it;
@@ -349,7 +583,7 @@ void VPreviewManager::clearBlockObsoletePreviewInfo(long long p_timeStamp,
     QSet<int> affectedBlocks;
     QVector<int> obsoleteBlocks;
     auto blocks = m_highlighter->getPossiblePreviewBlocks();
-    qDebug() << "possible preview blocks" << blocks;
+    qCDebug(lcPreview) << "possible preview blocks" << blocks;
     for (auto i : blocks) {
         QTextBlock block = m_document->findBlockByNumber(i);
         if (!block.isValid()) {
@@ -5,7 +5,9 @@
 #include <QString>
 #include <QTextBlock>
 #include <QHash>
+#include <QMultiHash>
 #include <QVector>
+#include <QPixmap>
 #include "hgmarkdownhighlighter.h"
 #include "vmdeditor.h"
 #include "vtextblockdata.h"
@@ -29,10 +31,21 @@ public:
     // Refresh all the preview.
     void refreshPreview();
 
+    // Image @p_path is being saved in background.
+    // Preview it with a placeholder of @p_size before it lands.
+    void addSavingImage(const QString &p_path, const QSize &p_size);
+
+    // Image @p_path has been saved or failed to save.
+    void savingImageFinished(const QString &p_path);
+
 public slots:
     // Image links were updated from the highlighter.
     void imageLinksUpdated(const QVector<VElementRegion> &p_imageRegions);
 
+    // Image @p_name could not be painted since it has been evicted from the
+    // shared cache.
+    void handleImageMissing(const QString &p_name);
+
 signals:
     // Request highlighter to update image links.
     void requestUpdateImageLinks();
@@ -41,6 +54,9 @@ private slots:
     // Non-local image downloaded for preview.
     void imageDownloaded(const QByteArray &p_data, const QString &p_url);
 
+    // Image of @p_key decoded in background by the shared cache.
+    void handleImageDecoded(const QString &p_key, const QPixmap &p_image);
+
 private:
     struct ImageLinkInfo
     {
@@ -113,6 +129,32 @@ private:
     // Returns empty if fail to add the image to the resource manager.
     QString imageResourceName(const ImageLinkInfo &p_link);
 
+    // Start to decode local image @p_path in background.
+    // Returns the size of the image once decoded, or invalid size if @p_path
+    // is not a readable image.
+    QSize decodeImageAsync(const QString &p_name, const QString &p_path);
+
+    // Local image @p_name of @p_key decoded in background for preview.
+    void imageDecoded(const QString &p_name, const QString &p_key, const QPixmap &p_image);
+
+    // Record where image @p_name of @p_key in the shared cache comes from, so
+    // that it could be decoded again once evicted.
+    // @p_size: size to decode to. Invalid for the original size.
+    void addSharedImage(const QString &p_name,
+                        const QString &p_key,
+                        const QString &p_path,
+                        const QSize &p_size);
+
+    // Add decoded image @p_name to the resource manager, referring to the
+    // shared cache if it holds the image.
+    void addDecodedImage(const QString &p_name, const QString &p_key, const QPixmap &p_image);
+
+    // Maximum width of the previewed images in pixels.
+    int maximumImageWidth() const;
+
+    // Size of image @p_name, either in the resource manager or being decoded.
+    QSize previewImageSize(const QString &p_name) const;
+
     // Calculate the block margin (prefix spaces) in pixels.
     int calculateBlockMargin(const QTextBlock &p_block);
 
@@ -140,6 +182,38 @@ private:
     // Used for downloading images.
     QHash<QString, QString> m_urlToName;
 
+    // Map from name in the resource manager to the placeholder size of images
+    // being decoded in background.
+    QHash<QString, QSize> m_pendingImages;
+
+    // Map from key in the shared cache to names of images being decoded.
+    QMultiHash<QString, QString> m_decodingImages;
+
+    struct SharedImage
+    {
+        // Key in the shared cache.
+        QString m_key;
+
+        QString m_path;
+
+        // Size to decode to.
+        QSize m_size;
+    };
+
+    // Map from name in the resource manager to local images in the shared cache.
+    QHash<QString, SharedImage> m_sharedImages;
+
+    struct SavingImage
+    {
+        QSize m_size;
+
+        // Name in the resource manager once previewed.
+        QString m_name;
+    };
+
+    // Map from clean path to images being saved in background.
+    QHash<QString, SavingImage> m_savingImages;
+
     TS m_timeStamp;
 
     // Used to discard obsolete images. One per each preview source.
@@ -0,0 +1,1056 @@
+#include "vsearchindex.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QTimer>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "vconfigmanager.h"
+#include "vconstants.h"
+#include "utils/vutils.h"
+
+extern VConfigManager *g_config;
+
+// Name of the index file in the cache folder of the notebook.
+static const QString c_indexFile = "index.dat";
+
+// Magic and version of the index file.
+static const quint32 c_indexMagic = 0x56534958;
+
+static const quint32 c_indexVersion = 2;
+
+// Types of the records of the index file.
+static const quint8 c_addRecord = 1;
+
+static const quint8 c_removeRecord = 2;
+
+// The index file will be compacted if the number of records exceeds
+// c_compactRatio times the number of notes plus c_compactThreshold.
+static const int c_compactRatio = 2;
+
+static const int c_compactThreshold = 256;
+
+// Terms longer than this will not be indexed.
+static const int c_maxTermLength = 64;
+
+// Maximum number of terms to expand for a prefix query.
+static const int c_maxPrefixExpansion = 256;
+
+// Parameters of BM25.
+static const double c_bm25K1 = 1.2;
+
+static const double c_bm25B = 0.75;
+
+// Interval in ms to collect updates before refreshing.
+static const int c_refreshInterval = 1000;
+
+// Each CJK character is a term since there is no space between words.
+static bool isCJK(QChar p_ch)
+{
+    ushort uc = p_ch.unicode();
+    return (uc >= 0x3040 && uc <= 0x30ff)
+           || (uc >= 0x3400 && uc <= 0x4dbf)
+           || (uc >= 0x4e00 && uc <= 0x9fff)
+           || (uc >= 0xac00 && uc <= 0xd7af)
+           || (uc >= 0xf900 && uc <= 0xfaff);
+}
+
+// Whether @p_line is an ATX header. Update @p_inFence with the fenced code
+// block state.
+static bool isHeaderLine(const QString &p_line, bool &p_inFence)
+{
+    QString line = p_line.trimmed();
+    if (line.startsWith("```") || line.startsWith("~~~")) {
+        p_inFence = !p_inFence;
+        return false;
+    }
+
+    if (p_inFence || !p_line.startsWith('#')) {
+        return false;
+    }
+
+    int level = 0;
+    while (level < p_line.size() && p_line[level] == '#') {
+        ++level;
+    }
+
+    return level <= 6 && level < p_line.size() && p_line[level].isSpace();
+}
+
+static bool isIndexableFile(const QString &p_name)
+{
+    DocType type = VUtils::docTypeFromName(p_name);
+    return type == DocType::Markdown || type == DocType::List;
+}
+
+// Whether @p_path is @p_dir or within it.
+static bool isUnderPath(const QString &p_path, const QString &p_dir)
+{
+    if (p_dir.isEmpty()) {
+        return true;
+    }
+
+    return p_path == p_dir
+           || (p_path.startsWith(p_dir) && p_path[p_dir.size()] == '/');
+}
+
+VSearchIndex::VSearchIndex(const QString &p_notebookPath, QObject *p_parent)
+    : QObject(p_parent),
+      m_notebookPath(p_notebookPath),
+      m_ready(false),
+      m_loadRequested(false)
+{
+    m_indexFile = QDir(g_config->getNotebookCacheFolder(m_notebookPath)).filePath(c_indexFile);
+
+    m_refreshTimer = new QTimer(this);
+    m_refreshTimer->setSingleShot(true);
+    m_refreshTimer->setInterval(c_refreshInterval);
+    connect(m_refreshTimer, &QTimer::timeout,
+            this, &VSearchIndex::startRefresh);
+
+    m_loadWatcher = new QFutureWatcher<VSearchIndexData>(this);
+    connect(m_loadWatcher, &QFutureWatcher<VSearchIndexData>::finished,
+            this, &VSearchIndex::handleLoadFinished);
+
+    m_refreshWatcher = new QFutureWatcher<QVector<VSearchChange>>(this);
+    connect(m_refreshWatcher, &QFutureWatcher<QVector<VSearchChange>>::finished,
+            this, &VSearchIndex::handleRefreshFinished);
+
+    m_writeWatcher = new QFutureWatcher<bool>(this);
+    connect(m_writeWatcher, &QFutureWatcher<bool>::finished,
+            this, &VSearchIndex::handleWriteFinished);
+}
+
+VSearchIndex::~VSearchIndex()
+{
+    m_loadWatcher->waitForFinished();
+    m_refreshWatcher->waitForFinished();
+    m_writeWatcher->waitForFinished();
+
+    if (!m_ready) {
+        return;
+    }
+
+    // Write the rest synchronously.
+    if (m_data.m_compactNeeded) {
+        writeIndex(m_indexFile, m_data.m_docs);
+    } else if (!m_unsavedChanges.isEmpty()) {
+        appendChanges(m_indexFile, m_unsavedChanges);
+    }
+}
+
+void VSearchIndex::init()
+{
+    if (m_ready || m_loadRequested) {
+        return;
+    }
+
+    m_loadRequested = true;
+    m_loadWatcher->setFuture(QtConcurrent::run(&VSearchIndex::loadIndex,
+                                               m_indexFile,
+                                               m_notebookPath));
+}
+
+void VSearchIndex::updatePaths(const QStringList &p_paths)
+{
+    for (auto const & path : p_paths) {
+        if (!m_pendingPaths.contains(path)) {
+            m_pendingPaths.append(path);
+        }
+    }
+
+    m_refreshTimer->start();
+}
+
+bool VSearchIndex::isBusy() const
+{
+    return m_loadWatcher->isRunning() || m_refreshWatcher->isRunning();
+}
+
+void VSearchIndex::handleLoadFinished()
+{
+    m_data = m_loadWatcher->result();
+    m_ready = true;
+
+    saveChanges();
+
+    emit indexUpdated();
+
+    if (!m_pendingPaths.isEmpty()) {
+        m_refreshTimer->start();
+    }
+}
+
+void VSearchIndex::startRefresh()
+{
+    if (!m_ready || m_refreshWatcher->isRunning()) {
+        // Will be started again when finished.
+        return;
+    }
+
+    if (m_pendingPaths.isEmpty()) {
+        return;
+    }
+
+    // Pick the indexed notes under the paths, which are much fewer than all
+    // the notes if not a whole folder is refreshed.
+    QDir rootDir(m_notebookPath);
+    QStringList relativePaths;
+    for (auto const & path : m_pendingPaths) {
+        QString relativePath = QDir::cleanPath(rootDir.relativeFilePath(path));
+        relativePaths.append(relativePath == "." ? QString() : relativePath);
+    }
+
+    QHash<QString, qint64> mtimes;
+    for (auto const & relativePath : relativePaths) {
+        int docId = m_data.m_pathToDoc.value(relativePath, -1);
+        if (docId != -1) {
+            mtimes.insert(relativePath, m_data.m_docs[docId].m_mtime);
+            continue;
+        }
+
+        for (auto it = m_data.m_pathToDoc.constBegin(); it != m_data.m_pathToDoc.constEnd(); ++it) {
+            if (isUnderPath(it.key(), relativePath)) {
+                mtimes.insert(it.key(), m_data.m_docs[it.value()].m_mtime);
+            }
+        }
+    }
+
+    QStringList paths = m_pendingPaths;
+    m_pendingPaths.clear();
+
+    m_refreshWatcher->setFuture(QtConcurrent::run(&VSearchIndex::collectChanges,
+                                                  m_notebookPath,
+                                                  paths,
+                                                  mtimes));
+}
+
+void VSearchIndex::handleRefreshFinished()
+{
+    const QVector<VSearchChange> changes = m_refreshWatcher->result();
+    for (auto const & change : changes) {
+        applyChange(m_data, change);
+    }
+
+    if (!changes.isEmpty()) {
+        m_unsavedChanges += changes;
+        saveChanges();
+
+        emit indexUpdated();
+    }
+
+    if (!m_pendingPaths.isEmpty()) {
+        m_refreshTimer->start();
+    }
+}
+
+void VSearchIndex::saveChanges()
+{
+    if (m_writeWatcher->isRunning()) {
+        // Will be called again when finished.
+        return;
+    }
+
+    if (!m_data.m_compactNeeded
+        && m_data.m_nrRecords + m_unsavedChanges.size()
+           > c_compactRatio * m_data.m_pathToDoc.size() + c_compactThreshold) {
+        m_data.m_compactNeeded = true;
+    }
+
+    if (m_data.m_compactNeeded) {
+        m_data.m_compactNeeded = false;
+        m_data.m_nrRecords = m_data.m_pathToDoc.size();
+        m_unsavedChanges.clear();
+        m_writeWatcher->setFuture(QtConcurrent::run(&VSearchIndex::writeIndex,
+                                                    m_indexFile,
+                                                    m_data.m_docs));
+    } else if (!m_unsavedChanges.isEmpty()) {
+        m_data.m_nrRecords += m_unsavedChanges.size();
+        m_writeWatcher->setFuture(QtConcurrent::run(&VSearchIndex::appendChanges,
+                                                    m_indexFile,
+                                                    m_unsavedChanges));
+        m_unsavedChanges.clear();
+    }
+}
+
+void VSearchIndex::handleWriteFinished()
+{
+    if (!m_writeWatcher->result()) {
+        qWarning() << "fail to write search index" << m_indexFile;
+        // The file may be broken now.
+        m_data.m_compactNeeded = true;
+    }
+
+    saveChanges();
+}
+
+void VSearchIndex::applyChange(VSearchIndexData &p_data, const VSearchChange &p_change)
+{
+    int docId = p_data.m_pathToDoc.value(p_change.m_path, -1);
+    if (docId != -1) {
+        removeDocument(p_data, docId);
+    }
+
+    if (p_change.m_doc.isValid()) {
+        addDocument(p_data, p_change.m_doc);
+    }
+}
+
+VSearchIndexData VSearchIndex::loadIndex(const QString &p_indexFile, const QString &p_notebookPath)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    VSearchIndexData data;
+    if (!readIndex(p_indexFile, data)) {
+        data = VSearchIndexData();
+        data.m_compactNeeded = true;
+    }
+
+    QHash<QString, qint64> mtimes;
+    for (auto const & doc : data.m_docs) {
+        if (doc.isValid()) {
+            mtimes.insert(doc.m_path, doc.m_mtime);
+        }
+    }
+
+    QVector<VSearchChange> changes = collectChanges(p_notebookPath,
+                                                    QStringList(p_notebookPath),
+                                                    mtimes);
+    for (auto const & change : changes) {
+        applyChange(data, change);
+    }
+
+    if (!changes.isEmpty()) {
+        // Rewrite it since it is in background already.
+        data.m_compactNeeded = true;
+    }
+
+    qDebug() << "search index of" << p_notebookPath << "loaded in" << timer.elapsed() << "ms"
+             << data.m_pathToDoc.size() << "notes" << data.m_termDocs.size() << "terms"
+             << changes.size() << "changes";
+
+    return data;
+}
+
+QVector<VSearchChange> VSearchIndex::collectChanges(const QString &p_notebookPath,
+                                                    const QStringList &p_paths,
+                                                    const QHash<QString, qint64> &p_mtimes)
+{
+    QVector<VSearchChange> changes;
+    QDir rootDir(p_notebookPath);
+    for (auto const & path : p_paths) {
+        QString relativePath = QDir::cleanPath(rootDir.relativeFilePath(path));
+        if (relativePath == ".") {
+            relativePath.clear();
+        } else if (relativePath.startsWith("../")
+                   || relativePath == ".."
+                   || QDir::isAbsolutePath(relativePath)) {
+            continue;
+        }
+
+        QSet<QString> visited;
+        QFileInfo info(path);
+        if (info.isFile()) {
+            collectFile(p_notebookPath, relativePath, p_mtimes, &visited, changes);
+        } else if (info.isDir()) {
+            collectDirectory(p_notebookPath, relativePath, p_mtimes, visited, changes);
+        }
+
+        // Remove missing notes.
+        for (auto it = p_mtimes.constBegin(); it != p_mtimes.constEnd(); ++it) {
+            if (isUnderPath(it.key(), relativePath) && !visited.contains(it.key())) {
+                VSearchChange change;
+                change.m_path = it.key();
+                changes.append(change);
+            }
+        }
+    }
+
+    return changes;
+}
+
+void VSearchIndex::collectFile(const QString &p_notebookPath,
+                               const QString &p_relativePath,
+                               const QHash<QString, qint64> &p_mtimes,
+                               QSet<QString> *p_visited,
+                               QVector<VSearchChange> &p_changes)
+{
+    if (!isIndexableFile(p_relativePath)) {
+        return;
+    }
+
+    QString filePath = QDir(p_notebookPath).filePath(p_relativePath);
+    QFileInfo info(filePath);
+    if (!info.isFile()) {
+        return;
+    }
+
+    if (p_visited) {
+        p_visited->insert(p_relativePath);
+    }
+
+    qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+    auto it = p_mtimes.find(p_relativePath);
+    if (it != p_mtimes.end() && it.value() == mtime) {
+        return;
+    }
+
+    VSearchChange change;
+    change.m_path = p_relativePath;
+    change.m_doc = buildDocument(p_relativePath, mtime, VUtils::readFileFromDisk(filePath));
+    p_changes.append(change);
+}
+
+void VSearchIndex::collectDirectory(const QString &p_notebookPath,
+                                    const QString &p_relativePath,
+                                    const QHash<QString, qint64> &p_mtimes,
+                                    QSet<QString> &p_visited,
+                                    QVector<VSearchChange> &p_changes)
+{
+    QDir dir(p_notebookPath);
+    QString dirPath = p_relativePath.isEmpty() ? p_notebookPath
+                                               : dir.filePath(p_relativePath);
+    QJsonObject configJson = VConfigManager::readDirectoryConfig(dirPath);
+    if (configJson.isEmpty()) {
+        return;
+    }
+
+    auto childPath = [&p_relativePath](const QString &p_name) {
+        return p_relativePath.isEmpty() ? p_name : p_relativePath + "/" + p_name;
+    };
+
+    QJsonArray fileJson = configJson[DirConfig::c_files].toArray();
+    for (int i = 0; i < fileJson.size(); ++i) {
+        QString name = fileJson[i].toObject()[DirConfig::c_name].toString();
+        if (!name.isEmpty()) {
+            collectFile(p_notebookPath, childPath(name), p_mtimes, &p_visited, p_changes);
+        }
+    }
+
+    QJsonArray dirJson = configJson[DirConfig::c_subDirectories].toArray();
+    for (int i = 0; i < dirJson.size(); ++i) {
+        QString name = dirJson[i].toObject()[DirConfig::c_name].toString();
+        if (!name.isEmpty()) {
+            collectDirectory(p_notebookPath, childPath(name), p_mtimes, p_visited, p_changes);
+        }
+    }
+}
+
+VSearchDocument VSearchIndex::buildDocument(const QString &p_relativePath,
+                                            qint64 p_mtime,
+                                            const QString &p_content)
+{
+    VSearchDocument doc;
+    doc.m_path = p_relativePath;
+    doc.m_mtime = p_mtime;
+
+    // Content and headings.
+    int pos = 0;
+    bool inFence = false;
+    const QStringList lines = p_content.split('\n');
+    for (auto const & line : lines) {
+        quint8 fields = VSearchIndex::Content;
+        if (isHeaderLine(line, inFence)) {
+            fields |= VSearchIndex::Heading;
+        }
+
+        const QStringList terms = tokenize(line);
+        for (auto const & term : terms) {
+            VSearchPosting &posting = doc.m_postings[term];
+            posting.m_fields |= fields;
+            posting.m_positions.append(pos++);
+        }
+    }
+
+    // File name.
+    const QStringList nameTerms = tokenize(QFileInfo(p_relativePath).completeBaseName());
+    for (auto const & term : nameTerms) {
+        doc.m_postings[term].m_fields |= VSearchIndex::Name;
+    }
+
+    doc.m_length = pos;
+    return doc;
+}
+
+void VSearchIndex::addDocument(VSearchIndexData &p_data, const VSearchDocument &p_doc)
+{
+    Q_ASSERT(p_doc.isValid() && !p_data.m_pathToDoc.contains(p_doc.m_path));
+
+    int docId;
+    if (p_data.m_freeIds.isEmpty()) {
+        docId = p_data.m_docs.size();
+        p_data.m_docs.append(p_doc);
+    } else {
+        docId = p_data.m_freeIds.takeLast();
+        p_data.m_docs[docId] = p_doc;
+    }
+
+    for (auto it = p_doc.m_postings.constBegin(); it != p_doc.m_postings.constEnd(); ++it) {
+        p_data.m_termDocs[it.key()].insert(docId);
+    }
+
+    p_data.m_pathToDoc.insert(p_doc.m_path, docId);
+    p_data.m_totalLength += p_doc.m_length;
+}
+
+void VSearchIndex::removeDocument(VSearchIndexData &p_data, int p_docId)
+{
+    VSearchDocument &doc = p_data.m_docs[p_docId];
+    Q_ASSERT(doc.isValid());
+
+    for (auto it = doc.m_postings.constBegin(); it != doc.m_postings.constEnd(); ++it) {
+        auto tit = p_data.m_termDocs.find(it.key());
+        if (tit == p_data.m_termDocs.end()) {
+            continue;
+        }
+
+        tit.value().remove(p_docId);
+        if (tit.value().isEmpty()) {
+            p_data.m_termDocs.erase(tit);
+        }
+    }
+
+    p_data.m_pathToDoc.remove(doc.m_path);
+    p_data.m_totalLength -= doc.m_length;
+    p_data.m_freeIds.append(p_docId);
+
+    doc = VSearchDocument();
+}
+
+// Write one record of note @p_path. Invalid @p_doc means the note is removed.
+static void writeRecord(QDataStream &p_out, const QString &p_path, const VSearchDocument &p_doc)
+{
+    if (!p_doc.isValid()) {
+        p_out << c_removeRecord << p_path;
+        return;
+    }
+
+    p_out << c_addRecord << p_path << p_doc.m_mtime << p_doc.m_length << p_doc.m_postings.size();
+    for (auto it = p_doc.m_postings.constBegin(); it != p_doc.m_postings.constEnd(); ++it) {
+        p_out << it.key() << it.value().m_fields << it.value().m_positions;
+    }
+}
+
+bool VSearchIndex::readIndex(const QString &p_file, VSearchIndexData &p_data)
+{
+    QFile file(p_file);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0, version = 0;
+    in >> magic >> version;
+    if (magic != c_indexMagic || version != c_indexVersion) {
+        qWarning() << "invalid search index" << p_file;
+        return false;
+    }
+
+    // Replay the records. Later records of the same note override the former.
+    while (!in.atEnd()) {
+        quint8 type = 0;
+        VSearchChange change;
+        in >> type >> change.m_path;
+        if (type == c_addRecord) {
+            VSearchDocument &doc = change.m_doc;
+            int nrTerms = 0;
+            in >> doc.m_mtime >> doc.m_length >> nrTerms;
+            for (int i = 0; i < nrTerms && in.status() == QDataStream::Ok; ++i) {
+                QString term;
+                VSearchPosting posting;
+                in >> term >> posting.m_fields >> posting.m_positions;
+                doc.m_postings.insert(term, posting);
+            }
+
+            doc.m_path = change.m_path;
+        } else if (type != c_removeRecord) {
+            in.setStatus(QDataStream::ReadCorruptData);
+        }
+
+        if (in.status() != QDataStream::Ok || change.m_path.isEmpty()) {
+            // Maybe a record partially written. Drop it and rewrite the file later.
+            qWarning() << "search index truncated" << p_file;
+            p_data.m_compactNeeded = true;
+            break;
+        }
+
+        applyChange(p_data, change);
+        ++p_data.m_nrRecords;
+    }
+
+    return true;
+}
+
+bool VSearchIndex::writeIndex(const QString &p_file, const QVector<VSearchDocument> &p_docs)
+{
+    VUtils::makePath(VUtils::basePathFromPath(p_file));
+    QSaveFile file(p_file);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+
+    out << c_indexMagic << c_indexVersion;
+
+    for (auto const & doc : p_docs) {
+        if (doc.isValid()) {
+            writeRecord(out, doc.m_path, doc);
+        }
+    }
+
+    if (out.status() != QDataStream::Ok) {
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
+}
+
+bool VSearchIndex::appendChanges(const QString &p_file, const QVector<VSearchChange> &p_changes)
+{
+    QFile file(p_file);
+    if (!file.exists()) {
+        // Create a new one with the header.
+        if (!writeIndex(p_file, QVector<VSearchDocument>())) {
+            return false;
+        }
+    }
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+
+    for (auto const & change : p_changes) {
+        writeRecord(out, change.m_path, change.m_doc);
+    }
+
+    file.close();
+    return out.status() == QDataStream::Ok && file.error() == QFileDevice::NoError;
+}
+
+QStringList VSearchIndex::tokenize(const QString &p_text)
+{
+    QStringList terms;
+    QString term;
+
+    auto flush = [&terms, &term]() {
+        if (!term.isEmpty()) {
+            if (term.size() <= c_maxTermLength) {
+                terms.append(term);
+            }
+
+            term.clear();
+        }
+    };
+
+    for (int i = 0; i < p_text.size(); ++i) {
+        QChar ch = p_text[i];
+        if (isCJK(ch)) {
+            flush();
+            terms.append(QString(ch));
+        } else if (ch.isLetterOrNumber() || ch == '_') {
+            term.append(ch.toLower());
+        } else {
+            flush();
+        }
+    }
+
+    flush();
+    return terms;
+}
+
+QVector<VSearchClause> VSearchIndex::parseQuery(const QString &p_query)
+{
+    QVector<VSearchClause> clauses;
+
+    int i = 0;
+    const int size = p_query.size();
+    while (i < size) {
+        if (p_query[i].isSpace()) {
+            ++i;
+            continue;
+        }
+
+        bool quoted = p_query[i] == '"';
+        int start = quoted ? i + 1 : i;
+        int end = start;
+        if (quoted) {
+            end = p_query.indexOf('"', start);
+            if (end == -1) {
+                end = size;
+            }
+
+            i = end + 1;
+        } else {
+            while (end < size && !p_query[end].isSpace()) {
+                ++end;
+            }
+
+            i = end;
+        }
+
+        QString word = p_query.mid(start, end - start);
+
+        VSearchClause clause;
+        clause.m_terms = tokenize(word);
+        if (clause.m_terms.isEmpty()) {
+            continue;
+        }
+
+        if (clause.m_terms.size() > 1) {
+            // Words joined by punctuation such as host names match as a phrase.
+            clause.m_type = VSearchClause::Phrase;
+        } else if (!quoted && word.endsWith('*')) {
+            clause.m_type = VSearchClause::Prefix;
+        }
+
+        clauses.append(clause);
+    }
+
+    return clauses;
+}
+
+double VSearchIndex::scoreTerm(const VSearchDocument &p_doc,
+                               const VSearchPosting &p_posting,
+                               int p_df,
+                               int p_tf) const
+{
+    int nrDocs = m_data.m_pathToDoc.size();
+    if (nrDocs == 0) {
+        return 0;
+    }
+
+    double idf = std::log(1.0 + (nrDocs - p_df + 0.5) / (p_df + 0.5));
+    double avgLength = qMax((double)m_data.m_totalLength / nrDocs, 1.0);
+    double length = p_doc.m_length;
+
+    double score = 0;
+    if (p_tf > 0) {
+        score = idf * p_tf * (c_bm25K1 + 1)
+                / (p_tf + c_bm25K1 * (1 - c_bm25B + c_bm25B * length / avgLength));
+    }
+
+    if (p_posting.m_fields & VSearchIndex::Name) {
+        score += 2 * idf;
+    }
+
+    if (p_posting.m_fields & VSearchIndex::Heading) {
+        score += idf;
+    }
+
+    return score;
+}
+
+QHash<int, double> VSearchIndex::scoreClause(const VSearchClause &p_clause) const
+{
+    QHash<int, double> scores;
+
+    switch (p_clause.m_type) {
+    case VSearchClause::Term:
+    {
+        const QString &term = p_clause.m_terms.first();
+        auto it = m_data.m_termDocs.find(term);
+        if (it == m_data.m_termDocs.end()) {
+            break;
+        }
+
+        const QSet<int> &docIds = it.value();
+        for (auto docId : docIds) {
+            const VSearchDocument &doc = m_data.m_docs[docId];
+            const VSearchPosting posting = doc.m_postings.value(term);
+            scores.insert(docId,
+                          scoreTerm(doc, posting, docIds.size(), posting.m_positions.size()));
+        }
+
+        break;
+    }
+
+    case VSearchClause::Prefix:
+    {
+        const QString &prefix = p_clause.m_terms.first();
+        int nrExpanded = 0;
+        for (auto it = m_data.m_termDocs.lowerBound(prefix);
+             it != m_data.m_termDocs.end() && it.key().startsWith(prefix);
+             ++it) {
+            if (++nrExpanded > c_maxPrefixExpansion) {
+                break;
+            }
+
+            const QSet<int> &docIds = it.value();
+            for (auto docId : docIds) {
+                const VSearchDocument &doc = m_data.m_docs[docId];
+                const VSearchPosting posting = doc.m_postings.value(it.key());
+                double score = scoreTerm(doc, posting, docIds.size(), posting.m_positions.size());
+                auto sit = scores.find(docId);
+                if (sit == scores.end()) {
+                    scores.insert(docId, score);
+                } else if (sit.value() < score) {
+                    sit.value() = score;
+                }
+            }
+        }
+
+        break;
+    }
+
+    case VSearchClause::Phrase:
+    {
+        const int nrTerms = p_clause.m_terms.size();
+        QVector<const QSet<int> *> lists;
+        for (auto const & term : p_clause.m_terms) {
+            auto it = m_data.m_termDocs.find(term);
+            if (it == m_data.m_termDocs.end()) {
+                return scores;
+            }
+
+            lists.append(&it.value());
+        }
+
+        QVector<VSearchPosting> docPostings(nrTerms);
+        for (auto docId : *lists[0]) {
+            const VSearchDocument &doc = m_data.m_docs[docId];
+            bool allFound = true;
+            for (int i = 0; i < nrTerms; ++i) {
+                auto pit = doc.m_postings.find(p_clause.m_terms[i]);
+                if (pit == doc.m_postings.end()) {
+                    allFound = false;
+                    break;
+                }
+
+                docPostings[i] = pit.value();
+            }
+
+            if (!allFound) {
+                continue;
+            }
+
+            int nrOccurs = 0;
+            for (auto pos : docPostings[0].m_positions) {
+                bool matched = true;
+                for (int i = 1; i < nrTerms; ++i) {
+                    const QVector<int> &positions = docPostings[i].m_positions;
+                    if (!std::binary_search(positions.begin(), positions.end(), pos + i)) {
+                        matched = false;
+                        break;
+                    }
+                }
+
+                if (matched) {
+                    ++nrOccurs;
+                }
+            }
+
+            if (nrOccurs == 0) {
+                continue;
+            }
+
+            double score = 0;
+            for (int i = 0; i < nrTerms; ++i) {
+                score += scoreTerm(doc, docPostings[i], lists[i]->size(), nrOccurs);
+            }
+
+            scores.insert(docId, score);
+        }
+
+        break;
+    }
+    }
+
+    return scores;
+}
+
+QVector<VSearchHit> VSearchIndex::search(const QVector<VSearchClause> &p_clauses, int p_limit) const
+{
+    QVector<VSearchHit> hits;
+    if (p_clauses.isEmpty() || p_limit <= 0) {
+        return hits;
+    }
+
+    QHash<int, double> scores = scoreClause(p_clauses.first());
+    for (int i = 1; i < p_clauses.size() && !scores.isEmpty(); ++i) {
+        QHash<int, double> clauseScores = scoreClause(p_clauses[i]);
+        for (auto it = scores.begin(); it != scores.end();) {
+            auto cit = clauseScores.find(it.key());
+            if (cit == clauseScores.end()) {
+                it = scores.erase(it);
+            } else {
+                it.value() += cit.value();
+                ++it;
+            }
+        }
+    }
+
+    QVector<QPair<double, int>> ranks;
+    ranks.reserve(scores.size());
+    for (auto it = scores.constBegin(); it != scores.constEnd(); ++it) {
+        ranks.append(qMakePair(it.value(), it.key()));
+    }
+
+    int nrHits = qMin(p_limit, ranks.size());
+    std::partial_sort(ranks.begin(),
+                      ranks.begin() + nrHits,
+                      ranks.end(),
+                      [](const QPair<double, int> &p_a, const QPair<double, int> &p_b) {
+                          return p_a.first > p_b.first;
+                      });
+
+    QDir rootDir(m_notebookPath);
+    hits.reserve(nrHits);
+    for (int i = 0; i < nrHits; ++i) {
+        VSearchHit hit;
+        hit.m_filePath = rootDir.filePath(m_data.m_docs[ranks[i].second].m_path);
+        hit.m_score = ranks[i].first;
+        hits.append(hit);
+    }
+
+    return hits;
+}
+
+QVector<VSearchHit> VSearchIndex::locateHits(QVector<VSearchHit> p_hits,
+                                             const QVector<VSearchClause> &p_clauses)
+{
+    for (auto & hit : p_hits) {
+        if (!hit.m_located) {
+            locateHit(VUtils::readFileFromDisk(hit.m_filePath), p_clauses, hit);
+        }
+    }
+
+    return p_hits;
+}
+
+// Whether terms of one line @p_terms match @p_clause.
+static bool lineMatchClause(const QStringList &p_terms, const VSearchClause &p_clause)
+{
+    switch (p_clause.m_type) {
+    case VSearchClause::Term:
+        return p_terms.contains(p_clause.m_terms.first());
+
+    case VSearchClause::Prefix:
+        for (auto const & term : p_terms) {
+            if (term.startsWith(p_clause.m_terms.first())) {
+                return true;
+            }
+        }
+
+        return false;
+
+    case VSearchClause::Phrase:
+    {
+        const int nrTerms = p_clause.m_terms.size();
+        for (int i = 0; i + nrTerms <= p_terms.size(); ++i) {
+            bool matched = true;
+            for (int j = 0; j < nrTerms; ++j) {
+                if (p_terms[i + j] != p_clause.m_terms[j]) {
+                    matched = false;
+                    break;
+                }
+            }
+
+            if (matched) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+    }
+
+    return false;
+}
+
+void VSearchIndex::locateHit(const QString &p_content,
+                             const QVector<VSearchClause> &p_clauses,
+                             VSearchHit &p_hit)
+{
+    p_hit.m_located = true;
+
+    // Max length of the snippet.
+    const int c_snippetLength = 160;
+
+    const QStringList lines = p_content.split('\n');
+    int bestLine = -1;
+    int bestHeaderIndex = -1;
+    int nrHeaders = 0;
+    int partialLine = -1;
+    int partialHeaderIndex = -1;
+    bool inFence = false;
+    for (int i = 0; i < lines.size(); ++i) {
+        if (isHeaderLine(lines[i], inFence)) {
+            ++nrHeaders;
+        }
+
+        QStringList terms = tokenize(lines[i]);
+        if (terms.isEmpty()) {
+            continue;
+        }
+
+        int nrMatched = 0;
+        for (auto const & clause : p_clauses) {
+            if (lineMatchClause(terms, clause)) {
+                ++nrMatched;
+            }
+        }
+
+        if (nrMatched == p_clauses.size()) {
+            bestLine = i;
+            bestHeaderIndex = nrHeaders - 1;
+            break;
+        } else if (nrMatched > 0 && partialLine == -1) {
+            partialLine = i;
+            partialHeaderIndex = nrHeaders - 1;
+        }
+    }
+
+    if (bestLine == -1) {
+        bestLine = partialLine;
+        bestHeaderIndex = partialHeaderIndex;
+    }
+
+    if (bestLine == -1) {
+        // Matched by file name only.
+        p_hit.m_lineNumber = -1;
+        p_hit.m_headerIndex = -1;
+        p_hit.m_snippet = lines.isEmpty() ? QString() : lines.first().trimmed().left(c_snippetLength);
+        return;
+    }
+
+    p_hit.m_lineNumber = bestLine;
+    p_hit.m_headerIndex = bestHeaderIndex;
+
+    QString line = lines[bestLine].trimmed();
+    if (line.size() > c_snippetLength) {
+        int idx = line.indexOf(p_clauses.first().m_terms.first(), 0, Qt::CaseInsensitive);
+        int start = qMax(0, qMin(idx - c_snippetLength / 3, line.size() - c_snippetLength));
+        QString snippet = line.mid(start, c_snippetLength);
+        if (start > 0) {
+            snippet.prepend("...");
+        }
+
+        if (start + c_snippetLength < line.size()) {
+            snippet.append("...");
+        }
+
+        line = snippet;
+    }
+
+    p_hit.m_snippet = line;
+}
@@ -0,0 +1,312 @@
+#ifndef VSEARCHINDEX_H
+#define VSEARCHINDEX_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+
+template <typename T> class QFutureWatcher;
+class QTimer;
+
+// Occurrences of one term in one note.
+struct VSearchPosting
+{
+    VSearchPosting() : m_fields(0)
+    {
+    }
+
+    // Bitwise OR of VSearchIndex::Field.
+    quint8 m_fields;
+
+    // Sorted token positions in the content.
+    QVector<int> m_positions;
+};
+
+// One indexed note.
+struct VSearchDocument
+{
+    VSearchDocument() : m_mtime(0), m_length(0)
+    {
+    }
+
+    bool isValid() const
+    {
+        return !m_path.isEmpty();
+    }
+
+    // Path relative to the notebook root.
+    QString m_path;
+
+    // Last modified time in msecs since epoch.
+    qint64 m_mtime;
+
+    // Number of tokens in the content.
+    int m_length;
+
+    // Term -> postings of this note.
+    // Kept per note so that a note could be replaced or removed touching
+    // only its own terms, and saved on its own.
+    QHash<QString, VSearchPosting> m_postings;
+};
+
+// One change of the index to be appended to the index file.
+struct VSearchChange
+{
+    // Relative path of the note.
+    QString m_path;
+
+    // New content of the note. Invalid if the note is removed.
+    VSearchDocument m_doc;
+};
+
+// Inverted index of all the notes of one notebook.
+struct VSearchIndexData
+{
+    VSearchIndexData() : m_totalLength(0), m_nrRecords(0), m_compactNeeded(false)
+    {
+    }
+
+    // Indexed by doc id. Removed documents are left invalid and reused.
+    QVector<VSearchDocument> m_docs;
+
+    QVector<int> m_freeIds;
+
+    // Relative path -> doc id.
+    QHash<QString, int> m_pathToDoc;
+
+    // Term -> ids of the documents containing it. Sorted to support prefix
+    // queries.
+    QMap<QString, QSet<int>> m_termDocs;
+
+    // Sum of the length of all the documents.
+    qint64 m_totalLength;
+
+    // Number of records in the index file.
+    int m_nrRecords;
+
+    // Whether the index file should be rewritten as a whole.
+    bool m_compactNeeded;
+};
+
+// One clause of a query. All the clauses are ANDed.
+struct VSearchClause
+{
+    enum Type
+    {
+        Term = 0,
+        Phrase,
+        Prefix
+    };
+
+    VSearchClause() : m_type(Type::Term)
+    {
+    }
+
+    Type m_type;
+
+    // Tokenized terms. Only Phrase has more than one term.
+    QStringList m_terms;
+};
+
+struct VSearchHit
+{
+    VSearchHit() : m_score(0), m_located(false), m_lineNumber(-1), m_headerIndex(-1)
+    {
+    }
+
+    // Absolute path of the note.
+    QString m_filePath;
+
+    double m_score;
+
+    // Whether the line number, header index, and snippet have been filled by
+    // VSearchIndex::locateHit().
+    bool m_located;
+
+    // Block number of the first matching line. -1 if not located.
+    int m_lineNumber;
+
+    // Index of the header before the matching line. -1 if none.
+    int m_headerIndex;
+
+    QString m_snippet;
+};
+
+// Full-text index of the notes of one notebook, including content, file
+// names and headings.
+// It is persisted in the cache folder of the notebook as a journal: changed
+// notes are appended as records in background, and the file is compacted
+// once there are too many obsolete records.
+// It is loaded and refreshed against the mtime of notes in background. Later
+// updates are collected in background and applied to the index in place.
+// Should be used in GUI thread only.
+class VSearchIndex : public QObject
+{
+    Q_OBJECT
+public:
+    enum Field
+    {
+        Content = 0x1,
+        Name = 0x2,
+        Heading = 0x4
+    };
+
+    VSearchIndex(const QString &p_notebookPath, QObject *p_parent = nullptr);
+
+    ~VSearchIndex();
+
+    // Load the index from disk and refresh it in background.
+    void init();
+
+    // Request to refresh notes or folders @p_paths (absolute) which have been
+    // added, modified, or removed.
+    void updatePaths(const QStringList &p_paths);
+
+    // Return at most @p_limit hits sorted by score.
+    // Hits are not located. Use locateHits() to fill the details.
+    QVector<VSearchHit> search(const QVector<VSearchClause> &p_clauses, int p_limit) const;
+
+    const QString &getNotebookPath() const;
+
+    // Whether the index has been loaded.
+    bool isReady() const;
+
+    // Whether it is refreshing in background.
+    bool isBusy() const;
+
+    int documentCount() const;
+
+    // Parse @p_query into clauses.
+    // Quoted strings are phrases, and a trailing * makes a prefix query.
+    static QVector<VSearchClause> parseQuery(const QString &p_query);
+
+    // Split @p_text into lowercase terms.
+    static QStringList tokenize(const QString &p_text);
+
+    // Locate the best matching line of @p_clauses in @p_content and fill
+    // the line number, header index, and snippet of @p_hit.
+    static void locateHit(const QString &p_content,
+                          const QVector<VSearchClause> &p_clauses,
+                          VSearchHit &p_hit);
+
+    // Read the notes of @p_hits and locate them.
+    // It reads from disk and should be called in background.
+    static QVector<VSearchHit> locateHits(QVector<VSearchHit> p_hits,
+                                          const QVector<VSearchClause> &p_clauses);
+
+signals:
+    // Emitted when the index has been loaded or updated.
+    void indexUpdated();
+
+private slots:
+    void startRefresh();
+
+    void handleLoadFinished();
+
+    void handleRefreshFinished();
+
+    void handleWriteFinished();
+
+private:
+    // Write the unsaved changes or compact the index file in background.
+    void saveChanges();
+
+    // Apply @p_change to @p_data.
+    static void applyChange(VSearchIndexData &p_data, const VSearchChange &p_change);
+
+    // Load the index file and refresh the whole notebook.
+    static VSearchIndexData loadIndex(const QString &p_indexFile, const QString &p_notebookPath);
+
+    // Collect the changes of notes or folders @p_paths (absolute).
+    // @p_mtimes: relative path -> mtime of the indexed notes under @p_paths.
+    static QVector<VSearchChange> collectChanges(const QString &p_notebookPath,
+                                                 const QStringList &p_paths,
+                                                 const QHash<QString, qint64> &p_mtimes);
+
+    // Collect the change of note @p_relativePath if it differs from @p_mtimes.
+    static void collectFile(const QString &p_notebookPath,
+                            const QString &p_relativePath,
+                            const QHash<QString, qint64> &p_mtimes,
+                            QSet<QString> *p_visited,
+                            QVector<VSearchChange> &p_changes);
+
+    // Walk the notes registered in the folder configurations under @p_relativePath.
+    static void collectDirectory(const QString &p_notebookPath,
+                                 const QString &p_relativePath,
+                                 const QHash<QString, qint64> &p_mtimes,
+                                 QSet<QString> &p_visited,
+                                 QVector<VSearchChange> &p_changes);
+
+    // Tokenize the content of a note.
+    static VSearchDocument buildDocument(const QString &p_relativePath,
+                                         qint64 p_mtime,
+                                         const QString &p_content);
+
+    static void addDocument(VSearchIndexData &p_data, const VSearchDocument &p_doc);
+
+    static void removeDocument(VSearchIndexData &p_data, int p_docId);
+
+    static bool readIndex(const QString &p_file, VSearchIndexData &p_data);
+
+    // Rewrite the index file with all the documents @p_docs.
+    static bool writeIndex(const QString &p_file, const QVector<VSearchDocument> &p_docs);
+
+    // Append @p_changes to the index file.
+    static bool appendChanges(const QString &p_file, const QVector<VSearchChange> &p_changes);
+
+    // Score documents matching @p_clause.
+    QHash<int, double> scoreClause(const VSearchClause &p_clause) const;
+
+    double scoreTerm(const VSearchDocument &p_doc,
+                     const VSearchPosting &p_posting,
+                     int p_df,
+                     int p_tf) const;
+
+    QString m_notebookPath;
+
+    // Path of the index file in the cache folder of the notebook.
+    QString m_indexFile;
+
+    VSearchIndexData m_data;
+
+    bool m_ready;
+
+    // Whether a load is requested.
+    bool m_loadRequested;
+
+    // Absolute paths to refresh.
+    QStringList m_pendingPaths;
+
+    // Changes applied but not written to the index file yet.
+    QVector<VSearchChange> m_unsavedChanges;
+
+    // Timer to collect updates.
+    QTimer *m_refreshTimer;
+
+    QFutureWatcher<VSearchIndexData> *m_loadWatcher;
+
+    QFutureWatcher<QVector<VSearchChange>> *m_refreshWatcher;
+
+    QFutureWatcher<bool> *m_writeWatcher;
+};
+
+inline const QString &VSearchIndex::getNotebookPath() const
+{
+    return m_notebookPath;
+}
+
+inline bool VSearchIndex::isReady() const
+{
+    return m_ready;
+}
+
+inline int VSearchIndex::documentCount() const
+{
+    return m_data.m_pathToDoc.size();
+}
+
+#endif // VSEARCHINDEX_H
@@ -0,0 +1,223 @@
+#include "vsearchpanel.h"
+
+#include <QtWidgets>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "vlineedit.h"
+#include "vfulltextsearch.h"
+#include "vmainwindow.h"
+#include "vnotebookselector.h"
+#include "vnote.h"
+#include "vnotefile.h"
+#include "veditarea.h"
+#include "vedittab.h"
+#include "vmdtab.h"
+#include "vmdeditor.h"
+#include "vedittabinfo.h"
+#include "vtableofcontent.h"
+#include "utils/vutils.h"
+
+extern VMainWindow *g_mainWin;
+
+extern VNote *g_vnote;
+
+extern VFullTextSearch *g_fullTextSearch;
+
+// Max number of results to list.
+static const int c_maxResults = 100;
+
+// Interval in ms to search while typing.
+static const int c_searchInterval = 300;
+
+VSearchPanel::VSearchPanel(QWidget *p_parent)
+    : QWidget(p_parent),
+      m_searchStamp(0),
+      m_incomplete(false)
+{
+    m_searchTimer = new QTimer(this);
+    m_searchTimer->setSingleShot(true);
+    m_searchTimer->setInterval(c_searchInterval);
+    connect(m_searchTimer, &QTimer::timeout,
+            this, &VSearchPanel::search);
+
+    setupUI();
+
+    connect(g_fullTextSearch, &VFullTextSearch::indexUpdated,
+            this, &VSearchPanel::handleIndexUpdated);
+}
+
+void VSearchPanel::setupUI()
+{
+    m_queryEdit = new VLineEdit();
+    m_queryEdit->setPlaceholderText(tr("Search notes (\"phrase\", prefix*)"));
+    connect(m_queryEdit, &VLineEdit::textChanged,
+            m_searchTimer, static_cast<void(QTimer::*)()>(&QTimer::start));
+    connect(m_queryEdit, &VLineEdit::returnPressed,
+            this, &VSearchPanel::search);
+
+    m_scopeCB = new QComboBox();
+    m_scopeCB->addItem(tr("All Notebooks"));
+    m_scopeCB->addItem(tr("Current Notebook"));
+    connect(m_scopeCB, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, &VSearchPanel::search);
+
+    m_infoLabel = new QLabel();
+
+    QHBoxLayout *scopeLayout = new QHBoxLayout();
+    scopeLayout->addWidget(m_scopeCB);
+    scopeLayout->addStretch();
+    scopeLayout->addWidget(m_infoLabel);
+    scopeLayout->setContentsMargins(0, 0, 3, 0);
+
+    m_resultList = new QListWidget();
+    m_resultList->setAttribute(Qt::WA_MacShowFocusRect, false);
+    m_resultList->setWordWrap(true);
+    connect(m_resultList, &QListWidget::itemActivated,
+            this, &VSearchPanel::handleItemActivated);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout();
+    mainLayout->addWidget(m_queryEdit);
+    mainLayout->addLayout(scopeLayout);
+    mainLayout->addWidget(m_resultList);
+    mainLayout->setContentsMargins(0, 0, 0, 0);
+
+    setLayout(mainLayout);
+}
+
+void VSearchPanel::showEvent(QShowEvent *p_event)
+{
+    QWidget::showEvent(p_event);
+
+    // Load the indexes in background before the first search.
+    g_fullTextSearch->prepare();
+}
+
+void VSearchPanel::focusInEvent(QFocusEvent *p_event)
+{
+    QWidget::focusInEvent(p_event);
+    m_queryEdit->setFocus();
+}
+
+void VSearchPanel::search()
+{
+    m_searchTimer->stop();
+    ++m_searchStamp;
+
+    const VNotebook *notebook = NULL;
+    if (m_scopeCB->currentIndex() == 1) {
+        notebook = g_mainWin->getNotebookSelector()->currentNotebook();
+        if (!notebook) {
+            m_hits.clear();
+            updateResults();
+            return;
+        }
+    }
+
+    m_hits = g_fullTextSearch->search(m_queryEdit->text(), notebook, c_maxResults);
+    m_clauses = VSearchIndex::parseQuery(m_queryEdit->text());
+    m_incomplete = !g_fullTextSearch->isReady();
+
+    updateResults();
+
+    locateHitsAsync();
+}
+
+void VSearchPanel::locateHitsAsync()
+{
+    if (m_hits.isEmpty()) {
+        return;
+    }
+
+    typedef QFutureWatcher<QVector<VSearchHit>> LocateWatcher;
+    LocateWatcher *watcher = new LocateWatcher(this);
+    int stamp = m_searchStamp;
+    connect(watcher, &LocateWatcher::finished,
+            this, [this, watcher, stamp]() {
+                watcher->deleteLater();
+
+                // Abandon obsolete result.
+                if (stamp != m_searchStamp) {
+                    return;
+                }
+
+                m_hits = watcher->result();
+                for (int i = 0; i < m_hits.size() && i < m_resultList->count(); ++i) {
+                    m_resultList->item(i)->setText(itemText(m_hits[i]));
+                }
+            });
+
+    watcher->setFuture(QtConcurrent::run(&VSearchIndex::locateHits, m_hits, m_clauses));
+}
+
+QString VSearchPanel::itemText(const VSearchHit &p_hit)
+{
+    QString text = QFileInfo(p_hit.m_filePath).fileName();
+    if (!p_hit.m_snippet.isEmpty()) {
+        text += "\n" + p_hit.m_snippet;
+    }
+
+    return text;
+}
+
+void VSearchPanel::updateResults()
+{
+    m_resultList->clear();
+
+    for (int i = 0; i < m_hits.size(); ++i) {
+        const VSearchHit &hit = m_hits[i];
+        QListWidgetItem *item = new QListWidgetItem(itemText(hit));
+        item->setToolTip(hit.m_filePath);
+        item->setData(Qt::UserRole, i);
+        m_resultList->addItem(item);
+    }
+
+    if (m_incomplete) {
+        m_infoLabel->setText(tr("Indexing..."));
+    } else if (m_queryEdit->text().isEmpty()) {
+        m_infoLabel->clear();
+    } else {
+        m_infoLabel->setText(tr("%1 Items").arg(m_hits.size()));
+    }
+}
+
+void VSearchPanel::handleIndexUpdated()
+{
+    if (m_incomplete && isVisible()) {
+        m_searchTimer->start();
+    }
+}
+
+void VSearchPanel::handleItemActivated(QListWidgetItem *p_item)
+{
+    int idx = p_item->data(Qt::UserRole).toInt();
+    if (idx < 0 || idx >= m_hits.size()) {
+        return;
+    }
+
+    VSearchHit &hit = m_hits[idx];
+    if (!hit.m_located) {
+        // Not located in background yet.
+        VSearchIndex::locateHit(VUtils::readFileFromDisk(hit.m_filePath), m_clauses, hit);
+    }
+
+    VNoteFile *file = g_vnote->getInternalFile(hit.m_filePath);
+    if (!file) {
+        return;
+    }
+
+    VEditTab *tab = g_mainWin->getEditArea()->openFile(file, OpenFileMode::Read);
+    if (!tab) {
+        return;
+    }
+
+    const VMdTab *mdTab = dynamic_cast<const VMdTab *>(tab);
+    if (mdTab && mdTab->isEditMode() && hit.m_lineNumber > -1) {
+        mdTab->getEditor()->scrollToBlock(hit.m_lineNumber);
+    } else if (hit.m_headerIndex > -1) {
+        // Restore later if the tab is not ready yet.
+        VEditTabInfo info;
+        info.m_editTab = tab;
+        info.m_headerIndex = hit.m_headerIndex;
+        tab->tryRestoreFromTabInfo(info);
+    }
+}
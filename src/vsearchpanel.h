@@ -0,0 +1,70 @@
+#ifndef VSEARCHPANEL_H
+#define VSEARCHPANEL_H
+
+#include <QWidget>
+#include <QVector>
+
+#include "vsearchindex.h"
+
+class VLineEdit;
+class QComboBox;
+class QLabel;
+class QListWidget;
+class QListWidgetItem;
+class QTimer;
+
+// Panel to search notes via the full-text index and list the results.
+// Activating a result opens the note at the matching place.
+class VSearchPanel : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit VSearchPanel(QWidget *p_parent = nullptr);
+
+protected:
+    void showEvent(QShowEvent *p_event) Q_DECL_OVERRIDE;
+
+    void focusInEvent(QFocusEvent *p_event) Q_DECL_OVERRIDE;
+
+private slots:
+    void search();
+
+    void handleItemActivated(QListWidgetItem *p_item);
+
+    // Re-run the query if the index is updated.
+    void handleIndexUpdated();
+
+private:
+    void setupUI();
+
+    void updateResults();
+
+    // Locate the hits in background and fill the results when done.
+    void locateHitsAsync();
+
+    static QString itemText(const VSearchHit &p_hit);
+
+    VLineEdit *m_queryEdit;
+
+    QComboBox *m_scopeCB;
+
+    QLabel *m_infoLabel;
+
+    QListWidget *m_resultList;
+
+    // Timer to search while typing.
+    QTimer *m_searchTimer;
+
+    QVector<VSearchHit> m_hits;
+
+    // Clauses of the query of m_hits.
+    QVector<VSearchClause> m_clauses;
+
+    // Increased on each search to abandon obsolete locating results.
+    int m_searchStamp;
+
+    // Whether the last search was done before the index was ready.
+    bool m_incomplete;
+};
+
+#endif // VSEARCHPANEL_H
@@ -9,6 +9,9 @@
 #include <QFont>
 #include <QPainter>
 #include <QDebug>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QtMath>
 
 #include "vimageresourcemanager2.h"
 #include "vtextedit.h"
@@ -17,12 +20,20 @@
 #define MARKER_THICKNESS        2
 #define MAX_INLINE_IMAGE_HEIGHT 400
 
+// Number of blocks below the paint clip to lay out in advance.
+#define PREFETCH_BLOCKS         50
+
+// Time in ms to lay out estimated blocks in one idle chunk.
+#define REFINE_CHUNK_TIME       10
+
+// Interval in ms between idle chunks.
+#define REFINE_INTERVAL         20
+
 VTextDocumentLayout::VTextDocumentLayout(QTextDocument *p_doc,
                                          VImageResourceManager2 *p_imageMgr)
     : QAbstractTextDocumentLayout(p_doc),
       m_margin(p_doc->documentMargin()),
       m_width(0),
-      m_maximumWidthBlockNumber(-1),
       m_height(0),
       m_lineLeading(0),
       m_blockCount(0),
@@ -37,8 +48,19 @@ VTextDocumentLayout::VTextDocumentLayout(QTextDocument *p_doc,
       m_lastCursorBlockWidth(-1),
       m_highlightCursorLineBlock(false),
       m_cursorLineBlockBg("#C0C0C0"),
-      m_cursorLineBlockNumber(-1)
+      m_cursorLineBlockNumber(-1),
+      m_lazyLayoutThreshold(0),
+      m_nrEstimatedBlocks(0),
+      m_refineBlockNumber(0),
+      m_firstPaintedBlockNumber(-1),
+      m_estimatedCharWidth(0),
+      m_estimatedLineHeight(0)
 {
+    m_refineTimer = new QTimer(this);
+    m_refineTimer->setSingleShot(true);
+    m_refineTimer->setInterval(REFINE_INTERVAL);
+    connect(m_refineTimer, &QTimer::timeout,
+            this, &VTextDocumentLayout::refineEstimatedBlocks);
 }
 
 static void fillBackground(QPainter *p_painter,
@@ -64,53 +86,6 @@ static void fillBackground(QPainter *p_painter,
     p_painter->restore();
 }
 
-void VTextDocumentLayout::blockRangeFromRect(const QRectF &p_rect,
-                                             int &p_first,
-                                             int &p_last) const
-{
-    if (p_rect.isNull()) {
-        p_first = 0;
-        p_last = m_blocks.size() - 1;
-        return;
-    }
-
-    p_first = -1;
-    p_last = m_blocks.size() - 1;
-    int y = p_rect.y();
-    Q_ASSERT(document()->blockCount() == m_blocks.size());
-    QTextBlock block = document()->firstBlock();
-    while (block.isValid()) {
-        const BlockInfo &info = m_blocks[block.blockNumber()];
-        Q_ASSERT(info.hasOffset());
-
-        if (info.top() == y
-            || (info.top() < y && info.bottom() >= y)) {
-            p_first = block.blockNumber();
-            break;
-        }
-
-        block = block.next();
-    }
-
-    if (p_first == -1) {
-        p_last = -1;
-        return;
-    }
-
-    y += p_rect.height();
-    while (block.isValid()) {
-        const BlockInfo &info = m_blocks[block.blockNumber()];
-        Q_ASSERT(info.hasOffset());
-
-        if (info.bottom() > y) {
-            p_last = block.blockNumber();
-            break;
-        }
-
-        block = block.next();
-    }
-}
-
 void VTextDocumentLayout::blockRangeFromRectBS(const QRectF &p_rect,
                                                int &p_first,
                                                int &p_last) const
@@ -130,58 +105,17 @@ void VTextDocumentLayout::blockRangeFromRectBS(const QRectF &p_rect,
         return;
     }
 
-    int y = p_rect.bottom();
-    QTextBlock block = document()->findBlockByNumber(p_first);
-
-    if (m_blocks[p_first].top() == p_rect.top()
+    if (blockTop(p_first) == p_rect.top()
         && p_first > 0) {
         --p_first;
     }
 
-    p_last = m_blocks.size() - 1;
-    while (block.isValid()) {
-        const BlockInfo &info = m_blocks[block.blockNumber()];
-        Q_ASSERT(info.hasOffset());
-
-        if (info.bottom() > y) {
-            p_last = block.blockNumber();
-            break;
-        }
-
-        block = block.next();
-    }
+    p_last = m_heightTree.findBlock(p_rect.bottom());
 }
 
 int VTextDocumentLayout::findBlockByPosition(const QPointF &p_point) const
 {
-    int first = 0, last = m_blocks.size() - 1;
-    int y = p_point.y();
-    while (first <= last) {
-        int mid = (first + last) / 2;
-        const BlockInfo &info = m_blocks[mid];
-        Q_ASSERT(info.hasOffset());
-        if (info.top() <= y && info.bottom() > y) {
-            // Found it.
-            return mid;
-        } else if (info.top() > y) {
-            last = mid - 1;
-        } else {
-            first = mid + 1;
-        }
-    }
-
-    int idx = previousValidBlockNumber(m_blocks.size());
-    if (y >= m_blocks[idx].bottom()) {
-        return idx;
-    }
-
-    idx = nextValidBlockNumber(-1);
-    if (y < m_blocks[idx].top()) {
-        return idx;
-    }
-
-    Q_ASSERT(false);
-    return -1;
+    return m_heightTree.findBlock(p_point.y());
 }
 
 void VTextDocumentLayout::draw(QPainter *p_painter, const PaintContext &p_context)
@@ -193,9 +127,22 @@ void VTextDocumentLayout::draw(QPainter *p_painter, const PaintContext &p_contex
         return;
     }
 
+    if (m_nrEstimatedBlocks > 0) {
+        // Lay out estimated blocks to paint. The range may change after that.
+        while (layoutEstimatedBlocks(first, qMin(last + PREFETCH_BLOCKS, m_blocks.size() - 1))) {
+            blockRangeFromRectBS(p_context.clip, first, last);
+        }
+
+        updateDocumentSize();
+    }
+
+    if (!p_context.clip.isNull()) {
+        m_firstPaintedBlockNumber = first;
+    }
+
     QTextDocument *doc = document();
     Q_ASSERT(doc->blockCount() == m_blocks.size());
-    QPointF offset(m_margin, m_blocks[first].top());
+    QPointF offset(m_margin, blockTop(first));
     QTextBlock block = doc->findBlockByNumber(first);
     QTextBlock lastBlock = doc->findBlockByNumber(last);
 
@@ -204,8 +151,6 @@ void VTextDocumentLayout::draw(QPainter *p_painter, const PaintContext &p_contex
 
     while (block.isValid()) {
         const BlockInfo &info = m_blocks[block.blockNumber()];
-        Q_ASSERT(info.hasOffset());
-
         const QRectF &rect = info.m_rect;
         QTextLayout *layout = block.layout();
 
@@ -352,11 +297,13 @@ int VTextDocumentLayout::hitTest(const QPointF &p_point, Qt::HitTestAccuracy p_a
         return -1;
     }
 
+    ensureBlockLayout(bn);
+
     QTextBlock block = document()->findBlockByNumber(bn);
     Q_ASSERT(block.isValid());
     QTextLayout *layout = block.layout();
     int off = 0;
-    QPointF pos = p_point - QPointF(m_margin, m_blocks[bn].top());
+    QPointF pos = p_point - QPointF(m_margin, blockTop(bn));
     for (int i = 0; i < layout->lineCount(); ++i) {
         QTextLine line = layout->lineAt(i);
         const QRectF lr = line.naturalTextRect();
@@ -397,11 +344,15 @@ QRectF VTextDocumentLayout::blockBoundingRect(const QTextBlock &p_block) const
         return QRectF();
     }
 
+    ensureBlockLayout(p_block.blockNumber());
+
     const BlockInfo &info = m_blocks[p_block.blockNumber()];
-    QRectF geo = info.m_rect.adjusted(0, info.m_offset, 0, info.m_offset);
-    Q_ASSERT(info.hasOffset());
+    if (info.m_rect.isNull()) {
+        return QRectF();
+    }
 
-    return geo;
+    qreal top = blockTop(p_block.blockNumber());
+    return info.m_rect.adjusted(0, top, 0, top);
 }
 
 void VTextDocumentLayout::documentChanged(int p_from, int p_charsRemoved, int p_charsAdded)
@@ -418,47 +369,44 @@ void VTextDocumentLayout::documentChanged(int p_from, int p_charsRemoved, int p_
     // May be an invalid block.
     QTextBlock changeEndBlock = doc->findBlock(qMax(0, p_from + charsChanged));
 
-    bool needRelayout = false;
     if (changeStartBlock == changeEndBlock
         && newBlockCount == m_blockCount) {
         // Change single block internal only.
         QTextBlock block = changeStartBlock;
         if (block.isValid() && block.length()) {
-            QRectF oldBr = blockBoundingRect(block);
+            qreal oldHeight = m_heightTree.height(block.blockNumber());
             clearBlockLayout(block);
             layoutBlock(block);
-            QRectF newBr = blockBoundingRect(block);
             // Only one block is affected.
-            if (newBr.height() == oldBr.height()) {
+            if (m_heightTree.height(block.blockNumber()) == oldHeight) {
                 // Update document size.
-                updateDocumentSizeWithOneBlockChanged(block.blockNumber());
+                updateDocumentSize();
 
                 emit updateBlock(block);
                 return;
             }
         }
     } else {
-        // Clear layout of all affected blocks.
+        // Blocks behind the change are only shifted.
+        updateBlockCount(newBlockCount, changeStartBlock.blockNumber());
+
+        // Relayout all affected blocks.
+        int endNumber = changeEndBlock.isValid() ? changeEndBlock.blockNumber()
+                                                 : newBlockCount - 1;
+        bool lazy = isLazyLayout(endNumber - changeStartBlock.blockNumber() + 1);
+        if (lazy) {
+            updateEstimationMetrics();
+        }
+
         QTextBlock block = changeStartBlock;
         do {
             clearBlockLayout(block);
-            if (block == changeEndBlock) {
-                break;
+            if (lazy) {
+                estimateBlock(block);
+            } else {
+                layoutBlock(block);
             }
 
-            block = block.next();
-        } while(block.isValid());
-
-        needRelayout = true;
-    }
-
-    updateBlockCount(newBlockCount, changeStartBlock.blockNumber());
-
-    if (needRelayout) {
-        // Relayout all affected blocks.
-        QTextBlock block = changeStartBlock;
-        do {
-            layoutBlock(block);
             if (block == changeEndBlock) {
                 break;
             }
@@ -470,8 +418,7 @@ void VTextDocumentLayout::documentChanged(int p_from, int p_charsRemoved, int p_
     updateDocumentSize();
 
     // TODO: Update the view of all the blocks after changeStartBlock.
-    const BlockInfo &firstInfo = m_blocks[changeStartBlock.blockNumber()];
-    emit update(QRectF(0., firstInfo.m_offset, 1000000000., 1000000000.));
+    emit update(QRectF(0., blockTop(changeStartBlock.blockNumber()), 1000000000., 1000000000.));
 }
 
 void VTextDocumentLayout::clearBlockLayout(QTextBlock &p_block)
@@ -479,72 +426,42 @@ void VTextDocumentLayout::clearBlockLayout(QTextBlock &p_block)
     p_block.clearLayout();
     int num = p_block.blockNumber();
     if (num < m_blocks.size()) {
-        m_blocks[num].reset();
-        clearOffsetFrom(num + 1);
-    }
-}
-
-void VTextDocumentLayout::clearOffsetFrom(int p_blockNumber)
-{
-    for (int i = p_blockNumber; i < m_blocks.size(); ++i) {
-        if (!m_blocks[i].hasOffset()) {
-            Q_ASSERT(validateBlocks());
-            break;
+        if (m_blocks[num].m_estimated) {
+            --m_nrEstimatedBlocks;
         }
 
-        m_blocks[i].m_offset = -1;
-    }
-}
-
-void VTextDocumentLayout::fillOffsetFrom(int p_blockNumber)
-{
-    qreal offset = m_blocks[p_blockNumber].bottom();
-    for (int i = p_blockNumber + 1; i < m_blocks.size(); ++i) {
-        BlockInfo &info = m_blocks[i];
-        if (!info.m_rect.isNull()) {
-            info.m_offset = offset;
-            offset += info.m_rect.height();
-        } else {
-            break;
-        }
+        m_blocks[num].reset();
+        m_heightTree.setBlock(num, 0, 0);
     }
 }
 
-bool VTextDocumentLayout::validateBlocks() const
+void VTextDocumentLayout::updateBlockCount(int p_count, int p_changeStartBlock)
 {
-    bool valid = true;
-    for (int i = 0; i < m_blocks.size(); ++i) {
-        const BlockInfo &info = m_blocks[i];
-        if (!info.hasOffset()) {
-            valid = false;
-        } else if (!valid) {
-            return false;
-        }
+    if (m_blockCount == p_count) {
+        return;
     }
 
-    return true;
-}
-
-void VTextDocumentLayout::updateBlockCount(int p_count, int p_changeStartBlock)
-{
-    if (m_blockCount != p_count) {
-        m_blockCount = p_count;
-        m_blocks.resize(m_blockCount);
-
-        // Fix m_blocks.
-        QTextBlock block = document()->findBlockByNumber(p_changeStartBlock);
-        while (block.isValid()) {
-            BlockInfo &info = m_blocks[block.blockNumber()];
-            info.reset();
-
-            QRectF br = blockRectFromTextLayout(block);
-            if (!br.isNull()) {
-                info.m_rect = br;
+    // Blocks after the change start block are inserted or removed.
+    int pos = qMin(p_changeStartBlock + 1, m_blocks.size());
+    if (p_count > m_blockCount) {
+        int nr = p_count - m_blockCount;
+        m_blocks.insert(pos, nr, BlockInfo());
+        m_heightTree.insert(pos, nr);
+    } else {
+        int nr = m_blockCount - p_count;
+        for (int i = pos; i < pos + nr; ++i) {
+            if (m_blocks[i].m_estimated) {
+                --m_nrEstimatedBlocks;
             }
-
-            block = block.next();
         }
+
+        m_blocks.remove(pos, nr);
+        m_heightTree.remove(pos, nr);
     }
+
+    m_blockCount = p_count;
+    Q_ASSERT(m_blocks.size() == m_blockCount);
+    Q_ASSERT(m_heightTree.count() == m_blockCount);
 }
 
 void VTextDocumentLayout::layoutBlock(const QTextBlock &p_block)
@@ -688,15 +605,14 @@ void VTextDocumentLayout::finishBlockLayout(const QTextBlock &p_block,
     Q_ASSERT(m_blocks.size() > num);
     ImagePaintInfo ipi;
     BlockInfo &info = m_blocks[num];
+    if (info.m_estimated) {
+        --m_nrEstimatedBlocks;
+    }
+
     info.reset();
     info.m_rect = blockRectFromTextLayout(p_block, &ipi);
     Q_ASSERT(!info.m_rect.isNull());
-    int pre = previousValidBlockNumber(num);
-    if (pre == -1) {
-        info.m_offset = 0;
-    } else if (m_blocks[pre].hasOffset()) {
-        info.m_offset = m_blocks[pre].bottom();
-    }
+    m_heightTree.setBlock(num, info.m_rect.height(), info.m_rect.width());
 
     bool hasImage = false;
     if (ipi.isValid()) {
@@ -721,53 +637,19 @@ void VTextDocumentLayout::finishBlockLayout(const QTextBlock &p_block,
 
         info.m_markers.append(mk);
     }
-
-    if (info.hasOffset()) {
-        fillOffsetFrom(num);
-    }
-}
-
-int VTextDocumentLayout::previousValidBlockNumber(int p_number) const
-{
-    return p_number >= 0 ? p_number - 1 : -1;
-}
-
-int VTextDocumentLayout::nextValidBlockNumber(int p_number) const
-{
-    if (p_number <= -1) {
-        return 0;
-    } else if (p_number >= m_blocks.size() - 1) {
-        return -1;
-    } else {
-        return p_number + 1;
-    }
 }
 
 void VTextDocumentLayout::updateDocumentSize()
 {
-    // The last valid block.
-    int idx = previousValidBlockNumber(m_blocks.size());
-    Q_ASSERT(idx > -1);
-    if (m_blocks[idx].hasOffset()) {
-        int oldHeight = m_height;
-        int oldWidth = m_width;
-
-        m_height = m_blocks[idx].bottom();
-
-        m_width = 0;
-        for (int i = 0; i < m_blocks.size(); ++i) {
-            const BlockInfo &info = m_blocks[i];
-            Q_ASSERT(info.hasOffset());
-            if (m_width < info.m_rect.width()) {
-                m_width = info.m_rect.width();
-                m_maximumWidthBlockNumber = i;
-            }
-        }
+    qreal oldHeight = m_height;
+    qreal oldWidth = m_width;
 
-        if (oldHeight != m_height
-            || oldWidth != m_width) {
-            emit documentSizeChanged(documentSize());
-        }
+    m_height = m_heightTree.totalHeight();
+    m_width = m_heightTree.maximumWidth();
+
+    if (oldHeight != m_height
+        || oldWidth != m_width) {
+        emit documentSizeChanged(documentSize());
     }
 }
 
@@ -840,20 +722,6 @@ QRectF VTextDocumentLayout::blockRectFromTextLayout(const QTextBlock &p_block,
     return br;
 }
 
-void VTextDocumentLayout::updateDocumentSizeWithOneBlockChanged(int p_blockNumber)
-{
-    const BlockInfo &info = m_blocks[p_blockNumber];
-    qreal width = info.m_rect.width();
-    if (width > m_width) {
-        m_width = width;
-        m_maximumWidthBlockNumber = p_blockNumber;
-        emit documentSizeChanged(documentSize());
-    } else if (width < m_width && p_blockNumber == m_maximumWidthBlockNumber) {
-        // Shrink the longest block.
-        updateDocumentSize();
-    }
-}
-
 void VTextDocumentLayout::setLineLeading(qreal p_leading)
 {
     if (p_leading >= 0) {
@@ -924,6 +792,10 @@ void VTextDocumentLayout::drawImages(QPainter *p_painter,
     for (auto const & img : images) {
         const QPixmap *image = m_imageMgr->findImage(img.m_name);
         if (!image) {
+            if (m_imageMgr->contains(img.m_name)) {
+                emit imageMissing(img.m_name);
+            }
+
             continue;
         }
 
@@ -974,9 +846,20 @@ void VTextDocumentLayout::relayout()
         block = block.previous();
     }
 
+    // Estimate all the blocks and leave the layout to painting and idle time.
+    bool lazy = isLazyLayout(doc->blockCount());
+    if (lazy) {
+        updateEstimationMetrics();
+    }
+
     block = doc->firstBlock();
     while (block.isValid()) {
-        layoutBlock(block);
+        if (lazy) {
+            estimateBlock(block);
+        } else {
+            layoutBlock(block);
+        }
+
         block = block.next();
     }
 
@@ -1119,3 +1002,147 @@ void VTextDocumentLayout::updateBlockByNumber(int p_blockNumber)
         emit updateBlock(block);
     }
 }
+
+void VTextDocumentLayout::setLazyLayoutThreshold(int p_count)
+{
+    m_lazyLayoutThreshold = p_count;
+}
+
+bool VTextDocumentLayout::isLazyLayout(int p_count) const
+{
+    return m_lazyLayoutThreshold > 0 && p_count > m_lazyLayoutThreshold;
+}
+
+void VTextDocumentLayout::updateEstimationMetrics()
+{
+    QFontMetricsF fm(document()->defaultFont());
+    m_estimatedCharWidth = fm.averageCharWidth();
+    m_estimatedLineHeight = fm.lineSpacing();
+}
+
+void VTextDocumentLayout::estimateBlock(const QTextBlock &p_block)
+{
+    QTextDocument *doc = document();
+    int num = p_block.blockNumber();
+    Q_ASSERT(m_blocks.size() > num);
+
+    qreal availableWidth = doc->pageSize().width();
+    if (availableWidth <= 0) {
+        availableWidth = qreal(INT_MAX);
+    }
+
+    availableWidth -= (2 * m_margin + m_cursorMargin + m_cursorWidth);
+
+    qreal textWidth = (p_block.length() - 1) * m_estimatedCharWidth;
+    int lines = 1;
+    if (doc->defaultTextOption().wrapMode() != QTextOption::NoWrap
+        && availableWidth > 0) {
+        lines = qMax(1, qCeil(textWidth / availableWidth));
+        textWidth = qMin(textWidth, availableWidth);
+    }
+
+    qreal height = lines * (m_estimatedLineHeight + m_lineLeading);
+    if (!p_block.next().isValid()) {
+        height += m_margin;
+    }
+
+    BlockInfo &info = m_blocks[num];
+    if (!info.m_estimated) {
+        ++m_nrEstimatedBlocks;
+    }
+
+    info.reset();
+    info.m_rect = QRectF(0, 0, textWidth + 2 * m_margin + m_cursorWidth, height);
+    info.m_estimated = true;
+
+    const_cast<QTextBlock &>(p_block).setLineCount(p_block.isVisible() ? lines : 0);
+
+    m_heightTree.setBlock(num, info.m_rect.height(), info.m_rect.width());
+
+    if (!m_refineTimer->isActive()) {
+        m_refineTimer->start();
+    }
+}
+
+bool VTextDocumentLayout::layoutEstimatedBlocks(int p_first, int p_last)
+{
+    bool changed = false;
+    QTextBlock block = document()->findBlockByNumber(p_first);
+    while (block.isValid() && block.blockNumber() <= p_last) {
+        int num = block.blockNumber();
+        if (m_blocks[num].m_estimated) {
+            qreal oldHeight = m_heightTree.height(num);
+            layoutBlock(block);
+            if (m_heightTree.height(num) != oldHeight) {
+                changed = true;
+            }
+        }
+
+        block = block.next();
+    }
+
+    return changed;
+}
+
+void VTextDocumentLayout::ensureBlockLayout(int p_blockNumber) const
+{
+    if (p_blockNumber < 0
+        || p_blockNumber >= m_blocks.size()
+        || !m_blocks[p_blockNumber].m_estimated) {
+        return;
+    }
+
+    // The document size will be updated in next painting or idle chunk.
+    VTextDocumentLayout *layout = const_cast<VTextDocumentLayout *>(this);
+    layout->layoutBlock(document()->findBlockByNumber(p_blockNumber));
+    if (!m_refineTimer->isActive()) {
+        m_refineTimer->start();
+    }
+}
+
+void VTextDocumentLayout::refineEstimatedBlocks()
+{
+    if (m_nrEstimatedBlocks == 0) {
+        updateDocumentSize();
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QTextDocument *doc = document();
+    QTextBlock block = doc->findBlockByNumber(m_refineBlockNumber);
+    qreal deltaAbove = 0;
+    int nrVisited = 0;
+    while (m_nrEstimatedBlocks > 0
+           && nrVisited < m_blocks.size()
+           && timer.elapsed() < REFINE_CHUNK_TIME) {
+        if (!block.isValid()) {
+            block = doc->firstBlock();
+        }
+
+        int num = block.blockNumber();
+        if (m_blocks[num].m_estimated) {
+            qreal oldHeight = m_heightTree.height(num);
+            layoutBlock(block);
+            if (num < m_firstPaintedBlockNumber) {
+                deltaAbove += m_heightTree.height(num) - oldHeight;
+            }
+        }
+
+        block = block.next();
+        ++nrVisited;
+    }
+
+    m_refineBlockNumber = block.isValid() ? block.blockNumber() : 0;
+
+    updateDocumentSize();
+
+    if (deltaAbove != 0) {
+        emit heightAboveViewChanged(deltaAbove);
+    }
+
+    if (m_nrEstimatedBlocks > 0) {
+        m_refineTimer->start();
+    }
+}
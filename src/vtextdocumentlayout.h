@@ -6,8 +6,10 @@
 #include <QSize>
 #include <QSet>
 #include "vconstants.h"
+#include "vblockheighttree.h"
 
 class VImageResourceManager2;
+class QTimer;
 struct VPreviewedImageInfo;
 struct VPreviewInfo;
 
@@ -70,13 +72,30 @@ public:
     // Request update block by block number.
     void updateBlockByNumber(int p_blockNumber);
 
+    // Lay out blocks lazily if more than @p_count blocks need to be laid out
+    // at once. 0 to disable.
+    void setLazyLayoutThreshold(int p_count);
+
 signals:
     // Emit to update current cursor block width if m_cursorBlockMode is enabled.
     void cursorBlockWidthUpdated(int p_width);
 
+    // Emit when estimated blocks above the painted area are laid out in idle
+    // time and change the height by @p_delta, so that the view could keep
+    // its contents still.
+    void heightAboveViewChanged(qreal p_delta);
+
+    // Emit when image @p_name in the resource manager could not be painted
+    // since it has been evicted from the shared cache.
+    void imageMissing(const QString &p_name);
+
 protected:
     void documentChanged(int p_from, int p_charsRemoved, int p_charsAdded) Q_DECL_OVERRIDE;
 
+private slots:
+    // Lay out a chunk of estimated blocks.
+    void refineEstimatedBlocks();
+
 private:
     // Denote the start and end position of a marker line.
     struct Marker
@@ -108,37 +127,19 @@ private:
 
         void reset()
         {
-            m_offset = -1;
             m_rect = QRectF();
+            m_estimated = false;
             m_markers.clear();
             m_images.clear();
         }
 
-        bool hasOffset() const
-        {
-            return m_offset > -1 && !m_rect.isNull();
-        }
-
-        qreal top() const
-        {
-            Q_ASSERT(hasOffset());
-            return m_offset;
-        }
-
-        qreal bottom() const
-        {
-            Q_ASSERT(hasOffset());
-            return m_offset + m_rect.height();
-        }
-
-        // Y offset of this block.
-        // -1 for invalid.
-        qreal m_offset;
-
         // The bounding rect of this block, including the margins.
         // Null for invalid.
         QRectF m_rect;
 
+        // Whether m_rect is estimated without laying out the block.
+        bool m_estimated;
+
         // Markers to draw for this block.
         // Y is the offset within this block.
         QVector<Marker> m_markers;
@@ -150,6 +151,23 @@ private:
 
     void layoutBlock(const QTextBlock &p_block);
 
+    // Give @p_block an estimated rect from its length and the font metrics
+    // without laying out it.
+    void estimateBlock(const QTextBlock &p_block);
+
+    // Update metrics used to estimate blocks.
+    void updateEstimationMetrics();
+
+    // Whether lay out @p_count blocks lazily.
+    bool isLazyLayout(int p_count) const;
+
+    // Lay out estimated blocks within [@p_first, @p_last].
+    // Return true if the height of any block changes.
+    bool layoutEstimatedBlocks(int p_first, int p_last);
+
+    // Lay out block @p_blockNumber if it is estimated.
+    void ensureBlockLayout(int p_blockNumber) const;
+
     // Returns the total height of this block after layouting lines and inline
     // images.
     qreal layoutLines(const QTextBlock &p_block,
@@ -183,42 +201,30 @@ private:
                                       QVector<QPair<qreal, qreal>> &p_imageRange);
 
     // Clear the layout of @p_block.
-    // Also clear all the offset behind this block.
     void clearBlockLayout(QTextBlock &p_block);
 
-    // Clear the offset of all the blocks from @p_blockNumber.
-    void clearOffsetFrom(int p_blockNumber);
-
-    // Fill the offset filed from @p_blockNumber + 1.
-    void fillOffsetFrom(int p_blockNumber);
-
     // Update block count to @p_count due to document change.
-    // Maintain m_blocks.
-    // @p_changeStartBlock is the block number of the start block in this change.
+    // Maintain m_blocks and m_heightTree by inserting or removing blocks after
+    // @p_changeStartBlock, which is the block number of the start block in
+    // this change, so blocks behind the change keep their layout.
     void updateBlockCount(int p_count, int p_changeStartBlock);
 
-    bool validateBlocks() const;
-
     void finishBlockLayout(const QTextBlock &p_block,
                            const QVector<Marker> &p_markers,
                            const QVector<ImagePaintInfo> &p_images);
 
-    int previousValidBlockNumber(int p_number) const;
-
-    int nextValidBlockNumber(int p_number) const;
+    // Y offset of block @p_blockNumber.
+    qreal blockTop(int p_blockNumber) const;
 
-    // Update block count and m_blocks size.
+    // Update document size from m_heightTree.
     void updateDocumentSize();
 
     QVector<QTextLayout::FormatRange> formatRangeFromSelection(const QTextBlock &p_block,
                                                                const QVector<Selection> &p_selections) const;
 
-    // Get the block range [first, last] by rect @p_rect.
+    // Get the block range [first, last] by rect @p_rect via m_heightTree.
     // @p_rect: a clip region in document coordinates. If null, returns all the blocks.
     // Return [-1, -1] if no valid block range found.
-    void blockRangeFromRect(const QRectF &p_rect, int &p_first, int &p_last) const;
-
-    // Binary search to get the block range [first, last] by @p_rect.
     void blockRangeFromRectBS(const QRectF &p_rect, int &p_first, int &p_last) const;
 
     // Return a rect from the layout.
@@ -228,10 +234,6 @@ private:
     QRectF blockRectFromTextLayout(const QTextBlock &p_block,
                                    ImagePaintInfo *p_image = NULL);
 
-    // Update document size when only block @p_blockNumber is changed and the height
-    // remain the same.
-    void updateDocumentSizeWithOneBlockChanged(int p_blockNumber);
-
     void adjustImagePaddingAndSize(const VPreviewedImageInfo *p_info,
                                    int p_maximumWidth,
                                    int &p_padding,
@@ -259,9 +261,6 @@ private:
     // Maximum width of the contents.
     qreal m_width;
 
-    // The block number of the block which contains the m_width.
-    int m_maximumWidthBlockNumber;
-
     // Height of all the document (all the blocks).
     qreal m_height;
 
@@ -279,6 +278,9 @@ private:
 
     QVector<BlockInfo> m_blocks;
 
+    // Heights and widths of m_blocks to get the offset of blocks.
+    VBlockHeightTree m_heightTree;
+
     VImageResourceManager2 *m_imageMgr;
 
     bool m_blockImageEnabled;
@@ -305,8 +307,33 @@ private:
 
     // The block containing the cursor.
     int m_cursorLineBlockNumber;
+
+    // Lay out lazily if more than this number of blocks need to be laid out.
+    // 0 to disable.
+    int m_lazyLayoutThreshold;
+
+    // Number of blocks with estimated rect.
+    int m_nrEstimatedBlocks;
+
+    // Next block to lay out in idle time.
+    int m_refineBlockNumber;
+
+    // The first block of last painting.
+    int m_firstPaintedBlockNumber;
+
+    // Average char width and line height to estimate blocks.
+    qreal m_estimatedCharWidth;
+
+    qreal m_estimatedLineHeight;
+
+    QTimer *m_refineTimer;
 };
 
+inline qreal VTextDocumentLayout::blockTop(int p_blockNumber) const
+{
+    return m_heightTree.offset(p_blockNumber);
+}
+
 inline qreal VTextDocumentLayout::getLineLeading() const
 {
     return m_lineLeading;
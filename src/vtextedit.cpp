@@ -68,6 +68,18 @@ void VTextEdit::init()
                 }
             });
 
+    // Do not touch the resources while painting.
+    connect(docLayout, &VTextDocumentLayout::imageMissing,
+            this, &VTextEdit::imageMissing,
+            Qt::QueuedConnection);
+
+    // Keep the contents still when estimated blocks above are laid out.
+    connect(docLayout, &VTextDocumentLayout::heightAboveViewChanged,
+            this, [this](qreal p_delta) {
+                QScrollBar *vbar = verticalScrollBar();
+                vbar->setValue(vbar->value() + qRound(p_delta));
+            });
+
     m_lineNumberArea = new VLineNumberArea(this,
                                            document(),
                                            fontMetrics().width(QLatin1Char('8')),
@@ -282,6 +294,14 @@ QTextBlock VTextEdit::firstVisibleBlock() const
     return document()->findBlockByNumber(blockNumber);
 }
 
+QTextBlock VTextEdit::lastVisibleBlock() const
+{
+    VTextDocumentLayout *layout = getLayout();
+    Q_ASSERT(layout);
+    int blockNumber = layout->findBlockByPosition(QPointF(0, -contentOffsetY() + viewport()->height()));
+    return document()->findBlockByNumber(blockNumber);
+}
+
 int VTextEdit::contentOffsetY() const
 {
     QScrollBar *sb = verticalScrollBar();
@@ -307,12 +327,7 @@ bool VTextEdit::containsImage(const QString &p_imageName) const
 
 QSize VTextEdit::imageSize(const QString &p_imageName) const
 {
-    const QPixmap *img = m_imageMgr->findImage(p_imageName);
-    if (img) {
-        return img->size();
-    }
-
-    return QSize();
+    return m_imageMgr->imageSize(p_imageName);
 }
 
 void VTextEdit::addImage(const QString &p_imageName, const QPixmap &p_image)
@@ -322,6 +337,13 @@ void VTextEdit::addImage(const QString &p_imageName, const QPixmap &p_image)
     }
 }
 
+void VTextEdit::addImage(const QString &p_imageName, const QString &p_key, const QSize &p_size)
+{
+    if (m_blockImageEnabled) {
+        m_imageMgr->addImage(p_imageName, p_key, p_size);
+    }
+}
+
 void VTextEdit::removeImage(const QString &p_imageName)
 {
     m_imageMgr->removeImage(p_imageName);
@@ -352,6 +374,11 @@ void VTextEdit::setImageLineColor(const QColor &p_color)
     getLayout()->setImageLineColor(p_color);
 }
 
+void VTextEdit::setLazyLayoutThreshold(int p_count)
+{
+    getLayout()->setLazyLayoutThreshold(p_count);
+}
+
 void VTextEdit::setCursorBlockMode(CursorBlock p_mode)
 {
     VTextDocumentLayout *layout = getLayout();
@@ -35,6 +35,8 @@ public:
 
     QTextBlock firstVisibleBlock() const;
 
+    QTextBlock lastVisibleBlock() const;
+
     void clearBlockImages();
 
     // Whether the resoruce manager contains image of name @p_imageName.
@@ -46,6 +48,9 @@ public:
     // Add an image to the resources.
     void addImage(const QString &p_imageName, const QPixmap &p_image);
 
+    // Add an image held by the shared preview image cache with key @p_key.
+    void addImage(const QString &p_imageName, const QString &p_key, const QSize &p_size);
+
     // Remove an image from the resources.
     void removeImage(const QString &p_imageName);
 
@@ -55,6 +60,9 @@ public:
 
     void setImageLineColor(const QColor &p_color);
 
+    // Lay out lazily if more than @p_count blocks need to be laid out at once.
+    void setLazyLayoutThreshold(int p_count);
+
     void relayout(const QSet<int> &p_blocks);
 
     void setCursorBlockMode(CursorBlock p_mode);
@@ -65,6 +73,11 @@ public:
 
     void relayout();
 
+signals:
+    // Emit when image @p_imageName in the resources could not be painted
+    // since it has been evicted from the shared preview image cache.
+    void imageMissing(const QString &p_imageName);
+
 protected:
     void resizeEvent(QResizeEvent *p_event) Q_DECL_OVERRIDE;
 
@@ -0,0 +1,167 @@
+#include "vtextreplacer.h"
+
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QDebug>
+
+#include "vconstants.h"
+#include "utils/veditutils.h"
+
+VTextReplacer::VTextReplacer(const QString &p_text,
+                             uint p_options,
+                             const QString &p_replaceText)
+    : m_text(p_text),
+      m_options(p_options),
+      m_replaceText(p_replaceText),
+      m_expandCaptures(false),
+      m_firstMatchOnly(false)
+{
+    if (m_options & FindOption::RegularExpression) {
+        m_exp = QRegExp(m_text,
+                        (m_options & FindOption::CaseSensitive) ? Qt::CaseSensitive
+                                                               : Qt::CaseInsensitive);
+    }
+}
+
+bool VTextReplacer::isValid() const
+{
+    if (m_text.isEmpty()) {
+        return false;
+    }
+
+    if (m_options & FindOption::RegularExpression) {
+        return m_exp.isValid();
+    }
+
+    return true;
+}
+
+QString VTextReplacer::errorString() const
+{
+    if (m_text.isEmpty()) {
+        return QObject::tr("Empty pattern");
+    }
+
+    if ((m_options & FindOption::RegularExpression) && !m_exp.isValid()) {
+        return QObject::tr("Invalid regular expression: %1").arg(m_exp.errorString());
+    }
+
+    return QString();
+}
+
+int VTextReplacer::replace(QTextDocument *p_document, int p_firstBlock, int p_lastBlock)
+{
+    if (!isValid()) {
+        return 0;
+    }
+
+    int maxBlockNumber = p_document->blockCount() - 1;
+    if (p_lastBlock < 0 || p_lastBlock > maxBlockNumber) {
+        p_lastBlock = maxBlockNumber;
+    }
+
+    // Find all the matches before changing anything.
+    QVector<Match> matches;
+    QTextBlock block = p_document->findBlockByNumber(qMax(p_firstBlock, 0));
+    while (block.isValid() && block.blockNumber() <= p_lastBlock) {
+        matchBlock(block, matches);
+        block = block.next();
+    }
+
+    if (matches.isEmpty()) {
+        return 0;
+    }
+
+    // Apply from the end so that positions of the previous matches still hold.
+    bool expand = m_expandCaptures && (m_options & FindOption::RegularExpression);
+    QTextCursor cursor(p_document);
+    cursor.beginEditBlock();
+    for (int i = matches.size() - 1; i >= 0; --i) {
+        const Match &match = matches[i];
+        cursor.setPosition(match.m_position);
+        cursor.setPosition(match.m_position + match.m_length, QTextCursor::KeepAnchor);
+        cursor.insertText(expand ? match.m_replaceText : m_replaceText);
+    }
+
+    cursor.endEditBlock();
+
+    qDebug() << "replaced" << matches.size() << "matches of" << m_text;
+    return matches.size();
+}
+
+void VTextReplacer::matchBlock(const QTextBlock &p_block, QVector<Match> &p_matches) const
+{
+    const QString text = p_block.text();
+    const int base = p_block.position();
+    bool wholeWord = m_options & FindOption::WholeWordOnly;
+    if (m_options & FindOption::RegularExpression) {
+        int pos = 0;
+        while (pos <= text.size()) {
+            int idx = m_exp.indexIn(text, pos);
+            if (idx == -1) {
+                break;
+            }
+
+            int len = m_exp.matchedLength();
+            if (!wholeWord || (len > 0 && VEditUtils::isWholeWord(text, idx, len))) {
+                p_matches.append(Match(base + idx, len));
+                if (m_expandCaptures) {
+                    p_matches.last().m_replaceText = expandCaptures();
+                }
+
+                if (m_firstMatchOnly) {
+                    break;
+                }
+            }
+
+            // Step over empty match.
+            pos = len > 0 ? idx + len : idx + 1;
+        }
+    } else {
+        Qt::CaseSensitivity cs = (m_options & FindOption::CaseSensitive) ? Qt::CaseSensitive
+                                                                         : Qt::CaseInsensitive;
+        int len = m_text.size();
+        int idx = text.indexOf(m_text, 0, cs);
+        while (idx != -1) {
+            if (!wholeWord || VEditUtils::isWholeWord(text, idx, len)) {
+                p_matches.append(Match(base + idx, len));
+                if (m_firstMatchOnly) {
+                    break;
+                }
+
+                idx = text.indexOf(m_text, idx + len, cs);
+            } else {
+                idx = text.indexOf(m_text, idx + 1, cs);
+            }
+        }
+    }
+}
+
+QString VTextReplacer::expandCaptures() const
+{
+    QString result;
+    result.reserve(m_replaceText.size());
+    for (int i = 0; i < m_replaceText.size(); ++i) {
+        QChar ch = m_replaceText[i];
+        if (ch == '&') {
+            result.append(m_exp.cap(0));
+        } else if (ch == '\\' && i + 1 < m_replaceText.size()) {
+            QChar next = m_replaceText[++i];
+            if (next.isDigit()) {
+                result.append(m_exp.cap(next.digitValue()));
+            } else if (next == 'n' || next == 'r') {
+                result.append('\n');
+            } else if (next == 't') {
+                result.append('\t');
+            } else {
+                // \\, \& and so on.
+                result.append(next);
+            }
+        } else {
+            result.append(ch);
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,89 @@
+#ifndef VTEXTREPLACER_H
+#define VTEXTREPLACER_H
+
+#include <QString>
+#include <QVector>
+#include <QRegExp>
+
+class QTextDocument;
+class QTextBlock;
+
+// Replace all the matches of a pattern in a document in one pass.
+// All the matches are computed against the text before any change and then
+// applied within one edit block, so the document emits one contentsChange,
+// which means one undo step, one relayout and one re-highlight.
+// Regular expressions are QRegExp, the same as finding and highlighting.
+class VTextReplacer
+{
+public:
+    // @p_options: FindOption.
+    VTextReplacer(const QString &p_text, uint p_options, const QString &p_replaceText);
+
+    // Expand & and \0 to \9 in the replace text to the captured texts, \n and
+    // \r to a new line, as Vim does. Only for RegularExpression.
+    void setExpandCaptures(bool p_expand);
+
+    // Replace only the first match in each block.
+    void setFirstMatchOnly(bool p_firstOnly);
+
+    bool isValid() const;
+
+    QString errorString() const;
+
+    // Replace all the matches within blocks [@p_firstBlock, @p_lastBlock] of
+    // @p_document. -1 for the last block.
+    // Returns the number of replacements.
+    int replace(QTextDocument *p_document, int p_firstBlock = 0, int p_lastBlock = -1);
+
+private:
+    struct Match
+    {
+        Match()
+            : m_position(0), m_length(0)
+        {
+        }
+
+        Match(int p_position, int p_length)
+            : m_position(p_position), m_length(p_length)
+        {
+        }
+
+        // Position in the document.
+        int m_position;
+
+        int m_length;
+
+        // Empty if m_replaceText is used.
+        QString m_replaceText;
+    };
+
+    // Append matches of @p_block to @p_matches.
+    void matchBlock(const QTextBlock &p_block, QVector<Match> &p_matches) const;
+
+    // Expand the replace text with the captured texts of the last match of m_exp.
+    QString expandCaptures() const;
+
+    QString m_text;
+
+    uint m_options;
+
+    QString m_replaceText;
+
+    QRegExp m_exp;
+
+    bool m_expandCaptures;
+
+    bool m_firstMatchOnly;
+};
+
+inline void VTextReplacer::setExpandCaptures(bool p_expand)
+{
+    m_expandCaptures = p_expand;
+}
+
+inline void VTextReplacer::setFirstMatchOnly(bool p_firstOnly)
+{
+    m_firstMatchOnly = p_firstOnly;
+}
+
+#endif // VTEXTREPLACER_H